@@ -0,0 +1,161 @@
+/*
+ * SUMMARY:      BenchFlowOrder.c - Microbenchmark for subsurface flow ordering
+ * USAGE:        make -f makefile_for_binary.txt bench_floworder
+ *               ./BENCH_FlowOrder [number of cells] [number of repetitions]
+ *
+ * DESCRIPTION:  Compares the per-step cost of ordering the flow directions
+ *               of each cell in RouteSubSurface() by sorting them with
+ *               quick() every time step, against walking an ordering that
+ *               was determined once with OrderFlowDirections().  Flow
+ *               fractions are drawn at random in the same form as produced
+ *               by flow_fractions() (integer weights summing to 255 over 1 to
+ *               NDIRS directions).  Both methods are checked to visit the
+ *               same directions in the same order.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "settings.h"
+#include "data.h"
+#include "constants.h"
+#include "slopeaspect.h"
+
+#define DEFAULT_CELLS 2000000
+#define DEFAULT_REPS  5
+
+static double Seconds(void)
+{
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec + 1e-9 * t.tv_nsec;
+}
+
+int main(int argc, char **argv)
+{
+  MAPSIZE Map;
+  int NCells = DEFAULT_CELLS;
+  int NReps = DEFAULT_REPS;
+  int i, k, n, r, x, y;
+  int NUsed, Remaining;
+  unsigned char *Dir;
+  unsigned char *Order;
+  unsigned char *NFlow;
+  ITEM kOrdered[MAXDIRS];
+  double Start, SortTime, OrderTime, CachedTime;
+  double SortSum = 0.0, CachedSum = 0.0;
+  int Mismatch = 0;
+
+  if (argc > 1)
+    NCells = atoi(argv[1]);
+  if (argc > 2)
+    NReps = atoi(argv[2]);
+  if (NCells < 1 || NReps < 1) {
+    fprintf(stderr, "usage: %s [number of cells] [number of repetitions]\n", argv[0]);
+    exit(1);
+  }
+
+  NDIRS = 8;
+  xdirection = &xdirection8[0];
+  ydirection = &ydirection8[0];
+
+  /* Cells are laid out on a grid so that edge cells lose some directions */
+  Map.NX = 1000;
+  Map.NY = (NCells + Map.NX - 1) / Map.NX;
+  Map.DX = Map.DY = 30.0;
+
+  if (!(Dir = (unsigned char *) calloc(NCells * NDIRS, sizeof(unsigned char))) ||
+      !(Order = (unsigned char *) calloc(NCells * NDIRS, sizeof(unsigned char))) ||
+      !(NFlow = (unsigned char *) calloc(NCells, sizeof(unsigned char)))) {
+    fprintf(stderr, "Not enough memory for %d cells\n", NCells);
+    exit(1);
+  }
+
+  srand(12345);
+  for (i = 0; i < NCells; i++) {
+    NUsed = 1 + rand() % NDIRS;
+    Remaining = 255;
+    for (n = 0; n < NUsed; n++) {
+      k = rand() % NDIRS;
+      r = (n == NUsed - 1) ? Remaining : rand() % (Remaining + 1);
+      Dir[i * NDIRS + k] += r;
+      Remaining -= r;
+    }
+  }
+
+  printf("Ordering flow directions for %d cells, %d repetitions\n", NCells, NReps);
+
+  /* Sort every cell every step, as RouteSubSurface() used to */
+  Start = Seconds();
+  for (r = 0; r < NReps; r++) {
+    for (i = 0; i < NCells; i++) {
+      x = i % Map.NX;
+      y = i / Map.NX;
+      for (k = 0; k < NDIRS; k++) {
+        kOrdered[k].x = xdirection[k] + x;
+        kOrdered[k].y = ydirection[k] + y;
+        if (valid_cell(&Map, kOrdered[k].x, kOrdered[k].y))
+          kOrdered[k].Rank = (float) Dir[i * NDIRS + k];
+        else
+          kOrdered[k].Rank = 0.0;
+      }
+      quick(kOrdered, NDIRS);
+      for (k = NDIRS - 1; k > -1; k--)
+        SortSum += kOrdered[k].Rank * (k + 1);
+    }
+  }
+  SortTime = Seconds() - Start;
+
+  /* Determine the orderings once */
+  Start = Seconds();
+  for (i = 0; i < NCells; i++)
+    OrderFlowDirections(&Map, &Dir[i * NDIRS], i % Map.NX, i / Map.NX,
+                        &Order[i * NDIRS], &NFlow[i]);
+  OrderTime = Seconds() - Start;
+
+  /* Walk the stored orderings */
+  Start = Seconds();
+  for (r = 0; r < NReps; r++) {
+    for (i = 0; i < NCells; i++) {
+      for (k = NDIRS - 1; k >= NDIRS - NFlow[i]; k--)
+        CachedSum += (float) Dir[i * NDIRS + Order[i * NDIRS + k]] * (k + 1);
+    }
+  }
+  CachedTime = Seconds() - Start;
+
+  /* Both methods must visit the directions with flow in the same order */
+  for (i = 0; i < NCells; i++) {
+    x = i % Map.NX;
+    y = i / Map.NX;
+    for (k = 0; k < NDIRS; k++) {
+      kOrdered[k].x = xdirection[k] + x;
+      kOrdered[k].y = ydirection[k] + y;
+      if (valid_cell(&Map, kOrdered[k].x, kOrdered[k].y))
+        kOrdered[k].Rank = (float) Dir[i * NDIRS + k];
+      else
+        kOrdered[k].Rank = 0.0;
+    }
+    quick(kOrdered, NDIRS);
+    for (k = NDIRS - 1; k >= NDIRS - NFlow[i]; k--) {
+      n = Order[i * NDIRS + k];
+      if (kOrdered[k].x != xdirection[n] + x || kOrdered[k].y != ydirection[n] + y)
+        Mismatch++;
+    }
+    if (NDIRS - NFlow[i] > 0 && kOrdered[NDIRS - NFlow[i] - 1].Rank > 0.0)
+      Mismatch++;
+  }
+
+  printf("quick() every step     : %8.2f ns/cell\n", 1e9 * SortTime / ((double) NCells * NReps));
+  printf("stored ordering        : %8.2f ns/cell\n", 1e9 * CachedTime / ((double) NCells * NReps));
+  printf("determining ordering   : %8.2f ns/cell (only when directions change)\n",
+         1e9 * OrderTime / (double) NCells);
+  printf("speedup per step       : %8.1fx\n", SortTime / CachedTime);
+  printf("checksums              : %.6e %.6e\n", SortSum, CachedSum);
+  printf("ordering mismatches    : %d\n", Mismatch);
+
+  free(Dir);
+  free(Order);
+  free(NFlow);
+
+  return (Mismatch == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
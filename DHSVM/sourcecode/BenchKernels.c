@@ -0,0 +1,695 @@
+/*
+ * SUMMARY:      BenchKernels.c - Microbenchmark for the physics kernels
+ * USAGE:        make -f makefile_for_binary.txt bench_kernels
+ *               ./BENCH_Kernels [-n samples] [-t seconds] [kernel ...]
+ *
+ * DESCRIPTION:  Times the per-pixel kernels that dominate a model time step
+ *               in isolation, so that changes to them can be evaluated
+ *               without running a basin.  Each kernel is called on a fixed
+ *               set of input samples (default 4096) for at least the given
+ *               number of seconds (default 0.5), and the cost is reported
+ *               in ns/call and calls/s.  When kernel names are given, only
+ *               the kernels whose name contains one of them are run.
+ *
+ *               The samples are drawn with a fixed seed from the ranges met
+ *               in a mountain basin during the spring: a three-layer soil
+ *               column with a water table anywhere between the surface and
+ *               the bottom of the soil, a snow pack from a few mm to more
+ *               than a meter, air temperatures from -15 to +10 C, and so on.
+ *               Snow samples are split into a melting and a cold set, since
+ *               only the latter needs the iterative solution of the surface
+ *               energy balance in RootBrent().  Kernels that change their
+ *               inputs work on a copy of the sample that is restored before
+ *               every call; the copy is included in the timing.
+ *
+ *               channel_route_segment() is local to channel.c and is timed
+ *               through channel_route_network() on a branching network of
+ *               channel segments; that time includes updating the routing
+ *               parameters and is reported per segment.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "settings.h"
+#include "data.h"
+#include "constants.h"
+#include "functions.h"
+#include "massenergy.h"
+#include "snow.h"
+#include "brent.h"
+#include "soilmoisture.h"
+#include "channel.h"
+
+#define DEFAULT_SAMPLES  4096
+#define DEFAULT_SECONDS  0.5
+#define NLAYERS          3         /* root zone layers in each soil column */
+#define NSTATIONS        4         /* met stations for MakeLocalMetData() */
+#define DT               10800     /* model time step (s) */
+#define DX               30.0
+
+typedef struct {
+  float Depth;                  /* total soil depth (m) */
+  float RootDepth[NLAYERS];
+  float Porosity[NLAYERS + 1];
+  float FCap[NLAYERS + 1];
+  float WP[NLAYERS];
+  float Ks[NLAYERS];
+  float PoreDist[NLAYERS];
+  float Adjust[NLAYERS + 1];
+  float PercArea[NLAYERS];
+  float Moist[NLAYERS + 1];
+  float Temp[NLAYERS];
+  float Perc[NLAYERS];
+  float TableDepth;
+  float KsLat;
+  float KsExp;
+  float DepthThresh;
+  float SatFlow;                /* net saturated flow into the column (m) */
+  float Infiltration;           /* m */
+  float CosSlope, SinSlope;
+} COLUMN;
+
+typedef struct {
+  float Ra;
+  float AirDens;
+  float Eact;
+  float Lv;
+  float NetShort;
+  float LongIn;
+  float Press;
+  float Rain;
+  float Snow;
+  float Tair;
+  float Vpd;
+  float Wind;
+  float PackWater;
+  float SurfWater;
+  float Swq;
+  float TPack;
+  float TSurf;
+} SNOWSAMPLE;
+
+typedef struct {
+  PIXMET Met;
+  float NetRad;
+  float Rp;
+  float Ra;
+  float Int;
+  float LAI[2];
+  float Fract[2];
+  float MaxInt[2];
+} ETSAMPLE;
+
+typedef struct {
+  MET Data[NSTATIONS];
+  uchar Weights[NSTATIONS];
+  float Elev;
+  SNOWPIX Snow;
+} METSAMPLE;
+
+typedef struct {
+  const char *Name;
+  void (*Kernel) (int N);
+  int PerSegment;               /* TRUE if timed per channel segment */
+} KERNEL;
+
+static int NSamples = DEFAULT_SAMPLES;
+static COLUMN *Column;
+static SNOWSAMPLE *WarmSnow;
+static SNOWSAMPLE *ColdSnow;
+static ETSAMPLE *ETSample;
+static METSAMPLE *MetSample;
+static Channel *Network;
+static int NSegments;
+static double Sink = 0.0;       /* keeps the results of the calls alive */
+
+char errorstr[BUFSIZ + 1] = "";    /* defined in MainDHSVM.c for the model */
+
+static OPTIONSTRUCT Options;
+static VEGTABLE VType;
+static SOILTABLE SType;
+static METLOCATION Stat[NSTATIONS];
+
+/*****************************************************************************
+  Utilities
+*****************************************************************************/
+static double Seconds(void)
+{
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec + 1e-9 * t.tv_nsec;
+}
+
+static unsigned int Seed = 12345;
+
+/* Uniform deviate in [Min, Max) */
+static float Uniform(float Min, float Max)
+{
+  Seed = Seed * 1103515245u + 12345u;
+  return Min + (Max - Min) * ((Seed >> 8) & 0xffffff) / (float) 0x1000000;
+}
+
+static void *Alloc(size_t N, size_t Size)
+{
+  void *p;
+
+  if (!(p = calloc(N, Size))) {
+    fprintf(stderr, "Not enough memory for %lu samples\n", (unsigned long) N);
+    exit(EXIT_FAILURE);
+  }
+  return p;
+}
+
+/*****************************************************************************
+  Input samples
+*****************************************************************************/
+static void MakeColumns(void)
+{
+  COLUMN *c;
+  float Bottom;
+  int i, k;
+
+  Column = (COLUMN *) Alloc(NSamples, sizeof(COLUMN));
+  for (i = 0; i < NSamples; i++) {
+    c = &Column[i];
+    c->RootDepth[0] = 0.10;
+    c->RootDepth[1] = 0.25;
+    c->RootDepth[2] = 0.40;
+    c->Depth = Uniform(0.9, 3.0);
+    for (k = 0; k <= NLAYERS; k++) {
+      c->Porosity[k] = Uniform(0.38, 0.48);
+      c->FCap[k] = Uniform(0.15, 0.30);
+      c->Adjust[k] = (Uniform(0.0, 1.0) < 0.1) ? Uniform(0.6, 1.0) : 1.0;
+    }
+    for (k = 0; k < NLAYERS; k++) {
+      c->WP[k] = c->FCap[k] * 0.5;
+      c->Ks[k] = Uniform(1e-6, 1e-4);
+      c->PoreDist[k] = Uniform(0.2, 0.4);
+      c->PercArea[k] = 1.0;
+      c->Temp[k] = Uniform(0.0, 8.0);
+      c->Perc[k] = Uniform(0.0, 1e-3);
+    }
+    c->TableDepth = Uniform(0.0, c->Depth);
+    /* saturated below the water table, between field capacity and
+       saturation above it */
+    for (k = 0, Bottom = 0.0; k <= NLAYERS; k++) {
+      Bottom += (k < NLAYERS) ? c->RootDepth[k] : c->Depth - Bottom;
+      if (Bottom > c->TableDepth)
+        c->Moist[k] = c->Porosity[k];
+      else
+        c->Moist[k] = Uniform(c->FCap[k], c->Porosity[k]);
+    }
+    c->KsLat = Uniform(1e-4, 2e-3);
+    c->KsExp = Uniform(0.0, 4.0);
+    c->DepthThresh = Uniform(0.5, 2.5);
+    c->SatFlow = Uniform(-0.02, 0.02);
+    c->Infiltration = (Uniform(0.0, 1.0) < 0.5) ? Uniform(0.0, 0.01) : 0.0;
+    c->SinSlope = Uniform(0.0, 0.6);
+    c->CosSlope = sqrt(1.0 - c->SinSlope * c->SinSlope);
+  }
+}
+
+/* Atmospheric conditions for air temperature Tair and relative humidity Rh */
+static void MakeAir(float Tair, float Rh, PIXMET *Met)
+{
+  Met->Tair = Tair;
+  Met->Rh = Rh;
+  Met->Press = Uniform(80000.0, 95000.0);
+  Met->Lv = 2501000 - 2361 * Tair;
+  Met->Gamma = CP * Met->Press / (EPS * Met->Lv);
+  Met->Es = SatVaporPressure(Tair);
+  Met->Slope = 4098.0 * Met->Es / ((237.3 + Tair) * (237.3 + Tair));
+  Met->Eact = Met->Es * Rh / 100.0;
+  Met->Vpd = Met->Es - Met->Eact;
+  Met->AirDens = 0.003486 * Met->Press / (275 + Tair);
+}
+
+static void MakeSnow(SNOWSAMPLE *s, int Cold)
+{
+  PIXMET Met;
+
+  MakeAir(Cold ? Uniform(-15.0, -2.0) : Uniform(0.5, 10.0), Uniform(40.0, 100.0),
+          &Met);
+  s->Tair = Met.Tair;
+  s->AirDens = Met.AirDens;
+  s->Eact = Met.Eact;
+  s->Lv = Met.Lv;
+  s->Press = Met.Press;
+  s->Vpd = Met.Vpd;
+  s->Wind = Uniform(0.5, 6.0);
+  s->Ra = Uniform(50.0, 300.0);
+  s->NetShort = Cold ? Uniform(0.0, 60.0) : Uniform(0.0, 300.0);
+  s->LongIn = Uniform(200.0, 320.0);
+  s->Rain = (!Cold && Uniform(0.0, 1.0) < 0.3) ? Uniform(0.0, 0.005) : 0.0;
+  s->Snow = (Cold && Uniform(0.0, 1.0) < 0.3) ? Uniform(0.0, 0.01) : 0.0;
+  s->Swq = Uniform(0.005, 1.2);
+  s->TPack = Cold ? Uniform(-8.0, 0.0) : 0.0;
+  s->TSurf = Cold ? Uniform(-12.0, 0.0) : 0.0;
+  s->PackWater = Cold ? 0.0 : Uniform(0.0, 0.01);
+  s->SurfWater = Cold ? 0.0 : Uniform(0.0, 0.003);
+}
+
+static void MakeSnowSamples(void)
+{
+  int i;
+
+  WarmSnow = (SNOWSAMPLE *) Alloc(NSamples, sizeof(SNOWSAMPLE));
+  ColdSnow = (SNOWSAMPLE *) Alloc(NSamples, sizeof(SNOWSAMPLE));
+  for (i = 0; i < NSamples; i++) {
+    MakeSnow(&WarmSnow[i], FALSE);
+    MakeSnow(&ColdSnow[i], TRUE);
+  }
+}
+
+static void MakeETSamples(void)
+{
+  ETSAMPLE *e;
+  int i, k;
+
+  ETSample = (ETSAMPLE *) Alloc(NSamples, sizeof(ETSAMPLE));
+  for (i = 0; i < NSamples; i++) {
+    e = &ETSample[i];
+    MakeAir(Uniform(-2.0, 25.0), Uniform(20.0, 100.0), &e->Met);
+    e->NetRad = Uniform(-50.0, 500.0);
+    e->Rp = VISFRACT * Uniform(0.0, 900.0);
+    e->Ra = Uniform(5.0, 100.0);
+    for (k = 0; k < 2; k++) {
+      e->LAI[k] = Uniform(0.5, 6.0);
+      e->Fract[k] = Uniform(0.3, 1.0);
+      e->MaxInt[k] = LAI_WATER_MULTIPLIER * e->LAI[k] * e->Fract[k];
+    }
+    e->Int = Uniform(0.0, e->MaxInt[0]);
+  }
+
+  /* a two-layer forest on three soil layers */
+  VType.NVegLayers = 2;
+  VType.NSoilLayers = NLAYERS;
+  VType.RsMin = (float *) Alloc(2, sizeof(float));
+  VType.RsMax = (float *) Alloc(2, sizeof(float));
+  VType.Rpc = (float *) Alloc(2, sizeof(float));
+  VType.VpdThres = (float *) Alloc(2, sizeof(float));
+  VType.MoistThres = (float *) Alloc(2, sizeof(float));
+  VType.RootDepth = (float *) Alloc(NLAYERS, sizeof(float));
+  VType.RootFract = (float **) Alloc(2, sizeof(float *));
+  for (k = 0; k < 2; k++) {
+    VType.RsMin[k] = (k == 0) ? 300.0 : 200.0;
+    VType.RsMax[k] = 5000.0;
+    VType.Rpc[k] = 0.108;
+    VType.VpdThres[k] = 4000.0;
+    VType.MoistThres[k] = 0.33;
+    VType.RootFract[k] = (float *) Alloc(NLAYERS, sizeof(float));
+    VType.RootFract[k][0] = (k == 0) ? 0.20 : 0.40;
+    VType.RootFract[k][1] = (k == 0) ? 0.40 : 0.60;
+    VType.RootFract[k][2] = (k == 0) ? 0.40 : 0.00;
+  }
+  VType.RootDepth[0] = 0.10;
+  VType.RootDepth[1] = 0.25;
+  VType.RootDepth[2] = 0.40;
+}
+
+static void MakeMetSamples(void)
+{
+  METSAMPLE *m;
+  int i, k;
+
+  MetSample = (METSAMPLE *) Alloc(NSamples, sizeof(METSAMPLE));
+  for (k = 0; k < NSTATIONS; k++)
+    Stat[k].Elev = Uniform(500.0, 2000.0);
+  for (i = 0; i < NSamples; i++) {
+    m = &MetSample[i];
+    m->Elev = Uniform(300.0, 2500.0);
+    for (k = 0; k < NSTATIONS; k++) {
+      m->Data[k].Tair = Uniform(-10.0, 15.0);
+      m->Data[k].TempLapse = -0.0065;
+      m->Data[k].Rh = Uniform(30.0, 100.0);
+      m->Data[k].Wind = Uniform(0.5, 8.0);
+      m->Data[k].Sin = Uniform(0.0, 900.0);
+      m->Data[k].SinBeamObs = 0.7 * m->Data[k].Sin;
+      m->Data[k].SinDiffuseObs = 0.3 * m->Data[k].Sin;
+      m->Data[k].Lin = Uniform(200.0, 350.0);
+      m->Data[k].Precip = (Uniform(0.0, 1.0) < 0.3) ? Uniform(0.0, 0.01) : 0.0;
+      m->Weights[k] = (uchar) Uniform(1.0, 255.0);
+    }
+    m->Snow.HasSnow = (Uniform(0.0, 1.0) < 0.5);
+    m->Snow.Swq = m->Snow.HasSnow ? Uniform(0.005, 1.0) : 0.0;
+    m->Snow.TSurf = m->Snow.HasSnow ? Uniform(-5.0, 0.0) : 0.0;
+    m->Snow.LastSnow = Uniform(0.0, 30.0);
+    m->Snow.Ts = 2.0;
+    m->Snow.Tr = -1.0;
+    m->Snow.amax = 0.85;
+    m->Snow.LamdaAcc = 0.92;
+    m->Snow.LamdaMelt = 0.70;
+    m->Snow.AccMin = 0.75;
+    m->Snow.MeltMin = 0.55;
+    m->Snow.AlbedoGround = 0.2;
+  }
+}
+
+/* A branching network: segment s drains to segment s / 2, and is routed
+   after all segments that drain to it */
+static void MakeNetwork(void)
+{
+  static ChannelClass Class = { 1, 3.0, 0.5, 0.04, NULL };
+  Channel *Segment;
+  int Depth, MaxDepth, s;
+
+  NSegments = (NSamples < 65535) ? NSamples : 65535;
+  Segment = (Channel *) Alloc(NSegments + 1, sizeof(Channel));
+  for (MaxDepth = 0; (2 << MaxDepth) <= NSegments; MaxDepth++)
+    ;
+  for (s = 1; s <= NSegments; s++) {
+    for (Depth = 0; (2 << Depth) <= s; Depth++)
+      ;
+    Segment[s].id = s;
+    Segment[s].outid = s / 2;
+    Segment[s].order = MaxDepth - Depth + 1;
+    Segment[s].outlet = (s > 1) ? &Segment[s / 2] : NULL;
+    Segment[s].next = (s < NSegments) ? &Segment[s + 1] : NULL;
+    Segment[s].class2 = &Class;
+    Segment[s].length = Uniform(30.0, 300.0);
+    Segment[s].ground_slope = Segment[s].slope = Uniform(0.001, 0.2);
+    Segment[s].lateral_inflow = Uniform(0.0, 50.0);
+    Segment[s].last_lateral_inflow = Segment[s].lateral_inflow;
+    Segment[s].storage = Segment[s].last_storage = Uniform(0.0, 200.0);
+  }
+  Network = &Segment[1];
+  channel_routing_parameters(Network, DT);
+}
+
+/*****************************************************************************
+  Kernels
+*****************************************************************************/
+static void KernelSnowMeltWarm(int N)
+{
+  SNOWSAMPLE s;
+  float VaporMassFlux, MeltEnergy;
+  int i;
+
+  for (i = 0; i < N; i++) {
+    s = WarmSnow[i];
+    Sink += SnowMelt(0, 0, DT, 2. + Z0_SNOW, 0.f, Z0_SNOW, s.Ra, s.AirDens, s.Eact,
+                     s.Lv, s.NetShort, s.LongIn, s.Press, s.Rain, s.Snow, s.Tair,
+                     s.Vpd, s.Wind, &s.PackWater, &s.SurfWater, &s.Swq,
+                     &VaporMassFlux, &s.TPack, &s.TSurf, &MeltEnergy, 1.0);
+  }
+}
+
+static void KernelSnowMeltCold(int N)
+{
+  SNOWSAMPLE s;
+  float VaporMassFlux, MeltEnergy;
+  int i;
+
+  for (i = 0; i < N; i++) {
+    s = ColdSnow[i];
+    Sink += SnowMelt(0, 0, DT, 2. + Z0_SNOW, 0.f, Z0_SNOW, s.Ra, s.AirDens, s.Eact,
+                     s.Lv, s.NetShort, s.LongIn, s.Press, s.Rain, s.Snow, s.Tair,
+                     s.Vpd, s.Wind, &s.PackWater, &s.SurfWater, &s.Swq,
+                     &VaporMassFlux, &s.TPack, &s.TSurf, &MeltEnergy, 1.0);
+    Sink += s.TSurf;
+  }
+}
+
+/* The surface temperature solution made by SnowMelt() for a cold pack */
+static void KernelRootBrent(int N)
+{
+  SNOWSAMPLE *s;
+  float RefreezeEnergy, VaporMassFlux, SurfaceSwq;
+  int i;
+
+  for (i = 0; i < N; i++) {
+    s = &ColdSnow[i];
+    SurfaceSwq = MIN(MAX_SURFACE_SWE, s->Swq);
+    Sink += RootBrent(0, 0, s->TSurf - DELTAT, 0.0, s->TSurf,
+                      SnowPackEnergyBalance, DT, s->Ra, 2. + Z0_SNOW, 0.0, Z0_SNOW,
+                      s->Wind, s->NetShort, s->LongIn, s->AirDens, s->Lv, s->Tair,
+                      s->Press, s->Vpd, s->Eact, s->Rain, SurfaceSwq, s->SurfWater,
+                      s->TSurf, &RefreezeEnergy, &VaporMassFlux);
+  }
+}
+
+static void KernelTransmissivity(int N)
+{
+  COLUMN *c;
+  int i;
+
+  for (i = 0; i < N; i++) {
+    c = &Column[i];
+    Sink += CalcTransmissivity(c->Depth, c->TableDepth, c->KsLat, c->KsExp,
+                               c->DepthThresh);
+  }
+}
+
+static void KernelAvailableWater(int N)
+{
+  COLUMN *c;
+  int i;
+
+  for (i = 0; i < N; i++) {
+    c = &Column[i];
+    Sink += CalcAvailableWater(NLAYERS, c->Depth, c->RootDepth, c->Porosity, c->FCap,
+                               c->Moist, c->TableDepth, c->Adjust);
+  }
+}
+
+static void KernelWaterTableDepth(int N)
+{
+  COLUMN *c;
+  int i;
+
+  for (i = 0; i < N; i++) {
+    c = &Column[i];
+    Sink += WaterTableDepth(NLAYERS, c->Depth, c->RootDepth, c->Porosity, c->FCap,
+                            c->Adjust, c->Moist);
+  }
+}
+
+static void KernelDistributeSatflow(int N)
+{
+  COLUMN *c;
+  float Moist[NLAYERS + 1];
+  float TableDepth, IExcess;
+  int i;
+
+  for (i = 0; i < N; i++) {
+    c = &Column[i];
+    memcpy(Moist, c->Moist, sizeof(Moist));
+    TableDepth = c->TableDepth;
+    IExcess = 0.0;
+    DistributeSatflow(DT, DX, DX, c->SatFlow, NLAYERS, c->Depth, c->RootDepth,
+                      c->Porosity, c->FCap, c->Adjust, &TableDepth, &IExcess, Moist);
+    Sink += Moist[0] + IExcess;
+  }
+}
+
+static void KernelUnsaturatedFlow(int N)
+{
+  COLUMN *c, *Down;
+  float Moist[NLAYERS + 1];
+  float Perc[NLAYERS];
+  float InterFlowDown[NLAYERS];
+  float TableDepth, IExcess;
+  int i;
+
+  for (i = 0; i < N; i++) {
+    c = &Column[i];
+    Down = &Column[(i + 1) % N];
+    memcpy(Moist, c->Moist, sizeof(Moist));
+    memcpy(Perc, c->Perc, sizeof(Perc));
+    memset(InterFlowDown, 0, sizeof(InterFlowDown));
+    TableDepth = c->TableDepth;
+    IExcess = 0.0;
+    UnsaturatedFlow(&Options, DT, DX, DX, c->Infiltration, NLAYERS, c->Depth,
+                    DX * DX, c->RootDepth, c->Ks, 1.0, c->PoreDist, c->Porosity,
+                    c->FCap, Perc, c->PercArea, c->Adjust, 0, 0.0, &TableDepth,
+                    &IExcess, Moist, STATIC, Down->Moist, Down->Porosity,
+                    InterFlowDown, Down->RootDepth, Down->Adjust, Down->PercArea,
+                    c->CosSlope, c->SinSlope);
+    Sink += TableDepth + IExcess;
+  }
+}
+
+static void KernelCanopyResistance(int N)
+{
+  COLUMN *c;
+  ETSAMPLE *e;
+  int i;
+
+  for (i = 0; i < N; i++) {
+    c = &Column[i];
+    e = &ETSample[i];
+    Sink += CanopyResistance(e->LAI[0], VType.RsMin[0], VType.RsMax[0], VType.Rpc[0],
+                             VType.VpdThres[0], VType.MoistThres[0], c->WP[0],
+                             c->Temp[0], c->Moist[0], e->Met.Vpd, e->Rp);
+  }
+}
+
+static void KernelEvapoTranspiration(int N)
+{
+  COLUMN *c;
+  ETSAMPLE *e;
+  VEGPIX LocalVeg;
+  float Moist[NLAYERS + 1];
+  float LAI[2], Fract[2], MaxInt[2];
+  float EPot[3], EInt[2], EAct[3], ESoil0[NLAYERS], ESoil1[NLAYERS];
+  float *ESoil[2];
+  float Int, ETot;
+  int i;
+
+  memset(&LocalVeg, 0, sizeof(VEGPIX));
+  LocalVeg.LAI = LAI;
+  LocalVeg.Fract = Fract;
+  LocalVeg.MaxInt = MaxInt;
+  ESoil[0] = ESoil0;
+  ESoil[1] = ESoil1;
+  for (i = 0; i < N; i++) {
+    c = &Column[i];
+    e = &ETSample[i];
+    memcpy(Moist, c->Moist, sizeof(Moist));
+    memcpy(LAI, e->LAI, sizeof(LAI));
+    memcpy(Fract, e->Fract, sizeof(Fract));
+    memcpy(MaxInt, e->MaxInt, sizeof(MaxInt));
+    SType.WP = c->WP;
+    Int = e->Int;
+    ETot = 0.0;
+    EvapoTranspiration(0, FALSE, DT, &e->Met, e->NetRad, e->Rp, &VType, &SType,
+                       0.0, Moist, c->Temp, &Int, EPot, EInt, ESoil, EAct, &ETot,
+                       c->Adjust, e->Ra, &LocalVeg);
+    Sink += ETot;
+  }
+}
+
+static void KernelLocalMetData(int N)
+{
+  METSAMPLE *m;
+  PIXMET LocalMet;
+  PIXRAD Rad;
+  PRECIPPIX Precip;
+  VEGPIX Veg;
+  SNOWPIX Snow;
+  CanopyGapStruct *Gap = NULL;
+  int i, k;
+
+  memset(&Veg, 0, sizeof(VEGPIX));
+  memset(&Precip, 0, sizeof(PRECIPPIX));
+  for (i = 0; i < N; i++) {
+    m = &MetSample[i];
+    for (k = 0; k < NSTATIONS; k++)
+      Stat[k].Data = m->Data[k];
+    Snow = m->Snow;
+    LocalMet = MakeLocalMetData(0, 0, NULL, 4, 8, &Options, NSTATIONS, Stat,
+                                m->Weights, m->Elev, &Rad, &Precip, NULL, NULL,
+                                &Snow, &Gap, &Veg, 1.0, 4, 1.0, 255, 0.0, 0.5);
+    Sink += LocalMet.Vpd + Precip.SnowFall;
+  }
+}
+
+static void KernelChannelRoute(int N)
+{
+  Channel *Segment;
+
+  for (Segment = Network; Segment != NULL; Segment = Segment->next) {
+    Segment->inflow = 0.0;
+    Segment->lateral_inflow = Segment->last_lateral_inflow;
+  }
+  channel_route_network(Network, DT);
+  Sink += Network->outflow;
+}
+
+static KERNEL Kernels[] = {
+  { "SnowMelt (melting pack)", KernelSnowMeltWarm, FALSE },
+  { "SnowMelt (cold pack)", KernelSnowMeltCold, FALSE },
+  { "RootBrent/SnowPackEnergyBalance", KernelRootBrent, FALSE },
+  { "CalcTransmissivity", KernelTransmissivity, FALSE },
+  { "CalcAvailableWater", KernelAvailableWater, FALSE },
+  { "DistributeSatflow", KernelDistributeSatflow, FALSE },
+  { "WaterTableDepth", KernelWaterTableDepth, FALSE },
+  { "UnsaturatedFlow", KernelUnsaturatedFlow, FALSE },
+  { "CanopyResistance", KernelCanopyResistance, FALSE },
+  { "EvapoTranspiration", KernelEvapoTranspiration, FALSE },
+  { "channel_route_network (per segment)", KernelChannelRoute, TRUE },
+  { "MakeLocalMetData", KernelLocalMetData, FALSE }
+};
+
+#define NKERNELS ((int) (sizeof(Kernels) / sizeof(KERNEL)))
+
+static int Selected(const char *Name, int NNames, char **Names)
+{
+  int i;
+
+  if (NNames == 0)
+    return TRUE;
+  for (i = 0; i < NNames; i++)
+    if (strstr(Name, Names[i]))
+      return TRUE;
+  return FALSE;
+}
+
+int main(int argc, char **argv)
+{
+  double MinTime = DEFAULT_SECONDS;
+  double Start, Elapsed;
+  long Calls, PerBatch;
+  int c, k;
+
+  while ((c = getopt(argc, argv, "n:t:h")) != -1) {
+    switch (c) {
+    case 'n': NSamples = atoi(optarg); break;
+    case 't': MinTime = atof(optarg); break;
+    default:
+      fprintf(stderr, "usage: %s [-n samples] [-t seconds] [kernel ...]\n", argv[0]);
+      exit(EXIT_FAILURE);
+    }
+  }
+  if (NSamples < 2 || MinTime <= 0.0) {
+    fprintf(stderr, "usage: %s [-n samples] [-t seconds] [kernel ...]\n", argv[0]);
+    exit(EXIT_FAILURE);
+  }
+
+  /* constants as set in the [CONSTANTS] section of the configuration file */
+  Z0_SNOW = 0.01;
+  LIQUID_WATER_CAPACITY = 0.03;
+  MAX_SURFACE_SWE = 0.125;
+  LAI_WATER_MULTIPLIER = 0.0001;
+  MIN_SNOW_RESET_ALBEDO = 0.005;
+  TEMPERATURE_OFFSET = 0.0;
+  LAPSE_RATE_BIAS = 0.0;
+  LAPSE_BIAS_ELEV = 0.0;
+  Options.Shading = FALSE;
+  Options.Prism = FALSE;
+  Options.SnowPattern = FALSE;
+  Options.PrecipSepr = FALSE;
+  Options.Rhoverride = FALSE;
+  Options.UseInterflow = TRUE;
+  InitSatVaporTable();
+
+  MakeColumns();
+  MakeSnowSamples();
+  MakeETSamples();
+  MakeMetSamples();
+  MakeNetwork();
+
+  printf("%d samples, at least %.2f s per kernel\n", NSamples, MinTime);
+  printf("%-38s %12s %10s %14s\n", "Kernel", "Calls", "ns/call", "calls/s");
+  for (k = 0; k < NKERNELS; k++) {
+    if (!Selected(Kernels[k].Name, argc - optind, &argv[optind]))
+      continue;
+    PerBatch = Kernels[k].PerSegment ? NSegments : NSamples;
+    Kernels[k].Kernel(NSamples);        /* warm up */
+    Calls = 0;
+    Start = Seconds();
+    do {
+      Kernels[k].Kernel(NSamples);
+      Calls += PerBatch;
+    } while ((Elapsed = Seconds() - Start) < MinTime);
+    printf("%-38s %12ld %10.1f %14.4g\n", Kernels[k].Name, Calls,
+           1e9 * Elapsed / Calls, Calls / Elapsed);
+  }
+  printf("checksum %.6e\n", Sink);
+
+  return EXIT_SUCCESS;
+}
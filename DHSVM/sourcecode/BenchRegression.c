@@ -0,0 +1,731 @@
+/*
+ * SUMMARY:      BenchRegression.c - Golden-output regression harness
+ * USAGE:        make -f makefile_for_binary.txt bench_regression
+ *               ./BENCH_Regression [-x model] [-g generator] [-o directory]
+ *                                  [-t tolerances] [-a abs] [-r rel] [-b]
+ *                                  [-u] [-s slowdown] [-m growth]
+ *
+ * DESCRIPTION:  Runs the model on a small reference basin and compares every
+ *               output file against a stored set of golden outputs, so that
+ *               changes made for performance can be shown to leave the
+ *               results unchanged, or within a stated tolerance.
+ *
+ *               The reference basin is the 40 x 40 cell, seven day synthetic
+ *               basin written by BENCH_SynthBasin -g -p to
+ *               <directory>/synth_40 (it is generated on the first run).  Its
+ *               outputs include Aggregated.Values, Mass.Balance,
+ *               Mass.Final.Balance, Stream.Flow, Streamflow.Only, pixel
+ *               dumps, binary map dumps and the model state files.
+ *
+ *               The first run, or a run with -u, stores the outputs in
+ *               <directory>/golden and writes a default tolerance file.
+ *               Later runs compare each golden file with the new output:
+ *
+ *               - text files are compared line by line and token by token.
+ *                 Tokens that are numbers in both files are compared with
+ *                 the tolerance for that file and column; all other tokens
+ *                 must be identical.  When the first line of a file has no
+ *                 numbers it is taken as a header and gives the column names.
+ *               - .bin files are compared as arrays of 4-byte floats with the
+ *                 tolerance for that file.
+ *               - with -b all files must be identical byte for byte.
+ *
+ *               Two numbers a and b agree if |a - b| <= abs or
+ *               |a - b| <= rel * max(|a|, |b|).  The tolerance file
+ *               (<directory>/tolerances, or -t) has one rule per line:
+ *
+ *                 <file pattern> <column> <abs> <rel>
+ *
+ *               where the file pattern is a shell wildcard, and the column is
+ *               a column name from the header, a column number (from 1), or
+ *               * for all columns.  The last matching rule applies; -a and
+ *               -r set the tolerance when no rule matches.
+ *
+ *               The wall clock time, CPU time and peak resident memory of
+ *               every run are appended to <directory>/history.csv with the
+ *               outcome.  A run that is more than the slowdown fraction
+ *               (-s, default 0.2) slower, or uses more than the growth
+ *               fraction (-m, default 0.1) more memory than the best earlier
+ *               run is flagged.  The exit status is zero only when all
+ *               outputs agree and nothing was flagged.
+ */
+
+#include <dirent.h>
+#include <errno.h>
+#include <fnmatch.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#define DEFAULT_MODEL     "./DHSVM_X.2.2_InterFlow"
+#define DEFAULT_GENERATOR "./BENCH_SynthBasin"
+#define DEFAULT_OUTDIR    "regression"
+#define DEFAULT_ABS       1e-6
+#define DEFAULT_REL       1e-4
+#define DEFAULT_SLOWDOWN  0.2
+#define DEFAULT_GROWTH    0.1
+#define REFERENCE_SIZE    "40"
+#define REFERENCE_DAYS    "7"
+#define REFERENCE_CASE    "synth_40"
+#define MAXRULES          256
+#define MAXCOLUMNS        1024
+#define NAMESIZE          1024
+
+typedef struct {
+  char File[NAMESIZE];
+  char Column[NAMESIZE];
+  double Abs;
+  double Rel;
+} RULE;
+
+typedef struct {
+  long NValues;                 /* numbers compared */
+  long NFailed;                 /* numbers outside the tolerance */
+  long NText;                   /* other tokens or lines that differ */
+  double MaxAbs;                /* largest absolute difference */
+  double MaxRel;                /* largest relative difference */
+  long Line;                    /* line of the largest difference (0 for .bin) */
+  char Where[NAMESIZE];         /* column of the largest difference */
+  char Message[NAMESIZE];       /* reason the files could not be compared */
+} RESULT;
+
+static RULE Rule[MAXRULES];
+static int NRules = 0;
+static double DefaultAbs = DEFAULT_ABS;
+static double DefaultRel = DEFAULT_REL;
+
+/*****************************************************************************
+  Utilities
+*****************************************************************************/
+static void Fail(const char *Msg, const char *Arg)
+{
+  fprintf(stderr, "BENCH_Regression: %s %s\n", Msg, Arg ? Arg : "");
+  exit(EXIT_FAILURE);
+}
+
+static double Seconds(void)
+{
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec + 1e-9 * t.tv_nsec;
+}
+
+static void MakeDir(const char *Path)
+{
+  if (mkdir(Path, 0755) != 0 && errno != EEXIST)
+    Fail("cannot create directory", Path);
+}
+
+static int IsFile(const char *Dir, const char *Name)
+{
+  char Path[NAMESIZE];
+  struct stat Stat;
+
+  snprintf(Path, sizeof(Path), "%.500s/%.500s", Dir, Name);
+  return (stat(Path, &Stat) == 0 && S_ISREG(Stat.st_mode));
+}
+
+static int HasSuffix(const char *Name, const char *Suffix)
+{
+  size_t n = strlen(Name), m = strlen(Suffix);
+  return (n >= m && strcmp(Name + n - m, Suffix) == 0);
+}
+
+/* Reads a whole file; returns NULL if it cannot be read */
+static char *ReadFile(const char *FileName, long *Size)
+{
+  char *Buffer;
+  FILE *f;
+
+  if (!(f = fopen(FileName, "rb")))
+    return NULL;
+  fseek(f, 0, SEEK_END);
+  *Size = ftell(f);
+  rewind(f);
+  if (!(Buffer = (char *) malloc(*Size + 1)) ||
+      (long) fread(Buffer, 1, *Size, f) != *Size) {
+    fclose(f);
+    free(Buffer);
+    return NULL;
+  }
+  Buffer[*Size] = '\0';
+  fclose(f);
+  return Buffer;
+}
+
+static int CopyFile(const char *From, const char *To)
+{
+  char *Buffer;
+  long Size;
+  FILE *f;
+  int ok;
+
+  if (!(Buffer = ReadFile(From, &Size)))
+    return 0;
+  if (!(f = fopen(To, "wb"))) {
+    free(Buffer);
+    return 0;
+  }
+  ok = ((long) fwrite(Buffer, 1, Size, f) == Size);
+  fclose(f);
+  free(Buffer);
+  return ok;
+}
+
+/* Removes all regular files from Dir */
+static void ClearDir(const char *Dir)
+{
+  char Path[NAMESIZE];
+  struct dirent *Entry;
+  DIR *d;
+
+  if (!(d = opendir(Dir)))
+    return;
+  while ((Entry = readdir(d))) {
+    if (IsFile(Dir, Entry->d_name)) {
+      snprintf(Path, sizeof(Path), "%.500s/%.500s", Dir, Entry->d_name);
+      unlink(Path);
+    }
+  }
+  closedir(d);
+}
+
+static int CompareNames(const void *a, const void *b)
+{
+  return strcmp(*(char *const *) a, *(char *const *) b);
+}
+
+/* Sorted list of the regular files in Dir */
+static int ListFiles(const char *Dir, char ***Names)
+{
+  struct dirent *Entry;
+  DIR *d;
+  int N = 0, Capacity = 64;
+
+  if (!(*Names = (char **) malloc(Capacity * sizeof(char *))))
+    Fail("not enough memory", NULL);
+  if (!(d = opendir(Dir)))
+    return 0;
+  while ((Entry = readdir(d))) {
+    if (!IsFile(Dir, Entry->d_name))
+      continue;
+    if (N == Capacity) {
+      Capacity *= 2;
+      if (!(*Names = (char **) realloc(*Names, Capacity * sizeof(char *))))
+        Fail("not enough memory", NULL);
+    }
+    if (!((*Names)[N++] = strdup(Entry->d_name)))
+      Fail("not enough memory", NULL);
+  }
+  closedir(d);
+  qsort(*Names, N, sizeof(char *), CompareNames);
+  return N;
+}
+
+/*****************************************************************************
+  Running programs
+*****************************************************************************/
+
+/* Runs Argv with its output going to Log (if not NULL); returns TRUE if it
+   exited normally with status 0 */
+static int Run(char **Argv, const char *Log, double *Wall, double *Cpu, long *PeakRSS)
+{
+  struct rusage Usage;
+  double Start;
+  int Status;
+  pid_t Pid;
+
+  fflush(stdout);
+  Start = Seconds();
+  if ((Pid = fork()) < 0)
+    Fail("cannot fork", NULL);
+  if (Pid == 0) {
+    if (Log && (!freopen(Log, "w", stdout) || !freopen(Log, "a", stderr)))
+      _exit(127);
+    execv(Argv[0], Argv);
+    _exit(127);
+  }
+  if (wait4(Pid, &Status, 0, &Usage) < 0)
+    Fail("wait failed for", Argv[0]);
+  if (Wall)
+    *Wall = Seconds() - Start;
+  if (Cpu)
+    *Cpu = Usage.ru_utime.tv_sec + 1e-6 * Usage.ru_utime.tv_usec +
+      Usage.ru_stime.tv_sec + 1e-6 * Usage.ru_stime.tv_usec;
+  if (PeakRSS)
+    *PeakRSS = Usage.ru_maxrss;
+  return (WIFEXITED(Status) && WEXITSTATUS(Status) == 0);
+}
+
+/*****************************************************************************
+  Tolerances
+*****************************************************************************/
+static void ReadRules(const char *FileName)
+{
+  char Line[NAMESIZE];
+  char File[NAMESIZE], Column[NAMESIZE];
+  double Abs, Rel;
+  FILE *f;
+
+  if (!(f = fopen(FileName, "r")))
+    return;
+  while (fgets(Line, sizeof(Line), f)) {
+    if (Line[strspn(Line, " \t")] == '#')
+      continue;
+    if (sscanf(Line, "%1023s %1023s %lf %lf", File, Column, &Abs, &Rel) != 4)
+      continue;
+    if (NRules == MAXRULES)
+      Fail("too many rules in", FileName);
+    strcpy(Rule[NRules].File, File);
+    strcpy(Rule[NRules].Column, Column);
+    Rule[NRules].Abs = Abs;
+    Rule[NRules].Rel = Rel;
+    NRules++;
+  }
+  fclose(f);
+}
+
+static void WriteRules(const char *FileName)
+{
+  FILE *f;
+
+  if (!(f = fopen(FileName, "w")))
+    Fail("cannot write", FileName);
+  fprintf(f, "# Tolerances for BENCH_Regression, one rule per line:\n");
+  fprintf(f, "#   <file pattern> <column name, number or *> <abs> <rel>\n");
+  fprintf(f, "# The last matching rule applies.\n");
+  fprintf(f, "*                  *             %g  %g\n", DEFAULT_ABS, DEFAULT_REL);
+  fprintf(f, "Mass.Balance       *             1e-6  1e-3\n");
+  fprintf(f, "Mass.Final.Balance *             1e-4  1e-3\n");
+  fprintf(f, "Stream.Flow        *             1e-3  1e-3\n");
+  fprintf(f, "Streamflow.Only    *             1e-3  1e-3\n");
+  fprintf(f, "*.bin              *             1e-6  1e-4\n");
+  fclose(f);
+}
+
+static void Tolerance(const char *File, const char *Column, int Index,
+                      double *Abs, double *Rel)
+{
+  int i;
+
+  *Abs = DefaultAbs;
+  *Rel = DefaultRel;
+  for (i = 0; i < NRules; i++) {
+    if (fnmatch(Rule[i].File, File, 0) != 0)
+      continue;
+    if (strcmp(Rule[i].Column, "*") == 0 ||
+        (Column && strcmp(Rule[i].Column, Column) == 0) ||
+        atoi(Rule[i].Column) == Index + 1) {
+      *Abs = Rule[i].Abs;
+      *Rel = Rule[i].Rel;
+    }
+  }
+}
+
+/*****************************************************************************
+  Comparisons
+*****************************************************************************/
+static void CompareValue(double a, double b, double Abs, double Rel, long Line,
+                         const char *Where, RESULT *r)
+{
+  double Diff, RelDiff, Scale;
+
+  r->NValues++;
+  if (isnan(a) || isnan(b)) {
+    if (!(isnan(a) && isnan(b))) {
+      r->NFailed++;
+      r->MaxAbs = r->MaxRel = HUGE_VAL;
+      r->Line = Line;
+      snprintf(r->Where, sizeof(r->Where), "%s", Where);
+    }
+    return;
+  }
+  Diff = fabs(a - b);
+  Scale = fmax(fabs(a), fabs(b));
+  RelDiff = (Scale > 0.0) ? Diff / Scale : 0.0;
+  if (Diff > Abs && Diff > Rel * Scale)
+    r->NFailed++;
+  if (Diff > r->MaxAbs) {
+    r->MaxAbs = Diff;
+    r->Line = Line;
+    snprintf(r->Where, sizeof(r->Where), "%s", Where);
+  }
+  if (RelDiff > r->MaxRel && Diff > Abs)
+    r->MaxRel = RelDiff;
+}
+
+static int IsNumber(const char *Token, double *Value)
+{
+  char *End;
+
+  *Value = strtod(Token, &End);
+  return (End != Token && *End == '\0');
+}
+
+/* Splits Line into at most MAXCOLUMNS whitespace separated tokens */
+static int Tokenize(char *Line, char **Token)
+{
+  int N = 0;
+  char *t;
+
+  for (t = strtok(Line, " \t\r\n"); t && N < MAXCOLUMNS; t = strtok(NULL, " \t\r\n"))
+    Token[N++] = t;
+  return N;
+}
+
+static void CompareText(const char *Name, char *Golden, char *Output, RESULT *r)
+{
+  char *Token[2][MAXCOLUMNS];
+  char *Header[MAXCOLUMNS];
+  char *Next[2], *Line[2];
+  char Where[NAMESIZE];
+  double Value[2], Abs, Rel;
+  int NHeader = 0, NToken[2], HasNumbers, i, k;
+  long LineNo = 0;
+
+  Next[0] = Golden;
+  Next[1] = Output;
+  while (Next[0] || Next[1]) {
+    for (k = 0; k < 2; k++) {
+      Line[k] = Next[k];
+      if (Next[k] && (Next[k] = strchr(Next[k], '\n')))
+        *(Next[k]++) = '\0';
+      if (Next[k] && *Next[k] == '\0')
+        Next[k] = NULL;
+    }
+    LineNo++;
+    if (!Line[0] || !Line[1]) {
+      snprintf(r->Message, sizeof(r->Message), "%s has %ld lines, %s has more",
+               Line[0] ? "output" : "golden", LineNo - 1,
+               Line[0] ? "golden" : "output");
+      r->NText++;
+      return;
+    }
+    for (k = 0; k < 2; k++)
+      NToken[k] = Tokenize(Line[k], Token[k]);
+    if (NToken[0] != NToken[1]) {
+      snprintf(r->Message, sizeof(r->Message), "line %ld has %d tokens, expected %d",
+               LineNo, NToken[1], NToken[0]);
+      r->NText++;
+      return;
+    }
+
+    /* a first line without numbers names the columns */
+    if (LineNo == 1) {
+      for (i = 0, HasNumbers = 0; i < NToken[0]; i++)
+        HasNumbers |= IsNumber(Token[0][i], &Value[0]);
+      if (!HasNumbers) {
+        NHeader = NToken[0];
+        for (i = 0; i < NHeader; i++)
+          Header[i] = strdup(Token[0][i]);
+      }
+    }
+
+    for (i = 0; i < NToken[0]; i++) {
+      if (IsNumber(Token[0][i], &Value[0]) && IsNumber(Token[1][i], &Value[1])) {
+        Tolerance(Name, (i < NHeader) ? Header[i] : NULL, i, &Abs, &Rel);
+        if (i < NHeader)
+          snprintf(Where, sizeof(Where), "%s", Header[i]);
+        else
+          snprintf(Where, sizeof(Where), "column %d", i + 1);
+        CompareValue(Value[0], Value[1], Abs, Rel, LineNo, Where, r);
+      }
+      else if (strcmp(Token[0][i], Token[1][i]) != 0) {
+        if (r->NText++ == 0)
+          snprintf(r->Message, sizeof(r->Message), "line %ld: \"%.100s\" became \"%.100s\"",
+                   LineNo, Token[0][i], Token[1][i]);
+      }
+    }
+  }
+  for (i = 0; i < NHeader; i++)
+    free(Header[i]);
+}
+
+static void CompareFloats(const char *Name, const char *Golden, const char *Output,
+                          long Size, RESULT *r)
+{
+  char Where[NAMESIZE];
+  float a, b;
+  double Abs, Rel;
+  long i;
+
+  Tolerance(Name, NULL, 0, &Abs, &Rel);
+  for (i = 0; i < Size / (long) sizeof(float); i++) {
+    memcpy(&a, Golden + i * sizeof(float), sizeof(float));
+    memcpy(&b, Output + i * sizeof(float), sizeof(float));
+    snprintf(Where, sizeof(Where), "element %ld", i);
+    CompareValue(a, b, Abs, Rel, 0, Where, r);
+  }
+}
+
+/* Compares the golden and new versions of file Name; returns TRUE if they
+   agree */
+static int CompareFile(const char *GoldenDir, const char *OutputDir, const char *Name,
+                       int Bitwise, RESULT *r)
+{
+  char Path[NAMESIZE];
+  char *Golden, *Output;
+  long GoldenSize, OutputSize, i;
+
+  memset(r, 0, sizeof(RESULT));
+  snprintf(Path, sizeof(Path), "%.500s/%.500s", GoldenDir, Name);
+  if (!(Golden = ReadFile(Path, &GoldenSize))) {
+    snprintf(r->Message, sizeof(r->Message), "cannot read golden file");
+    return 0;
+  }
+  snprintf(Path, sizeof(Path), "%.500s/%.500s", OutputDir, Name);
+  if (!(Output = ReadFile(Path, &OutputSize))) {
+    snprintf(r->Message, sizeof(r->Message), "missing from the output");
+    free(Golden);
+    return 0;
+  }
+
+  if (Bitwise) {
+    for (i = 0; i < GoldenSize && i < OutputSize && Golden[i] == Output[i]; i++)
+      ;
+    if (i < GoldenSize || i < OutputSize)
+      snprintf(r->Message, sizeof(r->Message), "first difference at byte %ld", i);
+  }
+  else if (HasSuffix(Name, ".bin")) {
+    if (GoldenSize != OutputSize)
+      snprintf(r->Message, sizeof(r->Message), "size %ld, expected %ld",
+               OutputSize, GoldenSize);
+    else
+      CompareFloats(Name, Golden, Output, GoldenSize, r);
+  }
+  else
+    CompareText(Name, Golden, Output, r);
+
+  free(Golden);
+  free(Output);
+  return (r->Message[0] == '\0' && r->NFailed == 0 && r->NText == 0);
+}
+
+/*****************************************************************************
+  History
+*****************************************************************************/
+
+/* Finds the best wall time and peak memory of the earlier runs */
+static void ReadHistory(const char *FileName, double *BestWall, long *BestRSS)
+{
+  char Line[NAMESIZE];
+  double Wall, Cpu;
+  long RSS;
+  FILE *f;
+
+  *BestWall = 0.0;
+  *BestRSS = 0;
+  if (!(f = fopen(FileName, "r")))
+    return;
+  while (fgets(Line, sizeof(Line), f)) {
+    /* Date,Wall(s),CPU(s),PeakRSS(kB),... */
+    if (sscanf(Line, "%*[^,],%lf,%lf,%ld", &Wall, &Cpu, &RSS) != 3)
+      continue;
+    if (*BestWall == 0.0 || Wall < *BestWall)
+      *BestWall = Wall;
+    if (*BestRSS == 0 || RSS < *BestRSS)
+      *BestRSS = RSS;
+  }
+  fclose(f);
+}
+
+static void WriteHistory(const char *FileName, double Wall, double Cpu, long RSS,
+                         int NFiles, int NFailed, const char *Status)
+{
+  char Date[32];
+  time_t Now = time(NULL);
+  FILE *f;
+  int New;
+
+  New = (access(FileName, F_OK) != 0);
+  if (!(f = fopen(FileName, "a")))
+    Fail("cannot write", FileName);
+  if (New)
+    fprintf(f, "Date,Wall(s),CPU(s),PeakRSS(kB),Files,Failed,Status\n");
+  strftime(Date, sizeof(Date), "%Y-%m-%dT%H:%M:%S", localtime(&Now));
+  fprintf(f, "%s,%.3f,%.3f,%ld,%d,%d,%s\n", Date, Wall, Cpu, RSS, NFiles, NFailed,
+          Status);
+  fclose(f);
+}
+
+static void Usage(const char *Name)
+{
+  fprintf(stderr, "usage: %s [-x model] [-g generator] [-o directory] [-t tolerances]\n",
+          Name);
+  fprintf(stderr, "       [-a abs] [-r rel] [-b] [-u] [-s slowdown] [-m growth]\n\n");
+  fprintf(stderr, "  -x  model executable                       [%s]\n", DEFAULT_MODEL);
+  fprintf(stderr, "  -g  synthetic basin generator              [%s]\n", DEFAULT_GENERATOR);
+  fprintf(stderr, "  -o  working directory                      [%s]\n", DEFAULT_OUTDIR);
+  fprintf(stderr, "  -t  tolerance file                [<directory>/tolerances]\n");
+  fprintf(stderr, "  -a  absolute tolerance if no rule matches  [%g]\n", DEFAULT_ABS);
+  fprintf(stderr, "  -r  relative tolerance if no rule matches  [%g]\n", DEFAULT_REL);
+  fprintf(stderr, "  -b  require bitwise identical outputs\n");
+  fprintf(stderr, "  -u  store the outputs as the new golden outputs\n");
+  fprintf(stderr, "  -s  slowdown that is flagged               [%g]\n", DEFAULT_SLOWDOWN);
+  fprintf(stderr, "  -m  memory growth that is flagged          [%g]\n", DEFAULT_GROWTH);
+  exit(EXIT_FAILURE);
+}
+
+int main(int argc, char **argv)
+{
+  char *Model = DEFAULT_MODEL;
+  char *Generator = DEFAULT_GENERATOR;
+  char *OutDir = DEFAULT_OUTDIR;
+  char *Tolerances = NULL;
+  char Case[NAMESIZE], Config[NAMESIZE], OutputDir[NAMESIZE], GoldenDir[NAMESIZE];
+  char Log[NAMESIZE], History[NAMESIZE], RulesFile[NAMESIZE];
+  char Source[NAMESIZE], Path[NAMESIZE];
+  char Status[64];
+  char *Argv[16];
+  char **Name;
+  double Slowdown = DEFAULT_SLOWDOWN, Growth = DEFAULT_GROWTH;
+  double Wall, Cpu, BestWall;
+  long PeakRSS, BestRSS;
+  int Bitwise = 0, Update = 0, Flagged = 0;
+  int NFiles, NFailed = 0, c, i;
+  RESULT r;
+
+  while ((c = getopt(argc, argv, "x:g:o:t:a:r:bus:m:h")) != -1) {
+    switch (c) {
+    case 'x': Model = optarg; break;
+    case 'g': Generator = optarg; break;
+    case 'o': OutDir = optarg; break;
+    case 't': Tolerances = optarg; break;
+    case 'a': DefaultAbs = atof(optarg); break;
+    case 'r': DefaultRel = atof(optarg); break;
+    case 'b': Bitwise = 1; break;
+    case 'u': Update = 1; break;
+    case 's': Slowdown = atof(optarg); break;
+    case 'm': Growth = atof(optarg); break;
+    default: Usage(argv[0]);
+    }
+  }
+  if (optind < argc || DefaultAbs < 0.0 || DefaultRel < 0.0)
+    Usage(argv[0]);
+
+  MakeDir(OutDir);
+  snprintf(Case, sizeof(Case), "%.900s/%s", OutDir, REFERENCE_CASE);
+  snprintf(Config, sizeof(Config), "%.900s/synth.cfg", Case);
+  snprintf(OutputDir, sizeof(OutputDir), "%.900s/output", Case);
+  snprintf(Log, sizeof(Log), "%.900s/run.log", Case);
+  snprintf(GoldenDir, sizeof(GoldenDir), "%.900s/golden", OutDir);
+  snprintf(History, sizeof(History), "%.900s/history.csv", OutDir);
+  snprintf(RulesFile, sizeof(RulesFile), "%.900s/tolerances", OutDir);
+
+  /* the reference basin */
+  if (access(Config, R_OK) != 0) {
+    Argv[0] = Generator;
+    Argv[1] = "-g";
+    Argv[2] = "-p";
+    Argv[3] = "-s";
+    Argv[4] = REFERENCE_SIZE;
+    Argv[5] = "-d";
+    Argv[6] = REFERENCE_DAYS;
+    Argv[7] = "-o";
+    Argv[8] = OutDir;
+    Argv[9] = NULL;
+    if (!Run(Argv, NULL, NULL, NULL, NULL))
+      Fail("cannot generate the reference basin with", Generator);
+  }
+
+  ClearDir(OutputDir);
+  Argv[0] = Model;
+  Argv[1] = Config;
+  Argv[2] = NULL;
+  printf("Running %s on %s\n", Model, Config);
+  if (!Run(Argv, Log, &Wall, &Cpu, &PeakRSS)) {
+    WriteHistory(History, Wall, Cpu, PeakRSS, 0, 0, "MODEL FAILED");
+    Fail("model run failed, see", Log);
+  }
+  ReadHistory(History, &BestWall, &BestRSS);
+
+  /* store the outputs as the golden outputs */
+  if (Update || access(GoldenDir, F_OK) != 0) {
+    MakeDir(GoldenDir);
+    ClearDir(GoldenDir);
+    NFiles = ListFiles(OutputDir, &Name);
+    for (i = 0; i < NFiles; i++) {
+      snprintf(Path, sizeof(Path), "%.900s/%.100s", GoldenDir, Name[i]);
+      snprintf(Source, sizeof(Source), "%.900s/%.100s", OutputDir, Name[i]);
+      if (!CopyFile(Source, Path))
+        Fail("cannot copy", Source);
+      free(Name[i]);
+    }
+    free(Name);
+    if (access(RulesFile, F_OK) != 0 && !Tolerances)
+      WriteRules(RulesFile);
+    printf("Stored %d output files in %s\n", NFiles, GoldenDir);
+    printf("Run: wall %.3f s, cpu %.3f s, peak RSS %.1f MB\n", Wall, Cpu,
+           PeakRSS / 1024.0);
+    WriteHistory(History, Wall, Cpu, PeakRSS, NFiles, 0, "UPDATE");
+    return EXIT_SUCCESS;
+  }
+
+  ReadRules(Tolerances ? Tolerances : RulesFile);
+  printf("Comparing against %s%s\n", GoldenDir, Bitwise ? " (bitwise)" : "");
+  NFiles = ListFiles(GoldenDir, &Name);
+  for (i = 0; i < NFiles; i++) {
+    if (CompareFile(GoldenDir, OutputDir, Name[i], Bitwise, &r)) {
+      printf("  %-44s ok", Name[i]);
+      if (r.NValues > 0)
+        printf("    %ld values, max abs diff %.3g", r.NValues, r.MaxAbs);
+      printf("\n");
+    }
+    else {
+      NFailed++;
+      printf("  %-44s FAIL", Name[i]);
+      if (r.Message[0])
+        printf("  %s", r.Message);
+      if (r.NFailed > 0 && r.Line > 0)
+        printf("  %ld of %ld values differ, max abs diff %.3g (line %ld, %s), "
+               "max rel diff %.3g", r.NFailed, r.NValues, r.MaxAbs, r.Line,
+               r.Where, r.MaxRel);
+      else if (r.NFailed > 0)
+        printf("  %ld of %ld values differ, max abs diff %.3g (%s), "
+               "max rel diff %.3g", r.NFailed, r.NValues, r.MaxAbs, r.Where,
+               r.MaxRel);
+      else if (r.NText > 0 && !r.Message[0])
+        printf("  %ld tokens differ", r.NText);
+      printf("\n");
+    }
+    free(Name[i]);
+  }
+  free(Name);
+
+  NFiles = ListFiles(OutputDir, &Name);
+  for (i = 0; i < NFiles; i++) {
+    if (!IsFile(GoldenDir, Name[i]))
+      printf("  %-44s new (not in the golden outputs)\n", Name[i]);
+    free(Name[i]);
+  }
+  free(Name);
+
+  strcpy(Status, NFailed ? "FAIL" : "PASS");
+  printf("Run: wall %.3f s, cpu %.3f s, peak RSS %.1f MB", Wall, Cpu, PeakRSS / 1024.0);
+  if (BestWall > 0.0)
+    printf(" (best %.3f s, %.1f MB)", BestWall, BestRSS / 1024.0);
+  printf("\n");
+  if (BestWall > 0.0 && Wall > (1.0 + Slowdown) * BestWall) {
+    printf("Flagged: %.0f%% slower than the best run\n", 100.0 * (Wall / BestWall - 1.0));
+    strcat(Status, " SLOWER");
+    Flagged = 1;
+  }
+  if (BestRSS > 0 && PeakRSS > (1.0 + Growth) * BestRSS) {
+    printf("Flagged: %.0f%% more memory than the best run\n",
+           100.0 * ((double) PeakRSS / BestRSS - 1.0));
+    strcat(Status, " MEMORY");
+    Flagged = 1;
+  }
+  WriteHistory(History, Wall, Cpu, PeakRSS, NFiles, NFailed, Status);
+  printf("Result: %s (%d of %d files differ)\n", Status, NFailed, NFiles);
+
+  return (NFailed == 0 && !Flagged) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,1261 @@
+/*
+ * SUMMARY:      BenchSynthBasin.c - Synthetic basin generator and scaling benchmark
+ * USAGE:        make -f makefile_for_binary.txt bench_synthetic
+ *               ./BENCH_SynthBasin [-s sizes] [-t threads] [-n stations]
+ *                                  [-d days] [-r spacing] [-a threshold]
+ *                                  [-x model] [-o directory] [-O option]
+ *                                  [-g] [-p]
+ *
+ * DESCRIPTION:  Builds a complete, self-contained DHSVM input data set for a
+ *               square synthetic basin of each requested size and runs the
+ *               model on it, so that the model can be benchmarked at scale
+ *               without any external data.  For a basin of N x N cells the
+ *               following is written to <directory>/synth_N:
+ *
+ *               input/DEM.bin       fractal (fBm) terrain, conditioned so
+ *                                   that every cell drains to one outlet
+ *                                   near the middle of the southern edge
+ *               input/Mask.bin      basin mask (all but the outer ring of
+ *                                   cells, which the model expects to lie
+ *                                   outside the basin)
+ *               input/Soil.bin      soil type (3 types)
+ *               input/SoilDepth.bin soil depth, deeper in the valleys
+ *               input/Veg.bin       vegetation type (4 types, by elevation)
+ *               input/stream.*      stream network, stream map and stream
+ *                                   classes derived from the flow
+ *                                   accumulation of the DEM, in the formats
+ *                                   read by channel_read_network(),
+ *                                   channel_grid_read_map() and
+ *                                   channel_read_classes()
+ *               met/Station_k.dat   hourly-resolved synthetic forcing for
+ *                                   each of the met stations
+ *               state/              initial interception, snow, soil and
+ *                                   channel states
+ *               synth.cfg           the DHSVM configuration file
+ *
+ *               With -p the configuration also asks for the outputs used by
+ *               the regression harness (BenchRegression.c): Stream.Flow, a
+ *               pixel dump at each met station, daily maps of snow water
+ *               equivalent, surface soil moisture and water table depth, and
+ *               a model state at the end of the run.
+ *
+ *               Each basin is then run once for every requested thread
+ *               count with PROFILE = TRUE, and the time spent in the time
+ *               loop is reported as cells * time steps / s, together with
+ *               the initialization time and the peak resident memory of the
+ *               model process.  Results are appended to
+ *               <directory>/scaling.csv.
+ *
+ *               The model itself is currently single-threaded; the thread
+ *               count is passed on as OMP_NUM_THREADS and recorded so that
+ *               the same harness can be used once parts of the model run in
+ *               parallel.
+ *
+ *               Everything is deterministic: the same size and options
+ *               always give the same basin and forcing.
+ */
+
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#define DEFAULT_SIZES    "100,200,400"
+#define DEFAULT_THREADS  "1"
+#define DEFAULT_STATIONS 4
+#define DEFAULT_DAYS     2
+#define DEFAULT_SPACING  30.0
+#define DEFAULT_MODEL    "./DHSVM_X.2.2_InterFlow"
+#define DEFAULT_OUTDIR   "synthetic"
+
+#define TIMESTEP     3          /* model time step (hours) */
+#define START_MONTH  4          /* the run starts on START_MONTH/START_DAY/START_YEAR */
+#define START_DAY    1
+#define START_YEAR   2000
+#define MAXSEGID     2147483647 /* channel segment IDs are read as int */
+#define NCLASSES     6          /* number of stream classes */
+#define NSOILLAYERS  3
+#define NVEGTYPES    4
+#define NSOILTYPES   3
+#define CHANNELAREA  2.0e5      /* default drainage area needed to form a channel (m2) */
+#define FILLEPS      0.001f     /* elevation increment used when filling pits (m) */
+#define MAXOPTIONS   32
+#define MAXLIST      64
+#define NAMESIZE     1024
+
+typedef struct {
+  int Year, Month, Day, Hour;
+} SYNTHDATE;
+
+typedef struct {
+  float Elev;
+  int Cell;
+} HEAPITEM;
+
+typedef struct {
+  int NX, NY;
+  float DX;
+  float *Dem;
+  unsigned char *Soil;
+  unsigned char *Veg;
+  unsigned char *Mask;
+  float *Depth;
+  int *Receiver;                /* cell each cell drains to, -1 at the outlet */
+  int *Order;                   /* basin cells in order from the outlet upwards */
+  int NBasin;                   /* number of cells in the basin */
+  int *Segment;                 /* channel segment of each cell, 0 if none */
+  int NSegments;
+  int Threshold;                /* contributing cells needed to form a channel */
+} BASIN;
+
+/* Per soil type: lateral Ks, exponential decrease, porosity, field capacity
+   and wilting point (the same for all layers) */
+static const char *SoilName[NSOILTYPES] = { "Loam", "Sandy_Loam", "Silt_Loam" };
+static const float SoilKsLat[NSOILTYPES] = { 0.0005, 0.001, 0.0002 };
+static const float SoilExpDec[NSOILTYPES] = { 3.0, 2.0, 4.0 };
+static const float SoilPorosity[NSOILTYPES] = { 0.43, 0.40, 0.45 };
+static const float SoilFCap[NSOILTYPES] = { 0.25, 0.18, 0.30 };
+static const float SoilWP[NSOILTYPES] = { 0.12, 0.08, 0.15 };
+
+static const float RootDepth[NSOILLAYERS] = { 0.10, 0.25, 0.40 };
+
+static int xdir[8] = { 0, 1, 1, 1, 0, -1, -1, -1 };
+static int ydir[8] = { -1, -1, 0, 1, 1, 1, 0, -1 };
+
+/*****************************************************************************
+  Utilities
+*****************************************************************************/
+static void Fail(const char *Msg, const char *Arg)
+{
+  fprintf(stderr, "BENCH_SynthBasin: %s %s\n", Msg, Arg ? Arg : "");
+  exit(EXIT_FAILURE);
+}
+
+static void *Alloc(size_t N, size_t Size)
+{
+  void *p;
+
+  if (!(p = calloc(N, Size)))
+    Fail("not enough memory", NULL);
+  return p;
+}
+
+static FILE *Create(const char *FileName, const char *Mode)
+{
+  FILE *f;
+
+  if (!(f = fopen(FileName, Mode)))
+    Fail("cannot create", FileName);
+  return f;
+}
+
+static void MakeDir(const char *Path)
+{
+  if (mkdir(Path, 0755) != 0 && errno != EEXIST)
+    Fail("cannot create directory", Path);
+}
+
+static void WriteMap(const char *FileName, const void *Data, size_t Size, size_t N)
+{
+  FILE *f = Create(FileName, "wb");
+
+  if (fwrite(Data, Size, N, f) != N)
+    Fail("cannot write", FileName);
+  fclose(f);
+}
+
+static double Seconds(void)
+{
+  struct timespec t;
+
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec + 1e-9 * t.tv_nsec;
+}
+
+static int ParseList(const char *Str, int *List)
+{
+  char Buffer[NAMESIZE];
+  char *Token;
+  int N = 0;
+
+  strncpy(Buffer, Str, NAMESIZE - 1);
+  Buffer[NAMESIZE - 1] = '\0';
+  for (Token = strtok(Buffer, ","); Token && N < MAXLIST; Token = strtok(NULL, ",")) {
+    List[N] = atoi(Token);
+    if (List[N] < 1)
+      Fail("bad list entry", Token);
+    N++;
+  }
+  return N;
+}
+
+static void AdvanceHours(SYNTHDATE *Date, int Hours)
+{
+  static const int DaysPerMonth[12] =
+    { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+  int NDays;
+
+  Date->Hour += Hours;
+  while (Date->Hour >= 24) {
+    Date->Hour -= 24;
+    NDays = DaysPerMonth[Date->Month - 1];
+    if (Date->Month == 2 && (Date->Year % 4 == 0 &&
+                             (Date->Year % 100 != 0 || Date->Year % 400 == 0)))
+      NDays = 29;
+    if (++Date->Day > NDays) {
+      Date->Day = 1;
+      if (++Date->Month > 12) {
+        Date->Month = 1;
+        Date->Year++;
+      }
+    }
+  }
+}
+
+/*****************************************************************************
+  Terrain
+
+  The DEM is fractional Brownian motion built from octaves of value noise on
+  top of a regional slope towards the outlet.  It is then conditioned with a
+  priority flood from the outlet: every cell is raised to at least FILLEPS
+  above the cell it drains to, which removes all pits and gives the D8
+  receiver of every cell and an outlet-to-ridge ordering for free.
+*****************************************************************************/
+static float Lattice(int x, int y, unsigned int Seed)
+{
+  unsigned int h = (unsigned int) x * 374761393u + (unsigned int) y * 668265263u +
+    Seed * 2246822519u;
+
+  h = (h ^ (h >> 13)) * 1274126177u;
+  h ^= h >> 16;
+  return (h & 0xffffff) / (float) 0xffffff;
+}
+
+static float ValueNoise(float x, float y, unsigned int Seed)
+{
+  int x0 = (int) floorf(x);
+  int y0 = (int) floorf(y);
+  float fx = x - x0;
+  float fy = y - y0;
+  float a, b;
+
+  fx = fx * fx * (3.0f - 2.0f * fx);
+  fy = fy * fy * (3.0f - 2.0f * fy);
+  a = Lattice(x0, y0, Seed) + fx * (Lattice(x0 + 1, y0, Seed) - Lattice(x0, y0, Seed));
+  b = Lattice(x0, y0 + 1, Seed) +
+    fx * (Lattice(x0 + 1, y0 + 1, Seed) - Lattice(x0, y0 + 1, Seed));
+  return a + fy * (b - a);
+}
+
+/* Fractal field in [0, 1] with features from the size of the grid down to a
+   couple of cells */
+static void Fractal(int NX, int NY, unsigned int Seed, float *Field)
+{
+  int x, y, i, Octave, NOctaves;
+  float Frequency, Amplitude, Sum, Norm, Min, Max;
+
+  NOctaves = 1;
+  for (i = (NX > NY ? NX : NY); i > 4; i /= 2)
+    NOctaves++;
+
+  for (y = 0, i = 0; y < NY; y++) {
+    for (x = 0; x < NX; x++, i++) {
+      Sum = 0.0;
+      Norm = 0.0;
+      Frequency = 2.0f / (NX > NY ? NX : NY);
+      Amplitude = 1.0;
+      for (Octave = 0; Octave < NOctaves; Octave++) {
+        Sum += Amplitude * ValueNoise(x * Frequency, y * Frequency, Seed + Octave);
+        Norm += Amplitude;
+        Frequency *= 2.0f;
+        Amplitude *= 0.55f;
+      }
+      Field[i] = Sum / Norm;
+    }
+  }
+
+  Min = Max = Field[0];
+  for (i = 0; i < NX * NY; i++) {
+    if (Field[i] < Min)
+      Min = Field[i];
+    if (Field[i] > Max)
+      Max = Field[i];
+  }
+  for (i = 0; i < NX * NY; i++)
+    Field[i] = (Max > Min) ? (Field[i] - Min) / (Max - Min) : 0.0f;
+}
+
+static void HeapPush(HEAPITEM **Heap, int *N, int *Capacity, float Elev, int Cell)
+{
+  HEAPITEM Item = { Elev, Cell };
+  int i, Parent;
+
+  if (*N == *Capacity) {
+    *Capacity = 2 * (*Capacity);
+    if (!(*Heap = (HEAPITEM *) realloc(*Heap, *Capacity * sizeof(HEAPITEM))))
+      Fail("not enough memory", NULL);
+  }
+  for (i = (*N)++; i > 0; i = Parent) {
+    Parent = (i - 1) / 2;
+    if ((*Heap)[Parent].Elev <= Elev)
+      break;
+    (*Heap)[i] = (*Heap)[Parent];
+  }
+  (*Heap)[i] = Item;
+}
+
+static HEAPITEM HeapPop(HEAPITEM *Heap, int *N)
+{
+  HEAPITEM Top = Heap[0];
+  HEAPITEM Last = Heap[--(*N)];
+  int i, Child;
+
+  for (i = 0; (Child = 2 * i + 1) < *N; i = Child) {
+    if (Child + 1 < *N && Heap[Child + 1].Elev < Heap[Child].Elev)
+      Child++;
+    if (Heap[Child].Elev >= Last.Elev)
+      break;
+    Heap[i] = Heap[Child];
+  }
+  Heap[i] = Last;
+  return Top;
+}
+
+static void MakeTerrain(BASIN *B)
+{
+  int NCells = B->NX * B->NY;
+  int i, k, n, x, y, nx, ny, NHeap, Capacity, NOrdered;
+  int OutletX = B->NX / 2;
+  int OutletY = B->NY - 2;
+  float Distance, MaxDistance;
+  float *Noise;
+  unsigned char *Closed;
+  HEAPITEM *Heap;
+  HEAPITEM Item;
+
+  B->Dem = (float *) Alloc(NCells, sizeof(float));
+  B->Receiver = (int *) Alloc(NCells, sizeof(int));
+  B->Mask = (unsigned char *) Alloc(NCells, sizeof(unsigned char));
+  B->Order = (int *) Alloc(NCells, sizeof(int));
+  Noise = (float *) Alloc(NCells, sizeof(float));
+  Closed = (unsigned char *) Alloc(NCells, sizeof(unsigned char));
+
+  Fractal(B->NX, B->NY, 1, Noise);
+  MaxDistance = sqrtf((float) OutletX * OutletX + (float) OutletY * OutletY) + 1.0f;
+  for (y = 0, i = 0; y < B->NY; y++) {
+    for (x = 0; x < B->NX; x++, i++) {
+      B->Mask[i] = (x > 0 && y > 0 && x < B->NX - 1 && y < B->NY - 1);
+      B->Receiver[i] = -1;
+      Distance = sqrtf((float) (x - OutletX) * (x - OutletX) +
+                       (float) (y - OutletY) * (y - OutletY));
+      B->Dem[i] = 300.0f + 800.0f * Distance / MaxDistance + 1200.0f * Noise[i];
+    }
+  }
+  free(Noise);
+
+  Capacity = 4 * (B->NX + B->NY) + 16;
+  Heap = (HEAPITEM *) Alloc(Capacity, sizeof(HEAPITEM));
+  NHeap = 0;
+  NOrdered = 0;
+  i = OutletY * B->NX + OutletX;
+  B->Receiver[i] = -1;
+  Closed[i] = 1;
+  HeapPush(&Heap, &NHeap, &Capacity, B->Dem[i], i);
+
+  while (NHeap > 0) {
+    Item = HeapPop(Heap, &NHeap);
+    i = Item.Cell;
+    B->Order[NOrdered++] = i;
+    x = i % B->NX;
+    y = i / B->NX;
+    for (k = 0; k < 8; k++) {
+      nx = x + xdir[k];
+      ny = y + ydir[k];
+      if (nx < 0 || ny < 0 || nx >= B->NX || ny >= B->NY)
+        continue;
+      n = ny * B->NX + nx;
+      if (Closed[n] || !B->Mask[n])
+        continue;
+      Closed[n] = 1;
+      if (B->Dem[n] < B->Dem[i] + FILLEPS)
+        B->Dem[n] = B->Dem[i] + FILLEPS;
+      B->Receiver[n] = i;
+      HeapPush(&Heap, &NHeap, &Capacity, B->Dem[n], n);
+    }
+  }
+  B->NBasin = NOrdered;
+
+  free(Heap);
+  free(Closed);
+}
+
+/*****************************************************************************
+  Soils and vegetation
+*****************************************************************************/
+static void MakeSoilVeg(BASIN *B)
+{
+  int NCells = B->NX * B->NY;
+  int i;
+  float Min, Max, e;
+  float *Noise;
+
+  B->Soil = (unsigned char *) Alloc(NCells, sizeof(unsigned char));
+  B->Veg = (unsigned char *) Alloc(NCells, sizeof(unsigned char));
+  B->Depth = (float *) Alloc(NCells, sizeof(float));
+  Noise = (float *) Alloc(NCells, sizeof(float));
+
+  Min = Max = B->Dem[0];
+  for (i = 0; i < NCells; i++) {
+    if (B->Dem[i] < Min)
+      Min = B->Dem[i];
+    if (B->Dem[i] > Max)
+      Max = B->Dem[i];
+  }
+
+  Fractal(B->NX, B->NY, 101, Noise);
+  for (i = 0; i < NCells; i++) {
+    e = (B->Dem[i] - Min) / (Max - Min) + 0.15f * (Noise[i] - 0.5f);
+    if (e < 0.15f)
+      B->Veg[i] = 3;                    /* meadow */
+    else if (e < 0.70f)
+      B->Veg[i] = 1;                    /* forest */
+    else if (e < 0.85f)
+      B->Veg[i] = 2;                    /* shrub */
+    else
+      B->Veg[i] = 4;                    /* bare */
+    /* deep soils in the valleys, shallow soils on the ridges; always deeper
+       than the deepest root zone */
+    B->Depth[i] = 1.0f + 2.0f * (1.0f - (B->Dem[i] - Min) / (Max - Min)) *
+      (0.75f + 0.5f * Noise[i]);
+  }
+
+  Fractal(B->NX, B->NY, 202, Noise);
+  for (i = 0; i < NCells; i++) {
+    B->Soil[i] = 1 + (unsigned char) (NSOILTYPES * Noise[i]);
+    if (B->Soil[i] > NSOILTYPES)
+      B->Soil[i] = NSOILTYPES;
+  }
+
+  free(Noise);
+}
+
+/*****************************************************************************
+  Stream network
+
+  A cell is a channel cell when at least Threshold cells drain through it.
+  Walking from the outlet upwards, a channel cell continues the segment of
+  its receiver if it is the only channel cell draining into that receiver,
+  and starts a new segment otherwise, so that segments end at confluences.
+  Because the walk goes upwards, the outlet of a segment always has a lower
+  ID than the segment itself.  The threshold is doubled until the number of
+  segments fits in a SegmentID.
+*****************************************************************************/
+static void MakeChannels(BASIN *B, int Threshold)
+{
+  int NCells = B->NX * B->NY;
+  int i, k, r;
+  int *Accum;
+  unsigned char *NDonors;
+
+  Accum = (int *) Alloc(NCells, sizeof(int));
+  NDonors = (unsigned char *) Alloc(NCells, sizeof(unsigned char));
+  B->Segment = (int *) Alloc(NCells, sizeof(int));
+
+  for (i = 0; i < NCells; i++)
+    Accum[i] = 1;
+  for (k = B->NBasin - 1; k > 0; k--) {
+    i = B->Order[k];
+    Accum[B->Receiver[i]] += Accum[i];
+  }
+
+  if (Threshold < 1) {
+    Threshold = (int) (CHANNELAREA / (B->DX * B->DX));
+    if (Threshold < 10)
+      Threshold = 10;
+  }
+
+  for (;;) {
+    memset(NDonors, 0, NCells);
+    for (i = 0; i < NCells; i++)
+      if (Accum[i] >= Threshold && B->Receiver[i] >= 0)
+        NDonors[B->Receiver[i]]++;
+
+    B->NSegments = 0;
+    for (k = 0; k < B->NBasin; k++) {
+      i = B->Order[k];
+      B->Segment[i] = 0;
+      if (Accum[i] < Threshold)
+        continue;
+      r = B->Receiver[i];
+      if (r >= 0 && NDonors[r] == 1)
+        B->Segment[i] = B->Segment[r];
+      else
+        B->Segment[i] = ++(B->NSegments);
+    }
+    if (B->NSegments <= MAXSEGID)
+      break;
+    Threshold *= 2;
+  }
+  B->Threshold = Threshold;
+
+  free(Accum);
+  free(NDonors);
+}
+
+static float CellLength(BASIN *B, int i)
+{
+  int r = B->Receiver[i];
+
+  if (r < 0 || r % B->NX == i % B->NX || r / B->NX == i / B->NX)
+    return B->DX;
+  return B->DX * sqrtf(2.0f);
+}
+
+static void WriteChannels(BASIN *B, const char *Dir)
+{
+  char FileName[NAMESIZE];
+  int NCells = B->NX * B->NY;
+  int i, k, r, s;
+  int *Outlet, *StreamOrder, *MaxChild, *NMaxChild, *Class;
+  float *Length, *Top, *Bottom, Slope, Width, Bank;
+  FILE *f;
+
+  Outlet = (int *) Alloc(B->NSegments + 1, sizeof(int));
+  StreamOrder = (int *) Alloc(B->NSegments + 1, sizeof(int));
+  MaxChild = (int *) Alloc(B->NSegments + 1, sizeof(int));
+  NMaxChild = (int *) Alloc(B->NSegments + 1, sizeof(int));
+  Class = (int *) Alloc(B->NSegments + 1, sizeof(int));
+  Length = (float *) Alloc(B->NSegments + 1, sizeof(float));
+  Top = (float *) Alloc(B->NSegments + 1, sizeof(float));
+  Bottom = (float *) Alloc(B->NSegments + 1, sizeof(float));
+
+  /* Segment length, outlet and elevation range.  The first cell of a
+     segment met walking upwards is its downstream end. */
+  for (k = 0; k < B->NBasin; k++) {
+    i = B->Order[k];
+    if ((s = B->Segment[i]) == 0)
+      continue;
+    r = B->Receiver[i];
+    Length[s] += CellLength(B, i);
+    Top[s] = B->Dem[i];
+    if (Outlet[s] == 0 && Bottom[s] == 0.0f) {
+      Outlet[s] = (r >= 0 && B->Segment[r] != s) ? B->Segment[r] : 0;
+      Bottom[s] = (r >= 0) ? B->Dem[r] : B->Dem[i] - FILLEPS;
+    }
+  }
+
+  /* Strahler order, from the most upstream segments down */
+  for (s = B->NSegments; s > 0; s--) {
+    StreamOrder[s] = (MaxChild[s] == 0) ? 1 :
+      ((NMaxChild[s] > 1) ? MaxChild[s] + 1 : MaxChild[s]);
+    if ((r = Outlet[s]) > 0) {
+      if (StreamOrder[s] > MaxChild[r]) {
+        MaxChild[r] = StreamOrder[s];
+        NMaxChild[r] = 1;
+      }
+      else if (StreamOrder[s] == MaxChild[r])
+        NMaxChild[r]++;
+    }
+    Class[s] = (StreamOrder[s] < NCLASSES) ? StreamOrder[s] : NCLASSES;
+  }
+
+  snprintf(FileName, sizeof(FileName), "%.900s/stream.class", Dir);
+  f = Create(FileName, "w");
+  fprintf(f, "# Class Width(m) BankHeight(m) Manning's_n\n");
+  for (k = 1; k <= NCLASSES; k++)
+    fprintf(f, "%d %.2f %.2f %.3f\n", k, 1.0 + 1.5 * (k - 1), 0.3 + 0.1 * k,
+            0.060 - 0.005 * k);
+  fclose(f);
+
+  snprintf(FileName, sizeof(FileName), "%.900s/stream.network", Dir);
+  f = Create(FileName, "w");
+  fprintf(f, "# ID Order Slope Length(m) Class Outlet [SAVE \"name\"]\n");
+  for (s = 1; s <= B->NSegments; s++) {
+    Slope = (Top[s] - Bottom[s]) / Length[s];
+    if (Slope < 0.0001f)
+      Slope = 0.0001f;
+    fprintf(f, "%d %d %.6f %.2f %d %d", s, StreamOrder[s], Slope, Length[s],
+            Class[s], Outlet[s]);
+    if (Outlet[s] == 0)
+      fprintf(f, " SAVE \"Outlet\"");
+    fprintf(f, "\n");
+  }
+  fclose(f);
+
+  snprintf(FileName, sizeof(FileName), "%.900s/stream.map", Dir);
+  f = Create(FileName, "w");
+  fprintf(f, "# Column Row Segment Length(m) CutHeight(m) CutWidth(m)\n");
+  for (i = 0; i < NCells; i++) {
+    if ((s = B->Segment[i]) == 0)
+      continue;
+    Width = 1.0 + 1.5 * (Class[s] - 1);
+    Bank = 0.3 + 0.1 * Class[s];
+    if (Bank > 0.9f * B->Depth[i])
+      Bank = 0.9f * B->Depth[i];
+    fprintf(f, "%d %d %d %.2f %.3f %.2f\n", i % B->NX, i / B->NX, s,
+            CellLength(B, i), Bank, Width);
+  }
+  fclose(f);
+
+  free(Outlet);
+  free(StreamOrder);
+  free(MaxChild);
+  free(NMaxChild);
+  free(Class);
+  free(Length);
+  free(Top);
+  free(Bottom);
+}
+
+/*****************************************************************************
+  Meteorology
+
+  Stations are laid out on a regular grid over the basin.  The forcing has a
+  diurnal cycle in temperature, humidity and radiation, and a storm on every
+  second day; each station is slightly offset so that the interpolation has
+  some work to do.
+*****************************************************************************/
+static void StationCell(BASIN *B, int NStations, int k, int *x, int *y)
+{
+  int gx = (int) ceil(sqrt((double) NStations));
+  int gy = (NStations + gx - 1) / gx;
+
+  *x = (int) (((k % gx) + 0.5) * B->NX / gx);
+  *y = (int) (((k / gx) + 0.5) * B->NY / gy);
+}
+
+static void WriteMet(BASIN *B, const char *Dir, int NStations, int NSteps)
+{
+  char FileName[NAMESIZE];
+  int k, n, Step;
+  double Hour, Tair, Offset;
+  SYNTHDATE Date;
+  FILE *f;
+
+  for (k = 0; k < NStations; k++) {
+    snprintf(FileName, sizeof(FileName), "%.900s/Station_%d.dat", Dir, k + 1);
+    f = Create(FileName, "w");
+    Offset = 0.5 * ((k % 3) - 1);
+    Date.Year = START_YEAR;
+    Date.Month = START_MONTH;
+    Date.Day = START_DAY;
+    Date.Hour = 0;
+    /* one record beyond the end of the run */
+    for (Step = 0; Step <= NSteps; Step++) {
+      n = Step * TIMESTEP / 24;
+      Hour = Date.Hour + 0.5 * TIMESTEP;
+      Tair = 4.0 + Offset + 6.0 * sin(2.0 * M_PI * (Hour - 9.0) / 24.0);
+      fprintf(f, "%02d/%02d/%04d-%02d %.2f %.2f %.1f %.1f %.1f %.5f\n",
+              Date.Month, Date.Day, Date.Year, Date.Hour,
+              Tair,
+              2.0 + 1.5 * sin(2.0 * M_PI * (Hour - 12.0) / 24.0) + 0.2 * k,
+              65.0 - 20.0 * sin(2.0 * M_PI * (Hour - 9.0) / 24.0),
+              (Hour > 6.0 && Hour < 18.0) ?
+              850.0 * sin(M_PI * (Hour - 6.0) / 12.0) : 0.0,
+              270.0 + 3.0 * Tair,
+              (n % 2 == 1) ? 0.002 * (1.0 + 0.1 * (k % 4)) : 0.0);
+      AdvanceHours(&Date, TIMESTEP);
+    }
+    fclose(f);
+  }
+}
+
+/*****************************************************************************
+  Initial model state
+*****************************************************************************/
+static void WriteState(BASIN *B, const char *Dir)
+{
+  char FileName[NAMESIZE];
+  char Str[32];
+  int NCells = B->NX * B->NY;
+  int i, j, s, t;
+  float Min, Max;
+  float *Map;
+  FILE *f;
+
+  Map = (float *) Alloc(NCells, sizeof(float));
+  snprintf(Str, sizeof(Str), "%02d.%02d.%04d.%02d.%02d.%02d", START_MONTH, START_DAY,
+          START_YEAR, 0, 0, 0);
+
+  /* Interception: rain and snow for each of the two vegetation layers,
+     followed by the temporary storage; all empty */
+  snprintf(FileName, sizeof(FileName), "%.900s/Interception.State.%s.bin", Dir, Str);
+  f = Create(FileName, "wb");
+  for (j = 0; j < 2 * 2 + 1; j++)
+    fwrite(Map, sizeof(float), NCells, f);
+  fclose(f);
+
+  /* Snow: HasSnow, LastSnow, Swq, PackWater, TPack, SurfWater, TSurf and
+     ColdContent, with a snow pack over the upper half of the basin */
+  Min = Max = B->Dem[0];
+  for (i = 0; i < NCells; i++) {
+    if (B->Dem[i] < Min)
+      Min = B->Dem[i];
+    if (B->Dem[i] > Max)
+      Max = B->Dem[i];
+  }
+  snprintf(FileName, sizeof(FileName), "%.900s/Snow.State.%s.bin", Dir, Str);
+  f = Create(FileName, "wb");
+  for (j = 0; j < 8; j++) {
+    for (i = 0; i < NCells; i++) {
+      float Swq = 0.6f * ((B->Dem[i] - Min) / (Max - Min) - 0.5f);
+      if (Swq < 0.0f)
+        Swq = 0.0f;
+      switch (j) {
+      case 0: Map[i] = (Swq > 0.0f) ? 1.0f : 0.0f; break;
+      case 1: Map[i] = 10.0f; break;
+      case 2: Map[i] = Swq; break;
+      case 4:
+      case 6: Map[i] = (Swq > 0.0f) ? -1.0f : 0.0f; break;
+      default: Map[i] = 0.0f; break;
+      }
+    }
+    fwrite(Map, sizeof(float), NCells, f);
+  }
+  fclose(f);
+
+  /* Soil: moisture in each root zone layer and below the root zone, surface
+     temperature, layer temperatures, ground heat storage and infiltration
+     excess.  Moisture starts well above field capacity, so that the valleys
+     are close to saturation and feed the channels from the first step. */
+  snprintf(FileName, sizeof(FileName), "%.900s/Soil.State.%s.bin", Dir, Str);
+  f = Create(FileName, "wb");
+  for (j = 0; j < NSOILLAYERS + 1; j++) {
+    for (i = 0; i < NCells; i++) {
+      t = B->Soil[i] - 1;
+      Map[i] = SoilFCap[t] + 0.7f * (SoilPorosity[t] - SoilFCap[t]);
+    }
+    fwrite(Map, sizeof(float), NCells, f);
+  }
+  for (i = 0; i < NCells; i++)
+    Map[i] = 2.0f;
+  for (j = 0; j < NSOILLAYERS + 1; j++)
+    fwrite(Map, sizeof(float), NCells, f);
+  for (i = 0; i < NCells; i++)
+    Map[i] = 0.0f;
+  fwrite(Map, sizeof(float), NCells, f);
+  fwrite(Map, sizeof(float), NCells, f);
+  fclose(f);
+
+  snprintf(FileName, sizeof(FileName), "%.900s/Channel.State.%s", Dir, Str);
+  f = Create(FileName, "w");
+  for (s = 1; s <= B->NSegments; s++)
+    fprintf(f, "%d %.4f\n", s, 0.0);
+  fclose(f);
+
+  free(Map);
+}
+
+/*****************************************************************************
+  Configuration file
+*****************************************************************************/
+static void WriteSoilTable(FILE *f)
+{
+  int t;
+
+  fprintf(f, "Number of Soil Types = %d\n", NSOILTYPES);
+  for (t = 0; t < NSOILTYPES; t++) {
+    fprintf(f, "Soil Description %d = %s\n", t + 1, SoilName[t]);
+    fprintf(f, "Lateral Conductivity %d = %g\n", t + 1, SoilKsLat[t]);
+    fprintf(f, "Exponential Decrease %d = %g\n", t + 1, SoilExpDec[t]);
+    fprintf(f, "Depth Threshold %d = 1.5\n", t + 1);
+    fprintf(f, "Vertical Anisotropy %d = 10.0\n", t + 1);
+    fprintf(f, "Maximum Infiltration %d = 3e-05\n", t + 1);
+    fprintf(f, "Capillary Drive %d = 0.07\n", t + 1);
+    fprintf(f, "Deep Flux %d = 0.0\n", t + 1);
+    fprintf(f, "Surface Albedo %d = 0.1\n", t + 1);
+    fprintf(f, "Mannings n %d = 0.1\n", t + 1);
+    fprintf(f, "Number of Soil Layers %d = %d\n", t + 1, NSOILLAYERS);
+    fprintf(f, "Porosity %d = %g %g %g\n", t + 1,
+            SoilPorosity[t], SoilPorosity[t], SoilPorosity[t]);
+    fprintf(f, "Pore Size Distribution %d = 0.3 0.3 0.3\n", t + 1);
+    fprintf(f, "Bubbling Pressure %d = 0.2 0.2 0.2\n", t + 1);
+    fprintf(f, "Field Capacity %d = %g %g %g\n", t + 1,
+            SoilFCap[t], SoilFCap[t], SoilFCap[t]);
+    fprintf(f, "Wilting Point %d = %g %g %g\n", t + 1, SoilWP[t], SoilWP[t], SoilWP[t]);
+    fprintf(f, "Bulk Density %d = 1500. 1500. 1500.\n", t + 1);
+    fprintf(f, "Vertical Conductivity %d = 1e-05 1e-05 1e-05\n", t + 1);
+    fprintf(f, "Thermal Conductivity %d = 7.114 6.923 7.0\n", t + 1);
+    fprintf(f, "Thermal Capacity %d = 1.4e6 1.4e6 1.4e6\n", t + 1);
+  }
+}
+
+static void WriteVegTable(FILE *f)
+{
+  static const char *Name[NVEGTYPES] = { "Forest", "Shrub", "Meadow", "Bare" };
+  static const float LAI[NVEGTYPES] = { 5.0, 2.0, 1.5, 0.0 };
+  int t, m;
+
+  fprintf(f, "Number of Vegetation Types = %d\n", NVEGTYPES);
+  for (t = 0; t < NVEGTYPES; t++) {
+    fprintf(f, "Vegetation Description %d = %s\n", t + 1, Name[t]);
+    fprintf(f, "Overstory Present %d = %s\n", t + 1, (t == 0) ? "TRUE" : "FALSE");
+    fprintf(f, "Understory Present %d = %s\n", t + 1, (t < 3) ? "TRUE" : "FALSE");
+    fprintf(f, "Impervious Fraction %d = 0.0\n", t + 1);
+    fprintf(f, "Number of Root Zones %d = %d\n", t + 1, NSOILLAYERS);
+    fprintf(f, "Root Zone Depths %d = %g %g %g\n", t + 1,
+            RootDepth[0], RootDepth[1], RootDepth[2]);
+    if (t == 0) {
+      fprintf(f, "Fractional Coverage %d = 0.8\n", t + 1);
+      fprintf(f, "Trunk Space %d = 0.4\n", t + 1);
+      fprintf(f, "Aerodynamic Attenuation %d = 1.5\n", t + 1);
+      fprintf(f, "Radiation Attenuation %d = 0.2\n", t + 1);
+      fprintf(f, "Max Snow Int Capacity %d = 0.003\n", t + 1);
+      fprintf(f, "Mass Release Drip Ratio %d = 0.4\n", t + 1);
+      fprintf(f, "Snow Interception Eff %d = 0.6\n", t + 1);
+      fprintf(f, "Overstory Root Fraction %d = 0.2 0.4 0.4\n", t + 1);
+      fprintf(f, "Overstory Monthly LAI %d =", t + 1);
+      for (m = 0; m < 12; m++)
+        fprintf(f, " %.1f", LAI[t]);
+      fprintf(f, "\nOverstory Monthly Alb %d =", t + 1);
+      for (m = 0; m < 12; m++)
+        fprintf(f, " 0.14");
+      fprintf(f, "\nHeight %d = 25.0 0.5\n", t + 1);
+      fprintf(f, "Maximum Resistance %d = 5000. 600.\n", t + 1);
+      fprintf(f, "Minimum Resistance %d = 666.6 200.\n", t + 1);
+      fprintf(f, "Moisture Threshold %d = 0.33 0.13\n", t + 1);
+      fprintf(f, "Vapor Pressure Deficit %d = 4000 4000\n", t + 1);
+      fprintf(f, "Rpc %d = 0.108 0.108\n", t + 1);
+    }
+    else if (t < 3) {
+      fprintf(f, "Height %d = %.1f\n", t + 1, (t == 1) ? 1.5 : 0.3);
+      fprintf(f, "Maximum Resistance %d = 600.\n", t + 1);
+      fprintf(f, "Minimum Resistance %d = 200.\n", t + 1);
+      fprintf(f, "Moisture Threshold %d = 0.13\n", t + 1);
+      fprintf(f, "Vapor Pressure Deficit %d = 4000\n", t + 1);
+      fprintf(f, "Rpc %d = 0.108\n", t + 1);
+    }
+    if (t > 0 && t < 3) {
+      fprintf(f, "Understory Root Fraction %d = 0.4 0.6 0.0\n", t + 1);
+      fprintf(f, "Understory Monthly LAI %d =", t + 1);
+      for (m = 0; m < 12; m++)
+        fprintf(f, " %.1f", LAI[t]);
+      fprintf(f, "\nUnderstory Monthly Alb %d =", t + 1);
+      for (m = 0; m < 12; m++)
+        fprintf(f, " 0.2");
+      fprintf(f, "\n");
+    }
+    else if (t == 0) {
+      fprintf(f, "Understory Root Fraction %d = 0.4 0.6 0.0\n", t + 1);
+      fprintf(f, "Understory Monthly LAI %d =", t + 1);
+      for (m = 0; m < 12; m++)
+        fprintf(f, " 1.0");
+      fprintf(f, "\nUnderstory Monthly Alb %d =", t + 1);
+      for (m = 0; m < 12; m++)
+        fprintf(f, " 0.2");
+      fprintf(f, "\n");
+    }
+  }
+}
+
+static void WriteConfig(BASIN *B, const char *Dir, int NStations, int NSteps,
+                        int NOptions, char **Options, int Dumps)
+{
+  char FileName[NAMESIZE];
+  int k, x, y, NDays;
+  SYNTHDATE End, Date;
+  FILE *f;
+
+  End.Year = START_YEAR;
+  End.Month = START_MONTH;
+  End.Day = START_DAY;
+  End.Hour = 0;
+  AdvanceHours(&End, (NSteps - 1) * TIMESTEP);
+
+  snprintf(FileName, sizeof(FileName), "%.900s/synth.cfg", Dir);
+  f = Create(FileName, "w");
+  fprintf(f, "# Synthetic %d x %d basin written by BENCH_SynthBasin\n", B->NX, B->NY);
+
+  fprintf(f, "\n[OPTIONS]\n");
+  /* options given on the command line come first, so that they take
+     precedence over the defaults below */
+  for (k = 0; k < NOptions; k++)
+    fprintf(f, "%s\n", Options[k]);
+  if (Dumps)
+    fprintf(f, "Extra Stream Timeseries Data = TRUE\n");
+  fprintf(f, "Extent = BASIN\n");
+  fprintf(f, "Gradient = TOPOGRAPHY\n");
+  fprintf(f, "Profile = TRUE\n");
+  fprintf(f, "Sensible Heat Flux = FALSE\n");
+  fprintf(f, "Overland Routing = CONVENTIONAL\n");
+  fprintf(f, "Infiltration = STATIC\n");
+  fprintf(f, "Interpolation = INVDIST\n");
+  fprintf(f, "Prism = FALSE\n");
+  fprintf(f, "Snow Pattern = FALSE\n");
+  fprintf(f, "Canopy Radiation Attenuation Mode = FIXED\n");
+  fprintf(f, "Shading = FALSE\n");
+  fprintf(f, "Outside = FALSE\n");
+  fprintf(f, "Rhoverride = FALSE\n");
+  fprintf(f, "Temperature Lapse Rate = CONSTANT\n");
+  fprintf(f, "Variable Light Transmittance = FALSE\n");
+  fprintf(f, "Canopy Gapping = FALSE\n");
+  fprintf(f, "Snow Sliding = FALSE\n");
+
+  fprintf(f, "\n[AREA]\n");
+  fprintf(f, "Coordinate System = UTM\n");
+  fprintf(f, "Extreme North = %.1f\n", 5000000.0 + B->NY * B->DX);
+  fprintf(f, "Extreme West = 500000.0\n");
+  fprintf(f, "Center Latitude = 47.0\n");
+  fprintf(f, "Center Longitude = -121.0\n");
+  fprintf(f, "Time Zone Meridian = -120.0\n");
+  fprintf(f, "Number of Rows = %d\n", B->NY);
+  fprintf(f, "Number of Columns = %d\n", B->NX);
+  fprintf(f, "Grid spacing = %g\n", B->DX);
+
+  fprintf(f, "\n[TIME]\n");
+  fprintf(f, "Time Step = %d\n", TIMESTEP);
+  fprintf(f, "Model Start = %02d/%02d/%04d-00\n", START_MONTH, START_DAY, START_YEAR);
+  fprintf(f, "Model End = %02d/%02d/%04d-%02d\n", End.Month, End.Day, End.Year, End.Hour);
+
+  fprintf(f, "\n[CONSTANTS]\n");
+  fprintf(f, "Ground Roughness = 0.02\n");
+  fprintf(f, "Snow Roughness = 0.01\n");
+  fprintf(f, "Snow Water Capacity = 0.03\n");
+  fprintf(f, "Reference Height = 40.0\n");
+  fprintf(f, "Rain LAI Multiplier = 0.0001\n");
+  fprintf(f, "Snow LAI Multiplier = 0.0005\n");
+  fprintf(f, "Min Intercepted Snow = 0.005\n");
+  fprintf(f, "Min Albedo Reset Snowfall = 0.005\n");
+  fprintf(f, "Outside Basin Value = 0\n");
+  fprintf(f, "Temperature Lapse Rate = -0.0065\n");
+  fprintf(f, "Rain Threshold = -1.0\n");
+  fprintf(f, "Snow Threshold = 2.0\n");
+  fprintf(f, "Fresh Snow Albedo = 0.85\n");
+  fprintf(f, "Albedo Accumulation Lambda = 0.92\n");
+  fprintf(f, "Albedo Melting Lambda = 0.70\n");
+  fprintf(f, "Albedo Accumulation Min = 0.75\n");
+  fprintf(f, "Albedo Melting Min = 0.55\n");
+  fprintf(f, "Precipitation Multiplier Map = 1.0\n");
+
+  fprintf(f, "\n[TERRAIN]\n");
+  fprintf(f, "DEM File = %s/input/DEM.bin\n", Dir);
+  fprintf(f, "Basin Mask File = %s/input/Mask.bin\n", Dir);
+
+  fprintf(f, "\n[ROUTING]\n");
+  fprintf(f, "Stream Network File = %s/input/stream.network\n", Dir);
+  fprintf(f, "Stream Map File = %s/input/stream.map\n", Dir);
+  fprintf(f, "Stream Class File = %s/input/stream.class\n", Dir);
+
+  fprintf(f, "\n[METEOROLOGY]\n");
+  fprintf(f, "Number of Stations = %d\n", NStations);
+  for (k = 0; k < NStations; k++) {
+    StationCell(B, NStations, k, &x, &y);
+    fprintf(f, "Station Name %d = Station_%d\n", k + 1, k + 1);
+    fprintf(f, "North Coordinate %d = %.1f\n", k + 1,
+            5000000.0 + B->NY * B->DX - (y + 0.5) * B->DX);
+    fprintf(f, "East Coordinate %d = %.1f\n", k + 1, 500000.0 + (x + 0.5) * B->DX);
+    fprintf(f, "Elevation %d = %.1f\n", k + 1, B->Dem[y * B->NX + x]);
+    fprintf(f, "Station File %d = %s/met/Station_%d.dat\n", k + 1, Dir, k + 1);
+  }
+
+  fprintf(f, "\n[SOILS]\n");
+  fprintf(f, "Soil Map File = %s/input/Soil.bin\n", Dir);
+  fprintf(f, "Soil Depth File = %s/input/SoilDepth.bin\n", Dir);
+  WriteSoilTable(f);
+
+  fprintf(f, "\n[VEGETATION]\n");
+  fprintf(f, "Vegetation Map File = %s/input/Veg.bin\n", Dir);
+  WriteVegTable(f);
+
+  fprintf(f, "\n[OUTPUT]\n");
+  fprintf(f, "Output Directory = %s/output/\n", Dir);
+  fprintf(f, "Initial State Directory = %s/state/\n", Dir);
+  if (!Dumps) {
+    fprintf(f, "Number of Output Pixels = 0\n");
+    fprintf(f, "Number of Model States = 0\n");
+    fprintf(f, "Number of Map Variables = 0\n");
+  }
+  else {
+    fprintf(f, "Number of Output Pixels = %d\n", NStations);
+    for (k = 0; k < NStations; k++) {
+      StationCell(B, NStations, k, &x, &y);
+      fprintf(f, "North Coordinate %d = %.1f\n", k + 1,
+              5000000.0 + B->NY * B->DX - (y + 0.5) * B->DX);
+      fprintf(f, "East Coordinate %d = %.1f\n", k + 1, 500000.0 + (x + 0.5) * B->DX);
+      fprintf(f, "Name %d = Station_%d\n", k + 1, k + 1);
+    }
+    fprintf(f, "Number of Model States = 1\n");
+    fprintf(f, "State Date 1 = %02d/%02d/%04d-%02d\n", End.Month, End.Day, End.Year,
+            End.Hour);
+    /* snow water equivalent, moisture in the top soil layer and water table
+       depth at noon on every day of the run */
+    NDays = (NSteps * TIMESTEP - 12 + 23) / 24;
+    fprintf(f, "Number of Map Variables = 3\n");
+    for (k = 1; k <= 3; k++) {
+      fprintf(f, "Map Variable %d = %d\n", k, (k == 1) ? 404 : ((k == 2) ? 501 : 503));
+      fprintf(f, "Map Layer %d = 1\n", k);
+      fprintf(f, "Number of Maps %d = %d\n", k, NDays);
+      Date.Year = START_YEAR;
+      Date.Month = START_MONTH;
+      Date.Day = START_DAY;
+      Date.Hour = 0;
+      AdvanceHours(&Date, 12);
+      for (x = 1; x <= NDays; x++) {
+        fprintf(f, "Map Date %d %d = %02d/%02d/%04d-%02d\n", x, k, Date.Month,
+                Date.Day, Date.Year, Date.Hour);
+        AdvanceHours(&Date, 24);
+      }
+    }
+  }
+
+  fclose(f);
+}
+
+/*****************************************************************************
+  MakeBasin()
+
+  Writes the complete data set for an N x N basin to Dir
+*****************************************************************************/
+static void MakeBasin(int N, float DX, int Threshold, int NStations, int NSteps,
+                      int NOptions, char **Options, int Dumps, const char *Dir)
+{
+  char Path[NAMESIZE];
+  int NChannelCells = 0;
+  int i;
+  BASIN B;
+
+  B.NX = B.NY = N;
+  B.DX = DX;
+
+  MakeTerrain(&B);
+  MakeSoilVeg(&B);
+  MakeChannels(&B, Threshold);
+
+  MakeDir(Dir);
+  snprintf(Path, sizeof(Path), "%.900s/input", Dir);
+  MakeDir(Path);
+  snprintf(Path, sizeof(Path), "%.900s/met", Dir);
+  MakeDir(Path);
+  snprintf(Path, sizeof(Path), "%.900s/state", Dir);
+  MakeDir(Path);
+  snprintf(Path, sizeof(Path), "%.900s/output", Dir);
+  MakeDir(Path);
+
+  snprintf(Path, sizeof(Path), "%.900s/input/DEM.bin", Dir);
+  WriteMap(Path, B.Dem, sizeof(float), (size_t) N * N);
+  snprintf(Path, sizeof(Path), "%.900s/input/Mask.bin", Dir);
+  WriteMap(Path, B.Mask, sizeof(unsigned char), (size_t) N * N);
+  snprintf(Path, sizeof(Path), "%.900s/input/Soil.bin", Dir);
+  WriteMap(Path, B.Soil, sizeof(unsigned char), (size_t) N * N);
+  snprintf(Path, sizeof(Path), "%.900s/input/SoilDepth.bin", Dir);
+  WriteMap(Path, B.Depth, sizeof(float), (size_t) N * N);
+  snprintf(Path, sizeof(Path), "%.900s/input/Veg.bin", Dir);
+  WriteMap(Path, B.Veg, sizeof(unsigned char), (size_t) N * N);
+
+  snprintf(Path, sizeof(Path), "%.900s/input", Dir);
+  WriteChannels(&B, Path);
+  snprintf(Path, sizeof(Path), "%.900s/met", Dir);
+  WriteMet(&B, Path, NStations, NSteps);
+  snprintf(Path, sizeof(Path), "%.900s/state", Dir);
+  WriteState(&B, Path);
+  WriteConfig(&B, Dir, NStations, NSteps, NOptions, Options, Dumps);
+
+  for (i = 0; i < N * N; i++)
+    if (B.Segment[i])
+      NChannelCells++;
+  printf("  %d x %d cells, %d channel cells in %d segments (threshold %d cells)\n",
+         N, N, NChannelCells, B.NSegments, B.Threshold);
+
+  free(B.Dem);
+  free(B.Soil);
+  free(B.Veg);
+  free(B.Depth);
+  free(B.Mask);
+  free(B.Receiver);
+  free(B.Order);
+  free(B.Segment);
+}
+
+/*****************************************************************************
+  RunModel()
+
+  Runs the model on the configuration in Dir with its output going to
+  Dir/run.log, and picks the number of steps, the initialization time and
+  the total time out of the profile summary.  Returns FALSE if the model
+  failed.
+*****************************************************************************/
+static int RunModel(const char *Model, const char *Dir, int Threads, long *NSteps,
+                    double *InitTime, double *TotalTime, double *Wall, long *PeakRSS)
+{
+  char Config[NAMESIZE];
+  char Log[NAMESIZE];
+  char Line[NAMESIZE];
+  char Value[32];
+  int Status;
+  double Start;
+  pid_t Pid;
+  struct rusage Usage;
+  FILE *f;
+
+  snprintf(Config, sizeof(Config), "%.900s/synth.cfg", Dir);
+  snprintf(Log, sizeof(Log), "%.900s/run.log", Dir);
+
+  fflush(stdout);
+  Start = Seconds();
+  if ((Pid = fork()) < 0)
+    Fail("cannot fork", NULL);
+  if (Pid == 0) {
+    sprintf(Value, "%d", Threads);
+    setenv("OMP_NUM_THREADS", Value, 1);
+    if (!freopen(Log, "w", stdout) || !freopen(Log, "a", stderr))
+      _exit(127);
+    execl(Model, Model, Config, (char *) NULL);
+    _exit(127);
+  }
+  if (wait4(Pid, &Status, 0, &Usage) < 0)
+    Fail("wait failed for", Model);
+  *Wall = Seconds() - Start;
+  *PeakRSS = Usage.ru_maxrss;
+
+  if (!WIFEXITED(Status) || WEXITSTATUS(Status) != 0)
+    return 0;
+
+  *NSteps = 0;
+  *InitTime = *TotalTime = 0.0;
+  if (!(f = fopen(Log, "r")))
+    return 0;
+  while (fgets(Line, NAMESIZE, f)) {
+    if (sscanf(Line, "Profile of %ld time steps", NSteps) == 1)
+      continue;
+    if (sscanf(Line, "Initialization %lf", InitTime) == 1)
+      continue;
+    sscanf(Line, "Total %lf", TotalTime);
+  }
+  fclose(f);
+  return (*NSteps > 0);
+}
+
+static void Usage(const char *Name)
+{
+  fprintf(stderr, "usage: %s [-s sizes] [-t threads] [-n stations] [-d days]\n", Name);
+  fprintf(stderr, "       [-r spacing] [-a threshold] [-x model] [-o directory]\n");
+  fprintf(stderr, "       [-O \"option = value\"] [-g] [-p]\n\n");
+  fprintf(stderr, "  -s  comma separated basin sizes N (N x N cells)  [%s]\n", DEFAULT_SIZES);
+  fprintf(stderr, "  -t  comma separated thread counts                [%s]\n", DEFAULT_THREADS);
+  fprintf(stderr, "  -n  number of met stations                       [%d]\n", DEFAULT_STATIONS);
+  fprintf(stderr, "  -d  length of the run in days                    [%d]\n", DEFAULT_DAYS);
+  fprintf(stderr, "  -r  grid spacing in m                            [%g]\n", DEFAULT_SPACING);
+  fprintf(stderr, "  -a  cells needed to form a channel (0: 0.2 km2)  [0]\n");
+  fprintf(stderr, "  -x  model executable                             [%s]\n", DEFAULT_MODEL);
+  fprintf(stderr, "  -o  output directory                             [%s]\n", DEFAULT_OUTDIR);
+  fprintf(stderr, "  -O  extra [OPTIONS] entry, may be repeated\n");
+  fprintf(stderr, "  -g  only generate the basins, do not run the model\n");
+  fprintf(stderr, "  -p  also write pixel, map and state dumps\n");
+  exit(EXIT_FAILURE);
+}
+
+int main(int argc, char **argv)
+{
+  char Dir[NAMESIZE];
+  char *Sizes = DEFAULT_SIZES;
+  char *ThreadList = DEFAULT_THREADS;
+  char *Model = DEFAULT_MODEL;
+  char *OutDir = DEFAULT_OUTDIR;
+  char *Options[MAXOPTIONS];
+  int NOptions = 0;
+  int NStations = DEFAULT_STATIONS;
+  int NDays = DEFAULT_DAYS;
+  int Threshold = 0;
+  int GenerateOnly = 0;
+  int Dumps = 0;
+  float DX = DEFAULT_SPACING;
+  int Size[MAXLIST], Threads[MAXLIST];
+  int NSizes, NThreads, NCells, i, j, c, NSteps;
+  long Steps, PeakRSS;
+  double Start, InitTime, TotalTime, LoopTime, Wall;
+  FILE *Csv;
+
+  while ((c = getopt(argc, argv, "s:t:n:d:r:a:x:o:O:gph")) != -1) {
+    switch (c) {
+    case 's': Sizes = optarg; break;
+    case 't': ThreadList = optarg; break;
+    case 'n': NStations = atoi(optarg); break;
+    case 'd': NDays = atoi(optarg); break;
+    case 'r': DX = atof(optarg); break;
+    case 'a': Threshold = atoi(optarg); break;
+    case 'x': Model = optarg; break;
+    case 'o': OutDir = optarg; break;
+    case 'O':
+      if (NOptions == MAXOPTIONS)
+        Fail("too many -O options", NULL);
+      Options[NOptions++] = optarg;
+      break;
+    case 'g': GenerateOnly = 1; break;
+    case 'p': Dumps = 1; break;
+    default: Usage(argv[0]);
+    }
+  }
+  if (NStations < 1 || NDays < 1 || DX <= 0.0)
+    Usage(argv[0]);
+
+  NSizes = ParseList(Sizes, Size);
+  for (i = 0; i < NSizes; i++)
+    if (Size[i] < 10)
+      Fail("basin size must be at least 10 cells:", Sizes);
+  NThreads = ParseList(ThreadList, Threads);
+  NSteps = NDays * 24 / TIMESTEP;
+
+  MakeDir(OutDir);
+  snprintf(Dir, sizeof(Dir), "%.900s/scaling.csv", OutDir);
+  Csv = NULL;
+  if (!GenerateOnly) {
+    if (access(Model, X_OK) != 0)
+      Fail("cannot execute model", Model);
+    c = (access(Dir, F_OK) != 0);
+    Csv = Create(Dir, "a");
+    if (c)
+      fprintf(Csv, "Cells,Steps,Stations,Threads,Init(s),Loop(s),Wall(s),"
+              "PeakRSS(kB),CellSteps/s\n");
+  }
+
+  if (NThreads > 1 || Threads[0] > 1)
+    printf("Note: the model is single-threaded; the thread count is only "
+           "passed on as OMP_NUM_THREADS\n");
+
+  if (!GenerateOnly)
+    printf("%10s %8s %8s %8s %10s %10s %10s %12s %14s\n", "Cells", "Steps",
+           "Stations", "Threads", "Init(s)", "Loop(s)", "Wall(s)", "PeakRSS(MB)",
+           "CellSteps/s");
+
+  for (i = 0; i < NSizes; i++) {
+    snprintf(Dir, sizeof(Dir), "%.900s/synth_%d", OutDir, Size[i]);
+    printf("Generating %s\n", Dir);
+    Start = Seconds();
+    MakeBasin(Size[i], DX, Threshold, NStations, NSteps, NOptions, Options, Dumps,
+              Dir);
+    printf("  generated in %.2f s\n", Seconds() - Start);
+    if (GenerateOnly)
+      continue;
+
+    NCells = (Size[i] - 2) * (Size[i] - 2);
+
+    for (j = 0; j < NThreads; j++) {
+      if (!RunModel(Model, Dir, Threads[j], &Steps, &InitTime, &TotalTime,
+                    &Wall, &PeakRSS)) {
+        printf("Model run failed, see %s/run.log\n", Dir);
+        continue;
+      }
+      LoopTime = TotalTime - InitTime;
+      printf("%10d %8ld %8d %8d %10.3f %10.3f %10.3f %12.1f %14.4g\n",
+             NCells, Steps, NStations, Threads[j], InitTime, LoopTime,
+             Wall, PeakRSS / 1024.0,
+             (LoopTime > 0.0) ? (double) NCells * Steps / LoopTime : 0.0);
+      fprintf(Csv, "%d,%ld,%d,%d,%.3f,%.3f,%.3f,%ld,%.6g\n", NCells,
+              Steps, NStations, Threads[j], InitTime, LoopTime, Wall, PeakRSS,
+              (LoopTime > 0.0) ? (double) NCells * Steps / LoopTime : 0.0);
+      fflush(Csv);
+    }
+  }
+
+  if (Csv)
+    fclose(Csv);
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,324 @@
+/*
+ * SUMMARY:      Bundle.c - Precompiled basin bundle
+ * USAGE:        Part of DHSVM
+ *
+ * DESCRIPTION:  With [OPTIONS] BASIN BUNDLE = <file> the static basin data
+ *               that every run derives in the same way are stored in one
+ *               binary file the first time they are computed, and loaded
+ *               from it with a few large reads on later runs:
+ *                 - the terrain, i.e. TopoMap as set up by InitTopoMap()
+ *                   (elevation, mask, lakes, slope, aspect and flow
+ *                   directions) and the basin cells ranked by elevation
+ *                   (MAPSIZE.OrderedCells)
+ *                 - the met station interpolation weights (CalcWeights())
+ *
+ *               The file holds a BUNDLEHEADER, the terrain section (NY rows
+ *               of NX TOPOPIX followed by NumCells ITEMs) and the weights
+ *               section (NStats weights per pixel, row by row).  Each section
+ *               is stored with a hash of its inputs: the settings it depends
+ *               on and the contents of the input maps, so that an edited map
+ *               is noticed whatever its size and time stamps.  A section
+ *               whose key does not match the current run is computed as
+ *               usual and replaces the one in the bundle.
+ *               Numbers are stored in the byte order of the machine.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "settings.h"
+#include "data.h"
+#include "DHSVMerror.h"
+#include "fileio.h"
+#include "bundle.h"
+#include "memtrack.h"
+
+#define FNV_OFFSET 14695981039346656037ULL
+#define FNV_PRIME  1099511628211ULL
+
+static BUNDLEHEADER Header;
+static unsigned long long TerrainKey = 0;  /* Keys of the current run */
+static unsigned long long WeightsKey = 0;
+
+static void HashBytes(unsigned long long *Key, const void *Data, size_t Size);
+static int HashFile(unsigned long long *Key, char *FileName);
+static int ReadBundleHeader(char *FileName, MAPSIZE *Map);
+
+/*****************************************************************************
+  LoadBundleTerrain()
+
+  Load TopoMap and the ordered basin cells from the bundle.  Returns FALSE if
+  there is no bundle or its terrain does not match the input maps, in which
+  case InitTopoMap() derives the terrain and stores it with
+  StoreBundleTerrain().
+*****************************************************************************/
+int LoadBundleTerrain(OPTIONSTRUCT *Options, MAPSIZE *Map, TOPOPIX **TopoMap,
+                      char *DemFile, char *MaskFile, char *LakeFile)
+{
+  FILE *InFile = NULL;
+  int x, y;
+  int Version = BUNDLE_VERSION;
+
+  if (!Options->Bundle)
+    return FALSE;
+
+  TerrainKey = FNV_OFFSET;
+  HashBytes(&TerrainKey, &Version, sizeof(Version));
+  HashBytes(&TerrainKey, &(Map->Xorig), sizeof(Map->Xorig));
+  HashBytes(&TerrainKey, &(Map->Yorig), sizeof(Map->Yorig));
+  HashBytes(&TerrainKey, &(Map->NX), sizeof(Map->NX));
+  HashBytes(&TerrainKey, &(Map->NY), sizeof(Map->NY));
+  HashBytes(&TerrainKey, &(Map->DX), sizeof(Map->DX));
+  HashBytes(&TerrainKey, &(Map->DY), sizeof(Map->DY));
+  HashBytes(&TerrainKey, &(Map->OffsetX), sizeof(Map->OffsetX));
+  HashBytes(&TerrainKey, &(Map->OffsetY), sizeof(Map->OffsetY));
+  HashBytes(&TerrainKey, &(Map->NumLakes), sizeof(Map->NumLakes));
+  HashBytes(&TerrainKey, &(Options->MultiFlowDir), sizeof(Options->MultiFlowDir));
+  HashBytes(&TerrainKey, &(Options->Extent), sizeof(Options->Extent));
+  HashBytes(&TerrainKey, &(Options->PointX), sizeof(Options->PointX));
+  HashBytes(&TerrainKey, &(Options->PointY), sizeof(Options->PointY));
+  HashBytes(&TerrainKey, &(Options->LakeDynamics), sizeof(Options->LakeDynamics));
+  if (!HashFile(&TerrainKey, DemFile) || !HashFile(&TerrainKey, MaskFile) ||
+      (Options->LakeDynamics && !HashFile(&TerrainKey, LakeFile))) {
+    /* Let the map reader report the missing file */
+    TerrainKey = 0;
+    return FALSE;
+  }
+
+  if (!ReadBundleHeader(Options->BundleFile, Map) ||
+      Header.TerrainKey != TerrainKey)
+    return FALSE;
+
+  OpenFile(&InFile, Options->BundleFile, "rb", FALSE);
+  if (fseek(InFile, Header.TerrainOffset, SEEK_SET))
+    ReportError(Options->BundleFile, 2);
+  for (y = 0; y < Map->NY; y++) {
+    if (fread(TopoMap[y], sizeof(TOPOPIX), Map->NX, InFile) != (size_t) Map->NX)
+      ReportError(Options->BundleFile, 2);
+    for (x = 0; x < Map->NX; x++)
+      TopoMap[y][x].OrderedTopoIndex = NULL;
+  }
+  Map->NumCells = Header.NumCells;
+  if (!(Map->OrderedCells = (ITEM *) TrackCalloc(Map->NumCells, sizeof(ITEM), MEM_TERRAIN)))
+    ReportError("LoadBundleTerrain", 1);
+  if (fread(Map->OrderedCells, sizeof(ITEM), Map->NumCells, InFile) !=
+      (size_t) Map->NumCells)
+    ReportError(Options->BundleFile, 2);
+  fclose(InFile);
+
+  printf("Terrain loaded from basin bundle %s\n", Options->BundleFile);
+  return TRUE;
+}
+
+/*****************************************************************************
+  StoreBundleTerrain()
+
+  Start a new bundle with the terrain derived by InitTopoMap().  The bundle
+  is written to a temporary file that replaces the old one when it is
+  complete.
+*****************************************************************************/
+void StoreBundleTerrain(OPTIONSTRUCT *Options, MAPSIZE *Map,
+                        TOPOPIX **TopoMap)
+{
+  FILE *OutFile = NULL;
+  char TempName[BUFSIZE + 5];
+  int y;
+
+  if (!Options->Bundle || TerrainKey == 0)
+    return;
+
+  memset(&Header, 0, sizeof(BUNDLEHEADER));
+  memcpy(Header.Magic, BUNDLE_MAGIC, sizeof(Header.Magic));
+  Header.Version = BUNDLE_VERSION;
+  Header.NX = Map->NX;
+  Header.NY = Map->NY;
+  Header.NumCells = Map->NumCells;
+  Header.TerrainKey = TerrainKey;
+  Header.TerrainOffset = sizeof(BUNDLEHEADER);
+  Header.WeightsOffset = Header.TerrainOffset +
+    (long) Map->NX * Map->NY * sizeof(TOPOPIX) + (long) Map->NumCells * sizeof(ITEM);
+
+  sprintf(TempName, "%s.tmp", Options->BundleFile);
+  OpenFile(&OutFile, TempName, "wb", TRUE);
+  if (fwrite(&Header, sizeof(BUNDLEHEADER), 1, OutFile) != 1)
+    ReportError(TempName, 2);
+  for (y = 0; y < Map->NY; y++)
+    if (fwrite(TopoMap[y], sizeof(TOPOPIX), Map->NX, OutFile) != (size_t) Map->NX)
+      ReportError(TempName, 2);
+  if (fwrite(Map->OrderedCells, sizeof(ITEM), Map->NumCells, OutFile) !=
+      (size_t) Map->NumCells)
+    ReportError(TempName, 2);
+  if (fclose(OutFile) != 0 || rename(TempName, Options->BundleFile) != 0)
+    ReportError(TempName, 2);
+
+  printf("Terrain stored in basin bundle %s\n", Options->BundleFile);
+}
+
+/*****************************************************************************
+  LoadBundleWeights()
+
+  Load the interpolation weights from the bundle, allocated as CalcWeights()
+  does.  Returns FALSE if the bundle has no weights for the current stations
+  and interpolation settings.
+*****************************************************************************/
+int LoadBundleWeights(OPTIONSTRUCT *Options, MAPSIZE *Map, METLOCATION *Stat,
+                      int NStats, uchar ****WeightArray)
+{
+  FILE *InFile = NULL;
+  uchar *Row;
+  int i, x, y;
+
+  if (!Options->Bundle || TerrainKey == 0)
+    return FALSE;
+  /* CalcWeights() changes the interpolation in this case */
+  if (NStats > (int) MAXUCHAR && Options->Interpolation == UNIFORM)
+    return FALSE;
+
+  WeightsKey = TerrainKey;
+  HashBytes(&WeightsKey, &NStats, sizeof(NStats));
+  for (i = 0; i < NStats; i++)
+    HashBytes(&WeightsKey, &(Stat[i].Loc), sizeof(COORD));
+  HashBytes(&WeightsKey, &(Options->Interpolation), sizeof(Options->Interpolation));
+  HashBytes(&WeightsKey, &(Options->MaxInterpDist), sizeof(Options->MaxInterpDist));
+  HashBytes(&WeightsKey, &(Options->CressRadius), sizeof(Options->CressRadius));
+  HashBytes(&WeightsKey, &(Options->CressStations), sizeof(Options->CressStations));
+
+  if (!ReadBundleHeader(Options->BundleFile, Map) ||
+      Header.TerrainKey != TerrainKey || Header.WeightsKey != WeightsKey ||
+      Header.NStats != NStats)
+    return FALSE;
+
+  OpenFile(&InFile, Options->BundleFile, "rb", FALSE);
+  if (fseek(InFile, Header.WeightsOffset, SEEK_SET))
+    ReportError(Options->BundleFile, 2);
+  if (!((*WeightArray) = (uchar ***) TrackCalloc(Map->NY, sizeof(uchar **), MEM_METWEIGHTS)))
+    ReportError("LoadBundleWeights", 1);
+  for (y = 0; y < Map->NY; y++) {
+    if (!((*WeightArray)[y] = (uchar **) TrackCalloc(Map->NX, sizeof(uchar *), MEM_METWEIGHTS)) ||
+        !(Row = (uchar *) TrackCalloc(Map->NX * NStats, sizeof(uchar), MEM_METWEIGHTS)))
+      ReportError("LoadBundleWeights", 1);
+    if (fread(Row, sizeof(uchar), Map->NX * NStats, InFile) != (size_t) (Map->NX * NStats))
+      ReportError(Options->BundleFile, 2);
+    for (x = 0; x < Map->NX; x++)
+      (*WeightArray)[y][x] = Row + x * NStats;
+  }
+  fclose(InFile);
+
+  printf("Interpolation weights loaded from basin bundle %s\n",
+         Options->BundleFile);
+  return TRUE;
+}
+
+/*****************************************************************************
+  StoreBundleWeights()
+
+  Add the weights computed by CalcWeights() to the bundle, replacing the
+  weights stored earlier.  The terrain section is kept.
+*****************************************************************************/
+void StoreBundleWeights(OPTIONSTRUCT *Options, MAPSIZE *Map, int NStats,
+                        uchar ***WeightArray)
+{
+  FILE *OutFile = NULL;
+  int x, y;
+
+  if (!Options->Bundle || WeightsKey == 0 ||
+      !ReadBundleHeader(Options->BundleFile, Map) ||
+      Header.TerrainKey != TerrainKey)
+    return;
+
+  OpenFile(&OutFile, Options->BundleFile, "r+b", FALSE);
+  if (fseek(OutFile, Header.WeightsOffset, SEEK_SET))
+    ReportError(Options->BundleFile, 2);
+  for (y = 0; y < Map->NY; y++)
+    for (x = 0; x < Map->NX; x++)
+      if (fwrite(WeightArray[y][x], sizeof(uchar), NStats, OutFile) != (size_t) NStats)
+        ReportError(Options->BundleFile, 2);
+
+  Header.NStats = NStats;
+  Header.WeightsKey = WeightsKey;
+  rewind(OutFile);
+  if (fwrite(&Header, sizeof(BUNDLEHEADER), 1, OutFile) != 1 ||
+      fflush(OutFile) != 0 ||
+      ftruncate(fileno(OutFile), Header.WeightsOffset +
+                (long) Map->NX * Map->NY * NStats) != 0)
+    ReportError(Options->BundleFile, 2);
+  fclose(OutFile);
+
+  printf("Interpolation weights stored in basin bundle %s\n",
+         Options->BundleFile);
+}
+
+/*****************************************************************************
+  HashBytes()
+
+  Add Size bytes to a 64-bit FNV-1a hash
+*****************************************************************************/
+static void HashBytes(unsigned long long *Key, const void *Data, size_t Size)
+{
+  const unsigned char *Byte = (const unsigned char *) Data;
+  size_t i;
+
+  for (i = 0; i < Size; i++)
+    *Key = (*Key ^ Byte[i]) * FNV_PRIME;
+}
+
+/*****************************************************************************
+  HashFile()
+
+  Add the size and contents of a file to a hash.  Returns FALSE if the file
+  cannot be read.
+*****************************************************************************/
+static int HashFile(unsigned long long *Key, char *FileName)
+{
+  FILE *InFile = NULL;
+  unsigned char Buffer[65536];
+  long long Size = 0;
+  size_t NRead;
+  int Valid;
+
+  if ((InFile = fopen(FileName, "rb")) == NULL)
+    return FALSE;
+  while ((NRead = fread(Buffer, 1, sizeof(Buffer), InFile)) > 0) {
+    HashBytes(Key, Buffer, NRead);
+    Size += NRead;
+  }
+  Valid = !ferror(InFile);
+  fclose(InFile);
+  HashBytes(Key, &Size, sizeof(Size));
+  return Valid;
+}
+
+/*****************************************************************************
+  ReadBundleHeader()
+
+  Read the header of the bundle into Header.  Returns FALSE if there is no
+  bundle, or if it is not a bundle for the current model grid.
+*****************************************************************************/
+static int ReadBundleHeader(char *FileName, MAPSIZE *Map)
+{
+  FILE *InFile = NULL;
+  struct stat Stat;
+  long Size;
+  int Valid;
+
+  if (stat(FileName, &Stat) != 0 || (InFile = fopen(FileName, "rb")) == NULL)
+    return FALSE;
+  Valid = (fread(&Header, sizeof(BUNDLEHEADER), 1, InFile) == 1);
+  fclose(InFile);
+
+  if (Valid)
+    Valid = !memcmp(Header.Magic, BUNDLE_MAGIC, sizeof(Header.Magic)) &&
+      Header.Version == BUNDLE_VERSION && Header.NX == Map->NX &&
+      Header.NY == Map->NY;
+  if (Valid) {
+    Size = Header.WeightsOffset;
+    if (Header.WeightsKey != 0)
+      Size += (long) Map->NX * Map->NY * Header.NStats;
+    Valid = ((long) Stat.st_size >= Size);
+  }
+  if (!Valid)
+    memset(&Header, 0, sizeof(BUNDLEHEADER));
+  return Valid;
+}
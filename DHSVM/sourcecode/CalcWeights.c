@@ -8,6 +8,7 @@
 #include "data.h"
 #include "DHSVMerror.h"
 #include "functions.h"
+#include "memtrack.h"
 
  /*****************************************************************************
    Function name: CalcWeights()
@@ -65,16 +66,16 @@ void CalcWeights(METLOCATION * Station, int NStats, int NX, int NY,
   if (DEBUG)
     printf("Calculating interpolation weights for %d stations\n", NStats);
 
-  if (!((*WeightArray) = (uchar ***)calloc(NY, sizeof(uchar **))))
+  if (!((*WeightArray) = (uchar ***)TrackCalloc(NY, sizeof(uchar **), MEM_METWEIGHTS)))
     ReportError("CalcWeights()", 1);
 
   for (y = 0; y < NY; y++)
-    if (!((*WeightArray)[y] = (uchar **)calloc(NX, sizeof(uchar *))))
+    if (!((*WeightArray)[y] = (uchar **)TrackCalloc(NX, sizeof(uchar *), MEM_METWEIGHTS)))
       ReportError("CalcWeights()", 1);
 
   for (y = 0; y < NY; y++)
     for (x = 0; x < NX; x++)
-      if (!((*WeightArray)[y][x] = (uchar *)calloc(NStats, sizeof(uchar))))
+      if (!((*WeightArray)[y][x] = (uchar *)TrackCalloc(NStats, sizeof(uchar), MEM_METWEIGHTS)))
         ReportError("CalcWeights()", 1);
 
   /* Allocate memory for the array that will contain weights, and the array for
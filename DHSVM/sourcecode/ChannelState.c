@@ -62,7 +62,7 @@ void ReadChannelState(char *Path, DATE *Now, Channel *Head)
   if (Record == NULL)
     ReportError("ReadChannelState", 1);
   for (i = 0; i < NLines; i++) {
-    if (fscanf(InFile, "%hu %f", &(Record[i].id), &(Record[i].storage)) == EOF)
+    if (fscanf(InFile, "%u %f", &(Record[i].id), &(Record[i].storage)) == EOF)
       ReportError(InFileName, 2);
   }
   qsort(Record, NLines, sizeof(RECORDSTRUCT), CompareRecord);
@@ -115,7 +115,7 @@ void StoreChannelState(char *Path, DATE * Now, Channel * Head)
   /* Store data */
   Current = Head;
   while (Current) {
-    fprintf(OutFile, "%12hu ", Current->id);
+    fprintf(OutFile, "%12u ", Current->id);
     fprintf(OutFile, "%12g\n", Current->storage);
     Current = Current->next;
   }
@@ -152,7 +152,7 @@ void StoreChannelStateExtra(char *Path, DATE * Now, Channel * Head)
   /* Store data */
   Current = Head;
   while (Current) {
-    fprintf(OutFile, "%12hu ", Current->id);
+    fprintf(OutFile, "%12u ", Current->id);
     fprintf(OutFile, "%12g ", Current->storage);
     fprintf(OutFile, "%12g ", Current->inflow);
     fprintf(OutFile, "%12g ", Current->lateral_inflow);
@@ -179,7 +179,7 @@ int CompareRecord(const void *record1, const void *record2)
   x = (RECORDSTRUCT *) record1;
   y = (RECORDSTRUCT *) record2;
 
-  return (int) x->id - y->id;
+  return (x->id > y->id) - (x->id < y->id);
 }
 
 /*****************************************************************************
@@ -196,5 +196,5 @@ int CompareRecordID(const void *key, const void *record)
   x = (SegmentID *) key;
   y = (RECORDSTRUCT *) record;
 
-  return (int) (*x - y->id);
+  return (*x > y->id) - (*x < y->id);
 }
@@ -0,0 +1,247 @@
+/*
+ * SUMMARY:      Counters.c - Counts of solver iterations and sub-steps
+ * USAGE:        Part of DHSVM
+ *
+ * DESCRIPTION:  With COUNTERS = TRUE the events listed in enum COUNTER
+ *               (counters.h) are counted for each pixel over the whole run,
+ *               and in total for each time step.  The pixel counts can be
+ *               written as maps (variable IDs 901 - 906) through the usual
+ *               map output; the step totals, the number of surface routing
+ *               sub-steps and the pixel that limited them are written to
+ *               Counters.csv in the output directory.  The pixels with the
+ *               highest counts are listed at the end of the run.
+ *
+ *               Channel events are attributed to the lowest pixel of the
+ *               channel segment.
+ *
+ *               When counting is off the hooks return immediately.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "settings.h"
+#include "data.h"
+#include "DHSVMerror.h"
+#include "DHSVMChannel.h"
+#include "fileio.h"
+#include "functions.h"
+#include "counters.h"
+#include "memtrack.h"
+
+static const char *CounterName[CNT_NCOUNTERS] = {
+  "BrentEvaluations", "BrentBrackets", "SurfaceCellSteps", "SubStepLimits",
+  "LayerMatching", "ChannelKClamps"
+};
+
+static int CountersOn = FALSE;
+static int NX = 0;
+static int NY = 0;
+static unsigned int *Count[CNT_NCOUNTERS]; /* Run totals per pixel */
+static unsigned long StepCount[CNT_NCOUNTERS];
+static unsigned long TotalCount[CNT_NCOUNTERS];
+static unsigned long MaxStepCount[CNT_NCOUNTERS];
+static ChannelIndex *SegmentIndex = NULL;
+static int *SegmentCell = NULL;       /* Lowest pixel (y * NX + x) of each segment,
+                                         by slot in SegmentIndex */
+static int SubSteps = 0;              /* Surface routing sub-steps in this step */
+static int LimitY = -1;               /* Pixel that set them */
+static int LimitX = -1;
+static int MaxSubSteps = 0;
+static long TotalSubSteps = 0;
+static long NSteps = 0;
+static FILE *CountersFile = NULL;
+
+/*****************************************************************************
+  InitCounters()
+
+  Allocates the pixel counts if Options->Counters is set and finds the
+  lowest pixel of each channel segment
+*****************************************************************************/
+void InitCounters(OPTIONSTRUCT *Options, MAPSIZE *Map, TOPOPIX **TopoMap,
+                  CHANNEL *ChannelData, char *Path)
+{
+  const char *Routine = "InitCounters";
+  char FileName[BUFSIZE + 1];
+  ChannelMapPtr Cell;
+  int i, x, y;
+
+  CountersOn = Options->Counters;
+  if (!CountersOn)
+    return;
+
+  NX = Map->NX;
+  NY = Map->NY;
+  for (i = 0; i < CNT_NCOUNTERS; i++) {
+    if (!(Count[i] = (unsigned int *) TrackCalloc(NX * NY, sizeof(unsigned int), MEM_DIAGNOSTICS)))
+      ReportError((char *) Routine, 1);
+    StepCount[i] = 0;
+    TotalCount[i] = 0;
+    MaxStepCount[i] = 0;
+  }
+
+  if (ChannelData != NULL && ChannelData->streams != NULL &&
+      ChannelData->stream_map != NULL) {
+    if (!(SegmentIndex = channel_index_create(ChannelData->streams)))
+      ReportError((char *) Routine, 1);
+    if (!(SegmentCell = (int *) TrackMalloc(SegmentIndex->size * sizeof(int), MEM_DIAGNOSTICS)))
+      ReportError((char *) Routine, 1);
+    for (i = 0; i < (int) SegmentIndex->size; i++)
+      SegmentCell[i] = -1;
+    for (y = 0; y < NY; y++) {
+      for (x = 0; x < NX; x++) {
+        for (Cell = ChannelData->stream_map[x][y]; Cell != NULL; Cell = Cell->next) {
+          i = channel_index_slot(SegmentIndex, Cell->channel->id);
+          if (SegmentCell[i] < 0 ||
+              TopoMap[y][x].Dem < TopoMap[SegmentCell[i] / NX][SegmentCell[i] % NX].Dem)
+            SegmentCell[i] = y * NX + x;
+        }
+      }
+    }
+  }
+
+  sprintf(FileName, "%sCounters.csv", Path);
+  OpenFile(&CountersFile, FileName, "w", TRUE);
+  fprintf(CountersFile, "Date");
+  for (i = 0; i < CNT_NCOUNTERS; i++)
+    if (i != CNT_DTLIMIT)
+      fprintf(CountersFile, ",%s", CounterName[i]);
+  fprintf(CountersFile, ",SurfaceSubSteps,LimitingRow,LimitingColumn\n");
+}
+
+/*****************************************************************************
+  CountEvent()
+
+  Adds n events of type Counter at pixel (y, x)
+*****************************************************************************/
+void CountEvent(int Counter, int y, int x, unsigned int n)
+{
+  if (!CountersOn)
+    return;
+
+  Count[Counter][y * NX + x] += n;
+  StepCount[Counter] += n;
+}
+
+/*****************************************************************************
+  CountSegmentEvent()
+
+  Counts an event of channel segment id at the lowest pixel of the segment
+*****************************************************************************/
+void CountSegmentEvent(int Counter, SegmentID id)
+{
+  int n;
+
+  if (!CountersOn)
+    return;
+
+  if (SegmentCell != NULL) {
+    n = channel_index_slot(SegmentIndex, id);
+    if (SegmentCell[n] >= 0)
+      Count[Counter][SegmentCell[n]]++;
+  }
+  StepCount[Counter]++;
+}
+
+/*****************************************************************************
+  CountSubSteps()
+
+  Records the number of surface routing sub-steps of this time step and the
+  pixel (y, x) that set them, or y < 0 if none did
+*****************************************************************************/
+void CountSubSteps(int NSubSteps, int y, int x)
+{
+  if (!CountersOn)
+    return;
+
+  SubSteps = NSubSteps;
+  LimitY = y;
+  LimitX = x;
+  if (y >= 0)
+    CountEvent(CNT_DTLIMIT, y, x, 1);
+}
+
+/*****************************************************************************
+  CounterValue()
+*****************************************************************************/
+unsigned int CounterValue(int Counter, int y, int x)
+{
+  if (!CountersOn)
+    return 0;
+  return Count[Counter][y * NX + x];
+}
+
+/*****************************************************************************
+  CountersEndStep()
+
+  Writes the totals of the step that just finished to Counters.csv and adds
+  them to the run totals
+*****************************************************************************/
+void CountersEndStep(DATE *Current)
+{
+  char buffer[32];
+  int i;
+
+  if (!CountersOn)
+    return;
+
+  SPrintDate(Current, buffer);
+  fprintf(CountersFile, "%s", buffer);
+  for (i = 0; i < CNT_NCOUNTERS; i++)
+    if (i != CNT_DTLIMIT)
+      fprintf(CountersFile, ",%lu", StepCount[i]);
+  fprintf(CountersFile, ",%d,%d,%d\n", SubSteps, LimitY, LimitX);
+
+  for (i = 0; i < CNT_NCOUNTERS; i++) {
+    TotalCount[i] += StepCount[i];
+    if (StepCount[i] > MaxStepCount[i])
+      MaxStepCount[i] = StepCount[i];
+    StepCount[i] = 0;
+  }
+  TotalSubSteps += SubSteps;
+  if (SubSteps > MaxSubSteps)
+    MaxSubSteps = SubSteps;
+  SubSteps = 0;
+  LimitY = -1;
+  LimitX = -1;
+  NSteps++;
+}
+
+/*****************************************************************************
+  CountersReport()
+
+  Prints the run totals and the pixel with the highest count of each event
+*****************************************************************************/
+void CountersReport(FILE *OutFile)
+{
+  unsigned int Max;
+  int i, k, MaxCell;
+
+  if (!CountersOn)
+    return;
+
+  fprintf(OutFile, "\nCounters for %ld time steps:\n", NSteps);
+  fprintf(OutFile, "%-20s %14s %12s %12s %20s\n", "Event", "Total", "Mean/step",
+          "Max/step", "Max pixel (row col)");
+  for (i = 0; i < CNT_NCOUNTERS; i++) {
+    Max = 0;
+    MaxCell = -1;
+    for (k = 0; k < NX * NY; k++) {
+      if (Count[i][k] > Max) {
+        Max = Count[i][k];
+        MaxCell = k;
+      }
+    }
+    fprintf(OutFile, "%-20s %14lu %12.1f %12lu", CounterName[i], TotalCount[i],
+            (NSteps > 0) ? (double) TotalCount[i] / NSteps : 0.0, MaxStepCount[i]);
+    if (MaxCell >= 0)
+      fprintf(OutFile, " %10u (%d %d)", Max, MaxCell / NX, MaxCell % NX);
+    fprintf(OutFile, "\n");
+  }
+  fprintf(OutFile, "%-20s %14ld %12.1f %12d\n", "SurfaceSubSteps", TotalSubSteps,
+          (NSteps > 0) ? (double) TotalSubSteps / NSteps : 0.0, MaxSubSteps);
+
+  if (CountersFile != NULL) {
+    fclose(CountersFile);
+    CountersFile = NULL;
+  }
+}
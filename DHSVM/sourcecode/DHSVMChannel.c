@@ -10,6 +10,7 @@
 #include "settings.h"
 #include "errorhandler.h"
 #include "fileio.h"
+#include "streamoutput.h"
 
 /* -----------------------------------------------------------------------------
    InitChannel
@@ -89,7 +90,7 @@ InitChannel(LISTPTR Input, MAPSIZE *Map, int deltat, CHANNEL *ChannelData,
         if (LType[i].OutletID != 0) {
           LType[i].outlet = channel_find_segment(ChannelData->streams, LType[i].OutletID);
           if (LType[i].outlet == NULL) {
-            printf("ERROR! cannot find outlet (%d) for lake %d", LType[i].OutletID, i);
+            printf("ERROR! cannot find outlet (%u) for lake %d", LType[i].OutletID, i);
           } else {
             LType[i].outlet->IntersectsLake = FALSE;
             LType[i].outlet->lake = NULL;
@@ -113,12 +114,16 @@ void InitChannelDump(OPTIONSTRUCT *Options, CHANNEL * ChannelData,
   char buffer[NAMESIZE];
 
   if (ChannelData->streams != NULL) {
-    if (Options->SaveExtraStreamData) {
-      sprintf(buffer, "%sStream.Flow", DumpPath);
-      OpenFile(&(ChannelData->streamout), buffer, "w", TRUE);
+    if (Options->StreamBinary)
+      InitStreamBinary(DumpPath, ChannelData->streams, Options->StreamDaily);
+    else {
+      if (Options->SaveExtraStreamData) {
+        sprintf(buffer, "%sStream.Flow", DumpPath);
+        OpenFile(&(ChannelData->streamout), buffer, "w", TRUE);
+      }
+      sprintf(buffer, "%sStreamflow.Only", DumpPath);
+      OpenFile(&(ChannelData->streamflowout), buffer, "w", TRUE);
     }
-    sprintf(buffer, "%sStreamflow.Only", DumpPath);
-    OpenFile(&(ChannelData->streamflowout), buffer, "w", TRUE);
   }
 }
 
@@ -248,10 +253,13 @@ RouteChannel(CHANNEL *ChannelData, TIMESTRUCT *Time, MAPSIZE *Map,
     }
   }
   
-  channel_save_outflow_text(buffer, ChannelData->streams,
-                            ChannelData->streamout,
-                            ChannelData->streamflowout, flag,
-                            Options->SaveExtraStreamData);
+  if (Options->StreamBinary)
+    WriteStreamBinary(Time);
+  else
+    channel_save_outflow_text(buffer, ChannelData->streams,
+                              ChannelData->streamout,
+                              ChannelData->streamflowout, flag,
+                              Options->SaveExtraStreamData);
   
 }
 
@@ -0,0 +1,81 @@
+/*
+ * SUMMARY:      DiagLog.c - Buffered per-step scalar diagnostics
+ * USAGE:        Part of DHSVM
+ *
+ * DESCRIPTION:  Writes a time series of one value per time step for each of
+ *               the diagnostics in enum DIAGLOG (see diaglog.h), one line
+ *               (the date and the value) per call to DiagLog().  The file of
+ *               a diagnostic is opened the first time it is written and
+ *               stays open for the rest of the run, with a large stdio
+ *               buffer, so a time step does not cost an open and a close of
+ *               the file.  The files are appended to, as before.
+ *
+ *               InitDiagLogs() is called again by each forecast scenario,
+ *               which then writes the diagnostics in its own directory.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "settings.h"
+#include "data.h"
+#include "DHSVMerror.h"
+#include "fileio.h"
+#include "diaglog.h"
+
+#define DIAGLOG_BUFFER (64 << 10)   /* Bytes of the stdio buffer of a file */
+
+static const char *LogName[DIAG_NLOGS] = {
+  "saturation_extent.txt"
+};
+
+static const char *LogFormat[DIAG_NLOGS] = {
+  "%-20s %.4f \n"
+};
+
+static FILES LogFile[DIAG_NLOGS];
+static char *LogBuffer[DIAG_NLOGS];
+static char LogPath[BUFSIZE + 1] = "";
+
+/*****************************************************************************
+  InitDiagLogs()
+
+  Sets the directory of the diagnostics files, closing the files of a
+  previous directory
+*****************************************************************************/
+void InitDiagLogs(char *Path)
+{
+  int i;
+
+  for (i = 0; i < DIAG_NLOGS; i++) {
+    if (LogFile[i].FilePtr != NULL) {
+      fclose(LogFile[i].FilePtr);
+      LogFile[i].FilePtr = NULL;
+    }
+  }
+  strncpy(LogPath, Path, BUFSIZE);
+  LogPath[BUFSIZE] = '\0';
+}
+
+/*****************************************************************************
+  DiagLog()
+
+  Writes the value of diagnostic Log for the time step Current
+*****************************************************************************/
+void DiagLog(int Log, DATE *Current, float Value)
+{
+  char Date[32];
+
+  if (LogFile[Log].FilePtr == NULL) {
+    sprintf(LogFile[Log].FileName, "%s%s", LogPath, LogName[Log]);
+    OpenFile(&(LogFile[Log].FilePtr), LogFile[Log].FileName, "a", TRUE);
+    if (LogBuffer[Log] == NULL &&
+        !(LogBuffer[Log] = (char *) malloc(DIAGLOG_BUFFER)))
+      ReportError("DiagLog", 1);
+    setvbuf(LogFile[Log].FilePtr, LogBuffer[Log], _IOFBF, DIAGLOG_BUFFER);
+  }
+
+  SPrintDate(Current, Date);
+  if (fprintf(LogFile[Log].FilePtr, LogFormat[Log], Date, Value) < 0)
+    ReportError(LogFile[Log].FileName, 41);
+}
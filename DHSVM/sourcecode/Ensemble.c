@@ -0,0 +1,700 @@
+/*
+ * SUMMARY:      Ensemble.c - Lockstep parameter ensemble
+ * USAGE:        Part of DHSVM
+ *
+ * DESCRIPTION:  With [OPTIONS] ENSEMBLE FILE set, one run advances several
+ *               ensemble members that differ only in entries of the
+ *               [CONSTANTS] section (calibration adjustments, snow
+ *               thresholds, multipliers, ...).  The ensemble file lists the
+ *               members, one per line:
+ *
+ *               # Member  SOIL_CONDUCTIVITY_ADJUST  VEG_LAI_ADJUST
+ *               Member    SOIL_CONDUCTIVITY_ADJUST  VEG_LAI_ADJUST
+ *               base      1.0                       1.0
+ *               ksat2     2.0                       1.0
+ *
+ *               The first line that is not a comment names the [CONSTANTS]
+ *               keys, with underscores for blanks.  Each key must be present
+ *               in the input file, which gives the base value.
+ *
+ *               The static inputs that do not depend on the constants (the
+ *               DEM, mask and cell ordering, the met stations, the
+ *               interpolation weights, the sky view and the monthly shade
+ *               maps of the run) are loaded once, after which a process is
+ *               forked for every member.  The members share these inputs
+ *               copy-on-write and build their own soil, vegetation, channel
+ *               and state.  The original process reads the met records of
+ *               every time step once and passes them to the members through
+ *               shared memory, at most ENSEMBLE_RING steps ahead of the
+ *               slowest member, so that the members run in lockstep.
+ *
+ *               Each member writes to <OUTPUT DIRECTORY>/<member>/, with its
+ *               standard output and error in stdout.txt and stderr.txt.
+ *
+ *               With [OPTIONS] FORECAST FILE set, the run is a forecast
+ *               ensemble instead.  The model runs with the station files of
+ *               the input file up to FORECAST START, and then forks a
+ *               process for every scenario in the forecast file, which has
+ *               the same layout with [METEOROLOGY] station file keys:
+ *
+ *               Scenario  STATION_FILE_1       STATION_FILE_2
+ *               s01       fcst/s01/station_1   fcst/s01/station_2
+ *
+ *               The scenarios share the state at FORECAST START and all
+ *               static inputs copy-on-write.  Each reads its own station
+ *               files (stations that are not listed keep their file) and
+ *               writes to <OUTPUT DIRECTORY>/<scenario>/ as if the run was
+ *               restarted at FORECAST START.  At most one scenario per
+ *               processor runs at a time.  When all have finished, the
+ *               original process collects their Streamflow.Only files in
+ *               <OUTPUT DIRECTORY>/Forecast.Streamflow.Only.
+ */
+
+#include <errno.h>
+#include <semaphore.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#ifdef __linux__
+#include <sys/prctl.h>
+#include <signal.h>
+#endif
+#include "settings.h"
+#include "data.h"
+#include "DHSVMerror.h"
+#include "constants.h"
+#include "fileio.h"
+#include "functions.h"
+#include "getinit.h"
+#include "ensemble.h"
+
+static int NMembers = 0;             /* Number of members or scenarios */
+static int NKeys = 0;
+static char (*MemberName)[BUFSIZE + 1] = NULL;
+static char (*Key)[BUFSIZE + 1] = NULL;      /* [CONSTANTS] or [METEOROLOGY] keys */
+static char (*Value)[BUFSIZE + 1] = NULL;    /* NMembers x NKeys entries */
+
+static int Member = -1;              /* Member of this process, -1 if none */
+static int Scenario = -1;            /* Scenario of this process, -1 if none */
+static long MemberStep = 0;          /* Met records consumed by this member */
+
+/* Shared between the reading process and the members */
+static sem_t *Progress = NULL;       /* Posted by a member after each step */
+static sem_t *Ready = NULL;          /* Posted for a member for each step read */
+static volatile long *Consumed = NULL; /* Steps consumed by each member */
+static MET *Ring = NULL;             /* ENSEMBLE_RING steps x NStats records */
+static unsigned char ***ShadeCache[12]; /* Shade maps of the months of the run */
+
+static void ReadEnsembleFile(LISTPTR Input, char *FileName, char *SectionName,
+                             int ErrorCode);
+static void CacheShadeMaps(OPTIONSTRUCT *Options, MAPSIZE *Map, TIMESTRUCT *Time);
+static void SetupMember(LISTPTR Input, LAYER *Veg, VEGTABLE *VType);
+static void SetupScenario(LISTPTR Input, int NStats, METLOCATION *Stat);
+static void MemberOutput(LISTPTR Input, char *Name);
+static int PrintSummary(char *Title, int *Status);
+static void CollectStreamflow(LISTPTR Input, int *Status);
+static void ServeMembers(OPTIONSTRUCT *Options, TIMESTRUCT *Time, int NSoilLayers,
+                         int NStats, METLOCATION *Stat, pid_t *Pid, int *Status);
+static int ReapMembers(pid_t *Pid, int *Status, int Options);
+
+/*****************************************************************************
+  RunEnsemble()
+
+  Forks a process for every member.  Returns in the members, after their
+  constants and output directory have been set.  The original process
+  serves the met records and exits when all members have finished.
+*****************************************************************************/
+void RunEnsemble(LISTPTR Input, OPTIONSTRUCT *Options, MAPSIZE *Map,
+                 TIMESTRUCT *Time, LAYER *Veg, VEGTABLE *VType,
+                 int NSoilLayers, int NStats, METLOCATION *Stat)
+{
+  const char *Routine = "RunEnsemble";
+  char *Shared;
+  size_t Size;
+  pid_t *Pid;
+  pid_t Parent;
+  int *Status;
+  int NFailed = 0;
+  int i, m;
+
+  ReadEnsembleFile(Input, Options->EnsembleFile, "CONSTANTS", 75);
+  if (Options->Shading == TRUE)
+    CacheShadeMaps(Options, Map, Time);
+
+  Size = (NMembers + 1) * sizeof(sem_t) + NMembers * sizeof(long) +
+    ENSEMBLE_RING * NStats * sizeof(MET);
+  Shared = mmap(NULL, Size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  if (Shared == MAP_FAILED)
+    ReportError((char *) Routine, 1);
+  Progress = (sem_t *) Shared;
+  Ready = Progress + 1;
+  Consumed = (volatile long *) (Ready + NMembers);
+  Ring = (MET *) (Consumed + NMembers);
+  if (sem_init(Progress, 1, 0) != 0)
+    ReportError((char *) Routine, 14);
+  for (m = 0; m < NMembers; m++) {
+    if (sem_init(&Ready[m], 1, 0) != 0)
+      ReportError((char *) Routine, 14);
+    Consumed[m] = 0;
+  }
+
+  if (!(Pid = (pid_t *) calloc(NMembers, sizeof(pid_t))) ||
+      !(Status = (int *) calloc(NMembers, sizeof(int))))
+    ReportError((char *) Routine, 1);
+
+  printf("\nRunning %d ensemble members in lockstep\n", NMembers);
+  fflush(stdout);
+  fflush(stderr);
+  Parent = getpid();
+
+  for (m = 0; m < NMembers; m++) {
+    if ((Pid[m] = fork()) < 0)
+      ReportError((char *) Routine, 14);
+    if (Pid[m] == 0) {
+#ifdef __linux__
+      /* Do not wait forever for met records if the reading process dies */
+      prctl(PR_SET_PDEATHSIG, SIGKILL);
+#endif
+      if (getppid() != Parent)
+        exit(EXIT_FAILURE);
+      Member = m;
+      /* The station files belong to the reading process */
+      for (i = 0; i < NStats; i++)
+        close(fileno(Stat[i].MetFile.FilePtr));
+      SetupMember(Input, Veg, VType);
+      return;
+    }
+  }
+
+  ServeMembers(Options, Time, NSoilLayers, NStats, Stat, Pid, Status);
+  while (ReapMembers(Pid, Status, 0) > 0)
+    ;
+
+  NFailed = PrintSummary("Ensemble", Status);
+  exit(NFailed > 0 ? EXIT_FAILURE : EXIT_SUCCESS);
+}
+
+/*****************************************************************************
+  RunForecast()
+
+  Forks a process for every forecast scenario, at most one per processor at
+  a time.  Returns in the scenarios, after their station files and output
+  directory have been set.  The original process collects the streamflow of
+  the scenarios and exits when all have finished.
+*****************************************************************************/
+void RunForecast(LISTPTR Input, OPTIONSTRUCT *Options, int NStats,
+                 METLOCATION *Stat)
+{
+  const char *Routine = "RunForecast";
+  pid_t *Pid;
+  pid_t Parent;
+  int *Status;
+  long NProcessors;
+  int NFailed;
+  int Running = 0;
+  int k, m;
+
+  ReadEnsembleFile(Input, Options->ForecastFile, "METEOROLOGY", 73);
+  for (k = 0; k < NKeys; k++)
+    if (strncmp(Key[k], "STATION FILE", 12) != 0)
+      ReportError(Key[k], 73);
+
+  if (!(Pid = (pid_t *) calloc(NMembers, sizeof(pid_t))) ||
+      !(Status = (int *) calloc(NMembers, sizeof(int))))
+    ReportError((char *) Routine, 1);
+  if ((NProcessors = sysconf(_SC_NPROCESSORS_ONLN)) < 1)
+    NProcessors = 1;
+
+  printf("\nRunning %d forecast scenarios, %ld at a time\n", NMembers,
+         NProcessors);
+  /* Output buffered so far would otherwise be written again by each
+     scenario */
+  fflush(NULL);
+  Parent = getpid();
+
+  for (m = 0; m < NMembers; m++) {
+    while (Running >= NProcessors)
+      Running = ReapMembers(Pid, Status, 0);
+    if ((Pid[m] = fork()) < 0)
+      ReportError((char *) Routine, 14);
+    if (Pid[m] == 0) {
+#ifdef __linux__
+      prctl(PR_SET_PDEATHSIG, SIGKILL);
+#endif
+      if (getppid() != Parent)
+        exit(EXIT_FAILURE);
+      Scenario = m;
+      SetupScenario(Input, NStats, Stat);
+      return;
+    }
+    Running++;
+  }
+  while (ReapMembers(Pid, Status, 0) > 0)
+    ;
+
+  NFailed = PrintSummary("Forecast", Status);
+  CollectStreamflow(Input, Status);
+  exit(NFailed > 0 ? EXIT_FAILURE : EXIT_SUCCESS);
+}
+
+/*****************************************************************************
+  PrintSummary()
+
+  Prints the exit state of every member or scenario.  Returns the number
+  that failed.
+*****************************************************************************/
+static int PrintSummary(char *Title, int *Status)
+{
+  int NFailed = 0;
+  int m;
+
+  printf("\n%s summary:\n", Title);
+  for (m = 0; m < NMembers; m++) {
+    if (WIFEXITED(Status[m]) && WEXITSTATUS(Status[m]) == EXIT_SUCCESS)
+      printf("  %-20s finished\n", MemberName[m]);
+    else {
+      NFailed++;
+      if (WIFEXITED(Status[m]))
+        printf("  %-20s failed with exit status %d\n", MemberName[m],
+               WEXITSTATUS(Status[m]));
+      else
+        printf("  %-20s terminated by signal %d\n", MemberName[m],
+               WTERMSIG(Status[m]));
+    }
+  }
+  printf("%d of %d finished\n", NMembers - NFailed, NMembers);
+  return NFailed;
+}
+
+/*****************************************************************************
+  ReadEnsembleFile()
+
+  Reads the member (or scenario) table.  The keys must be present in
+  SectionName, otherwise ErrorCode is reported.
+*****************************************************************************/
+static void ReadEnsembleFile(LISTPTR Input, char *FileName, char *SectionName,
+                             int ErrorCode)
+{
+  const char *Routine = "ReadEnsembleFile";
+  FILE *InFile = NULL;
+  LISTPTR Section;
+  char Buffer[BUFSIZE * 8 + 1];
+  char Header[BUFSIZE * 8 + 1];
+  char Entry[BUFSIZE + 1];
+  char *Token;
+  int NLines;
+  int NTokens;
+  int i, k;
+
+  OpenFile(&InFile, FileName, "r", FALSE);
+  NLines = CountLines(InFile);
+  rewind(InFile);
+
+  if ((Section = LocateSection(SectionName, Input)) == NULL)
+    ReportError(SectionName, 50);
+
+  NMembers = -1;
+  while (fgets(Buffer, sizeof(Buffer), InFile) != NULL) {
+    Strip(Buffer);
+    if (IsEmptyStr(Buffer))
+      continue;
+    if (NMembers < 0) {
+      /* Header: Member followed by the keys */
+      strcpy(Header, Buffer);
+      for (NTokens = 0, Token = strtok(Header, " \t"); Token != NULL;
+           Token = strtok(NULL, " \t"))
+        NTokens++;
+      if (!(Key = calloc(NTokens, sizeof(*Key))) ||
+          !(MemberName = calloc(NLines, sizeof(*MemberName))))
+        ReportError((char *) Routine, 1);
+      strtok(Buffer, " \t");
+      while ((Token = strtok(NULL, " \t")) != NULL) {
+        strncpy(Key[NKeys], Token, BUFSIZE);
+        for (i = 0; Key[NKeys][i] != '\0'; i++)
+          if (Key[NKeys][i] == '_')
+            Key[NKeys][i] = ' ';
+        MakeKeyString(Key[NKeys]);
+        if (!LocateKey(Key[NKeys], Entry, Section))
+          ReportError(Key[NKeys], ErrorCode);
+        NKeys++;
+      }
+      if (NKeys == 0)
+        ReportError(FileName, ErrorCode);
+      if (!(Value = calloc((size_t) NLines * NKeys, sizeof(*Value))))
+        ReportError((char *) Routine, 1);
+      NMembers = 0;
+      continue;
+    }
+    Token = strtok(Buffer, " \t");
+    if (strchr(Token, '/') != NULL)
+      ReportError(Token, ErrorCode);
+    strncpy(MemberName[NMembers], Token, BUFSIZE);
+    for (k = 0; k < NKeys; k++) {
+      if ((Token = strtok(NULL, " \t")) == NULL)
+        ReportError(MemberName[NMembers], ErrorCode);
+      strncpy(Value[NMembers * NKeys + k], Token, BUFSIZE);
+    }
+    NMembers++;
+  }
+  fclose(InFile);
+
+  if (NMembers <= 0)
+    ReportError(FileName, ErrorCode);
+}
+
+/*****************************************************************************
+  CacheShadeMaps()
+
+  Reads the shade maps of every month in the run into shared memory
+*****************************************************************************/
+static void CacheShadeMaps(OPTIONSTRUCT *Options, MAPSIZE *Map, TIMESTRUCT *Time)
+{
+  const char *Routine = "CacheShadeMaps";
+  TIMESTRUCT Run = *Time;
+  unsigned char *Rows;
+  int Used[12] = {0};
+  int NMonths = 0;
+  int i, n, y;
+
+  while (Before(&(Run.Current), &(Run.End)) ||
+         IsEqualTime(&(Run.Current), &(Run.End))) {
+    if (!Used[Run.Current.Month - 1]) {
+      Used[Run.Current.Month - 1] = TRUE;
+      NMonths++;
+    }
+    IncreaseTime(&Run);
+  }
+
+  Rows = mmap(NULL, (size_t) NMonths * Time->NDaySteps * Map->NY * Map->NX,
+              PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  if (Rows == MAP_FAILED)
+    ReportError((char *) Routine, 1);
+
+  for (i = 0; i < 12; i++) {
+    ShadeCache[i] = NULL;
+    if (!Used[i])
+      continue;
+    if (!(ShadeCache[i] = calloc(Time->NDaySteps, sizeof(unsigned char **))))
+      ReportError((char *) Routine, 1);
+    for (n = 0; n < Time->NDaySteps; n++) {
+      if (!(ShadeCache[i][n] = calloc(Map->NY, sizeof(unsigned char *))))
+        ReportError((char *) Routine, 1);
+      for (y = 0; y < Map->NY; y++, Rows += Map->NX)
+        ShadeCache[i][n][y] = Rows;
+    }
+    ReadShadeMap(Options, Map, i + 1, Time->NDaySteps, ShadeCache[i]);
+  }
+}
+
+/*****************************************************************************
+  SetupMember()
+
+  Sets the constants and the output directory of this member in the input
+  list and parses the constants again.  The wind profiles of the vegetation
+  types, which InitTables() derives from REFERENCE HEIGHT, GROUND ROUGHNESS
+  and SNOW ROUGHNESS, are calculated again with the constants of the member.
+*****************************************************************************/
+static void SetupMember(LISTPTR Input, LAYER *Veg, VEGTABLE *VType)
+{
+  OPTIONSTRUCT Options;
+  MAPSIZE Map;
+  SOLARGEOMETRY SolarGeo;
+  TIMESTRUCT Time;
+  int i, k;
+
+  for (k = 0; k < NKeys; k++)
+    ReplaceInitString("CONSTANTS", Key[k], Value[Member * NKeys + k], Input);
+
+  MemberOutput(Input, MemberName[Member]);
+  printf("Ensemble member %s\n", MemberName[Member]);
+
+  /* Only the global constants are taken, everything else is unchanged */
+  InitConstants(Input, &Options, &Map, &SolarGeo, &Time);
+
+  for (i = 0; i < Veg->NTypes; i++)
+    CalcAerodynamic(VType[i].NVegLayers, VType[i].OverStory, VType[i].Cn,
+                    VType[i].Height, VType[i].Trunk, VType[i].U,
+                    &(VType[i].USnow), VType[i].Ra, &(VType[i].RaSnow));
+}
+
+/*****************************************************************************
+  SetupScenario()
+
+  Sets the station files and the output directory of this scenario in the
+  input list and opens the station files of the scenario
+*****************************************************************************/
+static void SetupScenario(LISTPTR Input, int NStats, METLOCATION *Stat)
+{
+  char OldFile[BUFSIZE + 1];
+  int i, k;
+
+  MemberOutput(Input, MemberName[Scenario]);
+  printf("Forecast scenario %s\n", MemberName[Scenario]);
+
+  /* Stations outside the basin are not in Stat, so the stations are matched
+     by the file that they read so far */
+  for (k = 0; k < NKeys; k++) {
+    GetInitString("METEOROLOGY", Key[k], "", OldFile, (unsigned long) BUFSIZE,
+                  Input);
+    for (i = 0; i < NStats; i++)
+      if (strcmp(Stat[i].MetFile.FileName, OldFile) == 0)
+        strcpy(Stat[i].MetFile.FileName, Value[Scenario * NKeys + k]);
+    ReplaceInitString("METEOROLOGY", Key[k], Value[Scenario * NKeys + k], Input);
+  }
+
+  /* The open station files share their position with the other processes,
+     so every scenario opens its own.  ReadMetRecord() skips to the current
+     time step */
+  for (i = 0; i < NStats; i++)
+    if (freopen(Stat[i].MetFile.FileName, "r", Stat[i].MetFile.FilePtr) == NULL)
+      ReportError(Stat[i].MetFile.FileName, 3);
+}
+
+/*****************************************************************************
+  MemberOutput()
+
+  Sets the output directory to <OUTPUT DIRECTORY>/<Name>/ and sends the
+  standard output and error there
+*****************************************************************************/
+static void MemberOutput(LISTPTR Input, char *Name)
+{
+  char Path[BUFSIZE + 1];
+  char FileName[BUFSIZE + 1];
+
+  GetInitString("OUTPUT", "OUTPUT DIRECTORY", "", Path, (unsigned long) BUFSIZE, Input);
+  if (strlen(Path) > 0 && Path[strlen(Path) - 1] != '/')
+    strcat(Path, "/");
+  strncat(Path, Name, BUFSIZE - strlen(Path) - 1);
+  strcat(Path, "/");
+  if (mkdir(Path, 0755) != 0 && errno != EEXIST)
+    ReportError(Path, 3);
+  ReplaceInitString("OUTPUT", "OUTPUT DIRECTORY", Path, Input);
+
+  sprintf(FileName, "%.*sstdout.txt", BUFSIZE - 11, Path);
+  if (freopen(FileName, "w", stdout) == NULL)
+    ReportError(FileName, 3);
+  sprintf(FileName, "%.*sstderr.txt", BUFSIZE - 11, Path);
+  if (freopen(FileName, "w", stderr) == NULL)
+    ReportError(FileName, 3);
+}
+
+/*****************************************************************************
+  CollectStreamflow()
+
+  Combines the Streamflow.Only files of the scenarios that finished into
+  <OUTPUT DIRECTORY>/Forecast.Streamflow.Only.  The columns are those of
+  Streamflow.Only with the scenario after the date, and the scenarios follow
+  each other for every time step.  With STREAMFLOW OUTPUT FORMAT = BINARY
+  there is nothing to collect, the scenarios keep their Stream.Values.bin.
+*****************************************************************************/
+static void CollectStreamflow(LISTPTR Input, int *Status)
+{
+  const char *Routine = "CollectStreamflow";
+  char Path[BUFSIZE + 1];
+  char FileName[2 * BUFSIZE + 25];
+  FILE **InFile;
+  FILE *OutFile = NULL;
+  char *Line = NULL;
+  char *Rest;
+  size_t Length = 0;
+  int NOpen = 0;
+  int Header = TRUE;
+  int m;
+
+  GetInitString("OUTPUT", "OUTPUT DIRECTORY", "", Path, (unsigned long) BUFSIZE, Input);
+  if (strlen(Path) > 0 && Path[strlen(Path) - 1] != '/')
+    strcat(Path, "/");
+
+  if (!(InFile = (FILE **) calloc(NMembers, sizeof(FILE *))))
+    ReportError((char *) Routine, 1);
+  for (m = 0; m < NMembers; m++) {
+    if (!WIFEXITED(Status[m]) || WEXITSTATUS(Status[m]) != EXIT_SUCCESS)
+      continue;
+    sprintf(FileName, "%s%s/Streamflow.Only", Path, MemberName[m]);
+    if ((InFile[m] = fopen(FileName, "r")) != NULL)
+      NOpen++;
+  }
+  if (NOpen == 0) {
+    free(InFile);
+    return;
+  }
+
+  sprintf(FileName, "%sForecast.Streamflow.Only", Path);
+  OpenFile(&OutFile, FileName, "w", TRUE);
+  while (NOpen > 0) {
+    for (m = 0; m < NMembers; m++) {
+      if (InFile[m] == NULL)
+        continue;
+      if (getline(&Line, &Length, InFile[m]) < 0) {
+        fclose(InFile[m]);
+        InFile[m] = NULL;
+        NOpen--;
+        continue;
+      }
+      /* Split off the date (DATE in the header line) */
+      Rest = Line + strcspn(Line, " \t\r\n");
+      if (Header) {
+        fprintf(OutFile, "%.*s Scenario%s", (int) (Rest - Line), Line, Rest);
+        Header = FALSE;
+      }
+      else if (strncmp(Line, "DATE", 4) != 0)
+        fprintf(OutFile, "%.*s %-12s%s", (int) (Rest - Line), Line,
+                MemberName[m], Rest);
+    }
+  }
+  fclose(OutFile);
+  free(Line);
+  free(InFile);
+  printf("Streamflow of the scenarios collected in %s\n", FileName);
+}
+
+/*****************************************************************************
+  ReapMembers()
+
+  Collects the exit status of members that have finished.  Options is
+  WNOHANG or 0 (wait for one member).  Returns the number of members that
+  are still running.
+*****************************************************************************/
+static int ReapMembers(pid_t *Pid, int *Status, int Options)
+{
+  pid_t Done;
+  int Running = 0;
+  int State;
+  int m;
+
+  while ((Done = waitpid(-1, &State, Options)) > 0) {
+    for (m = 0; m < NMembers; m++) {
+      if (Pid[m] == Done) {
+        Status[m] = State;
+        Pid[m] = 0;
+      }
+    }
+    if (Options == 0)
+      break;
+  }
+
+  for (m = 0; m < NMembers; m++)
+    if (Pid[m] > 0)
+      Running++;
+  return Running;
+}
+
+/*****************************************************************************
+  ServeMembers()
+
+  Reads the met records of every time step and passes them to the members
+*****************************************************************************/
+static void ServeMembers(OPTIONSTRUCT *Options, TIMESTRUCT *Time, int NSoilLayers,
+                         int NStats, METLOCATION *Stat, pid_t *Pid, int *Status)
+{
+  struct timespec Timeout;
+  MET *Slot;
+  long Step = 0;
+  int Waiting;
+  int i, m;
+
+  while (Before(&(Time->Current), &(Time->End)) ||
+         IsEqualTime(&(Time->Current), &(Time->End))) {
+
+    /* Wait until every running member is done with the slot of this step */
+    do {
+      if (ReapMembers(Pid, Status, WNOHANG) == 0)
+        return;
+      Waiting = FALSE;
+      for (m = 0; m < NMembers; m++)
+        if (Pid[m] > 0 && Consumed[m] <= Step - ENSEMBLE_RING)
+          Waiting = TRUE;
+      if (Waiting) {
+        clock_gettime(CLOCK_REALTIME, &Timeout);
+        Timeout.tv_sec += 1;
+        sem_timedwait(Progress, &Timeout);
+      }
+    } while (Waiting);
+
+    Slot = Ring + (Step % ENSEMBLE_RING) * NStats;
+    for (i = 0; i < NStats; i++)
+      ReadMetRecord(Options, &(Time->Current), NSoilLayers, &(Stat[i].MetFile),
+                    &(Slot[i]));
+    for (m = 0; m < NMembers; m++)
+      if (Pid[m] > 0)
+        sem_post(&Ready[m]);
+
+    IncreaseTime(Time);
+    Step++;
+  }
+}
+
+/*****************************************************************************
+  EnsembleMetRecords()
+
+  In an ensemble member, takes the met records of the next time step from
+  the reading process instead of the station files.  Returns FALSE outside
+  an ensemble run.
+*****************************************************************************/
+int EnsembleMetRecords(OPTIONSTRUCT *Options, int NSoilLayers, int NStats,
+                       METLOCATION *Stat)
+{
+  MET *Slot;
+  MET *Data;
+  int i, j;
+
+  if (Member < 0)
+    return FALSE;
+
+  while (sem_wait(&Ready[Member]) != 0 && errno == EINTR)
+    ;
+
+  /* Copy the fields that ReadMetRecord() sets */
+  Slot = Ring + (MemberStep % ENSEMBLE_RING) * NStats;
+  for (i = 0; i < NStats; i++) {
+    Data = &(Stat[i].Data);
+    Data->Tair = Slot[i].Tair;
+    Data->Wind = Slot[i].Wind;
+    Data->Rh = Slot[i].Rh;
+    Data->Sin = Slot[i].Sin;
+    Data->Lin = Slot[i].Lin;
+    if (Options->HeatFlux == TRUE)
+      for (j = 0; j < NSoilLayers; j++)
+        Data->Tsoil[j] = Slot[i].Tsoil[j];
+    Data->Precip = Slot[i].Precip;
+    if (Options->PrecipSepr) {
+      Data->Rain = Slot[i].Rain;
+      Data->Snow = Slot[i].Snow;
+    }
+    /* The constant lapse rate may differ between the members */
+    Data->TempLapse = (Options->TempLapse == VARIABLE) ? Slot[i].TempLapse : TEMPLAPSE;
+  }
+
+  MemberStep++;
+  Consumed[Member] = MemberStep;
+  sem_post(Progress);
+
+  return TRUE;
+}
+
+/*****************************************************************************
+  EnsembleShadeMap()
+
+  In an ensemble member, points the shade map at the cached maps of Month.
+  Returns FALSE outside an ensemble run.
+*****************************************************************************/
+int EnsembleShadeMap(int Month, int NDaySteps, MAPSIZE *Map,
+                     unsigned char ***ShadowMap)
+{
+  int n, y;
+
+  if (Member < 0 || ShadeCache[Month - 1] == NULL)
+    return FALSE;
+
+  for (n = 0; n < NDaySteps; n++)
+    for (y = 0; y < Map->NY; y++)
+      ShadowMap[n][y] = ShadeCache[Month - 1][n][y];
+
+  return TRUE;
+}
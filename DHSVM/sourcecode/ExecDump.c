@@ -11,22 +11,31 @@
 #include "DHSVMerror.h"
 #include "functions.h"
 #include "constants.h"
+#include "profile.h"
+#include "counters.h"
+#include "snapshot.h"
+#include "pixeloutput.h"
+#include "mapaggregate.h"
 
 /*****************************************************************************
 ExecDump()
 *****************************************************************************/
-void ExecDump(MAPSIZE *Map, DATE *Current, DATE *Start, OPTIONSTRUCT *Options,
+void ExecDump(MAPSIZE *Map, TIMESTRUCT *Time, OPTIONSTRUCT *Options,
   DUMPSTRUCT *Dump, TOPOPIX **TopoMap, EVAPPIX **EvapMap,
   PIXRAD **RadMap, PRECIPPIX **PrecipMap, SNOWPIX **SnowMap,
   VEGPIX **VegMap, LAYER *Veg, SOILPIX **SoilMap,
   NETSTRUCT **Network, CHANNEL *ChannelData, LAYER *Soil,
-  AGGREGATED *Total)
+  AGGREGATED *Total, LAKETABLE *LType, WATERBALANCE *Mass)
 {
+  DATE *Current = &(Time->Current);
+  DATE *Start = &(Time->Start);
+  MAPDUMP *DMap;
   int i;			/* counter */
   int j;			/* counter */
   int x;
   int y;
   int flag;
+  PIXLAYOUT Layout;
 
   /* dump the aggregated basin values for this timestep */
 
@@ -41,46 +50,91 @@ void ExecDump(MAPSIZE *Map, DATE *Current, DATE *Start, OPTIONSTRUCT *Options,
   if (Options->Extent != POINT) {
     /* check whether the model state needs to be dumped at this timestep, and
     dump state if needed */
+    ProfileStart(PROF_STATE);
     if (Dump->NStates < 0) {
-      StoreModelState(Dump->Path, Current, Map, Options, TopoMap, PrecipMap,
-        SnowMap, VegMap, Veg, SoilMap, Soil,
-        Network, ChannelData);
-      if (Options->Extent != POINT)
-        StoreChannelState(Dump->Path, Current, ChannelData->streams);
+      if (Options->Snapshot)
+        StoreModelSnapshot(Dump->Path, Current, Map, Options, TopoMap,
+          PrecipMap, SnowMap, VegMap, Veg, SoilMap, Soil,
+          Network, ChannelData, LType, Mass);
+      else {
+        StoreModelState(Dump->Path, Current, Map, Options, TopoMap, PrecipMap,
+          SnowMap, VegMap, Veg, SoilMap, Soil,
+          Network, ChannelData);
+        if (Options->Extent != POINT)
+          StoreChannelState(Dump->Path, Current, ChannelData->streams);
+      }
     }
     else {
       for (i = 0; i < Dump->NStates; i++) {
         if (IsEqualTime(Current, &(Dump->DState[i]))) {
-          if (!(Options->DumpExtraStream))
-            StoreModelState(Dump->Path, Current, Map, Options, TopoMap,
-              PrecipMap, SnowMap, VegMap, Veg,
-              SoilMap, Soil, Network, ChannelData);
-          if (Options->Extent != POINT) {
-            if (Options->DumpExtraStream)
-              StoreChannelStateExtra(Dump->Path, Current, ChannelData->streams);
-            else
-              StoreChannelState(Dump->Path, Current, ChannelData->streams);
+          if (Options->Snapshot && !(Options->DumpExtraStream))
+            StoreModelSnapshot(Dump->Path, Current, Map, Options, TopoMap,
+              PrecipMap, SnowMap, VegMap, Veg, SoilMap, Soil,
+              Network, ChannelData, LType, Mass);
+          else {
+            if (!(Options->DumpExtraStream))
+              StoreModelState(Dump->Path, Current, Map, Options, TopoMap,
+                PrecipMap, SnowMap, VegMap, Veg,
+                SoilMap, Soil, Network, ChannelData);
+            if (Options->Extent != POINT) {
+              if (Options->DumpExtraStream)
+                StoreChannelStateExtra(Dump->Path, Current, ChannelData->streams);
+              else
+                StoreChannelState(Dump->Path, Current, ChannelData->streams);
+            }
           }
         }
       }
     }
+    ProfileStop(PROF_STATE);
 
     /* check which pixels need to be dumped, and dump if needed */
-    for (i = 0; i < Dump->NPix; i++) {
-      y = Dump->Pix[i].Loc.N;
-      x = Dump->Pix[i].Loc.E;
-      
-      /* output variable at the pixel */
+    if (Dump->PixBinary && Dump->NPix > 0) {
       flag = 2;
-      DumpPix(Current, IsEqualTime(Current, Start), &(Dump->Pix[i].OutFile),
-        &(EvapMap[y][x]), &(PrecipMap[y][x]), &(RadMap[y][x]), &(SnowMap[y][x]),
-        &(SoilMap[y][x]), &(VegMap[y][x]), Soil->NLayers[(SoilMap[y][x].Soil - 1)],
-        Veg->NLayers[(VegMap[y][x].Veg - 1)], Options, flag);
-      fprintf(Dump->Pix[i].OutFile.FilePtr, "\n");
+      for (i = 0; i < Dump->NPix; i++) {
+        y = Dump->Pix[i].Loc.N;
+        x = Dump->Pix[i].Loc.E;
+        GetPixLayout(&Layout, Soil->NLayers[(SoilMap[y][x].Soil - 1)],
+          Veg->NLayers[(VegMap[y][x].Veg - 1)], &(VegMap[y][x]), Options, flag);
+        GetPixValues(IsEqualTime(Current, Start), &(EvapMap[y][x]),
+          &(PrecipMap[y][x]), &(RadMap[y][x]), &(SnowMap[y][x]),
+          &(SoilMap[y][x]), &(VegMap[y][x]), &Layout,
+          PixBinarySlot(i, &Layout));
+      }
+      WritePixBinary(Current);
+    }
+    else {
+      for (i = 0; i < Dump->NPix; i++) {
+        y = Dump->Pix[i].Loc.N;
+        x = Dump->Pix[i].Loc.E;
+
+        /* output variable at the pixel */
+        flag = 2;
+        DumpPix(Current, IsEqualTime(Current, Start), &(Dump->Pix[i].OutFile),
+          &(EvapMap[y][x]), &(PrecipMap[y][x]), &(RadMap[y][x]), &(SnowMap[y][x]),
+          &(SoilMap[y][x]), &(VegMap[y][x]), Soil->NLayers[(SoilMap[y][x].Soil - 1)],
+          Veg->NLayers[(VegMap[y][x].Veg - 1)], Options, flag);
+        fprintf(Dump->Pix[i].OutFile.FilePtr, "\n");
+      }
     }
 
     /* check which maps need to be dumped at this timestep, and dump maps if needed */
     for (i = 0; i < Dump->NMaps; i++) {
+      DMap = &(Dump->DMap[i]);
+      if (DMap->Aggregation != MAP_SNAPSHOT) {
+        /* the call after the last time step repeats the state of that step */
+        if (After(Current, &(Time->End)))
+          continue;
+        DumpMap(Map, Current, DMap, TopoMap, EvapMap, PrecipMap, RadMap,
+          SnowMap, SoilMap, Soil, VegMap, Veg, Network, Options);
+        if (IsMapWindowEnd(Time, DMap->Window)) {
+          fprintf(stdout, "Dumping Maps at ");
+          PrintDate(Current, stdout);
+          fprintf(stdout, "\n");
+          WriteMapAggregate(Map, DMap);
+        }
+        continue;
+      }
       for (j = 0; j < Dump->DMap[i].N; j++) {
         if (IsEqualTime(Current, &(Dump->DMap[i].DumpDate[j]))) {
           fprintf(stdout, "Dumping Maps at ");
@@ -169,7 +223,7 @@ void DumpMap(MAPSIZE *Map, DATE *Current, MAPDUMP *DMap, TOPOPIX **TopoMap,
       for (y = 0; y < Map->NY; y++)
         for (x = 0; x < Map->NX; x++)
           ((float *)Array)[y * Map->NX + x] = EvapMap[y][x].ETot;
-      Write2DMatrix(DMap->FileName, Array, DMap->NumberType, Map,
+      StoreMap(DMap->FileName, Array, DMap->NumberType, Map,
         DMap, Index);
     }
     else
@@ -197,7 +251,7 @@ void DumpMap(MAPSIZE *Map, DATE *Current, MAPDUMP *DMap, TOPOPIX **TopoMap,
             ((float *)Array)[y * Map->NX + x] = NA;
         }
       }
-      Write2DMatrix(DMap->FileName, Array, DMap->NumberType, Map,
+      StoreMap(DMap->FileName, Array, DMap->NumberType, Map,
         DMap, Index);
     }
     else
@@ -222,7 +276,7 @@ void DumpMap(MAPSIZE *Map, DATE *Current, MAPDUMP *DMap, TOPOPIX **TopoMap,
             ((float *)Array)[y * Map->NX + x] = NA;
         }
       }
-      Write2DMatrix(DMap->FileName, Array, DMap->NumberType, Map, DMap, Index);
+      StoreMap(DMap->FileName, Array, DMap->NumberType, Map, DMap, Index);
     }
     else
       ReportError(VarIDStr, 66);
@@ -245,7 +299,7 @@ void DumpMap(MAPSIZE *Map, DATE *Current, MAPDUMP *DMap, TOPOPIX **TopoMap,
               ((float *)Array)[y * Map->NX + x] = NA;
           }
         }
-        Write2DMatrix(DMap->FileName, Array, DMap->NumberType, Map, DMap, Index);
+        StoreMap(DMap->FileName, Array, DMap->NumberType, Map, DMap, Index);
       }
     }
     else
@@ -270,7 +324,7 @@ void DumpMap(MAPSIZE *Map, DATE *Current, MAPDUMP *DMap, TOPOPIX **TopoMap,
             ((float *)Array)[y * Map->NX + x] = NA;
         }
       }
-      Write2DMatrix(DMap->FileName, Array, DMap->NumberType, Map, DMap, Index);
+      StoreMap(DMap->FileName, Array, DMap->NumberType, Map, DMap, Index);
 
     }
     else
@@ -284,7 +338,7 @@ void DumpMap(MAPSIZE *Map, DATE *Current, MAPDUMP *DMap, TOPOPIX **TopoMap,
           ((float *)Array)[y * Map->NX + x] = PrecipMap[y][x].Precip;
         }
       }
-      Write2DMatrix(DMap->FileName, Array, DMap->NumberType, Map, DMap, Index);
+      StoreMap(DMap->FileName, Array, DMap->NumberType, Map, DMap, Index);
 
     }
     else
@@ -306,7 +360,7 @@ void DumpMap(MAPSIZE *Map, DATE *Current, MAPDUMP *DMap, TOPOPIX **TopoMap,
             ((float *)Array)[y * Map->NX + x] = NA;
         }
       }
-      Write2DMatrix(DMap->FileName, Array, DMap->NumberType, Map, DMap, Index);
+      StoreMap(DMap->FileName, Array, DMap->NumberType, Map, DMap, Index);
 
     }
     else
@@ -329,7 +383,7 @@ void DumpMap(MAPSIZE *Map, DATE *Current, MAPDUMP *DMap, TOPOPIX **TopoMap,
             ((float *)Array)[y * Map->NX + x] = NA;
         }
       }
-      Write2DMatrix(DMap->FileName, Array, DMap->NumberType, Map, DMap, Index);
+      StoreMap(DMap->FileName, Array, DMap->NumberType, Map, DMap, Index);
 
     }
     else
@@ -343,7 +397,7 @@ void DumpMap(MAPSIZE *Map, DATE *Current, MAPDUMP *DMap, TOPOPIX **TopoMap,
           ((float *)Array)[y * Map->NX + x] = PrecipMap[y][x].SumPrecip;
         }
       }
-      Write2DMatrix(DMap->FileName, Array, DMap->NumberType, Map, DMap, Index);
+      StoreMap(DMap->FileName, Array, DMap->NumberType, Map, DMap, Index);
 
     }
     else
@@ -358,7 +412,7 @@ void DumpMap(MAPSIZE *Map, DATE *Current, MAPDUMP *DMap, TOPOPIX **TopoMap,
           ((float *)Array)[y * Map->NX + x] = RadMap[y][x].ObsShortIn;
         }
       }
-      Write2DMatrix(DMap->FileName, Array, DMap->NumberType, Map, DMap, Index);
+      StoreMap(DMap->FileName, Array, DMap->NumberType, Map, DMap, Index);
     }
     else
       ReportError(VarIDStr, 66);
@@ -370,7 +424,7 @@ void DumpMap(MAPSIZE *Map, DATE *Current, MAPDUMP *DMap, TOPOPIX **TopoMap,
       for (y = 0; y < Map->NY; y++)
         for (x = 0; x < Map->NX; x++)
           ((float *)Array)[y * Map->NX + x] = RadMap[y][x].PixelNetShort;
-      Write2DMatrix(DMap->FileName, Array, DMap->NumberType, Map, DMap, Index);
+      StoreMap(DMap->FileName, Array, DMap->NumberType, Map, DMap, Index);
 
     }
     else
@@ -384,7 +438,7 @@ void DumpMap(MAPSIZE *Map, DATE *Current, MAPDUMP *DMap, TOPOPIX **TopoMap,
       for (y = 0; y < Map->NY; y++)
         for (x = 0; x < Map->NX; x++)
           ((float *)Array)[y * Map->NX + x] = RadMap[y][x].NetRadiation[0] + RadMap[y][x].NetRadiation[1];
-      Write2DMatrix(DMap->FileName, Array, DMap->NumberType, Map, DMap, Index);
+      StoreMap(DMap->FileName, Array, DMap->NumberType, Map, DMap, Index);
 
     }
     else
@@ -396,7 +450,7 @@ void DumpMap(MAPSIZE *Map, DATE *Current, MAPDUMP *DMap, TOPOPIX **TopoMap,
       for (y = 0; y < Map->NY; y++)
         for (x = 0; x < Map->NX; x++)
           ((unsigned char *)Array)[y * Map->NX + x] = SnowMap[y][x].HasSnow;
-      Write2DMatrix(DMap->FileName, Array, DMap->NumberType, Map, DMap, Index);
+      StoreMap(DMap->FileName, Array, DMap->NumberType, Map, DMap, Index);
 
     }
     else
@@ -409,7 +463,7 @@ void DumpMap(MAPSIZE *Map, DATE *Current, MAPDUMP *DMap, TOPOPIX **TopoMap,
         for (x = 0; x < Map->NX; x++)
           ((unsigned char *)Array)[y * Map->NX + x] =
           SnowMap[y][x].SnowCoverOver;
-      Write2DMatrix(DMap->FileName, Array, DMap->NumberType, Map, DMap, Index);
+      StoreMap(DMap->FileName, Array, DMap->NumberType, Map, DMap, Index);
 
     }
     else
@@ -421,7 +475,7 @@ void DumpMap(MAPSIZE *Map, DATE *Current, MAPDUMP *DMap, TOPOPIX **TopoMap,
       for (y = 0; y < Map->NY; y++)
         for (x = 0; x < Map->NX; x++)
           ((float *)Array)[y * Map->NX + x] = SnowMap[y][x].LastSnow;
-      Write2DMatrix(DMap->FileName, Array, DMap->NumberType, Map, DMap, Index);
+      StoreMap(DMap->FileName, Array, DMap->NumberType, Map, DMap, Index);
 
     }
     else
@@ -433,7 +487,7 @@ void DumpMap(MAPSIZE *Map, DATE *Current, MAPDUMP *DMap, TOPOPIX **TopoMap,
       for (y = 0; y < Map->NY; y++)
         for (x = 0; x < Map->NX; x++)
           ((float *)Array)[y * Map->NX + x] = SnowMap[y][x].Swq;
-      Write2DMatrix(DMap->FileName, Array, DMap->NumberType, Map, DMap, Index);
+      StoreMap(DMap->FileName, Array, DMap->NumberType, Map, DMap, Index);
 
     }
     else
@@ -445,7 +499,7 @@ void DumpMap(MAPSIZE *Map, DATE *Current, MAPDUMP *DMap, TOPOPIX **TopoMap,
       for (y = 0; y < Map->NY; y++)
         for (x = 0; x < Map->NX; x++)
           ((float *)Array)[y * Map->NX + x] = SnowMap[y][x].Melt;
-      Write2DMatrix(DMap->FileName, Array, DMap->NumberType, Map, DMap, Index);
+      StoreMap(DMap->FileName, Array, DMap->NumberType, Map, DMap, Index);
 
     }
     else
@@ -457,7 +511,7 @@ void DumpMap(MAPSIZE *Map, DATE *Current, MAPDUMP *DMap, TOPOPIX **TopoMap,
       for (y = 0; y < Map->NY; y++)
         for (x = 0; x < Map->NX; x++)
           ((float *)Array)[y * Map->NX + x] = SnowMap[y][x].PackWater;
-      Write2DMatrix(DMap->FileName, Array, DMap->NumberType, Map, DMap, Index);
+      StoreMap(DMap->FileName, Array, DMap->NumberType, Map, DMap, Index);
 
     }
     else
@@ -469,7 +523,7 @@ void DumpMap(MAPSIZE *Map, DATE *Current, MAPDUMP *DMap, TOPOPIX **TopoMap,
       for (y = 0; y < Map->NY; y++)
         for (x = 0; x < Map->NX; x++)
           ((float *)Array)[y * Map->NX + x] = SnowMap[y][x].TPack;
-      Write2DMatrix(DMap->FileName, Array, DMap->NumberType, Map, DMap, Index);
+      StoreMap(DMap->FileName, Array, DMap->NumberType, Map, DMap, Index);
 
     }
     else
@@ -481,7 +535,7 @@ void DumpMap(MAPSIZE *Map, DATE *Current, MAPDUMP *DMap, TOPOPIX **TopoMap,
       for (y = 0; y < Map->NY; y++)
         for (x = 0; x < Map->NX; x++)
           ((float *)Array)[y * Map->NX + x] = SnowMap[y][x].SurfWater;
-      Write2DMatrix(DMap->FileName, Array, DMap->NumberType, Map, DMap, Index);
+      StoreMap(DMap->FileName, Array, DMap->NumberType, Map, DMap, Index);
 
     }
     else
@@ -493,7 +547,7 @@ void DumpMap(MAPSIZE *Map, DATE *Current, MAPDUMP *DMap, TOPOPIX **TopoMap,
       for (y = 0; y < Map->NY; y++)
         for (x = 0; x < Map->NX; x++)
           ((float *)Array)[y * Map->NX + x] = SnowMap[y][x].TSurf;
-      Write2DMatrix(DMap->FileName, Array, DMap->NumberType, Map, DMap, Index);
+      StoreMap(DMap->FileName, Array, DMap->NumberType, Map, DMap, Index);
 
     }
     else
@@ -505,7 +559,7 @@ void DumpMap(MAPSIZE *Map, DATE *Current, MAPDUMP *DMap, TOPOPIX **TopoMap,
       for (y = 0; y < Map->NY; y++)
         for (x = 0; x < Map->NX; x++)
           ((float *)Array)[y * Map->NX + x] = SnowMap[y][x].ColdContent;
-      Write2DMatrix(DMap->FileName, Array, DMap->NumberType, Map, DMap, Index);
+      StoreMap(DMap->FileName, Array, DMap->NumberType, Map, DMap, Index);
 
     }
     else
@@ -517,7 +571,7 @@ void DumpMap(MAPSIZE *Map, DATE *Current, MAPDUMP *DMap, TOPOPIX **TopoMap,
       for (y = 0; y < Map->NY; y++)
         for (x = 0; x < Map->NX; x++)
           ((float *)Array)[y * Map->NX + x] = SnowMap[y][x].Albedo;
-      Write2DMatrix(DMap->FileName, Array, DMap->NumberType, Map,
+      StoreMap(DMap->FileName, Array, DMap->NumberType, Map,
         DMap, Index);
     }
     else
@@ -529,7 +583,7 @@ void DumpMap(MAPSIZE *Map, DATE *Current, MAPDUMP *DMap, TOPOPIX **TopoMap,
       for (y = 0; y < Map->NY; y++)
         for (x = 0; x < Map->NX; x++)
           ((float *)Array)[y * Map->NX + x] = SnowMap[y][x].MaxSwe;
-      Write2DMatrix(DMap->FileName, Array, DMap->NumberType, Map,
+      StoreMap(DMap->FileName, Array, DMap->NumberType, Map,
         DMap, Index);
     }
     else
@@ -541,7 +595,7 @@ void DumpMap(MAPSIZE *Map, DATE *Current, MAPDUMP *DMap, TOPOPIX **TopoMap,
       for (y = 0; y < Map->NY; y++)
         for (x = 0; x < Map->NX; x++)
           ((unsigned int *)Array)[y * Map->NX + x] = SnowMap[y][x].MaxSweDate;
-      Write2DMatrix(DMap->FileName, Array, DMap->NumberType, Map,
+      StoreMap(DMap->FileName, Array, DMap->NumberType, Map,
         DMap, Index);
     }
     else
@@ -553,7 +607,7 @@ void DumpMap(MAPSIZE *Map, DATE *Current, MAPDUMP *DMap, TOPOPIX **TopoMap,
       for (y = 0; y < Map->NY; y++)
         for (x = 0; x < Map->NX; x++)
           ((unsigned int *)Array)[y * Map->NX + x] = SnowMap[y][x].MeltOutDate;
-      Write2DMatrix(DMap->FileName, Array, DMap->NumberType, Map,
+      StoreMap(DMap->FileName, Array, DMap->NumberType, Map,
         DMap, Index);
     }
     else
@@ -565,7 +619,7 @@ void DumpMap(MAPSIZE *Map, DATE *Current, MAPDUMP *DMap, TOPOPIX **TopoMap,
       for (y = 0; y < Map->NY; y++)
         for (x = 0; x < Map->NX; x++)
           ((float *)Array)[y * Map->NX + x] = PrecipMap[y][x].SnowAccum;
-      Write2DMatrix(DMap->FileName, Array, DMap->NumberType, Map,
+      StoreMap(DMap->FileName, Array, DMap->NumberType, Map,
                     DMap, Index);
     }
     else
@@ -577,7 +631,7 @@ void DumpMap(MAPSIZE *Map, DATE *Current, MAPDUMP *DMap, TOPOPIX **TopoMap,
       for (y = 0; y < Map->NY; y++)
         for (x = 0; x < Map->NX; x++)
           ((float *)Array)[y * Map->NX + x] = PrecipMap[y][x].SnowMelt;
-      Write2DMatrix(DMap->FileName, Array, DMap->NumberType, Map,
+      StoreMap(DMap->FileName, Array, DMap->NumberType, Map,
                     DMap, Index);
     }
     else
@@ -600,7 +654,7 @@ void DumpMap(MAPSIZE *Map, DATE *Current, MAPDUMP *DMap, TOPOPIX **TopoMap,
             ((float *)Array)[y * Map->NX + x] = NA;
         }
       }
-      Write2DMatrix(DMap->FileName, Array, DMap->NumberType, Map, DMap, Index);
+      StoreMap(DMap->FileName, Array, DMap->NumberType, Map, DMap, Index);
 
     }
     else
@@ -623,7 +677,7 @@ void DumpMap(MAPSIZE *Map, DATE *Current, MAPDUMP *DMap, TOPOPIX **TopoMap,
             ((float *)Array)[y * Map->NX + x] = NA;
         }
       }
-      Write2DMatrix(DMap->FileName, Array, DMap->NumberType, Map, DMap, Index);
+      StoreMap(DMap->FileName, Array, DMap->NumberType, Map, DMap, Index);
 
     }
     else
@@ -635,7 +689,7 @@ void DumpMap(MAPSIZE *Map, DATE *Current, MAPDUMP *DMap, TOPOPIX **TopoMap,
       for (y = 0; y < Map->NY; y++)
         for (x = 0; x < Map->NX; x++)
           ((float *)Array)[y * Map->NX + x] = SoilMap[y][x].TableDepth;
-      Write2DMatrix(DMap->FileName, Array, DMap->NumberType, Map, DMap, Index);
+      StoreMap(DMap->FileName, Array, DMap->NumberType, Map, DMap, Index);
 
     }
     else
@@ -647,7 +701,7 @@ void DumpMap(MAPSIZE *Map, DATE *Current, MAPDUMP *DMap, TOPOPIX **TopoMap,
       for (y = 0; y < Map->NY; y++)
         for (x = 0; x < Map->NX; x++)
           ((float *)Array)[y * Map->NX + x] = SoilMap[y][x].SatFlow;
-      Write2DMatrix(DMap->FileName, Array, DMap->NumberType, Map, DMap, Index);
+      StoreMap(DMap->FileName, Array, DMap->NumberType, Map, DMap, Index);
 
     }
     else
@@ -659,7 +713,7 @@ void DumpMap(MAPSIZE *Map, DATE *Current, MAPDUMP *DMap, TOPOPIX **TopoMap,
       for (y = 0; y < Map->NY; y++)
         for (x = 0; x < Map->NX; x++)
           ((float *)Array)[y * Map->NX + x] = SoilMap[y][x].TSurf;
-      Write2DMatrix(DMap->FileName, Array, DMap->NumberType, Map, DMap, Index);
+      StoreMap(DMap->FileName, Array, DMap->NumberType, Map, DMap, Index);
 
     }
     else
@@ -671,7 +725,7 @@ void DumpMap(MAPSIZE *Map, DATE *Current, MAPDUMP *DMap, TOPOPIX **TopoMap,
       for (y = 0; y < Map->NY; y++)
         for (x = 0; x < Map->NX; x++)
           ((float *)Array)[y * Map->NX + x] = SoilMap[y][x].Qnet;
-      Write2DMatrix(DMap->FileName, Array, DMap->NumberType, Map, DMap, Index);
+      StoreMap(DMap->FileName, Array, DMap->NumberType, Map, DMap, Index);
 
     }
     else
@@ -683,7 +737,7 @@ void DumpMap(MAPSIZE *Map, DATE *Current, MAPDUMP *DMap, TOPOPIX **TopoMap,
       for (y = 0; y < Map->NY; y++)
         for (x = 0; x < Map->NX; x++)
           ((float *)Array)[y * Map->NX + x] = SoilMap[y][x].Qs;
-      Write2DMatrix(DMap->FileName, Array, DMap->NumberType, Map, DMap, Index);
+      StoreMap(DMap->FileName, Array, DMap->NumberType, Map, DMap, Index);
 
     }
     else
@@ -695,7 +749,7 @@ void DumpMap(MAPSIZE *Map, DATE *Current, MAPDUMP *DMap, TOPOPIX **TopoMap,
       for (y = 0; y < Map->NY; y++)
         for (x = 0; x < Map->NX; x++)
           ((float *)Array)[y * Map->NX + x] = SoilMap[y][x].Qe;
-      Write2DMatrix(DMap->FileName, Array, DMap->NumberType, Map, DMap, Index);
+      StoreMap(DMap->FileName, Array, DMap->NumberType, Map, DMap, Index);
 
     }
     else
@@ -707,7 +761,7 @@ void DumpMap(MAPSIZE *Map, DATE *Current, MAPDUMP *DMap, TOPOPIX **TopoMap,
       for (y = 0; y < Map->NY; y++)
         for (x = 0; x < Map->NX; x++)
           ((float *)Array)[y * Map->NX + x] = SoilMap[y][x].Qg;
-      Write2DMatrix(DMap->FileName, Array, DMap->NumberType, Map, DMap, Index);
+      StoreMap(DMap->FileName, Array, DMap->NumberType, Map, DMap, Index);
 
     }
     else
@@ -719,7 +773,7 @@ void DumpMap(MAPSIZE *Map, DATE *Current, MAPDUMP *DMap, TOPOPIX **TopoMap,
       for (y = 0; y < Map->NY; y++)
         for (x = 0; x < Map->NX; x++)
           ((float *)Array)[y * Map->NX + x] = SoilMap[y][x].Qst;
-      Write2DMatrix(DMap->FileName, Array, DMap->NumberType, Map, DMap, Index);
+      StoreMap(DMap->FileName, Array, DMap->NumberType, Map, DMap, Index);
 
     }
     else
@@ -731,7 +785,7 @@ void DumpMap(MAPSIZE *Map, DATE *Current, MAPDUMP *DMap, TOPOPIX **TopoMap,
       for (y = 0; y < Map->NY; y++)
         for (x = 0; x < Map->NX; x++)
           ((float *)Array)[y * Map->NX + x] = SoilMap[y][x].IExcess;
-      Write2DMatrix(DMap->FileName, Array, DMap->NumberType, Map, DMap, Index);
+      StoreMap(DMap->FileName, Array, DMap->NumberType, Map, DMap, Index);
 
     }
     else
@@ -746,7 +800,7 @@ void DumpMap(MAPSIZE *Map, DATE *Current, MAPDUMP *DMap, TOPOPIX **TopoMap,
       for (y = 0; y < Map->NY; y++)
         for (x = 0; x < Map->NX; x++)
           ((float *)Array)[y * Map->NX + x] = SoilMap[y][x].InfiltAcc;
-      Write2DMatrix(DMap->FileName, Array, DMap->NumberType, Map, DMap, Index);
+      StoreMap(DMap->FileName, Array, DMap->NumberType, Map, DMap, Index);
 
     }
     else
@@ -769,14 +823,37 @@ void DumpMap(MAPSIZE *Map, DATE *Current, MAPDUMP *DMap, TOPOPIX **TopoMap,
             ((float *)Array)[y * Map->NX + x] = NA;
         }
       }
-      Write2DMatrix(DMap->FileName, Array, DMap->NumberType, Map, DMap, Index);
+      StoreMap(DMap->FileName, Array, DMap->NumberType, Map, DMap, Index);
 
     }
     else
       ReportError(VarIDStr, 66);
     break;
     
+  case 901:
+  case 902:
+  case 903:
+  case 904:
+  case 905:
+  case 906:
+    if (!Options->Counters) {
+      ReportError(VarIDStr, 67);
+    }
+    if (DMap->Resolution == MAP_OUTPUT) {
+      for (y = 0; y < Map->NY; y++)
+        for (x = 0; x < Map->NX; x++)
+          ((unsigned int *)Array)[y * Map->NX + x] =
+          CounterValue(DMap->ID - COUNTER_FIRSTID, y, x);
+      StoreMap(DMap->FileName, Array, DMap->NumberType, Map, DMap, Index);
+    }
+    else
+      ReportError(VarIDStr, 66);
+    break;
+    
   }
+
+  if (Array != NULL)
+    free(Array);
 }
 
 /*****************************************************************************
@@ -785,10 +862,57 @@ DumpPix()
 void DumpPix(DATE *Current, int first, FILES *OutFile, EVAPPIX *Evap,
   PRECIPPIX *Precip, PIXRAD *Rad, SNOWPIX *Snow, SOILPIX *Soil,
   VEGPIX *Veg, int NSoil, int NCanopyStory, OPTIONSTRUCT *Options, int flag)
+{
+  static float *Values = NULL;  /* Values of the time step */
+  static int NValues = 0;
+  PIXLAYOUT Layout;
+
+  GetPixLayout(&Layout, NSoil, NCanopyStory, Veg, Options, flag);
+  if (PixLayoutSize(&Layout) > NValues) {
+    NValues = PixLayoutSize(&Layout);
+    if (!(Values = (float *)realloc(Values, NValues * sizeof(float))))
+      ReportError("DumpPix", 1);
+  }
+  GetPixValues(first, Evap, Precip, Rad, Snow, Soil, Veg, &Layout, Values);
+
+  if (first == 1)
+    PrintPixHeader(OutFile->FilePtr, &Layout);
+
+  /* All variables are dumped in the case of a pixel dump */
+  PrintPixValues(OutFile->FilePtr, Current, &Layout, Values);
+}
+
+/*****************************************************************************
+GetPixLayout()
+
+The columns of a pixel time series.  The gap radiation is only reported
+when dumping pixels (flag 2) instead of the basin average (flag 1).
+*****************************************************************************/
+void GetPixLayout(PIXLAYOUT *Layout, int NSoil, int NCanopyStory, VEGPIX *Veg,
+  OPTIONSTRUCT *Options, int flag)
+{
+  Layout->NSoil = NSoil;
+  Layout->NCanopyStory = NCanopyStory;
+  Layout->HeatFlux = Options->HeatFlux ? TRUE : FALSE;
+  Layout->Gap = (TotNumGap > 0);
+  Layout->DynamicInfilt = (Options->Infiltration == DYNAMIC);
+  Layout->GapRad = (flag == 2 && Veg->Gapping > 0.0);
+}
+
+/*****************************************************************************
+GetPixValues()
+
+Stores the values of a time step in the order of PrintPixValues()
+*****************************************************************************/
+void GetPixValues(int first, EVAPPIX *Evap, PRECIPPIX *Precip, PIXRAD *Rad,
+  SNOWPIX *Snow, SOILPIX *Soil, VEGPIX *Veg, PIXLAYOUT *Layout, float *Values)
 {
   int i, j;			/* counter */
+  int NSoil = Layout->NSoil;
+  int NCanopyStory = Layout->NCanopyStory;
   float W;      /* available water for runoff - used in NG-IDF */
   float deltaSWE; /* delta SWE over delta t */
+  float *V = Values;
 
   /* calculate available water for runoff for NG-IDF */
   if (first == 1)
@@ -800,155 +924,103 @@ void DumpPix(DATE *Current, int first, FILES *OutFile, EVAPPIX *Evap,
   if (W <= 1.e-9)
     W = 0.;
 
-  if (first == 1) {
-
-    /* Main Aggregate Values File */
-    fprintf(OutFile->FilePtr, "Date ");
-    fprintf(OutFile->FilePtr, "W(mm) ");
-    fprintf(OutFile->FilePtr, "Precip(m) ");
-    fprintf(OutFile->FilePtr, "Snow(m) ");
-    fprintf(OutFile->FilePtr, "IExcess(m) ");
-    fprintf(OutFile->FilePtr, "HasSnow LastSnow Albedo Swq Melt ");
-    fprintf(OutFile->FilePtr, "PackWater TPack SurfWater TSurf ");
-
-    fprintf(OutFile->FilePtr, " TotalET ");   /*total evapotranspiration*/
-    for (i = 0; i < NCanopyStory + 1; i++)
-      fprintf(OutFile->FilePtr, " PotTransp.Story%d ", i); /* potential transpiration */
-    for (i = 0; i < NCanopyStory + 1; i++)
-      fprintf(OutFile->FilePtr, " ActTransp.Story%d ", i); /* Actual transpiration */
-    for (i = 0; i < NCanopyStory; i++)
-      fprintf(OutFile->FilePtr, "  EvapCanopyInt.Story%d ", i);
-    for (i = 0; i < NCanopyStory; i++)
-      for (j = 0; j < NSoil; j++)
-        fprintf(OutFile->FilePtr, " ActTransp.Story%d.Soil%d ", i, j);
-    fprintf(OutFile->FilePtr, " SoilEvap ");
-
-    for (i = 0; i < NCanopyStory; i++)
-      fprintf(OutFile->FilePtr, " IntRain.Story%d ", i);
-    for (i = 0; i < NCanopyStory; i++)
-      fprintf(OutFile->FilePtr, " IntSnow.Story%d ", i);
-
-    for (i = 0; i <= NSoil; i++)
-      fprintf(OutFile->FilePtr, " SoilMoist%d ", (i + 1));
-    for (i = 0; i < NSoil; i++)
-      fprintf(OutFile->FilePtr, " Perc%d ", (i + 1));
-    for (i = 0; i < NSoil; i++)
-      fprintf(OutFile->FilePtr, " InterFlow%d ", (i + 1));
-    fprintf(OutFile->FilePtr, " TableDepth SatFlow DetentionStorage ");
-
-    /* print radiation associated variables */
-    for (i = 0; i < NCanopyStory; i++)
-      fprintf(OutFile->FilePtr, " NetShort.Story%d ", (i + 1));
-    for (i = 0; i < NCanopyStory; i++)
-      fprintf(OutFile->FilePtr, " LongIn.Story%d ", (i + 1));
-    fprintf(OutFile->FilePtr, " PixelNetShort ");
-
-    if (Options->HeatFlux)
-      fprintf(OutFile->FilePtr, " TSurf ");
-
-    fprintf(OutFile->FilePtr, " Soil.Qnet Soil.Qs Soil.Qe Soil.Qg Soil.Qst Ra ");
-    fprintf(OutFile->FilePtr, " Snow.Qsw Snow.Qlw Snow.Qs Snow.Qe Snow.Qp Snow.MeltEnergy ");
-
-    if (TotNumGap > 0)
-      fprintf(OutFile->FilePtr, " Gap.SWE Gap.Qsw Gap.Qlin Gap.Qlw Gap.Qs Gap.Qe Gap.Qp Gap.MeltEnergy ");
-    fprintf(OutFile->FilePtr, " Tair ");
-    if (Options->Infiltration == DYNAMIC)
-      fprintf(OutFile->FilePtr, " InfiltAcc");
-
-    if (flag == 2)
-      if (Veg->Gapping > 0.0 )
-        fprintf(OutFile->FilePtr, "Gap_SW GAP_LW");
-
-    fprintf(OutFile->FilePtr, "\n");
+  *V++ = W*1000;
+  *V++ = Precip->Precip;
+  *V++ = Precip->SnowFall;
+  *V++ = Soil->IExcess;
 
-  }
+  /* Snow, with the snow cover flag in [0, 255] */
+  *V++ = (float) Snow->HasSnow;
+  *V++ = Snow->LastSnow;
+  *V++ = Snow->Albedo;
+  *V++ = Snow->Swq;
+  *V++ = Snow->Melt;
+  *V++ = Snow->PackWater;
+  *V++ = Snow->TPack;
+  *V++ = Snow->SurfWater;
+  *V++ = Snow->TSurf;
 
-  /* All variables are dumped in the case of a pixel dump */
-  /* Main Aggregate Values File */
-  
-  PrintDate(Current, OutFile->FilePtr);
-  fprintf(OutFile->FilePtr, " %g ", W*1000);
-  fprintf(OutFile->FilePtr, " %g ", Precip->Precip);
-  fprintf(OutFile->FilePtr, " %g ", Precip->SnowFall);
-  fprintf(OutFile->FilePtr, " %g ", Soil->IExcess);
-
-  /* Snow */
-  fprintf(OutFile->FilePtr, " %g %g %g %g %g %g %g %g %g ",
-    ((float) Snow->HasSnow) / 255.0, Snow->LastSnow, Snow->Albedo, Snow->Swq,
-    Snow->Melt, Snow->PackWater, Snow->TPack, Snow->SurfWater, Snow->TSurf);
-
-  fprintf(OutFile->FilePtr, " %g", Evap->ETot);
+  *V++ = Evap->ETot;
 
   /* Potential transpiration */
   for (i = 0; i < NCanopyStory + 1; i++)
-    fprintf(OutFile->FilePtr, " %g", Evap->EPot[i]);
+    *V++ = Evap->EPot[i];
   /* Actual transpiration */
   for (i = 0; i < NCanopyStory + 1; i++)
-    fprintf(OutFile->FilePtr, " %g", Evap->EAct[i]);
+    *V++ = Evap->EAct[i];
   for (i = 0; i < NCanopyStory; i++)
-    fprintf(OutFile->FilePtr, " %g", Evap->EInt[i]);
+    *V++ = Evap->EInt[i];
   /* transpiration from each veg layer from each soil layer */
   for (i = 0; i < NCanopyStory; i++)
     for (j = 0; j < NSoil; j++)
-      fprintf(OutFile->FilePtr, " %g", Evap->ESoil[i][j]);
+      *V++ = Evap->ESoil[i][j];
   /* evaporation from uppper soil */
-  fprintf(OutFile->FilePtr, " %g", Evap->EvapSoil);
+  *V++ = Evap->EvapSoil;
 
   for (i = 0; i < NCanopyStory; i++)
-    fprintf(OutFile->FilePtr, " %g", Precip->IntRain[i]);
+    *V++ = Precip->IntRain[i];
   for (i = 0; i < NCanopyStory; i++)
-    fprintf(OutFile->FilePtr, " %g", Precip->IntSnow[i]);
+    *V++ = Precip->IntSnow[i];
 
   for (i = 0; i <= NSoil; i++)
-    fprintf(OutFile->FilePtr, " %g ", Soil->Moist[i]);
+    *V++ = Soil->Moist[i];
   for (i = 0; i < NSoil; i++)
-    fprintf(OutFile->FilePtr, " %g ", Soil->Perc[i]);
+    *V++ = Soil->Perc[i];
   for (i = 0; i < NSoil; i++)
-    fprintf(OutFile->FilePtr, " %g ", Soil->InterFlow[i]);
+    *V++ = Soil->InterFlow[i];
 
-  fprintf(OutFile->FilePtr, " %g %g %g ", Soil->TableDepth,
-    Soil->SatFlow, Soil->DetentionStorage);
+  *V++ = Soil->TableDepth;
+  *V++ = Soil->SatFlow;
+  *V++ = Soil->DetentionStorage;
 
-  for (i = 0; i < NCanopyStory; i++) {
-    fprintf(OutFile->FilePtr, " %g ", Rad->NetShort[i]);
-  }
-
-  for (i = 0; i < NCanopyStory; i++) {
-    fprintf(OutFile->FilePtr, " %g ", Rad->LongIn[i]);
+  for (i = 0; i < NCanopyStory; i++)
+    *V++ = Rad->NetShort[i];
+  for (i = 0; i < NCanopyStory; i++)
+    *V++ = Rad->LongIn[i];
+
+  *V++ = Rad->PixelNetShort;
+
+  if (Layout->HeatFlux)
+    *V++ = Soil->TSurf;
+
+  *V++ = Soil->Qnet;
+  *V++ = Soil->Qs;
+  *V++ = Soil->Qe;
+  *V++ = Soil->Qg;
+  *V++ = Soil->Qst;
+  *V++ = Soil->Ra;
+  *V++ = Snow->Qsw;
+  *V++ = Snow->Qlw;
+  *V++ = Snow->Qs;
+  *V++ = Snow->Qe;
+  *V++ = Snow->Qp;
+  *V++ = Snow->MeltEnergy;
+
+  if (Layout->Gap) {
+    *V++ = Veg->Type[Opening].Swq;
+    *V++ = Veg->Type[Opening].Qsw;
+    *V++ = Veg->Type[Opening].Qlin;
+    *V++ = Veg->Type[Opening].Qlw;
+    *V++ = Veg->Type[Opening].Qs;
+    *V++ = Veg->Type[Opening].Qe;
+    *V++ = Veg->Type[Opening].Qp;
+    *V++ = Veg->Type[Opening].MeltEnergy;
   }
 
-  fprintf(OutFile->FilePtr, " %g ", Rad->PixelNetShort);
+  *V++ = Rad->Tair;
 
-  if (Options->HeatFlux)
-    fprintf(OutFile->FilePtr, " %g ", Soil->TSurf);
+  if (Layout->DynamicInfilt)
+    *V++ = Soil->InfiltAcc;
 
-  fprintf(OutFile->FilePtr, " %g %g %g %g %g %g ",
-    Soil->Qnet, Soil->Qs, Soil->Qe, Soil->Qg, Soil->Qst, Soil->Ra);
-  fprintf(OutFile->FilePtr, " %g %g %g %g %g %g ",
-    Snow->Qsw, Snow->Qlw, Snow->Qs, Snow->Qe, Snow->Qp, Snow->MeltEnergy);
-
-  if (TotNumGap > 0)
-    fprintf(OutFile->FilePtr, " %g %g %g %g %g %g %g %g ", Veg->Type[Opening].Swq,
-      Veg->Type[Opening].Qsw, Veg->Type[Opening].Qlin, Veg->Type[Opening].Qlw, Veg->Type[Opening].Qs,
-      Veg->Type[Opening].Qe, Veg->Type[Opening].Qp, Veg->Type[Opening].MeltEnergy);
-
-  fprintf(OutFile->FilePtr, " %g ", Rad->Tair);
-
-  if (Options->Infiltration == DYNAMIC)
-    fprintf(OutFile->FilePtr, " %g", Soil->InfiltAcc);
+  if (Layout->GapRad) {
+    *V++ = Veg->Type[Opening].NetShort[1];
+    *V++ = Veg->Type[Opening].LongIn[1];
+  }
 
-  /* Only report the gap radiations values when dumping pixels instead of basin average */
-  if (flag == 2)
-    if (Veg->Gapping > 0.0)
-      fprintf(OutFile->FilePtr, " %g %g",
-        Veg->Type[Opening].NetShort[1], Veg->Type[Opening].LongIn[1]);
-  
   /* store SWE */
   Snow->OldSwq = Snow->Swq;
-
 }
 
-
 #ifdef TOPO_DUMP
 /******************************************************************************/
 /*                                DumpTopo                                    */
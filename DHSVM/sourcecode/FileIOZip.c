@@ -0,0 +1,521 @@
+/*
+ * SUMMARY:      FileIOZip.c - Compressed map files
+ * USAGE:        Part of DHSVM
+ *
+ * DESCRIPTION:  With [OPTIONS] MAP FILE FORMAT = COMPRESSED the map output
+ *               and the state files are written through these functions
+ *               instead of the ones in FileIOBin.c.  A file holds the same
+ *               sequence of matrices as a binary file, but each matrix is
+ *               cut into tiles of MAPZ_TILE x MAPZ_TILE cells that are
+ *               compressed on their own: a tile with one value (e.g. all NA
+ *               outside the basin) is stored as that value, other tiles are
+ *               delta and run-length coded without loss (see fifozip.h for
+ *               the layout).  An index in the file gives the position of
+ *               every matrix, so that a matrix is read without reading the
+ *               ones before it.
+ *
+ *               Read2DMatrixZip() reads compressed and binary files alike,
+ *               so input maps and state files of either format can be used.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "fifobin.h"
+#include "fifozip.h"
+#include "fileio.h"
+#include "sizeofnt.h"
+#include "settings.h"
+#include "DHSVMerror.h"
+
+#define TILEBYTES (MAPZ_TILE * MAPZ_TILE * sizeof(double))
+
+static unsigned char *Buffer = NULL;   /* Tiles of one slice */
+static size_t BufferSize = 0;
+static unsigned char Tile[TILEBYTES];  /* Elements of one tile */
+static unsigned char Planes[TILEBYTES];
+static unsigned char Packed[TILEBYTES + TILEBYTES / 128 + 1];
+
+static unsigned char *SliceBuffer(size_t Size);
+static size_t EncodeTile(int N, size_t ElemSize, unsigned char *Out);
+static int DecodeTile(int N, size_t ElemSize, unsigned char *In,
+		      size_t Size, size_t *Used);
+static size_t PackBits(unsigned char *In, size_t N, unsigned char *Out);
+static int UnpackBits(unsigned char *In, size_t NIn, unsigned char *Out,
+		      size_t NOut);
+static long SliceOffset(FILE *InFile, char *FileName, MAPZHEADER *Header,
+			int NDataSet);
+
+/*****************************************************************************
+  Function name: CreateMapFileZip()
+
+  Purpose      : Create a new, empty file.  If the file already exists it
+                 will be overwritten.  The header is written with the first
+                 matrix.
+*****************************************************************************/
+void CreateMapFileZip(char *FileName, ...)
+{
+  FILE *NewFile;
+
+  OpenFile(&NewFile, FileName, "wb", TRUE);
+  fclose(NewFile);
+}
+
+/*****************************************************************************
+  Function name: Read2DMatrixZip()
+
+  Purpose      : Function to read a 2D array from a compressed file, or from
+                 a binary file if the file is not compressed.
+
+  Required     :
+    FileName   - name of input file
+    Matrix     - address of array data into
+    NumberType - code for number type
+    NY         - Number of rows
+    NX         - Number of columns
+    NDataSet   - number of the dataset to read, i.e. the first matrix in a
+                 file is number 0, etc.
+    Any remaining arguments are not used
+
+  Returns      : Number of elements read
+
+*****************************************************************************/
+int Read2DMatrixZip(char *FileName, void *Matrix, int NumberType, int NY,
+		    int NX, int NDataSet, ...)
+{
+  FILE *InFile;
+  MAPZHEADER Header;
+
+  OpenFile(&InFile, FileName, "rb", FALSE);
+  if (!IsMapFileZip(InFile)) {
+    fclose(InFile);
+    return Read2DMatrixBin(FileName, Matrix, NumberType, NY, NX, NDataSet);
+  }
+
+  ReadMapHeaderZip(InFile, FileName, &Header);
+  if (Header.NY != NY || Header.NX != NX)
+    ReportError(FileName, 51);
+  ReadMapSliceZip(InFile, FileName, &Header, NDataSet, NumberType, Matrix);
+
+  fclose(InFile);
+
+  return NY * NX;
+}
+
+/*****************************************************************************
+  Function name: Write2DMatrixZip()
+
+  Purpose      : Function to compress a 2D array and add it to the end of a
+                 file.
+
+  Required     :
+    FileName   - name of output file
+    Matrix     - address of array containing matrix elements
+    NumberType - code for number type
+    NY         - Number of rows
+    NX         - Number of columns
+
+  Returns      : Number of elements written
+
+*****************************************************************************/
+int Write2DMatrixZip(char *FileName, void *Matrix, int NumberType, int NY,
+		     int NX, ...)
+{
+  FILE *OutFile;
+  MAPZHEADER Header;
+  MAPZBLOCK Block;
+  MAPZSLICE Slice;
+  size_t ElemSize;
+  size_t Size;
+  long Offset;
+  long long SlicePos;
+  int x0;
+  int y0;
+  int y;
+  int NCols;
+  int NRows;
+
+  OpenFile(&OutFile, FileName, "r+b", FALSE);
+  if (fread(&Header, sizeof(MAPZHEADER), 1, OutFile) != 1) {
+    /* A new file */
+    memset(&Header, 0, sizeof(MAPZHEADER));
+    memcpy(Header.Magic, MAPZ_MAGIC, sizeof(Header.Magic));
+    Header.Version = MAPZ_VERSION;
+    Header.NY = NY;
+    Header.NX = NX;
+    Header.Tile = MAPZ_TILE;
+  }
+  else if (memcmp(Header.Magic, MAPZ_MAGIC, sizeof(Header.Magic)) != 0 ||
+	   Header.Version != MAPZ_VERSION || Header.NY != NY || Header.NX != NX)
+    ReportError(FileName, 51);
+
+  ElemSize = SizeOfNumberType(NumberType);
+
+  /* Compress the tiles, each copied to Tile first */
+  Buffer = SliceBuffer((size_t) NY * NX * ElemSize);
+  Size = 0;
+  for (y0 = 0; y0 < NY; y0 += MAPZ_TILE) {
+    NRows = (NY - y0 < MAPZ_TILE) ? NY - y0 : MAPZ_TILE;
+    for (x0 = 0; x0 < NX; x0 += MAPZ_TILE) {
+      NCols = (NX - x0 < MAPZ_TILE) ? NX - x0 : MAPZ_TILE;
+      for (y = 0; y < NRows; y++)
+	memcpy(Tile + (size_t) y * NCols * ElemSize,
+	       (unsigned char *) Matrix + ((size_t) (y0 + y) * NX + x0) * ElemSize,
+	       NCols * ElemSize);
+      Size += EncodeTile(NRows * NCols, ElemSize, Buffer + Size);
+    }
+  }
+
+  /* Start a new index block every MAPZ_BLOCK slices */
+  if (Header.NSlices % MAPZ_BLOCK == 0) {
+    memset(&Block, 0, sizeof(MAPZBLOCK));
+    if (fseek(OutFile, 0, SEEK_END))
+      ReportError(FileName, 39);
+    Offset = ftell(OutFile);
+    if (Offset < (long) sizeof(MAPZHEADER))
+      Offset = sizeof(MAPZHEADER);
+    if (fseek(OutFile, Offset, SEEK_SET))
+      ReportError(FileName, 39);
+    if (fwrite(&Block, sizeof(MAPZBLOCK), 1, OutFile) != 1)
+      ReportError(FileName, 41);
+    if (Header.LastBlock == 0)
+      Header.FirstBlock = Offset;
+    else {
+      SlicePos = Offset;
+      if (fseek(OutFile, (long) Header.LastBlock, SEEK_SET))
+	ReportError(FileName, 39);
+      if (fwrite(&SlicePos, sizeof(long long), 1, OutFile) != 1)
+	ReportError(FileName, 41);
+    }
+    Header.LastBlock = Offset;
+  }
+
+  /* Add the slice to the end of the file and to the index */
+  if (fseek(OutFile, 0, SEEK_END))
+    ReportError(FileName, 39);
+  SlicePos = ftell(OutFile);
+  Slice.NumberType = NumberType;
+  Slice.Size = (int) Size;
+  if (fwrite(&Slice, sizeof(MAPZSLICE), 1, OutFile) != 1 ||
+      fwrite(Buffer, 1, Size, OutFile) != Size)
+    ReportError(FileName, 41);
+
+  Offset = (long) Header.LastBlock + sizeof(long long) +
+    (Header.NSlices % MAPZ_BLOCK) * sizeof(long long);
+  if (fseek(OutFile, Offset, SEEK_SET))
+    ReportError(FileName, 39);
+  if (fwrite(&SlicePos, sizeof(long long), 1, OutFile) != 1)
+    ReportError(FileName, 41);
+
+  Header.NSlices++;
+  rewind(OutFile);
+  if (fwrite(&Header, sizeof(MAPZHEADER), 1, OutFile) != 1)
+    ReportError(FileName, 41);
+
+  fclose(OutFile);
+
+  return NY * NX;
+}
+
+/*****************************************************************************
+  IsMapFileZip()
+
+  Returns TRUE if the file is a compressed map file.  The file is left at its
+  start.
+*****************************************************************************/
+int IsMapFileZip(FILE *InFile)
+{
+  char Magic[sizeof(((MAPZHEADER *) 0)->Magic)];
+  int Result;
+
+  Result = (fread(Magic, sizeof(Magic), 1, InFile) == 1 &&
+	    memcmp(Magic, MAPZ_MAGIC, sizeof(Magic)) == 0);
+  rewind(InFile);
+
+  return Result;
+}
+
+/*****************************************************************************
+  ReadMapHeaderZip()
+*****************************************************************************/
+void ReadMapHeaderZip(FILE *InFile, char *FileName, MAPZHEADER *Header)
+{
+  rewind(InFile);
+  if (fread(Header, sizeof(MAPZHEADER), 1, InFile) != 1)
+    ReportError(FileName, 2);
+  if (memcmp(Header->Magic, MAPZ_MAGIC, sizeof(Header->Magic)) != 0 ||
+      Header->Version != MAPZ_VERSION || Header->Tile != MAPZ_TILE ||
+      Header->NY <= 0 || Header->NX <= 0)
+    ReportError(FileName, 51);
+}
+
+/*****************************************************************************
+  ReadMapSliceZip()
+
+  Reads matrix NDataSet of a compressed file into Matrix, and returns its
+  number type.  If NumberType is not 0, the matrix must have elements of
+  the same size.
+*****************************************************************************/
+int ReadMapSliceZip(FILE *InFile, char *FileName, MAPZHEADER *Header,
+		    int NDataSet, int NumberType, void *Matrix)
+{
+  MAPZSLICE Slice;
+  size_t ElemSize;
+  size_t Size;
+  size_t Used = 0;
+  int x0;
+  int y0;
+  int y;
+  int NCols;
+  int NRows;
+
+  if (fseek(InFile, SliceOffset(InFile, FileName, Header, NDataSet), SEEK_SET))
+    ReportError(FileName, 39);
+  if (fread(&Slice, sizeof(MAPZSLICE), 1, InFile) != 1)
+    ReportError(FileName, 2);
+  ElemSize = SizeOfNumberType(Slice.NumberType);
+  if (NumberType != 0 && ElemSize != SizeOfNumberType(NumberType))
+    ReportError(FileName, 51);
+  if (Slice.Size < 0)
+    ReportError(FileName, 2);
+
+  Buffer = SliceBuffer((size_t) Slice.Size);
+  if (fread(Buffer, 1, Slice.Size, InFile) != (size_t) Slice.Size)
+    ReportError(FileName, 2);
+
+  Size = 0;
+  for (y0 = 0; y0 < Header->NY; y0 += MAPZ_TILE) {
+    NRows = (Header->NY - y0 < MAPZ_TILE) ? Header->NY - y0 : MAPZ_TILE;
+    for (x0 = 0; x0 < Header->NX; x0 += MAPZ_TILE) {
+      NCols = (Header->NX - x0 < MAPZ_TILE) ? Header->NX - x0 : MAPZ_TILE;
+      if (!DecodeTile(NRows * NCols, ElemSize, Buffer + Size,
+		      Slice.Size - Size, &Used))
+	ReportError(FileName, 2);
+      Size += Used;
+      for (y = 0; y < NRows; y++)
+	memcpy((unsigned char *) Matrix +
+	       ((size_t) (y0 + y) * Header->NX + x0) * ElemSize,
+	       Tile + (size_t) y * NCols * ElemSize, NCols * ElemSize);
+    }
+  }
+
+  return Slice.NumberType;
+}
+
+/*****************************************************************************
+  SliceBuffer()
+
+  Returns Buffer, enlarged if needed to hold the tiles of Size bytes of
+  elements.
+*****************************************************************************/
+static unsigned char *SliceBuffer(size_t Size)
+{
+  /* A tile takes at most its elements and 5 bytes */
+  Size += (Size / (MAPZ_TILE * MAPZ_TILE) + 2) * 5 + TILEBYTES;
+  if (Size > BufferSize) {
+    free(Buffer);
+    if (!(Buffer = (unsigned char *) malloc(Size)))
+      ReportError("SliceBuffer", 1);
+    BufferSize = Size;
+  }
+  return Buffer;
+}
+
+/*****************************************************************************
+  EncodeTile()
+
+  Compresses the N elements in Tile to Out and returns the number of bytes
+  written.
+*****************************************************************************/
+static size_t EncodeTile(int N, size_t ElemSize, unsigned char *Out)
+{
+  size_t Bytes = N * ElemSize;
+  size_t Length;
+  size_t i;
+  size_t j;
+  int Length32;
+
+  for (i = ElemSize; i < Bytes; i++)
+    if (Tile[i] != Tile[i % ElemSize])
+      break;
+  if (i == Bytes) {
+    Out[0] = MAPZ_CONSTANT;
+    memcpy(Out + 1, Tile, ElemSize);
+    return 1 + ElemSize;
+  }
+
+  for (j = 0; j < ElemSize; j++) {
+    Planes[j * N] = Tile[j];
+    for (i = 1; i < (size_t) N; i++)
+      Planes[j * N + i] = Tile[i * ElemSize + j] ^ Tile[(i - 1) * ElemSize + j];
+  }
+  Length = PackBits(Planes, Bytes, Packed);
+
+  if (Length + sizeof(int) < Bytes) {
+    Out[0] = MAPZ_PACKED;
+    Length32 = (int) Length;
+    memcpy(Out + 1, &Length32, sizeof(int));
+    memcpy(Out + 1 + sizeof(int), Packed, Length);
+    return 1 + sizeof(int) + Length;
+  }
+
+  Out[0] = MAPZ_RAW;
+  memcpy(Out + 1, Tile, Bytes);
+  return 1 + Bytes;
+}
+
+/*****************************************************************************
+  DecodeTile()
+
+  Decompresses N elements from the Size bytes at In to Tile, and sets Used
+  to the number of bytes read.  Returns FALSE if the data are not valid.
+*****************************************************************************/
+static int DecodeTile(int N, size_t ElemSize, unsigned char *In,
+		      size_t Size, size_t *Used)
+{
+  size_t Bytes = N * ElemSize;
+  size_t i;
+  size_t j;
+  int Length;
+
+  if (Size < 1)
+    return FALSE;
+
+  switch (In[0]) {
+  case MAPZ_CONSTANT:
+    if (Size < 1 + ElemSize)
+      return FALSE;
+    for (i = 0; i < Bytes; i += ElemSize)
+      memcpy(Tile + i, In + 1, ElemSize);
+    *Used = 1 + ElemSize;
+    return TRUE;
+  case MAPZ_PACKED:
+    if (Size < 1 + sizeof(int))
+      return FALSE;
+    memcpy(&Length, In + 1, sizeof(int));
+    if (Length < 0 || (size_t) Length > Size - 1 - sizeof(int) ||
+	!UnpackBits(In + 1 + sizeof(int), Length, Planes, Bytes))
+      return FALSE;
+    for (j = 0; j < ElemSize; j++) {
+      Tile[j] = Planes[j * N];
+      for (i = 1; i < (size_t) N; i++)
+	Tile[i * ElemSize + j] = Planes[j * N + i] ^ Tile[(i - 1) * ElemSize + j];
+    }
+    *Used = 1 + sizeof(int) + Length;
+    return TRUE;
+  case MAPZ_RAW:
+    if (Size < 1 + Bytes)
+      return FALSE;
+    memcpy(Tile, In + 1, Bytes);
+    *Used = 1 + Bytes;
+    return TRUE;
+  default:
+    return FALSE;
+  }
+}
+
+/*****************************************************************************
+  PackBits()
+
+  Run-length codes N bytes.  A control byte n from 0 to 127 is followed by
+  n + 1 bytes that are copied, a control byte n from -127 to -1 by a byte
+  that is repeated 1 - n times.  Returns the number of bytes written to Out,
+  at most N + N / 128 + 1.
+*****************************************************************************/
+static size_t PackBits(unsigned char *In, size_t N, unsigned char *Out)
+{
+  size_t i = 0;
+  size_t o = 0;
+  size_t Run;
+  size_t Start;
+
+  while (i < N) {
+    for (Run = 1; i + Run < N && Run < 128 && In[i + Run] == In[i]; Run++)
+      ;
+    if (Run >= 3) {
+      Out[o++] = (unsigned char) (257 - Run);
+      Out[o++] = In[i];
+      i += Run;
+    }
+    else {
+      /* Copy up to the next run of three or more */
+      for (Start = i; i < N && i - Start < 128; i++)
+	if (i + 2 < N && In[i] == In[i + 1] && In[i] == In[i + 2])
+	  break;
+      Out[o++] = (unsigned char) (i - Start - 1);
+      memcpy(Out + o, In + Start, i - Start);
+      o += i - Start;
+    }
+  }
+
+  return o;
+}
+
+/*****************************************************************************
+  UnpackBits()
+
+  Reverses PackBits().  Returns FALSE unless the NIn bytes at In decode to
+  exactly NOut bytes.
+*****************************************************************************/
+static int UnpackBits(unsigned char *In, size_t NIn, unsigned char *Out,
+		      size_t NOut)
+{
+  size_t i = 0;
+  size_t o = 0;
+  size_t Count;
+  signed char n;
+
+  while (i < NIn) {
+    n = (signed char) In[i++];
+    if (n >= 0) {
+      Count = n + 1;
+      if (i + Count > NIn || o + Count > NOut)
+	return FALSE;
+      memcpy(Out + o, In + i, Count);
+      i += Count;
+    }
+    else if (n != -128) {
+      Count = 1 - n;
+      if (i >= NIn || o + Count > NOut)
+	return FALSE;
+      memset(Out + o, In[i++], Count);
+    }
+    else
+      continue;
+    o += Count;
+  }
+
+  return (o == NOut);
+}
+
+/*****************************************************************************
+  SliceOffset()
+
+  Returns the position of matrix NDataSet in the file, from the index.
+*****************************************************************************/
+static long SliceOffset(FILE *InFile, char *FileName, MAPZHEADER *Header,
+			int NDataSet)
+{
+  long long Block;
+  long long Offset;
+  int i;
+
+  if (NDataSet < 0 || NDataSet >= Header->NSlices)
+    ReportError(FileName, 2);
+
+  Block = Header->FirstBlock;
+  for (i = 0; i < NDataSet / MAPZ_BLOCK; i++) {
+    if (fseek(InFile, (long) Block, SEEK_SET))
+      ReportError(FileName, 39);
+    if (fread(&Block, sizeof(long long), 1, InFile) != 1 || Block <= 0)
+      ReportError(FileName, 2);
+  }
+
+  if (fseek(InFile, (long) (Block + sizeof(long long) *
+			    (1 + NDataSet % MAPZ_BLOCK)), SEEK_SET))
+    ReportError(FileName, 39);
+  if (fread(&Offset, sizeof(long long), 1, InFile) != 1 || Offset <= 0)
+    ReportError(FileName, 2);
+
+  return (long) Offset;
+}
@@ -13,6 +13,11 @@
  *               # comment
  *               [section]
  *               key=value          # comment
+ *
+ *               ReadInitFile keeps the lines of the file in a list and
+ *               indexes the key-entry pairs in a hash table under their
+ *               normalized section and key names, so that a lookup does
+ *               not have to parse the list up to the matching line.
  */
 #define _CRT_SECURE_NO_DEPRECATE
 #include <ctype.h>
@@ -23,38 +28,81 @@
 #include "fileio.h"
 #include "getinit.h"
 
+/* Hash table of the lines of an input list.  Key-entry lines are
+   stored under "SECTION\nKEY" and section lines under "SECTION".  Like
+   LocateSection and LocateKey, only the first section with a given name
+   and the first occurrence of a key in that section are found. */
+struct _INITINDEX {
+  unsigned long Size;		/* number of slots, a power of 2 */
+  char **Name;			/* NULL for empty slots */
+  LISTPTR *Node;		/* line stored in the slot */
+};
+
+static void BuildIndex(LISTPTR Head);
+static unsigned long FindSlot(INITINDEX *Index, const char *Name);
+static unsigned char GetEntry(const char *Section, const char *Key,
+			      char *Entry, LISTPTR Input);
+static LISTPTR IndexedKey(const char *Section, const char *Key,
+			  LISTPTR Input);
+
 unsigned long GetInitString(const char *Section, const char *Key,
 			    const char *Default, char *ReturnBuffer,
 			    unsigned long BufferSize, LISTPTR Input)
 {
-  LISTPTR SectionHead = NULL;
-
-  if ((SectionHead = LocateSection(Section, Input)) == NULL) {
+  if (!GetEntry(Section, Key, ReturnBuffer, Input)) {
     strncpy(ReturnBuffer, Default, BufferSize + 1);
     return (unsigned long) strlen(ReturnBuffer);
   }
 
-  if (!LocateKey(Key, ReturnBuffer, SectionHead)) {
-    strncpy(ReturnBuffer, Default, BufferSize + 1);
-    return (unsigned long) strlen(ReturnBuffer);
+  return (unsigned long) strlen(ReturnBuffer);
+}
+/*#####################################################################################
+ Replaces the entry of an existing key in the input list, returns FALSE if the key is
+ not found in the section
+ #####################################################################################*/
+unsigned char ReplaceInitString(const char *Section, const char *Key,
+				const char *Entry, LISTPTR Input)
+{
+  char Buffer[BUFSIZE + 1];
+  char *StrPtr = NULL;
+  LISTPTR Node = NULL;
+
+  if (Input != NULL && Input->Index != NULL) {
+    if ((Node = IndexedKey(Section, Key, Input)) == NULL)
+      return FALSE;
+    snprintf(Node->Str, BUFSIZE + 1, "%s = %.*s", Key,
+	     (int) (BUFSIZE - strlen(Key) - 3), Entry);
+    return TRUE;
   }
 
-  return (unsigned long) strlen(ReturnBuffer);
+  for (Input = LocateSection(Section, Input); Input != NULL; Input = Input->Next) {
+    strncpy(Buffer, Input->Str, BUFSIZE + 1);
+    if (IsSection(Buffer))
+      break;
+    if (IsKeyEntryPair(Buffer)) {
+      StrPtr = strchr(Buffer, SEPARATOR);
+      *StrPtr = '\0';
+      Strip(Buffer);
+      MakeKeyString(Buffer);
+      if (strcmp(Key, Buffer) == 0) {
+	snprintf(Input->Str, BUFSIZE + 1, "%s = %.*s", Key,
+		 (int) (BUFSIZE - strlen(Key) - 3), Entry);
+	return TRUE;
+      }
+    }
+  }
+
+  return FALSE;
 }
 /*#####################################################################################*/
 long GetInitLong(const char *Section, const char *Key, long Default,
 		 LISTPTR Input)
 {
-  LISTPTR SectionHead = NULL;
   char Buffer[BUFSIZE + 1];
   char *EndPtr = NULL;
   long Entry;
 
-  if ((SectionHead = LocateSection(Section, Input)) == NULL) {
-    return Default;
-  }
-
-  if (!LocateKey(Key, Buffer, SectionHead)) {
+  if (!GetEntry(Section, Key, Buffer, Input)) {
     return Default;
   }
 
@@ -69,16 +117,11 @@ long GetInitLong(const char *Section, const char *Key, long Default,
 double GetInitDouble(const char *Section, const char *Key, double Default,
 		     LISTPTR Input)
 {
-  LISTPTR SectionHead = NULL;
   char Buffer[BUFSIZE + 1];
   char *EndPtr = NULL;
   double Entry;
 
-  if ((SectionHead = LocateSection(Section, Input)) == NULL) {
-    return Default;
-  }
-
-  if (!LocateKey(Key, Buffer, SectionHead)) {
+  if (!GetEntry(Section, Key, Buffer, Input)) {
     return Default;
   }
 
@@ -89,6 +132,116 @@ double GetInitDouble(const char *Section, const char *Key, double Default,
 
   return (Entry);
 }
+/*#####################################################################################
+ Finds the entry of a key, through the index if the list has one
+ #####################################################################################*/
+static unsigned char GetEntry(const char *Section, const char *Key,
+			      char *Entry, LISTPTR Input)
+{
+  char Buffer[BUFSIZE + 1];
+  LISTPTR SectionHead = NULL;
+  LISTPTR Node = NULL;
+
+  if (Input != NULL && Input->Index != NULL) {
+    if ((Node = IndexedKey(Section, Key, Input)) == NULL)
+      return FALSE;
+    strncpy(Buffer, strchr(Node->Str, SEPARATOR) + 1, BUFSIZE + 1);
+    Strip(Buffer);
+    memmove(Entry, Buffer, strlen(Buffer) + 1);
+    return TRUE;
+  }
+
+  if ((SectionHead = LocateSection(Section, Input)) == NULL)
+    return FALSE;
+
+  return LocateKey(Key, Entry, SectionHead);
+}
+/*#####################################################################################
+ Returns the line with the key in the section from the index, NULL if there is none
+ #####################################################################################*/
+static LISTPTR IndexedKey(const char *Section, const char *Key, LISTPTR Input)
+{
+  char Name[2 * BUFSIZE + 2];
+
+  snprintf(Name, sizeof(Name), "%s\n%s", Section, Key);
+  return Input->Index->Node[FindSlot(Input->Index, Name)];
+}
+/*#####################################################################################
+ Returns the slot that holds Name, or the empty slot where it would go
+ #####################################################################################*/
+static unsigned long FindSlot(INITINDEX *Index, const char *Name)
+{
+  const unsigned char *Ptr;
+  unsigned long Hash = 2166136261UL;	/* FNV-1a */
+  unsigned long Slot;
+
+  for (Ptr = (const unsigned char *) Name; *Ptr != '\0'; Ptr++)
+    Hash = (Hash ^ *Ptr) * 16777619UL;
+
+  Slot = Hash & (Index->Size - 1);
+  while (Index->Name[Slot] != NULL && strcmp(Index->Name[Slot], Name) != 0)
+    Slot = (Slot + 1) & (Index->Size - 1);
+
+  return Slot;
+}
+/*#####################################################################################
+ Parses the lines of the list once and stores them in the index of the first node.
+ The table is kept at most half full.
+ #####################################################################################*/
+static void BuildIndex(LISTPTR Head)
+{
+  INITINDEX *Index = NULL;
+  LISTPTR Node = NULL;
+  char Section[BUFSIZE + 1] = "";
+  char Buffer[BUFSIZE + 1];
+  char Name[2 * BUFSIZE + 2];
+  unsigned long NLines = 0;
+  unsigned long Slot;
+  unsigned char Skip = TRUE;	/* TRUE outside the first instance of a section */
+
+  for (Node = Head; Node != NULL; Node = Node->Next)
+    NLines++;
+
+  if ((Index = calloc(1, sizeof(INITINDEX))) == NULL)
+    ReportError("BuildIndex", 1);
+  for (Index->Size = 16; Index->Size < 2 * NLines; Index->Size *= 2)
+    ;
+  Index->Name = calloc(Index->Size, sizeof(char *));
+  Index->Node = calloc(Index->Size, sizeof(LISTPTR));
+  if (Index->Name == NULL || Index->Node == NULL)
+    ReportError("BuildIndex", 1);
+
+  for (Node = Head; Node != NULL; Node = Node->Next) {
+    strncpy(Buffer, Node->Str, BUFSIZE + 1);
+    if (IsSection(Buffer)) {
+      *strchr(Buffer, CLOSESECTION) = '\0';
+      memmove(Buffer, &Buffer[1], strlen(&Buffer[1]) + 1);
+      Strip(Buffer);
+      MakeKeyString(Buffer);
+      strcpy(Section, Buffer);
+      strcpy(Name, Section);
+      Skip = (Index->Name[FindSlot(Index, Name)] != NULL);
+    }
+    else if (Skip || !IsKeyEntryPair(Buffer)) {
+      continue;
+    }
+    else {
+      *strchr(Buffer, SEPARATOR) = '\0';
+      Strip(Buffer);
+      MakeKeyString(Buffer);
+      snprintf(Name, sizeof(Name), "%s\n%s", Section, Buffer);
+    }
+
+    Slot = FindSlot(Index, Name);
+    if (Index->Name[Slot] == NULL) {
+      if ((Index->Name[Slot] = strdup(Name)) == NULL)
+        ReportError("BuildIndex", 1);
+      Index->Node[Slot] = Node;
+    }
+  }
+
+  Head->Index = Index;
+}
 /*#####################################################################################
  This function is used to find the matching key word in the input file for the "key" 
  specified in the fucntion: InitVegTable( )
@@ -421,6 +574,9 @@ void ReadInitFile(char *TemplateFileName, LISTPTR * Input)
 
   fclose(InFile);
 
+  if (Head != NULL)
+    BuildIndex(Head);
+
   return;
 }
 /*#####################################################################################*/
@@ -439,6 +595,15 @@ LISTPTR CreateNode(void)
 void DeleteList(LISTPTR Head)
 {
   LISTPTR Current = NULL;
+  unsigned long i;
+
+  if (Head != NULL && Head->Index != NULL) {
+    for (i = 0; i < Head->Index->Size; i++)
+      free(Head->Index->Name[i]);
+    free(Head->Index->Name);
+    free(Head->Index->Node);
+    free(Head->Index);
+  }
 
   Current = Head;
   while (Current != NULL) {
@@ -8,6 +8,8 @@
 #include "functions.h"
 #include "constants.h"
 #include "rad.h"
+#include "ensemble.h"
+#include "metprefetch.h"
 
  /*****************************************************************************
    GetMetData()
@@ -20,8 +22,12 @@ void GetMetData(OPTIONSTRUCT *Options, TIMESTRUCT *Time, int NSoilLayers,
   if (DEBUG)
     printf("Reading all met data for current timestep\n");
 
-  for (i = 0; i < NStats; i++)
-    ReadMetRecord(Options, &(Time->Current), NSoilLayers, &(Stat[i].MetFile), &(Stat[i].Data));
+  /* In an ensemble run the met records are read once for all members, and
+     with MET PREFETCH they are read ahead by a background thread */
+  if (!EnsembleMetRecords(Options, NSoilLayers, NStats, Stat) &&
+      !PrefetchMetRecords(Options, Time, NSoilLayers, NStats, Stat))
+    for (i = 0; i < NStats; i++)
+      ReadMetRecord(Options, &(Time->Current), NSoilLayers, &(Stat[i].MetFile), &(Stat[i].Data));
 
   for (i = 0; i < NStats; i++) {
     if (SunMax > 0.0) {
@@ -41,12 +41,26 @@ void InitConstants(LISTPTR Input, OPTIONSTRUCT *Options, MAPSIZE *Map,
   float TimeStep;		/* Timestep in hours */
   DATE End;			/* End of run */
   DATE Start;			/* Start of run */
+  TIMESTRUCT Run;		/* Used to step to the forecast start */
 
   STRINIENTRY StrEnv[] = {
     {"OPTIONS", "EXTENT", "", ""},
     {"OPTIONS", "GRADIENT", "", ""},
     {"OPTIONS", "ROUTING NEIGHBORS", "", "8"},
     {"OPTIONS", "MULTIPLE FLOW DIRECTIONS", "", "TRUE"},
+    {"OPTIONS", "SATURATED FLOW SOLVER", "", "EXPLICIT"},
+    {"OPTIONS", "WATER TABLE GRADIENT TOLERANCE", "", "0.0"},
+    {"OPTIONS", "CONTIGUOUS SOIL LAYERS", "", "FALSE"},
+    {"OPTIONS", "PROFILE", "", "FALSE"},
+    {"OPTIONS", "COUNTERS", "", "FALSE"},
+    {"OPTIONS", "MEMORY REPORT", "", "FALSE"},
+    {"OPTIONS", "MEMORY LIMIT", "", "0.0"},
+    {"OPTIONS", "ENSEMBLE FILE", "", "none"},
+    {"OPTIONS", "FORECAST FILE", "", "none"},
+    {"OPTIONS", "FORECAST START", "", ""},
+    {"OPTIONS", "STATE SNAPSHOT", "", "FALSE"},
+    {"OPTIONS", "BASIN BUNDLE", "", "none"},
+    {"OPTIONS", "MET PREFETCH", "", "0"},
     {"OPTIONS", "SENSIBLE HEAT FLUX", "", ""},
     {"OPTIONS", "OVERLAND ROUTING", "", ""},
     {"OPTIONS", "LAKE DYNAMICS", "", "FALSE"},
@@ -70,6 +84,7 @@ void InitConstants(LISTPTR Input, OPTIONSTRUCT *Options, MAPSIZE *Map,
     {"OPTIONS", "SHADING DATA PATH", "", ""},
     {"OPTIONS", "SHADING DATA EXTENSION", "", ""},
     {"OPTIONS", "SKYVIEW DATA PATH", "", ""},
+    {"OPTIONS", "STREAM SHADING", "", "FALSE"},
 	  {"OPTIONS", "VARIABLE LIGHT TRANSMITTANCE", "", "" },
     {"OPTIONS", "CANOPY GAPPING", "", "" },
     {"OPTIONS", "SNOW SLIDING", "", "" },
@@ -78,9 +93,14 @@ void InitConstants(LISTPTR Input, OPTIONSTRUCT *Options, MAPSIZE *Map,
     {"OPTIONS", "DYNAMIC VEGETATION", "", "FALSE" },
     {"OPTIONS", "EXTRA STREAM STATE DATA", "", "FALSE" },
     {"OPTIONS", "EXTRA STREAM TIMESERIES DATA", "", "FALSE"},
+    {"OPTIONS", "STREAMFLOW OUTPUT FORMAT", "", "TEXT"},
+    {"OPTIONS", "STREAMFLOW AGGREGATION", "", "NONE"},
+    {"OPTIONS", "MAP FILE FORMAT", "", "BINARY"},
     {"OPTIONS", "GROUNDWATER SPINUP", "", "FALSE" },
     {"OPTIONS", "GROUNDWATER SPINUP YEARS", "", "0" },
     {"OPTIONS", "GROUNDWATER SPINUP RECHARGE", "", "0.0" },
+    {"OPTIONS", "GROUNDWATER SPINUP TOLERANCE", "", "0.0" },
+    {"OPTIONS", "GROUNDWATER SPINUP RELAXATION", "", "1.0" },
     {"AREA", "COORDINATE SYSTEM", "", ""},
     {"AREA", "EXTREME NORTH", "", ""},
     {"AREA", "EXTREME WEST", "", ""},
@@ -185,6 +205,108 @@ void InitConstants(LISTPTR Input, OPTIONSTRUCT *Options, MAPSIZE *Map,
   else
     ReportError(StrEnv[routing_mfd].KeyName, 51);
   
+  /* Determine how lateral saturated flow is solved */
+  if (strncmp(StrEnv[sat_solver].VarStr, "EXPLICIT", 8) == 0)
+    Options->SatFlowSolver = EXPLICIT;
+  else if (strncmp(StrEnv[sat_solver].VarStr, "IMPLICIT", 8) == 0) {
+    Options->SatFlowSolver = IMPLICIT;
+    if (Options->FlowGradient != WATERTABLE)
+      ReportError(StrEnv[sat_solver].KeyName, 51);
+    printf("Using implicit solver for saturated subsurface flow\n");
+  }
+  else
+    ReportError(StrEnv[sat_solver].KeyName, 51);
+  
+  /* Change in water level that triggers recalculation of the subsurface flow directions */
+  if (Options->FlowGradient == WATERTABLE) {
+    if (!CopyFloat(&(Options->HeadSlopeTol), StrEnv[head_slope_tol].VarStr, 1) ||
+        Options->HeadSlopeTol < 0.0)
+      ReportError(StrEnv[head_slope_tol].KeyName, 51);
+  }
+  else
+    Options->HeadSlopeTol = 0.0;
+  
+  /* Determine how the per-layer soil arrays are stored */
+  if (strncmp(StrEnv[contiguous_soil].VarStr, "TRUE", 4) == 0)
+    Options->ContiguousSoil = TRUE;
+  else if (strncmp(StrEnv[contiguous_soil].VarStr, "FALSE", 5) == 0)
+    Options->ContiguousSoil = FALSE;
+  else
+    ReportError(StrEnv[contiguous_soil].KeyName, 51);
+  
+  /* Determine whether to time the model stages */
+  if (strncmp(StrEnv[profile].VarStr, "TRUE", 4) == 0)
+    Options->Profile = PROFILE_SUMMARY;
+  else if (strncmp(StrEnv[profile].VarStr, "TIMESTEP", 8) == 0)
+    Options->Profile = PROFILE_TIMESTEP;
+  else if (strncmp(StrEnv[profile].VarStr, "FALSE", 5) == 0)
+    Options->Profile = FALSE;
+  else
+    ReportError(StrEnv[profile].KeyName, 51);
+  
+  /* Determine whether to count solver iterations and sub-steps */
+  if (strncmp(StrEnv[counters].VarStr, "TRUE", 4) == 0)
+    Options->Counters = TRUE;
+  else if (strncmp(StrEnv[counters].VarStr, "FALSE", 5) == 0)
+    Options->Counters = FALSE;
+  else
+    ReportError(StrEnv[counters].KeyName, 51);
+  
+  /* Determine whether to report memory use, and the limit (GB) on the
+     forecast memory use (0.0 for no limit) */
+  if (strncmp(StrEnv[memory_report].VarStr, "TRUE", 4) == 0)
+    Options->MemoryReport = TRUE;
+  else if (strncmp(StrEnv[memory_report].VarStr, "FALSE", 5) == 0)
+    Options->MemoryReport = FALSE;
+  else
+    ReportError(StrEnv[memory_report].KeyName, 51);
+  if (!CopyFloat(&(Options->MemoryLimit), StrEnv[memory_limit].VarStr, 1) ||
+      Options->MemoryLimit < 0.0)
+    ReportError(StrEnv[memory_limit].KeyName, 51);
+  
+  /* Determine whether to run a parameter ensemble (see Ensemble.c) */
+  if (strncmp(StrEnv[ensemble_file].VarStr, "none", 4)) {
+    Options->Ensemble = TRUE;
+    strcpy(Options->EnsembleFile, StrEnv[ensemble_file].VarStr);
+  }
+  else
+    Options->Ensemble = FALSE;
+  
+  /* Determine whether to run forecast scenarios (see Ensemble.c).  The
+     forecast start is checked with the model period below */
+  if (strncmp(StrEnv[forecast_file].VarStr, "none", 4)) {
+    Options->Forecast = TRUE;
+    strcpy(Options->ForecastFile, StrEnv[forecast_file].VarStr);
+    if (Options->Ensemble)
+      ReportError(StrEnv[forecast_file].KeyName, 65);
+  }
+  else
+    Options->Forecast = FALSE;
+  
+  /* Determine whether the model state is stored in and restored from a
+     single binary snapshot (see Snapshot.c) */
+  if (strncmp(StrEnv[state_snapshot].VarStr, "TRUE", 4) == 0)
+    Options->Snapshot = TRUE;
+  else if (strncmp(StrEnv[state_snapshot].VarStr, "FALSE", 5) == 0)
+    Options->Snapshot = FALSE;
+  else
+    ReportError(StrEnv[state_snapshot].KeyName, 51);
+  
+  /* Determine whether the terrain and the interpolation weights are kept
+     in a precompiled basin bundle (see Bundle.c) */
+  if (strncmp(StrEnv[basin_bundle].VarStr, "none", 4)) {
+    Options->Bundle = TRUE;
+    strcpy(Options->BundleFile, StrEnv[basin_bundle].VarStr);
+  }
+  else
+    Options->Bundle = FALSE;
+
+  /* Determine how many time steps of met records are read ahead by a
+     background thread (see MetPrefetch.c) */
+  if (!CopyInt(&(Options->MetPrefetch), StrEnv[met_prefetch].VarStr, 1) ||
+      Options->MetPrefetch < 0)
+    ReportError(StrEnv[met_prefetch].KeyName, 51);
+  
   /* Determine what meterological interpolation to use */
   if (strncmp(StrEnv[interpolation].VarStr, "INVDIST", 7) == 0)
     Options->Interpolation = INVDIST;
@@ -367,6 +489,30 @@ void InitConstants(LISTPTR Input, OPTIONSTRUCT *Options, MAPSIZE *Map,
   else
     ReportError(StrEnv[streamtime].KeyName, 51);
   
+  /* Determine the format of the streamflow output (see StreamOutput.c) */
+  if (strncmp(StrEnv[streamflow_format].VarStr, "TEXT", 4) == 0)
+    Options->StreamBinary = FALSE;
+  else if (strncmp(StrEnv[streamflow_format].VarStr, "BINARY", 6) == 0)
+    Options->StreamBinary = TRUE;
+  else
+    ReportError(StrEnv[streamflow_format].KeyName, 51);
+  if (strncmp(StrEnv[streamflow_aggregation].VarStr, "NONE", 4) == 0)
+    Options->StreamDaily = FALSE;
+  else if (strncmp(StrEnv[streamflow_aggregation].VarStr, "DAILY", 5) == 0)
+    Options->StreamDaily = TRUE;
+  else
+    ReportError(StrEnv[streamflow_aggregation].KeyName, 51);
+  if (Options->StreamDaily && !Options->StreamBinary)
+    ReportError(StrEnv[streamflow_aggregation].KeyName, 65);
+
+  /* Determine the format of the map and state files (see FileIOZip.c) */
+  if (strncmp(StrEnv[map_format].VarStr, "BINARY", 6) == 0)
+    Options->MapCompressed = FALSE;
+  else if (strncmp(StrEnv[map_format].VarStr, "COMPRESSED", 10) == 0)
+    Options->MapCompressed = TRUE;
+  else
+    ReportError(StrEnv[map_format].KeyName, 51);
+  
   /* Determine whether to spinup groundwater state before starting model run */
   if (strncmp(StrEnv[gw_spinup].VarStr, "TRUE", 4) == 0)
     Options->GW_SPINUP = TRUE;
@@ -380,6 +526,15 @@ void InitConstants(LISTPTR Input, OPTIONSTRUCT *Options, MAPSIZE *Map,
       ReportError(StrEnv[gw_spinup_yrs].KeyName, 51);
     if (!CopyFloat(&(Options->GW_SPINUP_RECHARGE), StrEnv[gw_spinup_recharge].VarStr, 1))
       ReportError(StrEnv[gw_spinup_recharge].KeyName, 51);
+    
+    /* Optional early exit once the water table stops moving, and
+       over-relaxation (1 <= relax < 2) to get there in fewer sweeps */
+    if (!CopyFloat(&(Options->GW_SPINUP_TOL), StrEnv[gw_spinup_tol].VarStr, 1) ||
+        Options->GW_SPINUP_TOL < 0.0)
+      ReportError(StrEnv[gw_spinup_tol].KeyName, 51);
+    if (!CopyFloat(&(Options->GW_SPINUP_RELAX), StrEnv[gw_spinup_relax].VarStr, 1) ||
+        Options->GW_SPINUP_RELAX < 1.0 || Options->GW_SPINUP_RELAX >= 2.0)
+      ReportError(StrEnv[gw_spinup_relax].KeyName, 51);
   }
   
   /* If canopy gapping option is true, the improved radiation scheme must be true */
@@ -421,7 +576,18 @@ void InitConstants(LISTPTR Input, OPTIONSTRUCT *Options, MAPSIZE *Map,
     if (IsEmptyStr(StrEnv[skyview_data_path].VarStr))
       ReportError(StrEnv[skyview_data_path].KeyName, 51);
     strcpy(Options->SkyViewDataPath, StrEnv[skyview_data_path].VarStr);
+    /* Determine whether the shade maps are streamed (see ShadeStream.c) */
+    if (strncmp(StrEnv[stream_shading].VarStr, "TRUE", 4) == 0)
+      Options->StreamShading = TRUE;
+    else if (strncmp(StrEnv[stream_shading].VarStr, "FALSE", 5) == 0)
+      Options->StreamShading = FALSE;
+    else
+      ReportError(StrEnv[stream_shading].KeyName, 51);
+    if (Options->StreamShading && Options->Ensemble)
+      ReportError(StrEnv[stream_shading].KeyName, 65);
   }
+  else
+    Options->StreamShading = FALSE;
 
   /* Determine if rh override is used */
   if (strncmp(StrEnv[rhoverride].VarStr, "TRUE", 4) == 0)
@@ -516,6 +682,18 @@ void InitConstants(LISTPTR Input, OPTIONSTRUCT *Options, MAPSIZE *Map,
 
   InitTime(Time, &Start, &End, (int) TimeStep);
 
+  /* The forecast scenarios start at a time step within the model period */
+  if (Options->Forecast) {
+    if (!SScanDate(StrEnv[forecast_start].VarStr, &(Options->ForecastStart)))
+      ReportError(StrEnv[forecast_start].KeyName, 51);
+    Run = *Time;
+    while (Before(&(Run.Current), &(Options->ForecastStart)))
+      IncreaseTime(&Run);
+    if (!IsEqualTime(&(Run.Current), &(Options->ForecastStart)) ||
+        After(&(Options->ForecastStart), &End))
+      ReportError(StrEnv[forecast_start].KeyName, 23);
+  }
+
    /**************** Determine model constants ****************/
   
   if (!CopyFloat(&Z0_GROUND, StrEnv[ground_roughness].VarStr, 1))
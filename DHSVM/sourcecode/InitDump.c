@@ -11,6 +11,8 @@
 #include "getinit.h"
 #include "sizeofnt.h"
 #include "varid.h"
+#include "pixeloutput.h"
+#include "mapaggregate.h"
 
  /*******************************************************************************
    Function name: InitDump()
@@ -41,6 +43,7 @@ void InitDump(LISTPTR Input, OPTIONSTRUCT *Options, MAPSIZE *Map, int MaxSoilLay
                    dump maps */
   int temp_count;
   uchar **BasinMask;
+  PIXLAYOUT MaxLayout;		/* Widest pixel layout of a binary pixel file */
   char sumoutfile[BUFSIZ + 20];
 
 
@@ -50,6 +53,7 @@ void InitDump(LISTPTR Input, OPTIONSTRUCT *Options, MAPSIZE *Map, int MaxSoilLay
     {"OUTPUT", "NUMBER OF OUTPUT PIXELS", "", ""},
     {"OUTPUT", "NUMBER OF MODEL STATES", "", ""},
     {"OUTPUT", "NUMBER OF MAP VARIABLES", "", ""},
+    {"OUTPUT", "PIXEL OUTPUT FORMAT", "", "TEXT"},
     {NULL, NULL, "", NULL},
   };
 
@@ -90,6 +94,15 @@ void InitDump(LISTPTR Input, OPTIONSTRUCT *Options, MAPSIZE *Map, int MaxSoilLay
 
   Dump->NMaps = NMapVars;
 
+  /* Determine whether the pixel timeseries are written as text files or to
+     one binary file (see PixelOutput.c) */
+  if (strncmp(StrEnv[pixel_format].VarStr, "TEXT", 4) == 0)
+    Dump->PixBinary = FALSE;
+  else if (strncmp(StrEnv[pixel_format].VarStr, "BINARY", 6) == 0)
+    Dump->PixBinary = TRUE;
+  else
+    ReportError(StrEnv[pixel_format].KeyName, 51);
+
   // Open file for recording aggregated values for entire basin
   sprintf(Dump->Aggregate.FileName, "%sAggregated.Values", Dump->Path);
   OpenFile(&(Dump->Aggregate.FilePtr), Dump->Aggregate.FileName, "w", TRUE);
@@ -131,6 +144,18 @@ void InitDump(LISTPTR Input, OPTIONSTRUCT *Options, MAPSIZE *Map, int MaxSoilLay
       else {
         Dump->NPix = temp_count;
         printf("total number of accepted dump pixels %d \n", Dump->NPix);
+        if (Dump->PixBinary) {
+          MaxLayout.NSoil = MaxSoilLayers;
+          MaxLayout.NCanopyStory = MaxVegLayers;
+          MaxLayout.HeatFlux = MaxLayout.Gap = TRUE;
+          MaxLayout.DynamicInfilt = MaxLayout.GapRad = TRUE;
+          InitPixBinary(Dump->Path, Dump->NPix, Dump->Pix, &MaxLayout);
+        }
+        else {
+          for (i = 0; i < Dump->NPix; i++)
+            OpenFile(&(Dump->Pix[i].OutFile.FilePtr),
+              Dump->Pix[i].OutFile.FileName, "w", TRUE);
+        }
       }
     }
     for (y = 0; y < Map->NY; y++)
@@ -205,6 +230,8 @@ void InitMapDump(LISTPTR Input, MAPSIZE * Map, int MaxSoilLayers,
   char *KeyStr[] = {
     "MAP VARIABLE",
     "MAP LAYER",
+    "MAP AGGREGATION",
+    "MAP WINDOW",
     "NUMBER OF MAPS",
     "MAP DATE",
   };
@@ -242,11 +269,48 @@ void InitMapDump(LISTPTR Input, MAPSIZE * Map, int MaxSoilLayers,
 
     (*DMap)[i].Resolution = MAP_OUTPUT;
 
+    /* An aggregated map is written at the end of each window instead of at
+       the MAP DATEs */
+    if (IsEmptyStr(VarStr[map_aggregation]) ||
+        strncmp(VarStr[map_aggregation], "NONE", 4) == 0)
+      (*DMap)[i].Aggregation = MAP_SNAPSHOT;
+    else if (strncmp(VarStr[map_aggregation], "MEAN", 4) == 0)
+      (*DMap)[i].Aggregation = MAP_MEAN;
+    else if (strncmp(VarStr[map_aggregation], "MIN", 3) == 0)
+      (*DMap)[i].Aggregation = MAP_MIN;
+    else if (strncmp(VarStr[map_aggregation], "MAX", 3) == 0)
+      (*DMap)[i].Aggregation = MAP_MAX;
+    else if (strncmp(VarStr[map_aggregation], "SUM", 3) == 0)
+      (*DMap)[i].Aggregation = MAP_SUM;
+    else
+      ReportError(KeyName[map_aggregation], 51);
+
+    if ((*DMap)[i].Aggregation != MAP_SNAPSHOT) {
+      if (strncmp(VarStr[map_window], "DAILY", 5) == 0)
+        (*DMap)[i].Window = MAP_DAILY;
+      else if (strncmp(VarStr[map_window], "MONTHLY", 7) == 0)
+        (*DMap)[i].Window = MAP_MONTHLY;
+      else if (strncmp(VarStr[map_window], "WATERYEAR", 9) == 0)
+        (*DMap)[i].Window = MAP_WATERYEAR;
+      else
+        ReportError(KeyName[map_window], 51);
+    }
+
     strncpy((*DMap)[i].FileName, Path, BUFSIZE);
     GetVarAttr(&((*DMap)[i]));
+    if ((*DMap)[i].Aggregation != MAP_SNAPSHOT)
+      InitMapAggregate(Map, &((*DMap)[i]));
 
     CreateMapFile((*DMap)[i].FileName, (*DMap)[i].FileLabel, Map);
 
+    (*DMap)[i].MinVal = 0.0;
+    (*DMap)[i].MaxVal = 0.0;
+
+    if ((*DMap)[i].Aggregation != MAP_SNAPSHOT) {
+      (*DMap)[i].N = 0;
+      continue;
+    }
+
     if (!CopyInt(&((*DMap)[i].N), VarStr[nmaps], 1))
       ReportError(KeyName[nmaps], 51);
 
@@ -263,9 +327,6 @@ void InitMapDump(LISTPTR Input, MAPSIZE * Map, int MaxSoilLayers,
       if (!SScanDate(VarStr[map_date], &((*DMap)[i].DumpDate[j])))
         ReportError(KeyName[map_date], 51);
     }
-
-    (*DMap)[i].MinVal = 0.0;
-    (*DMap)[i].MaxVal = 0.0;
   }
 }
 
@@ -343,7 +404,6 @@ int InitPixDump(LISTPTR Input, MAPSIZE *Map, uchar **BasinMask, char *Path,
       sprintf((*Pix)[ok].OutFile.FileName, "%sPixel.%s", Path, Str);
       (*Pix)[ok].Loc.N = (*Pix)[i].Loc.N;
       (*Pix)[ok].Loc.E = (*Pix)[i].Loc.E;
-      OpenFile(&((*Pix)[ok].OutFile.FilePtr), (*Pix)[ok].OutFile.FileName, "w", TRUE);
       ok++;
     }
   }
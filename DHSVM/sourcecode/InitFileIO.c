@@ -4,6 +4,7 @@
 #include <string.h>
 #include "fileio.h"
 #include "fifobin.h"
+#include "fifozip.h"
 #include "DHSVMerror.h"
 
 void (*CreateMapFileFmt) (char *FileName, ...);
@@ -25,7 +26,9 @@ int (*Write2DMatrixFmt) (char *FileName, void *Matrix, int NumberType, int NY, i
   functions for the new file format, and add the additional options to this 
   initialization routine.
 
-  ONLY SUPPORTS BINARY GOING FORWARD
+  ONLY SUPPORTS BINARY GOING FORWARD, written as is or compressed (with
+  [OPTIONS] MAP FILE FORMAT = COMPRESSED, see FileIOZip.c).  Both have the
+  extension .bin, and files of either format are read.
 
   Information is stored in all files in the following way:
   fastest varying dimension: X (West to East)
@@ -48,14 +51,20 @@ int (*Write2DMatrixFmt) (char *FileName, void *Matrix, int NumberType, int NY, i
        in the range [0, 255].
 
 *******************************************************************************/
-void InitFileIO(void)
+void InitFileIO(OPTIONSTRUCT *Options)
 {
   printf("Initializing file IO\n");
 
   strcpy(fileext, ".bin");
-  CreateMapFileFmt = CreateMapFileBin;
-  Read2DMatrixFmt = Read2DMatrixBin;
-  Write2DMatrixFmt = Write2DMatrixBin;
+  Read2DMatrixFmt = Read2DMatrixZip;
+  if (Options->MapCompressed) {
+    CreateMapFileFmt = CreateMapFileZip;
+    Write2DMatrixFmt = Write2DMatrixZip;
+  }
+  else {
+    CreateMapFileFmt = CreateMapFileBin;
+    Write2DMatrixFmt = Write2DMatrixBin;
+  }
 }
 
 /******************************************************************************/
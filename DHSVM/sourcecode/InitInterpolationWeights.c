@@ -6,6 +6,7 @@
 #include "DHSVMerror.h"
 #include "functions.h"
 #include "constants.h"
+#include "bundle.h"
 
  /*****************************************************************************
    InitInterpolationWeights()
@@ -30,8 +31,12 @@ void InitInterpolationWeights(MAPSIZE *Map, OPTIONSTRUCT *Options,
     for (x = 0; x < Map->NX; x++)
       BasinMask[y][x] = TopoMap[y][x].Mask;
   
-  CalcWeights(Stats, NStats, Map->NX, Map->NY, BasinMask, MetWeights,
-              Options);
+  /* The weights may come precomputed from the basin bundle (see Bundle.c) */
+  if (!LoadBundleWeights(Options, Map, Stats, NStats, MetWeights)) {
+    CalcWeights(Stats, NStats, Map->NX, Map->NY, BasinMask, MetWeights,
+                Options);
+    StoreBundleWeights(Options, Map, NStats, *MetWeights);
+  }
   
   printf("\nSummary info on met stations used for current model run \n");
   printf("        Name\t\tY\tX\tIn Mask\tDefined Elev\tActual Elev\n");
@@ -11,6 +11,8 @@
 #include "rad.h"
 #include "sizeofnt.h"
 #include "varid.h"
+#include "memtrack.h"
+#include "shadestream.h"
 
  /*****************************************************************************
    InitMetMaps()
@@ -36,13 +38,13 @@ void InitMetMaps(LISTPTR Input, int NDaySteps, MAPSIZE *Map,
     InitPrismMap(Map->NY, Map->NX, PrismMap);
   if (Options->SnowPattern == TRUE)
     InitSnowPatternMap(SnowPatternMap, SnowPatternMapBase, Map, Options);
-  if (Options->Shading == TRUE)
+  if (Options->Shading == TRUE && *ShadowMap == NULL)
     InitShadeMap(Options, NDaySteps, Map, ShadowMap, SkyViewMap);
   
-  if (!((*SkyViewMap) = (float **)calloc(Map->NY, sizeof(float *))))
+  if (!((*SkyViewMap) = (float **)TrackCalloc(Map->NY, sizeof(float *), MEM_SHADING)))
     ReportError("InitMetMaps()", 1);
   for (y = 0; y < Map->NY; y++) {
-    if (!((*SkyViewMap)[y] = (float *)calloc(Map->NX, sizeof(float))))
+    if (!((*SkyViewMap)[y] = (float *)TrackCalloc(Map->NX, sizeof(float), MEM_SHADING)))
       ReportError("InitMetMaps()", 1);
   }
   for (y = 0; y < Map->NY; y++) {
@@ -72,11 +74,11 @@ void InitEvapMap(MAPSIZE *Map, EVAPPIX ***EvapMap, SOILPIX **SoilMap,
   if (DEBUG)
     printf("Initializing evaporation map\n");
 
-  if (!(*EvapMap = (EVAPPIX **)calloc(Map->NY, sizeof(EVAPPIX *))))
+  if (!(*EvapMap = (EVAPPIX **)TrackCalloc(Map->NY, sizeof(EVAPPIX *), MEM_EVAP)))
     ReportError((char *)Routine, 1);
 
   for (y = 0; y < Map->NY; y++) {
-    if (!((*EvapMap)[y] = (EVAPPIX *)calloc(Map->NX, sizeof(EVAPPIX))))
+    if (!((*EvapMap)[y] = (EVAPPIX *)TrackCalloc(Map->NX, sizeof(EVAPPIX), MEM_EVAP)))
       ReportError((char *)Routine, 1);
   }
 
@@ -87,23 +89,23 @@ void InitEvapMap(MAPSIZE *Map, EVAPPIX ***EvapMap, SOILPIX **SoilMap,
         NSoil = Soil->NLayers[(SoilMap[y][x].Soil - 1)];
         
         if (!((*EvapMap)[y][x].EPot =
-          (float *)calloc(NVeg + 1, sizeof(float))))
+          (float *)TrackCalloc(NVeg + 1, sizeof(float), MEM_EVAP)))
           ReportError((char *)Routine, 1);
 
         if (!((*EvapMap)[y][x].EAct =
-          (float *)calloc(NVeg + 1, sizeof(float))))
+          (float *)TrackCalloc(NVeg + 1, sizeof(float), MEM_EVAP)))
           ReportError((char *)Routine, 1);
 
-        if (!((*EvapMap)[y][x].EInt = (float *)calloc(NVeg, sizeof(float))))
+        if (!((*EvapMap)[y][x].EInt = (float *)TrackCalloc(NVeg, sizeof(float), MEM_EVAP)))
           ReportError((char *)Routine, 1);
 
         if (!((*EvapMap)[y][x].ESoil =
-          (float **)calloc(NVeg, sizeof(float *))))
+          (float **)TrackCalloc(NVeg, sizeof(float *), MEM_EVAP)))
           ReportError((char *)Routine, 1);
 
         for (i = 0; i < NVeg; i++) {
           if (!((*EvapMap)[y][x].ESoil[i] =
-            (float *)calloc(NSoil, sizeof(float))))
+            (float *)TrackCalloc(NSoil, sizeof(float), MEM_EVAP)))
             ReportError((char *)Routine, 1);
         }
       }
@@ -125,11 +127,11 @@ void InitPrecipMap(MAPSIZE * Map, PRECIPPIX *** PrecipMap, VEGPIX ** VegMap,
   if (DEBUG)
     printf("Initializing precipitation map\n");
 
-  if (!(*PrecipMap = (PRECIPPIX **)calloc(Map->NY, sizeof(PRECIPPIX *))))
+  if (!(*PrecipMap = (PRECIPPIX **)TrackCalloc(Map->NY, sizeof(PRECIPPIX *), MEM_PRECIP)))
     ReportError((char *)Routine, 1);
 
   for (y = 0; y < Map->NY; y++) {
-    if (!((*PrecipMap)[y] = (PRECIPPIX *)calloc(Map->NX, sizeof(PRECIPPIX))))
+    if (!((*PrecipMap)[y] = (PRECIPPIX *)TrackCalloc(Map->NX, sizeof(PRECIPPIX), MEM_PRECIP)))
       ReportError((char *)Routine, 1);
   }
 
@@ -138,7 +140,7 @@ void InitPrecipMap(MAPSIZE * Map, PRECIPPIX *** PrecipMap, VEGPIX ** VegMap,
       if (INBASIN(TopoMap[y][x].Mask)) {
         NVeg = Veg->NLayers[(VegMap[y][x].Veg - 1)];
         if (!((*PrecipMap)[y][x].IntRain =
-          (float *)calloc(NVeg, sizeof(float))))
+          (float *)TrackCalloc(NVeg, sizeof(float), MEM_PRECIP)))
           ReportError((char *)Routine, 1);
       }
     }
@@ -149,7 +151,7 @@ void InitPrecipMap(MAPSIZE * Map, PRECIPPIX *** PrecipMap, VEGPIX ** VegMap,
       if (INBASIN(TopoMap[y][x].Mask)) {
         NVeg = Veg->NLayers[(VegMap[y][x].Veg - 1)];
         if (!((*PrecipMap)[y][x].IntSnow =
-          (float *)calloc(NVeg, sizeof(float))))
+          (float *)TrackCalloc(NVeg, sizeof(float), MEM_PRECIP)))
           ReportError((char *)Routine, 1);
       }
     }
@@ -177,11 +179,11 @@ void InitRadMap(MAPSIZE *Map, PIXRAD ***RadMap)
   if (DEBUG)
     printf("Initializing radiation map\n");
 
-  if (!(*RadMap = (PIXRAD **)calloc(Map->NY, sizeof(PIXRAD *))))
+  if (!(*RadMap = (PIXRAD **)TrackCalloc(Map->NY, sizeof(PIXRAD *), MEM_RADIATION)))
     ReportError((char *)Routine, 1);
 
   for (y = 0; y < Map->NY; y++) {
-    if (!((*RadMap)[y] = (PIXRAD *)calloc(Map->NX, sizeof(PIXRAD))))
+    if (!((*RadMap)[y] = (PIXRAD *)TrackCalloc(Map->NX, sizeof(PIXRAD), MEM_RADIATION)))
       ReportError((char *)Routine, 1);
   }
 }
@@ -196,11 +198,11 @@ void InitPrismMap(int NY, int NX, float ***PrismMap)
   int x;			/* counter */
   int y;			/* counter */
 
-  if (!((*PrismMap) = (float **)calloc(NY, sizeof(float *))))
+  if (!((*PrismMap) = (float **)TrackCalloc(NY, sizeof(float *), MEM_METMAPS)))
     ReportError((char *)Routine, 1);
 
   for (y = 0; y < NY; y++) {
-    if (!((*PrismMap)[y] = (float *)calloc(NX, sizeof(float))))
+    if (!((*PrismMap)[y] = (float *)TrackCalloc(NX, sizeof(float), MEM_METMAPS)))
       ReportError((char *)Routine, 1);
   }
 
@@ -226,17 +228,17 @@ void InitSnowPatternMap(float ***SnowPatternMap, float ***SnowPatternMapBase,
   int NumberType;
   float *Array = NULL;
   
-  if (!((*SnowPatternMap) = (float **)calloc(Map->NY, sizeof(float *))))
+  if (!((*SnowPatternMap) = (float **)TrackCalloc(Map->NY, sizeof(float *), MEM_METMAPS)))
     ReportError((char *)Routine, 1);
-  if (!((*SnowPatternMapBase) = (float **)calloc(Map->NY, sizeof(float *))))
+  if (!((*SnowPatternMapBase) = (float **)TrackCalloc(Map->NY, sizeof(float *), MEM_METMAPS)))
     ReportError((char *)Routine, 1);
   
   for (y = 0; y < Map->NY; y++) {
-    if (!((*SnowPatternMap)[y] = (float *)calloc(Map->NX, sizeof(float))))
+    if (!((*SnowPatternMap)[y] = (float *)TrackCalloc(Map->NX, sizeof(float), MEM_METMAPS)))
       ReportError((char *)Routine, 1);
   }
   for (y = 0; y < Map->NY; y++) {
-    if (!((*SnowPatternMapBase)[y] = (float *)calloc(Map->NX, sizeof(float))))
+    if (!((*SnowPatternMapBase)[y] = (float *)TrackCalloc(Map->NX, sizeof(float), MEM_METMAPS)))
       ReportError((char *)Routine, 1);
   }
   
@@ -269,24 +271,28 @@ void InitShadeMap(OPTIONSTRUCT * Options, int NDaySteps, MAPSIZE *Map,
   int NumberType;
   float *Array = NULL;
 
-  if (!((*ShadowMap) =
-    (unsigned char ***)calloc(NDaySteps, sizeof(unsigned char **))))
-    ReportError((char *)Routine, 1);
-  for (n = 0; n < NDaySteps; n++) {
-    if (!((*ShadowMap)[n] =
-      (unsigned char **)calloc(Map->NY, sizeof(unsigned char *))))
+  if (Options->StreamShading)
+    InitShadeStream(NDaySteps, Map, ShadowMap);
+  else {
+    if (!((*ShadowMap) =
+      (unsigned char ***)TrackCalloc(NDaySteps, sizeof(unsigned char **), MEM_SHADING)))
       ReportError((char *)Routine, 1);
-    for (y = 0; y < Map->NY; y++) {
-      if (!((*ShadowMap)[n][y] =
-        (unsigned char *)calloc(Map->NX, sizeof(unsigned char))))
+    for (n = 0; n < NDaySteps; n++) {
+      if (!((*ShadowMap)[n] =
+        (unsigned char **)TrackCalloc(Map->NY, sizeof(unsigned char *), MEM_SHADING)))
         ReportError((char *)Routine, 1);
+      for (y = 0; y < Map->NY; y++) {
+        if (!((*ShadowMap)[n][y] =
+          (unsigned char *)TrackCalloc(Map->NX, sizeof(unsigned char), MEM_SHADING)))
+          ReportError((char *)Routine, 1);
+      }
     }
   }
 
-  if (!((*SkyViewMap) = (float **)calloc(Map->NY, sizeof(float *))))
+  if (!((*SkyViewMap) = (float **)TrackCalloc(Map->NY, sizeof(float *), MEM_SHADING)))
     ReportError((char *)Routine, 1);
   for (y = 0; y < Map->NY; y++) {
-    if (!((*SkyViewMap)[y] = (float *)calloc(Map->NX, sizeof(float))))
+    if (!((*SkyViewMap)[y] = (float *)TrackCalloc(Map->NX, sizeof(float), MEM_SHADING)))
       ReportError((char *)Routine, 1);
   }
 
@@ -327,10 +333,10 @@ void InitMultiplierMaps(OPTIONSTRUCT * Options, MAPSIZE *Map,
   
   /* Precip multiplier */
   
-  if (!((*PptMultiplierMap) = (float **)calloc(Map->NY, sizeof(float *))))
+  if (!((*PptMultiplierMap) = (float **)TrackCalloc(Map->NY, sizeof(float *), MEM_METMAPS)))
     ReportError((char *)Routine, 1);
   for (y = 0; y < Map->NY; y++) {
-    if (!((*PptMultiplierMap)[y] = (float *)calloc(Map->NX, sizeof(float))))
+    if (!((*PptMultiplierMap)[y] = (float *)TrackCalloc(Map->NX, sizeof(float), MEM_METMAPS)))
       ReportError((char *)Routine, 1);
   }
   if (PRECIP_MULTIPLIER > NA) {
@@ -362,10 +368,10 @@ void InitMultiplierMaps(OPTIONSTRUCT * Options, MAPSIZE *Map,
 
   /* Snow melt multiplier */
   
-  if (!((*MeltMultiplierMap) = (float **)calloc(Map->NY, sizeof(float *))))
+  if (!((*MeltMultiplierMap) = (float **)TrackCalloc(Map->NY, sizeof(float *), MEM_METMAPS)))
     ReportError((char *)Routine, 1);
   for (y = 0; y < Map->NY; y++) {
-    if (!((*MeltMultiplierMap)[y] = (float *)calloc(Map->NX, sizeof(float))))
+    if (!((*MeltMultiplierMap)[y] = (float *)TrackCalloc(Map->NX, sizeof(float), MEM_METMAPS)))
       ReportError((char *)Routine, 1);
   }
   if (SNOWMELT_MULTIPLIER > NA) {
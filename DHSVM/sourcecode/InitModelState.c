@@ -13,6 +13,7 @@
 #include "varid.h"
 #include "channel_grid.h"
 #include "Calendar.h"
+#include "snapshot.h"
 
  /*****************************************************************************
    Function name: InitModelState()
@@ -25,7 +26,9 @@
      of files.  This allows restarts of the model from any timestep for which
      the model state is known.  These model states can be stored using the
      routine StoreModelState().  Timesteps at which to dump the model state
-     can be specified in the file with dump information.
+     can be specified in the file with dump information.  If a snapshot
+     was opened with OpenModelSnapshot(), the maps are taken from it instead
+     (see Snapshot.c).
 
  *****************************************************************************/
 void InitModelState(DATE *Start, int StepsPerDay, int Dt,
@@ -45,6 +48,10 @@ void InitModelState(DATE *Start, int StepsPerDay, int Dt,
   int NSoil = 0;			 /* Number of soil layers for current pixel */
   int NVeg;				 /* Number of veg layers for current pixel */
   float remove;
+  float MaxChange, LastMaxChange;	/* Largest water table change during spinup (m) */
+  float Relax;				 /* Current spinup over-relaxation factor */
+  int Converged;
+  int NDays;				 /* Number of daily spinup iterations */
   void *Array;
   MAPDUMP DMap;			 /* Dump Info */
 
@@ -73,11 +80,10 @@ void InitModelState(DATE *Start, int StepsPerDay, int Dt,
     DMap.Resolution = MAP_OUTPUT;
     strcpy(DMap.FileName, "");
     GetVarAttr(&DMap);
-    Read2DMatrix(FileName, Array, DMap.NumberType, Map, NSet++, DMap.Name, 0);
+    ReadStateMap(FileName, Array, &DMap, Map, NSet++);
     for (y = 0; y < Map->NY; y++) {
       for (x = 0; x < Map->NX; x++) {
         if (INBASIN(TopoMap[y][x].Mask)) {
-          PrecipMap[y][x].IntRain[i] = 0.0;
           NVeg = Veg.NLayers[(VegMap[y][x].Veg - 1)];
           if (i < NVeg) {
             PrecipMap[y][x].IntRain[i] = ((float *)Array)[y * Map->NX + x];
@@ -99,11 +105,10 @@ void InitModelState(DATE *Start, int StepsPerDay, int Dt,
     DMap.Resolution = MAP_OUTPUT;
     strcpy(DMap.FileName, "");
     GetVarAttr(&DMap);
-    Read2DMatrix(FileName, Array, DMap.NumberType, Map, NSet++, DMap.Name, 0);
+    ReadStateMap(FileName, Array, &DMap, Map, NSet++);
     for (y = 0; y < Map->NY; y++) {
       for (x = 0; x < Map->NX; x++) {
         if (INBASIN(TopoMap[y][x].Mask)) {
-          PrecipMap[y][x].IntSnow[i] = 0.0;
           NVeg = Veg.NLayers[(VegMap[y][x].Veg - 1)];
           if (i < NVeg) {
             PrecipMap[y][x].IntSnow[i] = ((float *)Array)[y * Map->NX + x];
@@ -123,7 +128,7 @@ void InitModelState(DATE *Start, int StepsPerDay, int Dt,
   DMap.Resolution = MAP_OUTPUT;
   strcpy(DMap.FileName, "");
   GetVarAttr(&DMap);
-  Read2DMatrix(FileName, Array, DMap.NumberType, Map, NSet++, DMap.Name, 0);
+  ReadStateMap(FileName, Array, &DMap, Map, NSet++);
   for (y = 0; y < Map->NY; y++) {
     for (x = 0; x < Map->NX; x++) {
       if (INBASIN(TopoMap[y][x].Mask)) {
@@ -152,7 +157,7 @@ void InitModelState(DATE *Start, int StepsPerDay, int Dt,
   GetVarAttr(&DMap);
   if (!(Array = (float *)calloc(Map->NY * Map->NX, SizeOfNumberType(DMap.NumberType))))
     ReportError((char *)Routine, 1);
-  Read2DMatrix(FileName, Array, DMap.NumberType, Map, NSet++, DMap.Name, 0);
+  ReadStateMap(FileName, Array, &DMap, Map, NSet++);
   for (y = 0; y < Map->NY; y++) {
     for (x = 0; x < Map->NX; x++) {
       if (INBASIN(TopoMap[y][x].Mask)) {
@@ -165,7 +170,7 @@ void InitModelState(DATE *Start, int StepsPerDay, int Dt,
   DMap.Resolution = MAP_OUTPUT;
   strcpy(DMap.FileName, "");
   GetVarAttr(&DMap);
-  Read2DMatrix(FileName, Array, DMap.NumberType, Map, NSet++, DMap.Name, 0);
+  ReadStateMap(FileName, Array, &DMap, Map, NSet++);
   for (y = 0; y < Map->NY; y++) {
     for (x = 0; x < Map->NX; x++) {
       if (INBASIN(TopoMap[y][x].Mask)) {
@@ -178,7 +183,7 @@ void InitModelState(DATE *Start, int StepsPerDay, int Dt,
   DMap.Resolution = MAP_OUTPUT;
   strcpy(DMap.FileName, "");
   GetVarAttr(&DMap);
-  Read2DMatrix(FileName, Array, DMap.NumberType, Map, NSet++, DMap.Name, 0);
+  ReadStateMap(FileName, Array, &DMap, Map, NSet++);
   for (y = 0; y < Map->NY; y++) {
     for (x = 0; x < Map->NX; x++) {
       if (INBASIN(TopoMap[y][x].Mask)) {
@@ -191,7 +196,7 @@ void InitModelState(DATE *Start, int StepsPerDay, int Dt,
   DMap.Resolution = MAP_OUTPUT;
   strcpy(DMap.FileName, "");
   GetVarAttr(&DMap);
-  Read2DMatrix(FileName, Array, DMap.NumberType, Map, NSet++, DMap.Name, 0);
+  ReadStateMap(FileName, Array, &DMap, Map, NSet++);
   for (y = 0; y < Map->NY; y++) {
     for (x = 0; x < Map->NX; x++) {
       if (INBASIN(TopoMap[y][x].Mask)) {
@@ -204,7 +209,7 @@ void InitModelState(DATE *Start, int StepsPerDay, int Dt,
   DMap.Resolution = MAP_OUTPUT;
   strcpy(DMap.FileName, "");
   GetVarAttr(&DMap);
-  Read2DMatrix(FileName, Array, DMap.NumberType, Map, NSet++, DMap.Name, 0);
+  ReadStateMap(FileName, Array, &DMap, Map, NSet++);
   for (y = 0; y < Map->NY; y++) {
     for (x = 0; x < Map->NX; x++) {
       if (INBASIN(TopoMap[y][x].Mask)) {
@@ -217,7 +222,7 @@ void InitModelState(DATE *Start, int StepsPerDay, int Dt,
   DMap.Resolution = MAP_OUTPUT;
   strcpy(DMap.FileName, "");
   GetVarAttr(&DMap);
-  Read2DMatrix(FileName, Array, DMap.NumberType, Map, NSet++, DMap.Name, 0);
+  ReadStateMap(FileName, Array, &DMap, Map, NSet++);
   for (y = 0; y < Map->NY; y++) {
     for (x = 0; x < Map->NX; x++) {
       if (INBASIN(TopoMap[y][x].Mask)) {
@@ -230,7 +235,7 @@ void InitModelState(DATE *Start, int StepsPerDay, int Dt,
   DMap.Resolution = MAP_OUTPUT;
   strcpy(DMap.FileName, "");
   GetVarAttr(&DMap);
-  Read2DMatrix(FileName, Array, DMap.NumberType, Map, NSet++, DMap.Name, 0);
+  ReadStateMap(FileName, Array, &DMap, Map, NSet++);
 
   for (y = 0; y < Map->NY; y++) {
     for (x = 0; x < Map->NX; x++) {
@@ -248,7 +253,7 @@ void InitModelState(DATE *Start, int StepsPerDay, int Dt,
   DMap.Resolution = MAP_OUTPUT;
   strcpy(DMap.FileName, "");
   GetVarAttr(&DMap);
-  Read2DMatrix(FileName, Array, DMap.NumberType, Map, NSet++, DMap.Name, 0);
+  ReadStateMap(FileName, Array, &DMap, Map, NSet++);
   for (y = 0; y < Map->NY; y++) {
     for (x = 0; x < Map->NX; x++) {
       if (INBASIN(TopoMap[y][x].Mask)) {
@@ -308,7 +313,7 @@ void InitModelState(DATE *Start, int StepsPerDay, int Dt,
     DMap.Resolution = MAP_OUTPUT;
     strcpy(DMap.FileName, "");
     GetVarAttr(&DMap);
-    Read2DMatrix(FileName, Array, DMap.NumberType, Map, NSet++, DMap.Name, 0);
+    ReadStateMap(FileName, Array, &DMap, Map, NSet++);
     for (y = 0; y < Map->NY; y++) {
       for (x = 0; x < Map->NX; x++) {
         if (INBASIN(TopoMap[y][x].Mask)) {
@@ -342,7 +347,7 @@ void InitModelState(DATE *Start, int StepsPerDay, int Dt,
   DMap.Resolution = MAP_OUTPUT;
   strcpy(DMap.FileName, "");
   GetVarAttr(&DMap);
-  Read2DMatrix(FileName, Array, DMap.NumberType, Map, NSet++, DMap.Name, 0);
+  ReadStateMap(FileName, Array, &DMap, Map, NSet++);
   for (y = 0; y < Map->NY; y++) {
     for (x = 0; x < Map->NX; x++) {
       if (INBASIN(TopoMap[y][x].Mask)) {
@@ -357,7 +362,7 @@ void InitModelState(DATE *Start, int StepsPerDay, int Dt,
     DMap.Resolution = MAP_OUTPUT;
     strcpy(DMap.FileName, "");
     GetVarAttr(&DMap);
-    Read2DMatrix(FileName, Array, DMap.NumberType, Map, NSet++, DMap.Name, 0);
+    ReadStateMap(FileName, Array, &DMap, Map, NSet++);
     for (y = 0; y < Map->NY; y++) {
       for (x = 0; x < Map->NX; x++) {
         if (INBASIN(TopoMap[y][x].Mask)) {
@@ -372,7 +377,7 @@ void InitModelState(DATE *Start, int StepsPerDay, int Dt,
   DMap.Resolution = MAP_OUTPUT;
   strcpy(DMap.FileName, "");
   GetVarAttr(&DMap);
-  Read2DMatrix(FileName, Array, DMap.NumberType, Map, NSet++, DMap.Name, 0);
+  ReadStateMap(FileName, Array, &DMap, Map, NSet++);
   for (y = 0; y < Map->NY; y++) {
     for (x = 0; x < Map->NX; x++) {
       if (INBASIN(TopoMap[y][x].Mask)) {
@@ -385,7 +390,7 @@ void InitModelState(DATE *Start, int StepsPerDay, int Dt,
   DMap.Resolution = MAP_OUTPUT;
   strcpy(DMap.FileName, "");
   GetVarAttr(&DMap);
-  Read2DMatrix(FileName, Array, DMap.NumberType, Map, NSet++, DMap.Name, 0);
+  ReadStateMap(FileName, Array, &DMap, Map, NSet++);
   for (y = 0; y < Map->NY; y++) {
     for (x = 0; x < Map->NX; x++) {
       if (INBASIN(TopoMap[y][x].Mask)) {
@@ -463,15 +468,48 @@ void InitModelState(DATE *Start, int StepsPerDay, int Dt,
         ReportError((char *) Routine, 1);
     }
     
-    for (i = 0; i < Options->GW_SPINUP_YRS; i++) {
+    /* Iterate daily until the largest water table change drops below the
+       tolerance (if given) or the maximum number of years is reached.
+       If the over-relaxed iteration starts to oscillate (the max change
+       grows), the relaxation factor is pulled back toward 1. */
+    Relax = Options->GW_SPINUP_RELAX;
+    LastMaxChange = DHSVM_HUGE;
+    Converged = FALSE;
+    NDays = 0;
+    for (i = 0; i < Options->GW_SPINUP_YRS && !Converged; i++) {
       printf("Groundwater spinup: year %d\n",i+1);
       for (j = 0; j < DAYPYEAR; j++) {
-        RouteSubSurfaceSpinup(Dt * StepsPerDay, Map, TopoMap, VType, VegMap, Network, SType, SoilMap, Options,
-                              SubFlowGrad, SubDir, SubTotalDir);
+        MaxChange = RouteSubSurfaceSpinup(Dt * StepsPerDay, Map, TopoMap, VType, VegMap, Network, SType, SoilMap,
+                                          Options, SubFlowGrad, SubDir, SubTotalDir, Relax);
+        NDays++;
+        if (Relax > 1.0 && MaxChange > 1.1 * LastMaxChange) {
+          Relax = 1.0 + 0.5 * (Relax - 1.0);
+          if (Relax < 1.01)
+            Relax = 1.0;
+        }
+        LastMaxChange = MaxChange;
+        if (MaxChange < Options->GW_SPINUP_TOL) {
+          Converged = TRUE;
+          break;
+        }
       }
+      printf("  max water table change %.3e m/day (relaxation %.2f)\n", MaxChange, Relax);
     }
+    if (Converged)
+      printf("Groundwater spinup converged after %d days\n", NDays);
     printf("Groundwater spinup complete\n\n");
     
+    for(i=0; i<Map->NY; i++) { 
+      free(SubTotalDir[i]);
+      free(SubFlowGrad[i]);
+      for(j=0; j<Map->NX; j++)
+        free(SubDir[i][j]);
+      free(SubDir[i]);
+    }
+    free(SubDir);
+    free(SubTotalDir);
+    free(SubFlowGrad);
+    
     for (y = 0; y < Map->NY; y++) {
       for (x = 0; x < Map->NX; x++) {
         SoilMap[y][x].SatFlow = 0.0;
@@ -9,6 +9,7 @@
 #include "settings.h"
 #include "soilmoisture.h"
 #include "DHSVMChannel.h"
+#include "memtrack.h"
 
  /*****************************************************************************
    Function name: InitNetwork()
@@ -32,11 +33,11 @@ void InitNetwork(int NY, int NX, float DX, float DY, TOPOPIX **TopoMap,
   FILE *inputfile;
   /* Allocate memory for network structure */
 
-  if (!(*Network = (NETSTRUCT **)calloc(NY, sizeof(NETSTRUCT *))))
+  if (!(*Network = (NETSTRUCT **)TrackCalloc(NY, sizeof(NETSTRUCT *), MEM_NETWORK)))
     ReportError((char *)Routine, 1);
 
   for (y = 0; y < NY; y++) {
-    if (!((*Network)[y] = (NETSTRUCT *)calloc(NX, sizeof(NETSTRUCT))))
+    if (!((*Network)[y] = (NETSTRUCT *)TrackCalloc(NX, sizeof(NETSTRUCT), MEM_NETWORK)))
       ReportError((char *)Routine, 1);
   }
 
@@ -44,11 +45,11 @@ void InitNetwork(int NY, int NX, float DX, float DY, TOPOPIX **TopoMap,
     for (x = 0; x < NX; x++) {
       if (INBASIN(TopoMap[y][x].Mask)) {
         if (!((*Network)[y][x].Adjust =
-          (float *)calloc((VType[VegMap[y][x].Veg - 1].NSoilLayers + 1), sizeof(float))))
+          (float *)TrackCalloc((VType[VegMap[y][x].Veg - 1].NSoilLayers + 1), sizeof(float), MEM_NETWORK)))
           ReportError((char *)Routine, 1);
 
         if (!((*Network)[y][x].PercArea =
-          (float *)calloc((VType[VegMap[y][x].Veg - 1].NSoilLayers + 1), sizeof(float))))
+          (float *)TrackCalloc((VType[VegMap[y][x].Veg - 1].NSoilLayers + 1), sizeof(float), MEM_NETWORK)))
           ReportError((char *)Routine, 1);
       }
     }
@@ -14,6 +14,7 @@
 #include "slopeaspect.h"
 #include "sizeofnt.h"
 #include "varid.h"
+#include "ensemble.h"
 
  /*****************************************************************************
    InitNewMonth()
@@ -29,12 +30,11 @@ void InitNewMonth(TIMESTRUCT *Time, OPTIONSTRUCT *Options, MAPSIZE *Map,
   char FileName[BUFSIZE * 2 + 5];
   char VarName[BUFSIZE + 1];	/* Variable name */
   int i;
-  int j, jj;
+  int j;
   int y, x;
   float a, b, l;
   int NumberType;
   float *Array = NULL;
-  unsigned char *Array1 = NULL;
   
   if (DEBUG)
     printf("Initializing new month\n");
@@ -74,31 +74,11 @@ void InitNewMonth(TIMESTRUCT *Time, OPTIONSTRUCT *Options, MAPSIZE *Map,
     
   }
 
-  if (Options->Shading == TRUE) {
-    printf("reading in new shadow map for month %d \n", Time->Current.Month);
-    sprintf(FileName, "%s.%02d.%s", Options->ShadingDataPath,
-      Time->Current.Month, Options->ShadingDataExt);
-    GetVarName(304, 0, VarName);
-    GetVarNumberType(304, &NumberType);
-    if (!(Array1 = (unsigned char *)calloc(Map->NY * Map->NX, sizeof(unsigned char))))
-      ReportError((char *)Routine, 1);
-    for (i = 0; i < Time->NDaySteps; i++) {
-	  /* if computational time step is finer than hourly, make the shade factor equal within
-	  the hourly interval */
-	  if (Time->NDaySteps > 24) {
-		jj = round(i / (Time->NDaySteps / 24));
-		Read2DMatrix(FileName, Array1, NumberType, Map, jj, VarName, jj);
-	  }
-	  else   
-      Read2DMatrix(FileName, Array1, NumberType, Map, i, VarName, i);
-      for (y = 0; y < Map->NY; y++) {
-        for (x = 0; x < Map->NX; x++) {
-          ShadowMap[i][y][x] = Array1[y * Map->NX + x];
-        }
-      }
-    }
-    free(Array1);
-  }
+  /* In an ensemble run the shade maps are read once for all members, and
+     streamed maps are read at every time step (ShadeStreamStep()) */
+  if (Options->Shading == TRUE && !Options->StreamShading &&
+      !EnsembleShadeMap(Time->Current.Month, Time->NDaySteps, Map, ShadowMap))
+    ReadShadeMap(Options, Map, Time->Current.Month, Time->NDaySteps, ShadowMap);
 
   printf("changing LAI, albedo and diffuse transmission parameters\n");
 
@@ -159,6 +139,46 @@ void InitNewMonth(TIMESTRUCT *Time, OPTIONSTRUCT *Options, MAPSIZE *Map,
 }
 
 
+/*****************************************************************************
+  ReadShadeMap()
+  Reads the shade factors of every time step of the day for Month
+*****************************************************************************/
+void ReadShadeMap(OPTIONSTRUCT *Options, MAPSIZE *Map, int Month, int NDaySteps,
+  unsigned char ***ShadowMap)
+{
+  const char *Routine = "ReadShadeMap";
+  char FileName[BUFSIZE * 2 + 5];
+  char VarName[BUFSIZE + 1];	/* Variable name */
+  int i, jj;
+  int y, x;
+  int NumberType;
+  unsigned char *Array1 = NULL;
+
+  printf("reading in new shadow map for month %d \n", Month);
+  sprintf(FileName, "%s.%02d.%s", Options->ShadingDataPath,
+    Month, Options->ShadingDataExt);
+  GetVarName(304, 0, VarName);
+  GetVarNumberType(304, &NumberType);
+  if (!(Array1 = (unsigned char *)calloc(Map->NY * Map->NX, sizeof(unsigned char))))
+    ReportError((char *)Routine, 1);
+  for (i = 0; i < NDaySteps; i++) {
+    /* if computational time step is finer than hourly, make the shade factor equal within
+    the hourly interval */
+    if (NDaySteps > 24) {
+      jj = round(i / (NDaySteps / 24));
+      Read2DMatrix(FileName, Array1, NumberType, Map, jj, VarName, jj);
+    }
+    else   
+      Read2DMatrix(FileName, Array1, NumberType, Map, i, VarName, i);
+    for (y = 0; y < Map->NY; y++) {
+      for (x = 0; x < Map->NX; x++) {
+        ShadowMap[i][y][x] = Array1[y * Map->NX + x];
+      }
+    }
+  }
+  free(Array1);
+}
+
 /*****************************************************************************
   Function name: InitNewDay()
 
@@ -6,6 +6,7 @@
 #include "DHSVMerror.h"
 #include "functions.h"
 #include "constants.h"
+#include "memtrack.h"
 
 /*****************************************************************************
   Function name: InitSnowMap()
@@ -24,11 +25,11 @@ void InitSnowMap(MAPSIZE *Map, SNOWPIX ***SnowMap, TIMESTRUCT *Time)
   
   printf("Initializing snow map\n");
 
-  if (!(*SnowMap = (SNOWPIX **) calloc(Map->NY, sizeof(SNOWPIX *))))
+  if (!(*SnowMap = (SNOWPIX **) TrackCalloc(Map->NY, sizeof(SNOWPIX *), MEM_SNOW)))
     ReportError((char *) Routine, 1);
 
   for (y = 0; y < Map->NY; y++) {
-    if (!((*SnowMap)[y] = (SNOWPIX *) calloc(Map->NX, sizeof(SNOWPIX))))
+    if (!((*SnowMap)[y] = (SNOWPIX *) TrackCalloc(Map->NX, sizeof(SNOWPIX), MEM_SNOW)))
       ReportError((char *) Routine, 1);
   }
 }
@@ -12,6 +12,8 @@
 #include "sizeofnt.h"
 #include "slopeaspect.h"
 #include "varid.h"
+#include "memtrack.h"
+#include "bundle.h"
 
  /*****************************************************************************
    InitTerrainMaps()
@@ -23,7 +25,9 @@ void InitTerrainMaps(LISTPTR Input, OPTIONSTRUCT *Options, MAPSIZE *Map,
 {
   printf("\nInitializing terrain maps\n");
 
-  InitTopoMap(Input, Options, Map, TopoMap, LType);
+  /* Already loaded in an ensemble run */
+  if (*TopoMap == NULL)
+    InitTopoMap(Input, Options, Map, TopoMap, LType);
   InitVegMap(Options, Input, Map, VegMap, VType, DVeg);
   InitSoilMap(Input, Options, Map, Soil, *TopoMap, SoilMap, SType, VegMap, VType);
   if (Options->CanopyGapping)
@@ -54,10 +58,10 @@ void InitTopoMap(LISTPTR Input, OPTIONSTRUCT * Options, MAPSIZE * Map,
   };
 
   /* Process the [TERRAIN] section in the input file */
-  if (!(*TopoMap = (TOPOPIX **)calloc(Map->NY, sizeof(TOPOPIX *))))
+  if (!(*TopoMap = (TOPOPIX **)TrackCalloc(Map->NY, sizeof(TOPOPIX *), MEM_TERRAIN)))
     ReportError((char *)Routine, 1);
   for (y = 0; y < Map->NY; y++) {
-    if (!((*TopoMap)[y] = (TOPOPIX *)calloc(Map->NX, sizeof(TOPOPIX))))
+    if (!((*TopoMap)[y] = (TOPOPIX *)TrackCalloc(Map->NX, sizeof(TOPOPIX), MEM_TERRAIN)))
       ReportError((char *)Routine, 1);
   }
 
@@ -69,58 +73,86 @@ void InitTopoMap(LISTPTR Input, OPTIONSTRUCT * Options, MAPSIZE * Map,
       ReportError(StrEnv[i].KeyName, 51);
   }
 
-  /* Read the elevation data from the DEM dataset */
-  GetVarName(001, 0, VarName);
-  GetVarNumberType(001, &NumberType);
-  if (!(Elev = (float *)calloc(Map->NX * Map->NY,
-    SizeOfNumberType(NumberType))))
-    ReportError((char *)Routine, 1);
-
-  Read2DMatrix(StrEnv[demfile].VarStr, Elev, NumberType, Map, 0,
-    VarName, 0);
-
-  for (y = 0, i = 0; y < Map->NY; y++) {
-    for (x = 0; x < Map->NX; x++, i++) {
-      (*TopoMap)[y][x].Dem = Elev[i];
-    }
-  }
-  free(Elev);
+  /* The terrain may come precomputed from the basin bundle (see Bundle.c) */
+  if (!LoadBundleTerrain(Options, Map, *TopoMap, StrEnv[demfile].VarStr,
+                         StrEnv[maskfile].VarStr, StrEnv[lakefile].VarStr)) {
+    /* Read the elevation data from the DEM dataset */
+    GetVarName(001, 0, VarName);
+    GetVarNumberType(001, &NumberType);
+    if (!(Elev = (float *)calloc(Map->NX * Map->NY,
+      SizeOfNumberType(NumberType))))
+      ReportError((char *)Routine, 1);
 
-  /* Read the mask */
-  GetVarName(002, 0, VarName);
-  GetVarNumberType(002, &NumberType);
-  if (!(Mask = (unsigned char *)calloc(Map->NX * Map->NY,
-    SizeOfNumberType(NumberType))))
-    ReportError((char *)Routine, 1);
-  Read2DMatrix(StrEnv[maskfile].VarStr, Mask, NumberType, Map, 0,
-    VarName, 0);
+    Read2DMatrix(StrEnv[demfile].VarStr, Elev, NumberType, Map, 0,
+      VarName, 0);
 
-  for (y = 0, i = 0; y < Map->NY; y++) {
-    for (x = 0; x < Map->NX; x++, i++) {
-      (*TopoMap)[y][x].Mask = Mask[i];
+    for (y = 0, i = 0; y < Map->NY; y++) {
+      for (x = 0; x < Map->NX; x++, i++) {
+        (*TopoMap)[y][x].Dem = Elev[i];
+      }
     }
-  }
-  free(Mask);
+    free(Elev);
 
-  /* Read the lake map */
-  if (Options->LakeDynamics) {
-    printf("\nSetting up lakes\n");
-    GetVarName(017, 0, VarName);
-    GetVarNumberType(017, &NumberType);
-    if (!(Lakes = (unsigned char *)calloc(Map->NX * Map->NY,
+    /* Read the mask */
+    GetVarName(002, 0, VarName);
+    GetVarNumberType(002, &NumberType);
+    if (!(Mask = (unsigned char *)calloc(Map->NX * Map->NY,
       SizeOfNumberType(NumberType))))
       ReportError((char *)Routine, 1);
-    Read2DMatrix(StrEnv[lakefile].VarStr, Lakes, NumberType, 
-  	Map, 0, VarName, 0);
-  
+    Read2DMatrix(StrEnv[maskfile].VarStr, Mask, NumberType, Map, 0,
+      VarName, 0);
+
     for (y = 0, i = 0; y < Map->NY; y++) {
       for (x = 0; x < Map->NX; x++, i++) {
-        if (((int)Lakes[i]) > Map->NumLakes)
-          ReportError(StrEnv[lakefile].VarStr, 32);
-        (*TopoMap)[y][x].LakeID = Lakes[i];
+        (*TopoMap)[y][x].Mask = Mask[i];
       }
     }
-    
+    free(Mask);
+
+    /* Read the lake map */
+    if (Options->LakeDynamics) {
+      GetVarName(017, 0, VarName);
+      GetVarNumberType(017, &NumberType);
+      if (!(Lakes = (unsigned char *)calloc(Map->NX * Map->NY,
+        SizeOfNumberType(NumberType))))
+        ReportError((char *)Routine, 1);
+      Read2DMatrix(StrEnv[lakefile].VarStr, Lakes, NumberType, 
+    	Map, 0, VarName, 0);
+  
+      for (y = 0, i = 0; y < Map->NY; y++) {
+        for (x = 0; x < Map->NX; x++, i++) {
+          if (((int)Lakes[i]) > Map->NumLakes)
+            ReportError(StrEnv[lakefile].VarStr, 32);
+          (*TopoMap)[y][x].LakeID = Lakes[i];
+        }
+      }
+    } else {
+      for (y = 0; y < Map->NY; y++) {
+        for (x = 0; x < Map->NX; x++) {
+          (*TopoMap)[y][x].LakeID = 0;
+        }
+      }
+    }
+
+    /* Calculate slope, aspect, magnitude of subsurface flow gradient, and
+       fraction of flow flowing in each direction based on the land surface
+       slope. */
+    ElevationSlopeAspect(Map, *TopoMap, Options->MultiFlowDir);
+
+    /* After calculating the slopes and aspects for all the points, reset the
+       mask if the model is to be run in point mode */
+    if (Options->Extent == POINT) {
+      for (y = 0; y < Map->NY; y++)
+        for (x = 0; x < Map->NX; x++)
+          (*TopoMap)[y][x].Mask = OUTSIDEBASIN;
+      (*TopoMap)[Options->PointY][Options->PointX].Mask = (1 != OUTSIDEBASIN);
+    }
+    StoreBundleTerrain(Options, Map, *TopoMap);
+  }
+
+  if (Options->LakeDynamics) {
+    printf("\nSetting up lakes\n");
+
     /* Calculate the area of each lake */
     for (i = 0; i < Map->NumLakes; i++) {
       Area = 0.0;
@@ -142,27 +174,8 @@ void InitTopoMap(LISTPTR Input, OPTIONSTRUCT * Options, MAPSIZE * Map,
              LType[i].PowLawScale, LType[i].PowLawExponent);
     }
     printf("Total: %d lakes\n\n",Map->NumLakes);
-  } else {
-    for (y = 0; y < Map->NY; y++) {
-      for (x = 0; x < Map->NX; x++) {
-        (*TopoMap)[y][x].LakeID = 0;
-      }
-    }
   }
 
-  /* Calculate slope, aspect, magnitude of subsurface flow gradient, and
-     fraction of flow flowing in each direction based on the land surface
-     slope. */
-  ElevationSlopeAspect(Map, *TopoMap, Options->MultiFlowDir);
-
-  /* After calculating the slopes and aspects for all the points, reset the
-     mask if the model is to be run in point mode */
-  if (Options->Extent == POINT) {
-    for (y = 0; y < Map->NY; y++)
-      for (x = 0; x < Map->NX; x++)
-        (*TopoMap)[y][x].Mask = OUTSIDEBASIN;
-    (*TopoMap)[Options->PointY][Options->PointX].Mask = (1 != OUTSIDEBASIN);
-  }
   /* find out the minimum grid elevation of the basin */
   MINELEV = 9999;
   for (y = 0, i = 0; y < Map->NY; y++) {
@@ -211,10 +224,10 @@ void InitSoilMap(LISTPTR Input, OPTIONSTRUCT * Options, MAPSIZE * Map,
 
   /* Process the filenames in the [SOILS] section in the input file */
   /* Assign the attributes to the correct map pixel */
-  if (!(*SoilMap = (SOILPIX **)calloc(Map->NY, sizeof(SOILPIX *))))
+  if (!(*SoilMap = (SOILPIX **)TrackCalloc(Map->NY, sizeof(SOILPIX *), MEM_SOIL)))
     ReportError((char *)Routine, 1);
   for (y = 0; y < Map->NY; y++) {
-    if (!((*SoilMap)[y] = (SOILPIX *)calloc(Map->NX, sizeof(SOILPIX))))
+    if (!((*SoilMap)[y] = (SOILPIX *)TrackCalloc(Map->NX, sizeof(SOILPIX), MEM_SOIL)))
       ReportError((char *)Routine, 1);
   }
 
@@ -243,6 +256,9 @@ void InitSoilMap(LISTPTR Input, OPTIONSTRUCT * Options, MAPSIZE * Map,
     }
   }
   
+  /* Allocate memory for the layered soil properties and state */
+  InitSoilLayers(Options, Map, Soil, TopoMap, *SoilMap);
+  
   /******************************************************************/
   
   /* Read the total soil depth  */
@@ -370,15 +386,6 @@ void InitSoilMap(LISTPTR Input, OPTIONSTRUCT * Options, MAPSIZE * Map,
   
   /******************************************************************/
   
-  /* Allocate memory for vertical conductivity */
-  for (y = 0; y < Map->NY; y++) {
-    for (x = 0; x < Map->NX; x++) {
-      if (!((*SoilMap)[y][x].KsVert =
-          (float *)calloc(Soil->MaxLayers + 1, sizeof(float *))))
-        ReportError((char *)Routine, 1);
-    }
-  }
-  
   /* Creating spatial layered vertical conductivity */
   for (NSet = 0; NSet < Soil->MaxLayers; NSet++) {
     for (y = 0; y < Map->NY; y++) {
@@ -485,14 +492,6 @@ void InitSoilMap(LISTPTR Input, OPTIONSTRUCT * Options, MAPSIZE * Map,
   /* Read the spatial field capacity map */
   GetVarNumberType(015, &NumberType);
 
-  /*Allocate memory*/  
-  for (y = 0; y < Map->NY; y++) {
-    for (x = 0; x < Map->NX; x++) {
-      if (!((*SoilMap)[y][x].FCap =
-            (float *)calloc(Soil->MaxLayers + 1, sizeof(float *))))
-        ReportError((char *)Routine, 1);
-    }
-  }
 
   /*Creating spatial layered field capacity*/
   if (strncmp(StrEnv[fc_file].VarStr, "none", 4)) {
@@ -560,15 +559,6 @@ void InitSoilMap(LISTPTR Input, OPTIONSTRUCT * Options, MAPSIZE * Map,
   /* Read the spatial porosity map */
   GetVarNumberType(013, &NumberType);
 
-  /*Allocate memory for porosity*/
-  for (y = 0; y < Map->NY; y++) {
-    for (x = 0; x < Map->NX; x++) {
-      if (!((*SoilMap)[y][x].Porosity =
-            (float *)calloc(Soil->MaxLayers + 1, sizeof(float *))))
-        ReportError((char *)Routine, 1);
-    }
-  }
-
   /*Creating spatial layered porosity*/
   if (strncmp(StrEnv[porosity_file].VarStr, "none", 4)) {
     printf("Spatial soil porosity map provided, reading map\n");   
@@ -638,33 +628,126 @@ void InitSoilMap(LISTPTR Input, OPTIONSTRUCT * Options, MAPSIZE * Map,
       if (Options->Infiltration == DYNAMIC)
         (*SoilMap)[y][x].InfiltAcc = 0.;
       (*SoilMap)[y][x].MoistInit = 0.;
+    }
+  }
+  free(Type);
+  free(Depth);
+}
 
-      /* allocate memory for the number of root layers, plus an additional
-       layer below the deepest root layer */
-      if (INBASIN(TopoMap[y][x].Mask)) {
-        if (!((*SoilMap)[y][x].Moist =
-          (float *)calloc((Soil->NLayers[Type[i] - 1] + 1), sizeof(float))))
-          ReportError((char *)Routine, 1);
-        if (!((*SoilMap)[y][x].Perc =
-          (float *)calloc(Soil->NLayers[Type[i] - 1], sizeof(float))))
+/*****************************************************************************
+  InitSoilLayers()
+
+  Allocates the per-layer soil arrays of each pixel: KsVert, FCap and
+  Porosity (MaxLayers + 1 entries, all pixels) and Moist, InterFlow (number
+  of root layers plus the deep layer), Perc and Temp (number of root
+  layers) for pixels in the basin.
+
+  By default every array is allocated separately.  With CONTIGUOUS SOIL
+  LAYERS = TRUE each variable is instead stored in a single block of
+  MaxLayers + 1 floats per pixel, with the basin pixels first in the order
+  in which the routing sweeps visit them (descending elevation, i.e.
+  Map->OrderedCells from the end) followed by the pixels outside the basin.  The SOILPIX pointers point
+  into these blocks, so the rest of the model is unaffected, but the layer
+  values of consecutive pixels are adjacent in memory instead of scattered
+  over the heap.  The blocks are kept for the duration of the run.
+*****************************************************************************/
+void InitSoilLayers(OPTIONSTRUCT *Options, MAPSIZE *Map, LAYER *Soil,
+                    TOPOPIX **TopoMap, SOILPIX **SoilMap)
+{
+  const char *Routine = "InitSoilLayers";
+  int x, y, i;
+  int NLayers;
+  int Stride;
+  long Offset;
+  long NAll, NBasin;
+  float *KsVert, *FCap, *Porosity;
+  float *Moist, *Perc, *InterFlow, *Temp;
+
+  if (!Options->ContiguousSoil) {
+    for (y = 0; y < Map->NY; y++) {
+      for (x = 0; x < Map->NX; x++) {
+        if (!(SoilMap[y][x].KsVert = (float *)TrackCalloc(Soil->MaxLayers + 1, sizeof(float), MEM_SOIL)))
           ReportError((char *)Routine, 1);
-        if (!((*SoilMap)[y][x].InterFlow =
-            (float *)calloc((Soil->NLayers[Type[i] - 1] + 1), sizeof(float))))
+        if (!(SoilMap[y][x].FCap = (float *)TrackCalloc(Soil->MaxLayers + 1, sizeof(float), MEM_SOIL)))
           ReportError((char *)Routine, 1);
-        if (!((*SoilMap)[y][x].Temp =
-          (float *)calloc(Soil->NLayers[Type[i] - 1], sizeof(float))))
+        if (!(SoilMap[y][x].Porosity = (float *)TrackCalloc(Soil->MaxLayers + 1, sizeof(float), MEM_SOIL)))
           ReportError((char *)Routine, 1);
+
+        /* allocate memory for the number of root layers, plus an additional
+           layer below the deepest root layer */
+        if (INBASIN(TopoMap[y][x].Mask)) {
+          NLayers = Soil->NLayers[SoilMap[y][x].Soil - 1];
+          if (!(SoilMap[y][x].Moist = (float *)TrackCalloc(NLayers + 1, sizeof(float), MEM_SOIL)))
+            ReportError((char *)Routine, 1);
+          if (!(SoilMap[y][x].Perc = (float *)TrackCalloc(NLayers, sizeof(float), MEM_SOIL)))
+            ReportError((char *)Routine, 1);
+          if (!(SoilMap[y][x].InterFlow = (float *)TrackCalloc(NLayers + 1, sizeof(float), MEM_SOIL)))
+            ReportError((char *)Routine, 1);
+          if (!(SoilMap[y][x].Temp = (float *)TrackCalloc(NLayers, sizeof(float), MEM_SOIL)))
+            ReportError((char *)Routine, 1);
+        }
+        else {
+          SoilMap[y][x].Moist = NULL;
+          SoilMap[y][x].Perc = NULL;
+          SoilMap[y][x].InterFlow = NULL;
+          SoilMap[y][x].Temp = NULL;
+        }
       }
-      else {
-        (*SoilMap)[y][x].Moist = NULL;
-        (*SoilMap)[y][x].Perc = NULL;
-        (*SoilMap)[y][x].InterFlow = NULL;
-        (*SoilMap)[y][x].Temp = NULL;
+    }
+    return;
+  }
+
+  printf("Storing soil layer arrays contiguously\n");
+
+  Stride = Soil->MaxLayers + 1;
+  NAll = (long) Map->NX * Map->NY;
+  NBasin = Map->NumCells;
+
+  if (!(KsVert = (float *)TrackCalloc(NAll * Stride, sizeof(float), MEM_SOIL)))
+    ReportError((char *)Routine, 1);
+  if (!(FCap = (float *)TrackCalloc(NAll * Stride, sizeof(float), MEM_SOIL)))
+    ReportError((char *)Routine, 1);
+  if (!(Porosity = (float *)TrackCalloc(NAll * Stride, sizeof(float), MEM_SOIL)))
+    ReportError((char *)Routine, 1);
+  if (!(Moist = (float *)TrackCalloc(NBasin * Stride, sizeof(float), MEM_SOIL)))
+    ReportError((char *)Routine, 1);
+  if (!(Perc = (float *)TrackCalloc(NBasin * Stride, sizeof(float), MEM_SOIL)))
+    ReportError((char *)Routine, 1);
+  if (!(InterFlow = (float *)TrackCalloc(NBasin * Stride, sizeof(float), MEM_SOIL)))
+    ReportError((char *)Routine, 1);
+  if (!(Temp = (float *)TrackCalloc(NBasin * Stride, sizeof(float), MEM_SOIL)))
+    ReportError((char *)Routine, 1);
+
+  /* Basin pixels in routing order */
+  for (i = 0; i < Map->NumCells; i++) {
+    y = Map->OrderedCells[i].y;
+    x = Map->OrderedCells[i].x;
+    Offset = (long) (Map->NumCells - 1 - i) * Stride;
+    SoilMap[y][x].KsVert = KsVert + Offset;
+    SoilMap[y][x].FCap = FCap + Offset;
+    SoilMap[y][x].Porosity = Porosity + Offset;
+    SoilMap[y][x].Moist = Moist + Offset;
+    SoilMap[y][x].Perc = Perc + Offset;
+    SoilMap[y][x].InterFlow = InterFlow + Offset;
+    SoilMap[y][x].Temp = Temp + Offset;
+  }
+
+  /* Remaining pixels only carry the soil properties */
+  Offset = NBasin * Stride;
+  for (y = 0; y < Map->NY; y++) {
+    for (x = 0; x < Map->NX; x++) {
+      if (!INBASIN(TopoMap[y][x].Mask)) {
+        SoilMap[y][x].KsVert = KsVert + Offset;
+        SoilMap[y][x].FCap = FCap + Offset;
+        SoilMap[y][x].Porosity = Porosity + Offset;
+        SoilMap[y][x].Moist = NULL;
+        SoilMap[y][x].Perc = NULL;
+        SoilMap[y][x].InterFlow = NULL;
+        SoilMap[y][x].Temp = NULL;
+        Offset += Stride;
       }
     }
   }
-  free(Type);
-  free(Depth);
 }
 
 /*****************************************************************************
@@ -699,10 +782,10 @@ void InitVegMap(OPTIONSTRUCT * Options, LISTPTR Input, MAPSIZE * Map, VEGPIX ***
   };
 
   /* Assign the attributes to the correct map pixel */
-  if (!(*VegMap = (VEGPIX **)calloc(Map->NY, sizeof(VEGPIX *))))
+  if (!(*VegMap = (VEGPIX **)TrackCalloc(Map->NY, sizeof(VEGPIX *), MEM_VEG)))
     ReportError((char *)Routine, 1);
   for (y = 0; y < Map->NY; y++) {
-    if (!((*VegMap)[y] = (VEGPIX *)calloc(Map->NX, sizeof(VEGPIX))))
+    if (!((*VegMap)[y] = (VEGPIX *)TrackCalloc(Map->NX, sizeof(VEGPIX), MEM_VEG)))
       ReportError((char *)Routine, 1);
   }
 
@@ -766,7 +849,7 @@ void InitVegMap(OPTIONSTRUCT * Options, LISTPTR Input, MAPSIZE * Map, VEGPIX ***
     for (y = 0, i = 0; y < Map->NY; y++) {
       for (x = 0; x < Map->NX; x++, i++) {
         /*Allocate Memory*/
-        if (!((*VegMap)[y][x].Fract = (float *)calloc(VType[(*VegMap)[y][x].Veg - 1].NVegLayers, sizeof(float))))
+        if (!((*VegMap)[y][x].Fract = (float *)TrackCalloc(VType[(*VegMap)[y][x].Veg - 1].NVegLayers, sizeof(float), MEM_VEG)))
           ReportError((char *)Routine, 1);
         if (VType[(*VegMap)[y][x].Veg - 1].OverStory == TRUE) {
           if (FC[i] > 0.0)
@@ -791,7 +874,7 @@ void InitVegMap(OPTIONSTRUCT * Options, LISTPTR Input, MAPSIZE * Map, VEGPIX ***
     for (y = 0, i = 0; y < Map->NY; y++) {
       for (x = 0; x < Map->NX; x++, i++) {
           /*Allocate Memory*/
-          if (!((*VegMap)[y][x].Fract = (float *)calloc(VType[(*VegMap)[y][x].Veg - 1].NVegLayers, sizeof(float))))
+          if (!((*VegMap)[y][x].Fract = (float *)TrackCalloc(VType[(*VegMap)[y][x].Veg - 1].NVegLayers, sizeof(float), MEM_VEG)))
             ReportError((char *)Routine, 1);
 
           if ( VType[(*VegMap)[y][x].Veg - 1].OverStory == TRUE) {
@@ -842,10 +925,10 @@ void InitVegMap(OPTIONSTRUCT * Options, LISTPTR Input, MAPSIZE * Map, VEGPIX ***
       for (y = 0; y < Map->NY; y++) {
         for (x = 0; x < Map->NX; x++) {
 
-          if (!((*VegMap)[y][x].LAIMonthly = (float **)calloc(VType[(*VegMap)[y][x].Veg - 1].NVegLayers , sizeof(float *))))
+          if (!((*VegMap)[y][x].LAIMonthly = (float **)TrackCalloc(VType[(*VegMap)[y][x].Veg - 1].NVegLayers , sizeof(float *), MEM_VEG)))
             ReportError((char *)Routine, 1);
           for (j = 0; j < VType[(*VegMap)[y][x].Veg - 1].NVegLayers; j++) {
-              if (!((*VegMap)[y][x].LAIMonthly[j] = (float *)calloc(12, sizeof(float))))
+              if (!((*VegMap)[y][x].LAIMonthly[j] = (float *)TrackCalloc(12, sizeof(float), MEM_VEG)))
               ReportError((char *)Routine, 1);
               }
         }
@@ -886,10 +969,10 @@ void InitVegMap(OPTIONSTRUCT * Options, LISTPTR Input, MAPSIZE * Map, VEGPIX ***
       for (y = 0; y < Map->NY; y++) {
         for (x = 0; x < Map->NX; x++) {
 
-          if (!((*VegMap)[y][x].LAIMonthly = (float **)calloc(VType[(*VegMap)[y][x].Veg - 1].NVegLayers , sizeof(float *))))
+          if (!((*VegMap)[y][x].LAIMonthly = (float **)TrackCalloc(VType[(*VegMap)[y][x].Veg - 1].NVegLayers , sizeof(float *), MEM_VEG)))
             ReportError((char *)Routine, 1);
           for (j = 0; j < VType[(*VegMap)[y][x].Veg - 1].NVegLayers; j++) {
-              if (!((*VegMap)[y][x].LAIMonthly[j] = (float *)calloc(12, sizeof(float))))
+              if (!((*VegMap)[y][x].LAIMonthly[j] = (float *)TrackCalloc(12, sizeof(float), MEM_VEG)))
               ReportError((char *)Routine, 1);
               }
         }
@@ -930,9 +1013,9 @@ void InitVegMap(OPTIONSTRUCT * Options, LISTPTR Input, MAPSIZE * Map, VEGPIX ***
   for (y = 0; y < Map->NY; y++) {
 		for (x = 0; x < Map->NX; x++) {
       /*Allocate memory to LAI values*/
-      if (!((*VegMap)[y][x].LAI = (float *)calloc(VType[(*VegMap)[y][x].Veg - 1].NVegLayers, sizeof(float))))
+      if (!((*VegMap)[y][x].LAI = (float *)TrackCalloc(VType[(*VegMap)[y][x].Veg - 1].NVegLayers, sizeof(float), MEM_VEG)))
         ReportError((char *)Routine, 1);
-      if (!((*VegMap)[y][x].MaxInt = (float *)calloc(VType[(*VegMap)[y][x].Veg - 1].NVegLayers, sizeof(float))))
+      if (!((*VegMap)[y][x].MaxInt = (float *)TrackCalloc(VType[(*VegMap)[y][x].Veg - 1].NVegLayers, sizeof(float), MEM_VEG)))
         ReportError((char *)Routine, 1);
     }
   }
@@ -945,7 +1028,7 @@ void InitVegMap(OPTIONSTRUCT * Options, LISTPTR Input, MAPSIZE * Map, VEGPIX ***
   /*Allcate Memory*/
   for (y = 0, i = 0; y < Map->NY; y++) {
     for (x = 0; x < Map->NX; x++, i++) {
-      if (!((*VegMap)[y][x].Height = (float *)calloc(VType[(*VegMap)[y][x].Veg - 1].NVegLayers, sizeof(float))))
+      if (!((*VegMap)[y][x].Height = (float *)TrackCalloc(VType[(*VegMap)[y][x].Veg - 1].NVegLayers, sizeof(float), MEM_VEG)))
       ReportError((char *)Routine, 1);
     }
   }
@@ -1039,26 +1122,26 @@ void InitCanopyGapMap(OPTIONSTRUCT *Options, LISTPTR Input, MAPSIZE *Map,
       NVeg = Veg->MaxLayers;
       NSoil = Soil->MaxLayers;
       if (Options->CanopyGapping) {
-        if (!((*VegMap)[y][x].Type = (CanopyGapStruct *)calloc(2, sizeof(CanopyGapStruct))))
+        if (!((*VegMap)[y][x].Type = (CanopyGapStruct *)TrackCalloc(2, sizeof(CanopyGapStruct), MEM_CANOPYGAP)))
           ReportError((char *)Routine, 1);
         for (i = 0; i < CELL_PARTITION; i++) {
-          if (!((*VegMap)[y][x].Type[i].IntRain = (float *)calloc(NVeg, sizeof(float))))
+          if (!((*VegMap)[y][x].Type[i].IntRain = (float *)TrackCalloc(NVeg, sizeof(float), MEM_CANOPYGAP)))
             ReportError((char *)Routine, 1);
-          if (!((*VegMap)[y][x].Type[i].IntSnow = (float *)calloc(NVeg, sizeof(float))))
+          if (!((*VegMap)[y][x].Type[i].IntSnow = (float *)TrackCalloc(NVeg, sizeof(float), MEM_CANOPYGAP)))
             ReportError((char *)Routine, 1);
-          if (!((*VegMap)[y][x].Type[i].Moist = (float *)calloc(NSoil+1, sizeof(float))))
+          if (!((*VegMap)[y][x].Type[i].Moist = (float *)TrackCalloc(NSoil+1, sizeof(float), MEM_CANOPYGAP)))
             ReportError((char *)Routine, 1);
-          if (!((*VegMap)[y][x].Type[i].EPot = (float *)calloc(NVeg+1, sizeof(float))))
+          if (!((*VegMap)[y][x].Type[i].EPot = (float *)TrackCalloc(NVeg+1, sizeof(float), MEM_CANOPYGAP)))
             ReportError((char *)Routine, 1);
-          if (!((*VegMap)[y][x].Type[i].EAct = (float *)calloc(NVeg+1, sizeof(float))))
+          if (!((*VegMap)[y][x].Type[i].EAct = (float *)TrackCalloc(NVeg+1, sizeof(float), MEM_CANOPYGAP)))
             ReportError((char *)Routine, 1);
-          if (!((*VegMap)[y][x].Type[i].EInt = (float *)calloc(NVeg, sizeof(float))))
+          if (!((*VegMap)[y][x].Type[i].EInt = (float *)TrackCalloc(NVeg, sizeof(float), MEM_CANOPYGAP)))
             ReportError((char *)Routine, 1);
-          if (!((*VegMap)[y][x].Type[i].ESoil = (float **)calloc(NVeg, sizeof(float *))))
+          if (!((*VegMap)[y][x].Type[i].ESoil = (float **)TrackCalloc(NVeg, sizeof(float *), MEM_CANOPYGAP)))
             ReportError((char *)Routine, 1);
 
           for (j = 0; j < NVeg; j++) {
-            if (!((*VegMap)[y][x].Type[i].ESoil[j] = (float *)calloc(NSoil, sizeof(float))))
+            if (!((*VegMap)[y][x].Type[i].ESoil[j] = (float *)TrackCalloc(NSoil, sizeof(float), MEM_CANOPYGAP)))
               ReportError((char *)Routine, 1);
           }
         }
@@ -21,6 +21,14 @@
 #include "getinit.h"
 #include "DHSVMChannel.h"
 #include "channel.h"
+#include "profile.h"
+#include "counters.h"
+#include "memtrack.h"
+#include "ensemble.h"
+#include "snapshot.h"
+#include "shadestream.h"
+#include "diaglog.h"
+#include "mapaggregate.h"
 
 /******************************************************************************/
 /* GLOBAL VARIABLES */
@@ -44,11 +52,12 @@ int main(int argc, char **argv) {
   float **PptMultiplierMap = NULL;                                  
   float **MeltMultiplierMap = NULL;                                  
   int MaxStreamID;
-  clock_t start, finish1;
+  double start, finish1;
   double runtime = 0.0;
   int t = 0;
   int i, x, y, xdown, ydown;
   int NStats;
+  int Snapshot = FALSE;		/* TRUE if the state is restored from a snapshot */
   uchar ***MetWeights = NULL;
   
   AGGREGATED Total = {			/* Total or average value of a  variable over the entire basin */
@@ -118,12 +127,24 @@ int main(int argc, char **argv) {
 #endif
   printf("\nSTARTING INITIALIZATION PROCEDURES\n\n");
   
-  start = clock();
+  start = WallClock();
   
   ReadInitFile(InFiles.Const, &Input);
   InitConstants(Input, &Options, &Map, &SolarGeo, &Time);
-  InitFileIO();
+  InitFileIO(&Options);
   InitTables(Time.NDaySteps, Input, &Options, &Map, &SType, &Soil, &VType, &Veg, &LType, &Time);
+  MemoryForecast(Input, &Options, &Map, &Soil, &Veg, Time.NDaySteps);
+  if (Options.Ensemble) {
+    /* Static inputs shared by the ensemble members, which are forked here */
+    InitTopoMap(Input, &Options, &Map, &TopoMap, LType);
+    InitMetSources(Input, &Options, &Map, TopoMap, Soil.MaxLayers, &Time,
+		   &InFiles, &NStats, &Stat);
+    InitInterpolationWeights(&Map, &Options, TopoMap, &MetWeights, Stat, NStats);
+    if (Options.Shading == TRUE)
+      InitShadeMap(&Options, Time.NDaySteps, &Map, &ShadowMap, &SkyViewMap);
+    RunEnsemble(Input, &Options, &Map, &Time, &Veg, VType, Soil.MaxLayers,
+		NStats, Stat);
+  }
   InitTerrainMaps(Input, &Options, &Map, &Soil, &Veg, &TopoMap, SType, &SoilMap, VType, &VegMap, &DVeg, LType);
   InitSnowMap(&Map, &SnowMap, &Time);
   InitMappedConstants(Input, &Options, &Map, &SnowMap, VType, &VegMap);
@@ -133,22 +154,36 @@ int main(int argc, char **argv) {
                 LType, TopoMap, &MaxStreamID, &Options);
   InitNetwork(Map.NY, Map.NX, Map.DX, Map.DY, TopoMap, SoilMap, 
 	      VegMap, VType, &Network, &ChannelData, Veg, &Options);
-  InitMetSources(Input, &Options, &Map, TopoMap, Soil.MaxLayers, &Time,
-		 &InFiles, &NStats, &Stat);
+  if (Stat == NULL)
+    InitMetSources(Input, &Options, &Map, TopoMap, Soil.MaxLayers, &Time,
+		   &InFiles, &NStats, &Stat);
   InitMetMaps(Input, Time.NDaySteps, &Map, &Options,
 	      &PrismMap, &SnowPatternMap, &SnowPatternMapBase,
 	      &ShadowMap, &SkyViewMap, &EvapMap, &PrecipMap, &PptMultiplierMap,
 	      &MeltMultiplierMap, &RadiationMap, SoilMap, &Soil, VegMap, &Veg, TopoMap);
-  InitInterpolationWeights(&Map, &Options, TopoMap, &MetWeights, Stat, NStats);
+  if (MetWeights == NULL)
+    InitInterpolationWeights(&Map, &Options, TopoMap, &MetWeights, Stat, NStats);
   InitDump(Input, &Options, &Map, Soil.MaxLayers, Veg.MaxLayers, Time.Dt,
 	   TopoMap, &Dump);
-  /* Done with initialization, delete the list with input strings */
-  DeleteList(Input);
+  InitProfile(&Options, Dump.Path, start);
+  InitDiagLogs(Dump.Path);
+  InitCounters(&Options, &Map, TopoMap, &ChannelData, Dump.Path);
+  MemoryReport(stdout, "after initialization");
+  /* Done with initialization, delete the list with input strings.  The
+     forecast scenarios still need it to set up their output */
+  if (!Options.Forecast)
+    DeleteList(Input);
+  
+  if (Options.Snapshot && Options.Extent != POINT)
+    Snapshot = OpenModelSnapshot(Dump.InitStatePath, &(Time.Start), &Map, TopoMap);
   
 #ifndef SNOW_ONLY
   if (Options.Extent != POINT) {
     InitChannelDump(&Options, &ChannelData, Dump.Path);
-    ReadChannelState(Dump.InitStatePath, &(Time.Start), ChannelData.streams);
+    if (Snapshot)
+      ReadSnapshotChannel(ChannelData.streams);
+    else
+      ReadChannelState(Dump.InitStatePath, &(Time.Start), ChannelData.streams);
   }
 #endif
   
@@ -156,6 +191,11 @@ int main(int argc, char **argv) {
   InitModelState(&(Time.Start), Time.NDaySteps, Time.Dt, &Map, &Options, PrecipMap, SnowMap, SoilMap,
 		 Soil, SType, VegMap, Veg, VType, Dump.InitStatePath,
 		 TopoMap, Network, &ChannelData);
+  if (Snapshot) {
+    ReadSnapshotLakes(LType, Map.NumLakes);
+    ReadSnapshotMass(&Mass);
+    CloseModelSnapshot();
+  }
   InitNewMonth(&Time, &Options, &Map, TopoMap, PrismMap, SnowPatternMap, SnowPatternMapBase, ShadowMap,
 	       &InFiles, Veg.NTypes, VType, NStats, Stat, Dump.InitStatePath, &VegMap, SnowMap);
   InitNewDay(Time.Current.JDay, &SolarGeo);
@@ -163,9 +203,14 @@ int main(int argc, char **argv) {
   /* Setup for mass balance calculations */
   Aggregate(&Map, &Options, TopoMap, &Soil, &Veg, VegMap, EvapMap, PrecipMap,
 	      RadiationMap, SnowMap, SoilMap, &Total, VType, Network, &ChannelData, Time.Dt, Time.NDaySteps);
-  Mass.StartWaterStorage = Total.Soil.IExcess + Total.CanopyWater +
-                           Total.SoilWater + Total.Snow.Swq + Total.Soil.SatFlow;
-  Mass.OldWaterStorage = Mass.StartWaterStorage;
+  /* A snapshot continues the mass balance of the run that stored it */
+  if (!Snapshot) {
+    Mass.StartWaterStorage = Total.Soil.IExcess + Total.CanopyWater +
+                             Total.SoilWater + Total.Snow.Swq + Total.Soil.SatFlow;
+    Mass.OldWaterStorage = Mass.StartWaterStorage;
+  }
+  
+  ProfileStop(PROF_INIT);
   
 /******************************************************************************/
 /* CALCULATIONS */
@@ -174,6 +219,32 @@ int main(int argc, char **argv) {
   while (Before(&(Time.Current), &(Time.End)) ||
   IsEqualTime(&(Time.Current), &(Time.End))) {
     
+    if (Options.Forecast && IsEqualTime(&(Time.Current), &(Options.ForecastStart))) {
+      /* Returns in each forecast scenario, which continues as if the model
+         was restarted here, with its own output (see Ensemble.c) */
+      RunForecast(Input, &Options, NStats, Stat);
+      for (i = 0; i < Dump.NMaps; i++)
+        FreeMapAggregate(&(Dump.DMap[i]));
+      InitDump(Input, &Options, &Map, Soil.MaxLayers, Veg.MaxLayers, Time.Dt,
+               TopoMap, &Dump);
+#ifndef SNOW_ONLY
+      if (Options.Extent != POINT)
+        InitChannelDump(&Options, &ChannelData, Dump.Path);
+#endif
+      InitProfile(&Options, Dump.Path, WallClock());
+      InitDiagLogs(Dump.Path);
+      ProfileStop(PROF_INIT);
+      InitCounters(&Options, &Map, TopoMap, &ChannelData, Dump.Path);
+      DeleteList(Input);
+      InitTime(&Time, &(Options.ForecastStart), &(Time.End), Time.Dt);
+      Mass.StartWaterStorage = Mass.OldWaterStorage;
+      Mass.CumPrecipIn = Mass.CumET = Mass.CumIExcess = Mass.CumChannelInt = 0.0;
+      Mass.CumChannelInfiltration = Mass.CumChannelEvap = 0.0;
+      Mass.CumSnowVaporFlux = Mass.CumDeepGW = 0.0;
+    }
+    
+    ProfileStart(PROF_OTHER);
+    
     ResetAggregate(&Soil, &Veg, &Total, &Options);
     
     if (Options.SnowSlide)
@@ -184,6 +255,7 @@ int main(int argc, char **argv) {
         UpdateVegMap(&(Time.Current), &Options, &Map, &Veg, &VegMap, VType, &DVeg);
     }
     
+    ProfileStart(PROF_NEWPERIOD);
     if (IsNewWaterYear(&(Time.Current)))
       InitNewWaterYear(&Time, &Options, &Map, TopoMap, SnowMap, PrecipMap);
     if (IsNewMonth(&(Time.Current), Time.Dt))
@@ -194,8 +266,14 @@ int main(int argc, char **argv) {
       PrintDate(&(Time.Current), stdout);
       printf("\n");
     }
+    ProfileStop(PROF_NEWPERIOD);
+    
+    ProfileStart(PROF_NEWSTEP);
     InitNewStep(&InFiles, &Map, &Time, Soil.MaxLayers, &Options, NStats, Stat,
                 &SolarGeo, TopoMap, SoilMap);
+    if (Options.Shading == TRUE && Options.StreamShading)
+      ShadeStreamStep(&Options, &Map, &Time, ShadowMap);
+    ProfileStop(PROF_NEWSTEP);
     if (Options.Extent != POINT) {
       channel_step_initialize_network(ChannelData.streams);
     }
@@ -209,6 +287,9 @@ int main(int argc, char **argv) {
       }
     }
     
+    /* The cells are timed as one sweep, not one by one, to keep the clock
+       reads out of the loop */
+    ProfileStart(PROF_PIXELS);
     for (y = 0; y < Map.NY; y++) {
       for (x = 0; x < Map.NX; x++) {
   	    if (INBASIN(TopoMap[y][x].Mask)) {
@@ -250,41 +331,60 @@ int main(int argc, char **argv) {
 		    }
 	    }
     }
+    ProfileStop(PROF_PIXELS);
     
 #ifndef SNOW_ONLY
     
+    ProfileStart(PROF_SUBSURFACE);
     RouteSubSurface(Time.Dt, &Map, TopoMap, VType, VegMap, Network, 
-		    SType, SoilMap, &ChannelData, &Time, &Options, Dump.Path);
+		    SType, SoilMap, &ChannelData, &Time, &Options);
+    ProfileStop(PROF_SUBSURFACE);
     
+    ProfileStart(PROF_CHANNEL);
     if (Options.Extent != POINT)
       RouteChannel(&ChannelData, &Time, &Map, TopoMap, SoilMap, &Total, 
 		   &Options, Network, SType, VType, VegMap, EvapMap, LType);
+    ProfileStop(PROF_CHANNEL);
     
+    ProfileStart(PROF_SURFACE);
     if (Options.Extent == BASIN)
       RouteSurface(&Map, &Time, TopoMap, SoilMap, &Options,
         &Dump, VegMap, VType, LType, SType, &ChannelData, LocalMet.Tair, LocalMet.Rh);
+    ProfileStop(PROF_SURFACE);
     
 #endif
     
+    ProfileStart(PROF_AGGREGATE);
     Aggregate(&Map, &Options, TopoMap, &Soil, &Veg, VegMap, EvapMap, PrecipMap,
 	      RadiationMap, SnowMap, SoilMap, &Total, VType, Network, &ChannelData, Time.Dt, Time.NDaySteps);
+    ProfileStop(PROF_AGGREGATE);
     
     if (Options.SnowStats)
       SnowStats(&(Time.Current), &Map, &Options, TopoMap, SnowMap, Time.Dt);
     
+    ProfileStart(PROF_MASSBALANCE);
     MassBalance(&(Time.Current), &(Time.Start), &(Dump.Balance), &Total, &Mass);
+    ProfileStop(PROF_MASSBALANCE);
     
-    ExecDump(&Map, &(Time.Current), &(Time.Start), &Options, &Dump, TopoMap,
+    ProfileStart(PROF_OUTPUT);
+    ExecDump(&Map, &Time, &Options, &Dump, TopoMap,
              EvapMap, RadiationMap, PrecipMap, SnowMap, VegMap, &Veg,
-             SoilMap, Network, &ChannelData, &Soil, &Total);
+             SoilMap, Network, &ChannelData, &Soil, &Total, LType, &Mass);
+    ProfileStop(PROF_OUTPUT);
+    
+    ProfileStop(PROF_OTHER);
+    ProfileEndStep(&(Time.Current));
+    CountersEndStep(&(Time.Current));
     
     IncreaseTime(&Time);
 	  t += 1;
   } /* End of calculation loop over time steps */
   
-  ExecDump(&Map, &(Time.Current), &(Time.Start), &Options, &Dump, TopoMap,
+  ProfileStart(PROF_OUTPUT);
+  ExecDump(&Map, &Time, &Options, &Dump, TopoMap,
 	   EvapMap, RadiationMap, PrecipMap, SnowMap, VegMap, &Veg, SoilMap,
-	   Network, &ChannelData, &Soil, &Total);
+	   Network, &ChannelData, &Soil, &Total, LType, &Mass);
+  ProfileStop(PROF_OUTPUT);
   
 #ifndef SNOW_ONLY
   FinalMassBalance(&(Dump.FinalBalance), &Total, &Mass, &Options);
@@ -292,13 +392,17 @@ int main(int argc, char **argv) {
   
   printf("\nEND OF MODEL RUN\n\n");
   
-  /* Record the total simulation run time */
-  finish1 = clock();
-  runtime = (finish1-start)/CLOCKS_PER_SEC;
+  /* Record the total simulation run time (wall clock) */
+  finish1 = WallClock();
+  runtime = finish1 - start;
   printf("***********************************************************************************");
   printf("\nRuntime Summary:\n");
   printf("%6.2f hours elapsed for the simulation period of %d hours (%.1f days) \n", 
 	  runtime/3600, t*Time.Dt/3600, (float)t*Time.Dt/3600/24);
   
+  ProfileReport(stdout);
+  CountersReport(stdout);
+  MemoryReport(stdout, "at the end of the run");
+  
   return EXIT_SUCCESS;
 }
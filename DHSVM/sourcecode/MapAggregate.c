@@ -0,0 +1,195 @@
+/*
+ * SUMMARY:      MapAggregate.c - Map output aggregated over time
+ * USAGE:        Part of DHSVM
+ *
+ * DESCRIPTION:  With [OUTPUT] MAP AGGREGATION i = MEAN, MIN, MAX or SUM the
+ *               map of variable i is not written at the dates in MAP DATE
+ *               j i, but is added to an in-memory statistic every time
+ *               step.  The statistic is written at the end of each window
+ *               (MAP WINDOW i = DAILY, MONTHLY or WATERYEAR, water years
+ *               starting on October 1) and at the end of the run, so the
+ *               first and last window may cover part of a day, month or
+ *               water year.  A pixel that is NA at any time step in the
+ *               window is NA in the statistic.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "settings.h"
+#include "data.h"
+#include "DHSVMerror.h"
+#include "fileio.h"
+#include "sizeofnt.h"
+#include "mapaggregate.h"
+
+static const char *StatName[] = { "", "Mean", "Min", "Max", "Sum" };
+static const char *WindowName[] = { "Daily", "Monthly", "WaterYear" };
+
+/*****************************************************************************
+  InitMapAggregate()
+
+  Allocates the statistic of an aggregated map and changes its file name
+  from Map.<Name>.bin to Map.<Name>.<Statistic>.<Window>.bin
+*****************************************************************************/
+void InitMapAggregate(MAPSIZE *Map, MAPDUMP *DMap)
+{
+  char Suffix[BUFSIZE + 1];
+  size_t Length;
+
+  if (!(DMap->Accum = (double *) calloc(Map->NX * Map->NY, sizeof(double))))
+    ReportError("InitMapAggregate", 1);
+  DMap->NSteps = 0;
+  DMap->NWindows = 0;
+
+  sprintf(Suffix, ".%s.%s%s", StatName[DMap->Aggregation],
+	  WindowName[DMap->Window], fileext);
+  Length = strlen(DMap->FileName) - strlen(fileext);
+  if (Length + strlen(Suffix) > BUFSIZE)
+    ReportError(DMap->FileName, 51);
+  strcpy(DMap->FileName + Length, Suffix);
+}
+
+/*****************************************************************************
+  FreeMapAggregate()
+
+  Frees the statistic of an aggregated map, before InitDump() sets up the
+  maps again for a forecast scenario
+*****************************************************************************/
+void FreeMapAggregate(MAPDUMP *DMap)
+{
+  if (DMap->Aggregation == MAP_SNAPSHOT)
+    return;
+  free(DMap->Accum);
+  DMap->Accum = NULL;
+}
+
+/*****************************************************************************
+  StoreMap()
+
+  Writes the map of the current time step, or adds it to the statistic of
+  an aggregated map.  Takes the same arguments as Write2DMatrix().
+*****************************************************************************/
+int StoreMap(char *FileName, void *Matrix, int NumberType, MAPSIZE *Map,
+	     MAPDUMP *DMap, int Index)
+{
+  double Value;
+  double *Accum;
+  int NPoints;
+  int i;
+
+  if (DMap->Aggregation == MAP_SNAPSHOT)
+    return Write2DMatrix(FileName, Matrix, NumberType, Map, DMap, Index);
+
+  Accum = DMap->Accum;
+  NPoints = Map->NX * Map->NY;
+  for (i = 0; i < NPoints; i++) {
+    switch (NumberType) {
+    case NC_BYTE:
+    case NC_CHAR:
+      Value = ((unsigned char *) Matrix)[i];
+      break;
+    case NC_SHORT:
+      Value = ((short *) Matrix)[i];
+      break;
+    case NC_INT:
+      Value = ((int *) Matrix)[i];
+      break;
+    case NC_FLOAT:
+      Value = ((float *) Matrix)[i];
+      break;
+    case NC_DOUBLE:
+      Value = ((double *) Matrix)[i];
+      break;
+    default:
+      Value = NA;
+      ReportError("StoreMap", 40);
+      break;
+    }
+
+    if (DMap->NSteps == 0 || Value == NA)
+      Accum[i] = Value;
+    else if (Accum[i] != NA) {
+      switch (DMap->Aggregation) {
+      case MAP_MIN:
+	if (Value < Accum[i])
+	  Accum[i] = Value;
+	break;
+      case MAP_MAX:
+	if (Value > Accum[i])
+	  Accum[i] = Value;
+	break;
+      default:
+	Accum[i] += Value;
+	break;
+      }
+    }
+  }
+  DMap->NSteps++;
+
+  return NPoints;
+}
+
+/*****************************************************************************
+  IsMapWindowEnd()
+
+  Returns TRUE if the current time step is the last one of its window, or
+  of the run
+*****************************************************************************/
+uchar IsMapWindowEnd(TIMESTRUCT *Time, int Window)
+{
+  TIMESTRUCT Next;
+  DATE *Now = &(Time->Current);
+
+  if (!Before(Now, &(Time->End)))
+    return TRUE;
+
+  Next = *Time;
+  IncreaseTime(&Next);
+
+  switch (Window) {
+  case MAP_DAILY:
+    return (Next.Current.Day != Now->Day || Next.Current.Month != Now->Month ||
+	    Next.Current.Year != Now->Year);
+  case MAP_MONTHLY:
+    return (Next.Current.Month != Now->Month ||
+	    Next.Current.Year != Now->Year);
+  case MAP_WATERYEAR:
+    return (Next.Current.Year + (Next.Current.Month >= 10) !=
+	    Now->Year + (Now->Month >= 10));
+  default:
+    ReportError("IsMapWindowEnd", 65);
+    return TRUE;
+  }
+}
+
+/*****************************************************************************
+  WriteMapAggregate()
+
+  Writes the statistic of the current window and starts the next window
+*****************************************************************************/
+void WriteMapAggregate(MAPSIZE *Map, MAPDUMP *DMap)
+{
+  float *Array;
+  int NPoints;
+  int i;
+
+  if (DMap->NSteps == 0)
+    return;
+
+  NPoints = Map->NX * Map->NY;
+  if (!(Array = (float *) calloc(NPoints, sizeof(float))))
+    ReportError("WriteMapAggregate", 1);
+  for (i = 0; i < NPoints; i++) {
+    if (DMap->Aggregation == MAP_MEAN && DMap->Accum[i] != NA)
+      Array[i] = DMap->Accum[i] / DMap->NSteps;
+    else
+      Array[i] = DMap->Accum[i];
+  }
+
+  Write2DMatrix(DMap->FileName, Array, NC_FLOAT, Map, DMap, DMap->NWindows);
+  free(Array);
+
+  DMap->NWindows++;
+  DMap->NSteps = 0;
+}
@@ -0,0 +1,73 @@
+/*
+ * SUMMARY:      MapToBin.c - Convert a compressed map file to binary
+ * USAGE:        make -f makefile_for_binary.txt map_to_bin
+ *               ./DHSVM_MapToBin <compressed file> <binary file> [matrix]
+ *
+ * DESCRIPTION:  Writes the matrices of a map or state file written with
+ *               [OPTIONS] MAP FILE FORMAT = COMPRESSED (see FileIOZip.c) to
+ *               a file in the plain binary format, the one the model writes
+ *               with MAP FILE FORMAT = BINARY.  With a matrix number (the
+ *               first matrix is 0) only that matrix is written.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "settings.h"
+#include "DHSVMerror.h"
+#include "fileio.h"
+#include "fifozip.h"
+#include "sizeofnt.h"
+
+int main(int argc, char **argv)
+{
+  const char *Routine = "MapToBin";
+  FILE *InFile;
+  FILE *OutFile;
+  MAPZHEADER Header;
+  void *Matrix;
+  size_t NPoints;
+  int NumberType;
+  int First;
+  int Last;
+  int i;
+
+  if (argc < 3 || argc > 4) {
+    fprintf(stderr, "usage: %s <compressed file> <binary file> [matrix]\n",
+	    argv[0]);
+    exit(EXIT_FAILURE);
+  }
+
+  OpenFile(&InFile, argv[1], "rb", FALSE);
+  if (!IsMapFileZip(InFile))
+    ReportError(argv[1], 51);
+  ReadMapHeaderZip(InFile, argv[1], &Header);
+
+  First = 0;
+  Last = Header.NSlices;
+  if (argc == 4) {
+    First = atoi(argv[3]);
+    Last = First + 1;
+    if (First < 0 || First >= Header.NSlices)
+      ReportError(argv[3], 51);
+  }
+
+  NPoints = (size_t) Header.NY * Header.NX;
+  if (!(Matrix = malloc(NPoints * sizeof(double))))
+    ReportError((char *) Routine, 1);
+
+  OpenFile(&OutFile, argv[2], "wb", TRUE);
+  for (i = First; i < Last; i++) {
+    NumberType = ReadMapSliceZip(InFile, argv[1], &Header, i, 0, Matrix);
+    if (fwrite(Matrix, SizeOfNumberType(NumberType), NPoints, OutFile) !=
+	NPoints)
+      ReportError(argv[2], 41);
+  }
+
+  fclose(OutFile);
+  fclose(InFile);
+  printf("%d x %d, %d of %d matrices\n", Header.NY, Header.NX, Last - First,
+	 Header.NSlices);
+
+  return EXIT_SUCCESS;
+}
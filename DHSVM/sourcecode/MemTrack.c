@@ -0,0 +1,260 @@
+/*
+ * SUMMARY:      MemTrack.c - Memory accounting per model subsystem
+ * USAGE:        Part of DHSVM
+ *
+ * DESCRIPTION:  The long-lived allocations of the model (the pixel maps and
+ *               their per-pixel arrays, shading maps, interpolation weights,
+ *               flow directions and channel records) are made through
+ *               TrackCalloc() and TrackMalloc(), which attribute the bytes
+ *               to a subsystem (see enum MEMSUBSYSTEM in memtrack.h).  These
+ *               allocations persist for the whole run and are freed with
+ *               free() as usual.  Besides the bytes requested, the heap
+ *               footprint is estimated, since for the many small per-pixel
+ *               arrays the allocator overhead can exceed the data.
+ *
+ *               MemoryForecast() estimates, from the grid size, the number
+ *               of layers and the options, the memory each subsystem will
+ *               need before any of the maps are allocated.  It assumes that
+ *               every pixel is in the basin and has the maximum number of
+ *               layers, so it is an upper bound; the channel records are not
+ *               included.  If the forecast exceeds MEMORY LIMIT the run is
+ *               stopped.  With MEMORY REPORT = TRUE the forecast is printed,
+ *               and MemoryReport() prints the tracked memory per subsystem
+ *               after initialization and at the end of the run, together
+ *               with the peak resident set size of the process.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/resource.h>
+#include "settings.h"
+#include "data.h"
+#include "DHSVMerror.h"
+#include "constants.h"
+#include "functions.h"
+#include "getinit.h"
+#include "counters.h"
+#include "memtrack.h"
+
+#define MB (1024.0 * 1024.0)
+
+static const char *SubsystemName[MEM_NSUBSYSTEMS] = {
+  "Terrain", "Soil", "Vegetation", "CanopyGap", "Snow", "Evaporation",
+  "Precipitation", "Radiation", "Shading", "MetMaps", "MetWeights",
+  "Network", "Routing", "Channel", "Diagnostics"
+};
+
+static int ReportMemory = FALSE;
+static unsigned long NAllocations[MEM_NSUBSYSTEMS];
+static double Requested[MEM_NSUBSYSTEMS];  /* Bytes requested */
+static double Footprint[MEM_NSUBSYSTEMS];  /* Estimated heap use */
+static double Forecast[MEM_NSUBSYSTEMS];   /* Estimated heap use before allocation */
+
+/*****************************************************************************
+  Chunk()
+
+  Estimated heap use of one allocation of Size bytes: glibc adds an 8 byte
+  header, rounds up to 16 bytes and uses at least 32 bytes per allocation
+*****************************************************************************/
+static double Chunk(double Size)
+{
+  double Bytes;
+
+  Bytes = 16.0 * (double) (long) ((Size + 8.0 + 15.0) / 16.0);
+  return (Bytes < 32.0) ? 32.0 : Bytes;
+}
+
+/* Heap use of a map allocated as NY rows of NX elements of Size bytes */
+static double Rows(int NY, int NX, size_t Size)
+{
+  return Chunk((double) NY * sizeof(void *)) + NY * Chunk((double) NX * Size);
+}
+
+static void Account(size_t Size, int Subsystem)
+{
+  NAllocations[Subsystem]++;
+  Requested[Subsystem] += (double) Size;
+  Footprint[Subsystem] += Chunk((double) Size);
+}
+
+/*****************************************************************************
+  TrackCalloc()
+*****************************************************************************/
+void *TrackCalloc(size_t NElements, size_t Size, int Subsystem)
+{
+  void *Ptr;
+
+  if ((Ptr = calloc(NElements, Size)) != NULL)
+    Account(NElements * Size, Subsystem);
+  return Ptr;
+}
+
+/*****************************************************************************
+  TrackMalloc()
+*****************************************************************************/
+void *TrackMalloc(size_t Size, int Subsystem)
+{
+  void *Ptr;
+
+  if ((Ptr = malloc(Size)) != NULL)
+    Account(Size, Subsystem);
+  return Ptr;
+}
+
+/*****************************************************************************
+  MemoryForecast()
+
+  Estimates the memory needed by each subsystem.  Called after InitTables(),
+  when the number of layers is known, and before the maps are allocated.
+*****************************************************************************/
+void MemoryForecast(LISTPTR Input, OPTIONSTRUCT *Options, MAPSIZE *Map,
+                    LAYER *Soil, LAYER *Veg, int NDaySteps)
+{
+  char VarStr[BUFSIZE + 1];
+  double N;                     /* Number of pixels */
+  double Total = 0.0;
+  int NL;                       /* Maximum number of soil layers */
+  int NV;                       /* Maximum number of vegetation layers */
+  int NStats;
+  int i;
+
+  ReportMemory = Options->MemoryReport;
+  if (!ReportMemory && Options->MemoryLimit <= 0.0)
+    return;
+
+  N = (double) Map->NX * Map->NY;
+  NL = Soil->MaxLayers;
+  NV = Veg->MaxLayers;
+
+  GetInitString("METEOROLOGY", "NUMBER OF STATIONS", "", VarStr,
+                (unsigned long) BUFSIZE, Input);
+  if (!CopyInt(&NStats, VarStr, 1) || NStats < 1)
+    NStats = 1;
+
+  for (i = 0; i < MEM_NSUBSYSTEMS; i++)
+    Forecast[i] = 0.0;
+
+  Forecast[MEM_TERRAIN] = Rows(Map->NY, Map->NX, sizeof(TOPOPIX)) +
+    Chunk(N * sizeof(ITEM));
+
+  Forecast[MEM_SOIL] = Rows(Map->NY, Map->NX, sizeof(SOILPIX));
+  if (Options->ContiguousSoil)
+    Forecast[MEM_SOIL] += 7 * Chunk(N * (NL + 1) * sizeof(float));
+  else
+    Forecast[MEM_SOIL] += N * (5 * Chunk((NL + 1) * sizeof(float)) +
+                               2 * Chunk(NL * sizeof(float)));
+
+  Forecast[MEM_VEG] = Rows(Map->NY, Map->NX, sizeof(VEGPIX)) +
+    N * (4 * Chunk(NV * sizeof(float)) + Chunk(NV * sizeof(float *)) +
+         NV * Chunk(12 * sizeof(float)));
+
+  if (Options->CanopyGapping)
+    Forecast[MEM_CANOPYGAP] = N * (Chunk(CELL_PARTITION * sizeof(CanopyGapStruct)) +
+      CELL_PARTITION * (3 * Chunk(NV * sizeof(float)) + Chunk((NL + 1) * sizeof(float)) +
+                        2 * Chunk((NV + 1) * sizeof(float)) + Chunk(NV * sizeof(float *)) +
+                        NV * Chunk(NL * sizeof(float))));
+
+  Forecast[MEM_SNOW] = Rows(Map->NY, Map->NX, sizeof(SNOWPIX));
+
+  Forecast[MEM_EVAP] = Rows(Map->NY, Map->NX, sizeof(EVAPPIX)) +
+    N * (2 * Chunk((NV + 1) * sizeof(float)) + Chunk(NV * sizeof(float)) +
+         Chunk(NV * sizeof(float *)) + NV * Chunk(NL * sizeof(float)));
+
+  Forecast[MEM_PRECIP] = Rows(Map->NY, Map->NX, sizeof(PRECIPPIX)) +
+    N * 2 * Chunk(NV * sizeof(float));
+
+  Forecast[MEM_RADIATION] = Rows(Map->NY, Map->NX, sizeof(PIXRAD));
+
+  Forecast[MEM_SHADING] = Rows(Map->NY, Map->NX, sizeof(float));
+  if (Options->Shading && Options->StreamShading)
+    Forecast[MEM_SHADING] += Chunk(NDaySteps * sizeof(unsigned char **)) +
+      NDaySteps * Chunk((double) Map->NY * sizeof(unsigned char *)) +
+      2 * Chunk((double) Map->NY * Map->NX) +
+      Rows(Map->NY, Map->NX, sizeof(float));
+  else if (Options->Shading)
+    Forecast[MEM_SHADING] += Chunk(NDaySteps * sizeof(unsigned char **)) +
+      NDaySteps * Rows(Map->NY, Map->NX, sizeof(unsigned char)) +
+      Rows(Map->NY, Map->NX, sizeof(float));
+
+  Forecast[MEM_METMAPS] = 2 * Rows(Map->NY, Map->NX, sizeof(float));
+  if (Options->Prism)
+    Forecast[MEM_METMAPS] += Rows(Map->NY, Map->NX, sizeof(float));
+  if (Options->SnowPattern)
+    Forecast[MEM_METMAPS] += 2 * Rows(Map->NY, Map->NX, sizeof(float));
+
+  Forecast[MEM_METWEIGHTS] = Rows(Map->NY, Map->NX, sizeof(unsigned char *)) +
+    N * Chunk(NStats * sizeof(unsigned char));
+
+  Forecast[MEM_NETWORK] = Rows(Map->NY, Map->NX, sizeof(NETSTRUCT)) +
+    N * 2 * Chunk((NL + 1) * sizeof(float));
+
+  if (Options->Extent != POINT) {
+    Forecast[MEM_ROUTING] = 3 * Rows(Map->NY, Map->NX, sizeof(float)) +
+      2 * (Rows(Map->NY, Map->NX, sizeof(unsigned char *)) +
+           N * Chunk(NDIRS * sizeof(unsigned char))) +
+      3 * Rows(Map->NY, Map->NX, sizeof(unsigned char));
+    Forecast[MEM_CHANNEL] = Chunk(Map->NX * sizeof(void *)) +
+      Chunk(N * sizeof(void *));
+  }
+
+  if (Options->Counters)
+    Forecast[MEM_DIAGNOSTICS] = CNT_NCOUNTERS * Chunk(N * sizeof(unsigned int));
+
+  for (i = 0; i < MEM_NSUBSYSTEMS; i++)
+    Total += Forecast[i];
+
+  if (ReportMemory) {
+    printf("\nMemory forecast for %d x %d pixels, %d soil and %d vegetation layers:\n",
+           Map->NY, Map->NX, NL, NV);
+    for (i = 0; i < MEM_NSUBSYSTEMS; i++)
+      if (Forecast[i] > 0.0)
+        printf("  %-16s %12.1f MB\n", SubsystemName[i], Forecast[i] / MB);
+    printf("  %-16s %12.1f MB (channel records not included)\n", "Total", Total / MB);
+  }
+
+  if (Options->MemoryLimit > 0.0 && Total > Options->MemoryLimit * 1024.0 * MB) {
+    sprintf(VarStr, "%.3g GB forecast, %.3g GB allowed", Total / (1024.0 * MB),
+            Options->MemoryLimit);
+    ReportError(VarStr, 68);
+  }
+}
+
+/*****************************************************************************
+  MemoryReport()
+
+  Prints the tracked memory per subsystem and the peak resident set size
+*****************************************************************************/
+void MemoryReport(FILE *OutFile, const char *When)
+{
+  struct rusage Usage;
+  double TotalRequested = 0.0;
+  double TotalFootprint = 0.0;
+  double TotalForecast = 0.0;
+  unsigned long TotalAllocations = 0;
+  int i;
+
+  if (!ReportMemory)
+    return;
+
+  fprintf(OutFile, "\nMemory use %s:\n", When);
+  fprintf(OutFile, "%-16s %12s %14s %14s %14s\n", "Subsystem", "Allocations",
+          "Requested (MB)", "Heap (MB)", "Forecast (MB)");
+  for (i = 0; i < MEM_NSUBSYSTEMS; i++) {
+    if (NAllocations[i] == 0 && Forecast[i] == 0.0)
+      continue;
+    fprintf(OutFile, "%-16s %12lu %14.1f %14.1f %14.1f\n", SubsystemName[i],
+            NAllocations[i], Requested[i] / MB, Footprint[i] / MB, Forecast[i] / MB);
+    TotalAllocations += NAllocations[i];
+    TotalRequested += Requested[i];
+    TotalFootprint += Footprint[i];
+    TotalForecast += Forecast[i];
+  }
+  fprintf(OutFile, "%-16s %12lu %14.1f %14.1f %14.1f\n", "Total", TotalAllocations,
+          TotalRequested / MB, TotalFootprint / MB, TotalForecast / MB);
+
+  /* ru_maxrss is in kilobytes on Linux */
+  if (getrusage(RUSAGE_SELF, &Usage) == 0)
+    fprintf(OutFile, "Peak resident set size %.1f MB (%.1f MB not tracked)\n",
+            Usage.ru_maxrss / 1024.0,
+            Usage.ru_maxrss / 1024.0 - TotalFootprint / MB);
+}
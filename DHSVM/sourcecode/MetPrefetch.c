@@ -0,0 +1,247 @@
+/*
+ * SUMMARY:      MetPrefetch.c - Met records read ahead by a background thread
+ * USAGE:        Part of DHSVM
+ *
+ * DESCRIPTION:  With [OPTIONS] MET PREFETCH = <n> a background thread reads
+ *               the records of every met station up to n time steps ahead
+ *               of the model, so that reading the station files overlaps
+ *               with the computations of the current time step instead of
+ *               preceding them.  The thread parses the records with
+ *               ScanMetRecord() into a ring of n time steps, and
+ *               GetMetData() takes the records of the current time step
+ *               from the ring.  The checks of the values and their warnings
+ *               (SetMetRecord()) are done in the main thread, in the same
+ *               order as without the prefetch.
+ *
+ *               A read error ends the thread and is reported when the model
+ *               reaches the time step of the failed record, so the output
+ *               up to that time step is the same as without the prefetch.
+ *
+ *               The thread is stopped before a fork().  A forecast scenario
+ *               reopens its station files and starts its own thread.
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "settings.h"
+#include "data.h"
+#include "DHSVMerror.h"
+#include "functions.h"
+#include "metprefetch.h"
+
+static float *Ring = NULL;        /* MetPrefetch steps x NStats records */
+static DATE *RingDate = NULL;     /* Time step of each slot */
+static int *RingError = NULL;     /* ReportError() code of each slot, or 0 */
+static int *RingStation = NULL;   /* Station of the failed record */
+static int Depth = 0;             /* Number of slots */
+static int RecordSize = 0;        /* Variables per station record */
+static long Head = 0;             /* Time steps read by the thread */
+static long Tail = 0;             /* Time steps taken by the model */
+static TIMESTRUCT Next;           /* Next time step to read */
+
+static OPTIONSTRUCT *PrefetchOptions = NULL;
+static METLOCATION *PrefetchStat = NULL;
+static int PrefetchStats = 0;
+static int PrefetchSoilLayers = 0;
+
+static pthread_t Reader;
+static pthread_mutex_t Lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t Filled = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t Emptied = PTHREAD_COND_INITIALIZER;
+static int Running = FALSE;       /* TRUE while the thread has not been joined */
+static int Done = FALSE;          /* TRUE when the thread has no more to read */
+static int Stop = FALSE;          /* Set to ask the thread to stop */
+
+static void *ReadAhead(void *Arg);
+static void StartReader(void);
+static void StopReader(void);
+static void ForkedReader(void);
+
+/*****************************************************************************
+  PrefetchMetRecords()
+
+  Sets the met records of the current time step from the ring, starting the
+  reading thread the first time.  Returns FALSE if MET PREFETCH is not set,
+  in which case GetMetData() reads the records.
+*****************************************************************************/
+int PrefetchMetRecords(OPTIONSTRUCT *Options, TIMESTRUCT *Time,
+                       int NSoilLayers, int NStats, METLOCATION *Stat)
+{
+  const char *Routine = "PrefetchMetRecords";
+  float *Slot;
+  int Start;
+  int i;
+
+  if (Options->MetPrefetch <= 0 || NStats <= 0)
+    return FALSE;
+
+  if (Ring == NULL) {
+    Depth = Options->MetPrefetch;
+    RecordSize = MetRecordSize(Options, NSoilLayers);
+    if (!(Ring = (float *) calloc((size_t) Depth * NStats * RecordSize,
+                                  sizeof(float))) ||
+        !(RingDate = (DATE *) calloc(Depth, sizeof(DATE))) ||
+        !(RingError = (int *) calloc(Depth, sizeof(int))) ||
+        !(RingStation = (int *) calloc(Depth, sizeof(int))))
+      ReportError((char *) Routine, 1);
+    PrefetchOptions = Options;
+    PrefetchStat = Stat;
+    PrefetchStats = NStats;
+    PrefetchSoilLayers = NSoilLayers;
+    Head = Tail = 0;
+    Next = *Time;
+    Done = FALSE;
+    pthread_atfork(StopReader, NULL, ForkedReader);
+  }
+
+  /* The ring only holds consecutive time steps from the first one on.  If
+     the model time does not continue from there, the reading starts over
+     from the current time step (ScanMetRecord() skips to it). */
+  pthread_mutex_lock(&Lock);
+  if (Head > Tail && !IsEqualTime(&(RingDate[Tail % Depth]), &(Time->Current))) {
+    pthread_mutex_unlock(&Lock);
+    StopReader();
+    pthread_mutex_lock(&Lock);
+    Head = Tail = 0;
+    Next = *Time;
+    Done = FALSE;
+  }
+  else if (Head == Tail && !Running && !Done)
+    Next = *Time;
+  Start = !Running && !Done;
+  pthread_mutex_unlock(&Lock);
+
+  if (Start)
+    StartReader();
+
+  pthread_mutex_lock(&Lock);
+  while (Head == Tail && !Done)
+    pthread_cond_wait(&Filled, &Lock);
+  if (Head == Tail) {
+    /* The thread ended at the end of the run, so the station files are
+       read as usual */
+    pthread_mutex_unlock(&Lock);
+    return FALSE;
+  }
+  pthread_mutex_unlock(&Lock);
+
+  Slot = Ring + (size_t) (Tail % Depth) * PrefetchStats * RecordSize;
+  if (RingError[Tail % Depth] != 0)
+    ReportError(Stat[RingStation[Tail % Depth]].MetFile.FileName,
+                RingError[Tail % Depth]);
+  for (i = 0; i < NStats; i++)
+    SetMetRecord(Options, NSoilLayers, Stat[i].MetFile.FileName,
+                 Slot + (size_t) i * RecordSize, &(Stat[i].Data));
+
+  pthread_mutex_lock(&Lock);
+  Tail++;
+  pthread_cond_signal(&Emptied);
+  pthread_mutex_unlock(&Lock);
+
+  return TRUE;
+}
+
+/*****************************************************************************
+  ReadAhead()
+
+  Body of the reading thread.  Reads the records of one time step at a time
+  into the next free slot of the ring, until the end of the run, a read
+  error or StopReader().
+*****************************************************************************/
+static void *ReadAhead(void *Arg)
+{
+  float *Slot;
+  int Index;
+  int ErrorCode = 0;
+  int i;
+
+  while (ErrorCode == 0 &&
+         (Before(&(Next.Current), &(Next.End)) ||
+          IsEqualTime(&(Next.Current), &(Next.End)))) {
+    pthread_mutex_lock(&Lock);
+    while (Head - Tail >= Depth && !Stop)
+      pthread_cond_wait(&Emptied, &Lock);
+    if (Stop) {
+      pthread_mutex_unlock(&Lock);
+      return NULL;
+    }
+    pthread_mutex_unlock(&Lock);
+
+    Index = Head % Depth;
+    Slot = Ring + (size_t) Index * PrefetchStats * RecordSize;
+    RingDate[Index] = Next.Current;
+    RingError[Index] = 0;
+    for (i = 0; i < PrefetchStats && ErrorCode == 0; i++) {
+      ErrorCode = ScanMetRecord(PrefetchOptions, &(Next.Current),
+                                PrefetchSoilLayers, &(PrefetchStat[i].MetFile),
+                                Slot + (size_t) i * RecordSize);
+      if (ErrorCode != 0) {
+        RingError[Index] = ErrorCode;
+        RingStation[Index] = i;
+      }
+    }
+
+    pthread_mutex_lock(&Lock);
+    Head++;
+    pthread_cond_signal(&Filled);
+    pthread_mutex_unlock(&Lock);
+    IncreaseTime(&Next);
+  }
+
+  pthread_mutex_lock(&Lock);
+  Done = TRUE;
+  pthread_cond_signal(&Filled);
+  pthread_mutex_unlock(&Lock);
+  return NULL;
+}
+
+/*****************************************************************************
+  StartReader()
+
+  Starts the reading thread.  If that fails the records in the ring are
+  used up, after which the station files are read as usual.
+*****************************************************************************/
+static void StartReader(void)
+{
+  Stop = FALSE;
+  if (pthread_create(&Reader, NULL, ReadAhead, NULL) == 0)
+    Running = TRUE;
+  else
+    Done = TRUE;
+}
+
+/*****************************************************************************
+  StopReader()
+
+  Stops and joins the reading thread.  The records that it has read stay in
+  the ring, and PrefetchMetRecords() starts a new thread that continues from
+  there.
+*****************************************************************************/
+static void StopReader(void)
+{
+  if (!Running)
+    return;
+  pthread_mutex_lock(&Lock);
+  Stop = TRUE;
+  pthread_cond_signal(&Emptied);
+  pthread_mutex_unlock(&Lock);
+  pthread_join(Reader, NULL);
+  Running = FALSE;
+  Stop = FALSE;
+}
+
+/*****************************************************************************
+  ForkedReader()
+
+  In a forked process the ring is emptied, since a forecast scenario reads
+  its own station files from the current time step on
+*****************************************************************************/
+static void ForkedReader(void)
+{
+  Head = Tail = 0;
+  Done = FALSE;
+  Running = FALSE;
+  Stop = FALSE;
+}
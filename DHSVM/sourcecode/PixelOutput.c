@@ -0,0 +1,299 @@
+/*
+ * SUMMARY:      PixelOutput.c - Layout and binary output of pixel time series
+ * USAGE:        Part of DHSVM
+ *
+ * DESCRIPTION:  The pixel time series (Aggregated.Values and Pixel.<name>)
+ *               are written from a vector of values per time step, in the
+ *               column layout described by a PIXLAYOUT.  PrintPixHeader()
+ *               and PrintPixValues() produce the text format.
+ *
+ *               With [OUTPUT] PIXEL OUTPUT FORMAT = BINARY, the values of all
+ *               output pixels are instead written to one file,
+ *               <OUTPUT DIRECTORY>/Pixel.Values.bin, with one fixed-width
+ *               record per time step (see pixeloutput.h).  The file is
+ *               written through a large stdio buffer, so that it is written
+ *               in large blocks.  The DHSVM_PixelToText utility (PixelToText.c)
+ *               converts it to the Pixel.<name> text files on demand.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "settings.h"
+#include "data.h"
+#include "DHSVMerror.h"
+#include "fileio.h"
+#include "pixeloutput.h"
+
+#define PIXFILE_BUFFER (4 << 20)  /* Bytes of the stdio buffer of the file */
+
+static FILES PixFile;
+static char *PixBuffer = NULL;
+static int NPixels = 0;
+static int Width = 0;              /* Floats per pixel per time step */
+static float *Record = NULL;       /* Values of the current time step */
+static PIXLAYOUT *Layouts = NULL;  /* Layouts of the current time step */
+static PIXFILEPIXEL *Pixels = NULL;
+static int HeaderDone = FALSE;     /* TRUE once the pixel layouts are written */
+
+/*****************************************************************************
+  PixLayoutSize()
+
+  Number of values per time step
+*****************************************************************************/
+int PixLayoutSize(PIXLAYOUT *Layout)
+{
+  int NSoil = Layout->NSoil;
+  int NStory = Layout->NCanopyStory;
+
+  return 14 + 2 * (NStory + 1) + NStory + NStory * NSoil + 1 + 2 * NStory +
+    (NSoil + 1) + 2 * NSoil + 3 + 2 * NStory + 1 +
+    (Layout->HeatFlux ? 1 : 0) + 12 + (Layout->Gap ? 8 : 0) + 1 +
+    (Layout->DynamicInfilt ? 1 : 0) + (Layout->GapRad ? 2 : 0);
+}
+
+/*****************************************************************************
+  PrintPixHeader()
+*****************************************************************************/
+void PrintPixHeader(FILE *OutFile, PIXLAYOUT *Layout)
+{
+  int i, j;
+  int NSoil = Layout->NSoil;
+  int NCanopyStory = Layout->NCanopyStory;
+
+  /* Main Aggregate Values File */
+  fprintf(OutFile, "Date ");
+  fprintf(OutFile, "W(mm) ");
+  fprintf(OutFile, "Precip(m) ");
+  fprintf(OutFile, "Snow(m) ");
+  fprintf(OutFile, "IExcess(m) ");
+  fprintf(OutFile, "HasSnow LastSnow Albedo Swq Melt ");
+  fprintf(OutFile, "PackWater TPack SurfWater TSurf ");
+
+  fprintf(OutFile, " TotalET ");   /*total evapotranspiration*/
+  for (i = 0; i < NCanopyStory + 1; i++)
+    fprintf(OutFile, " PotTransp.Story%d ", i); /* potential transpiration */
+  for (i = 0; i < NCanopyStory + 1; i++)
+    fprintf(OutFile, " ActTransp.Story%d ", i); /* Actual transpiration */
+  for (i = 0; i < NCanopyStory; i++)
+    fprintf(OutFile, "  EvapCanopyInt.Story%d ", i);
+  for (i = 0; i < NCanopyStory; i++)
+    for (j = 0; j < NSoil; j++)
+      fprintf(OutFile, " ActTransp.Story%d.Soil%d ", i, j);
+  fprintf(OutFile, " SoilEvap ");
+
+  for (i = 0; i < NCanopyStory; i++)
+    fprintf(OutFile, " IntRain.Story%d ", i);
+  for (i = 0; i < NCanopyStory; i++)
+    fprintf(OutFile, " IntSnow.Story%d ", i);
+
+  for (i = 0; i <= NSoil; i++)
+    fprintf(OutFile, " SoilMoist%d ", (i + 1));
+  for (i = 0; i < NSoil; i++)
+    fprintf(OutFile, " Perc%d ", (i + 1));
+  for (i = 0; i < NSoil; i++)
+    fprintf(OutFile, " InterFlow%d ", (i + 1));
+  fprintf(OutFile, " TableDepth SatFlow DetentionStorage ");
+
+  /* print radiation associated variables */
+  for (i = 0; i < NCanopyStory; i++)
+    fprintf(OutFile, " NetShort.Story%d ", (i + 1));
+  for (i = 0; i < NCanopyStory; i++)
+    fprintf(OutFile, " LongIn.Story%d ", (i + 1));
+  fprintf(OutFile, " PixelNetShort ");
+
+  if (Layout->HeatFlux)
+    fprintf(OutFile, " TSurf ");
+
+  fprintf(OutFile, " Soil.Qnet Soil.Qs Soil.Qe Soil.Qg Soil.Qst Ra ");
+  fprintf(OutFile, " Snow.Qsw Snow.Qlw Snow.Qs Snow.Qe Snow.Qp Snow.MeltEnergy ");
+
+  if (Layout->Gap)
+    fprintf(OutFile, " Gap.SWE Gap.Qsw Gap.Qlin Gap.Qlw Gap.Qs Gap.Qe Gap.Qp Gap.MeltEnergy ");
+  fprintf(OutFile, " Tair ");
+  if (Layout->DynamicInfilt)
+    fprintf(OutFile, " InfiltAcc");
+
+  if (Layout->GapRad)
+    fprintf(OutFile, "Gap_SW GAP_LW");
+
+  fprintf(OutFile, "\n");
+}
+
+/*****************************************************************************
+  PrintPixValues()
+
+  Prints the values of a time step, in the order of GetPixValues(), without
+  the end of line
+*****************************************************************************/
+void PrintPixValues(FILE *OutFile, DATE *Current, PIXLAYOUT *Layout,
+                    float *Values)
+{
+  int i, j;
+  int NSoil = Layout->NSoil;
+  int NCanopyStory = Layout->NCanopyStory;
+  float *V = Values;
+
+  PrintDate(Current, OutFile);
+  fprintf(OutFile, " %g ", V[0]);
+  fprintf(OutFile, " %g ", V[1]);
+  fprintf(OutFile, " %g ", V[2]);
+  fprintf(OutFile, " %g ", V[3]);
+  V += 4;
+
+  /* Snow */
+  fprintf(OutFile, " %g %g %g %g %g %g %g %g %g ",
+    V[0] / 255.0, V[1], V[2], V[3], V[4], V[5], V[6], V[7], V[8]);
+  V += 9;
+
+  fprintf(OutFile, " %g", *V++);
+
+  /* Potential transpiration */
+  for (i = 0; i < NCanopyStory + 1; i++)
+    fprintf(OutFile, " %g", *V++);
+  /* Actual transpiration */
+  for (i = 0; i < NCanopyStory + 1; i++)
+    fprintf(OutFile, " %g", *V++);
+  for (i = 0; i < NCanopyStory; i++)
+    fprintf(OutFile, " %g", *V++);
+  /* transpiration from each veg layer from each soil layer */
+  for (i = 0; i < NCanopyStory; i++)
+    for (j = 0; j < NSoil; j++)
+      fprintf(OutFile, " %g", *V++);
+  /* evaporation from uppper soil */
+  fprintf(OutFile, " %g", *V++);
+
+  for (i = 0; i < NCanopyStory; i++)
+    fprintf(OutFile, " %g", *V++);
+  for (i = 0; i < NCanopyStory; i++)
+    fprintf(OutFile, " %g", *V++);
+
+  for (i = 0; i <= NSoil; i++)
+    fprintf(OutFile, " %g ", *V++);
+  for (i = 0; i < NSoil; i++)
+    fprintf(OutFile, " %g ", *V++);
+  for (i = 0; i < NSoil; i++)
+    fprintf(OutFile, " %g ", *V++);
+
+  fprintf(OutFile, " %g %g %g ", V[0], V[1], V[2]);
+  V += 3;
+
+  for (i = 0; i < NCanopyStory; i++)
+    fprintf(OutFile, " %g ", *V++);
+  for (i = 0; i < NCanopyStory; i++)
+    fprintf(OutFile, " %g ", *V++);
+
+  fprintf(OutFile, " %g ", *V++);
+
+  if (Layout->HeatFlux)
+    fprintf(OutFile, " %g ", *V++);
+
+  fprintf(OutFile, " %g %g %g %g %g %g ", V[0], V[1], V[2], V[3], V[4], V[5]);
+  V += 6;
+  fprintf(OutFile, " %g %g %g %g %g %g ", V[0], V[1], V[2], V[3], V[4], V[5]);
+  V += 6;
+
+  if (Layout->Gap) {
+    fprintf(OutFile, " %g %g %g %g %g %g %g %g ",
+      V[0], V[1], V[2], V[3], V[4], V[5], V[6], V[7]);
+    V += 8;
+  }
+
+  fprintf(OutFile, " %g ", *V++);
+
+  if (Layout->DynamicInfilt)
+    fprintf(OutFile, " %g", *V++);
+
+  if (Layout->GapRad)
+    fprintf(OutFile, " %g %g", V[0], V[1]);
+}
+
+/*****************************************************************************
+  InitPixBinary()
+
+  Creates the binary pixel file.  Each pixel gets MaxLayout's number of
+  values per time step.  The layouts of the pixels are written with the
+  first time step, and with every record.
+*****************************************************************************/
+void InitPixBinary(char *Path, int NPix, PIXDUMP *Pix, PIXLAYOUT *MaxLayout)
+{
+  const char *Routine = "InitPixBinary";
+  size_t PathLength = strlen(Path);
+  int i;
+
+  NPixels = NPix;
+  Width = PixLayoutSize(MaxLayout);
+  HeaderDone = FALSE;
+
+  /* A forecast scenario starts its own file */
+  free(Record);
+  free(Layouts);
+  free(Pixels);
+  if (!(Record = (float *) calloc((size_t) NPix * Width, sizeof(float))) ||
+      !(Layouts = (PIXLAYOUT *) calloc(NPix, sizeof(PIXLAYOUT))) ||
+      !(Pixels = (PIXFILEPIXEL *) calloc(NPix, sizeof(PIXFILEPIXEL))))
+    ReportError((char *) Routine, 1);
+  for (i = 0; i < NPix; i++)
+    strcpy(Pixels[i].FileName, Pix[i].OutFile.FileName + PathLength);
+
+  sprintf(PixFile.FileName, "%s%s", Path, PIXFILE_NAME);
+  if (PixFile.FilePtr != NULL)
+    fclose(PixFile.FilePtr);
+  OpenFile(&(PixFile.FilePtr), PixFile.FileName, "wb", TRUE);
+  if (PixBuffer == NULL && !(PixBuffer = malloc(PIXFILE_BUFFER)))
+    ReportError((char *) Routine, 1);
+  setvbuf(PixFile.FilePtr, PixBuffer, _IOFBF, PIXFILE_BUFFER);
+}
+
+/*****************************************************************************
+  PixBinarySlot()
+
+  Returns where the values of Pixel go in the record of the current time
+  step.  The layout is stored with the record, as it changes when the
+  vegetation of the pixel does.
+*****************************************************************************/
+float *PixBinarySlot(int Pixel, PIXLAYOUT *Layout)
+{
+  if (!HeaderDone)
+    Pixels[Pixel].Layout = *Layout;
+  Layouts[Pixel] = *Layout;
+  return Record + (size_t) Pixel * Width;
+}
+
+/*****************************************************************************
+  WritePixBinary()
+
+  Writes the record of the current time step, preceded by the header of the
+  file at the first time step
+*****************************************************************************/
+void WritePixBinary(DATE *Current)
+{
+  PIXFILEHEADER Header;
+  int Date[6];
+
+  if (!HeaderDone) {
+    memset(&Header, 0, sizeof(PIXFILEHEADER));
+    memcpy(Header.Magic, PIXFILE_MAGIC, sizeof(Header.Magic));
+    Header.Version = PIXFILE_VERSION;
+    Header.NPix = NPixels;
+    Header.Width = Width;
+    if (fwrite(&Header, sizeof(PIXFILEHEADER), 1, PixFile.FilePtr) != 1 ||
+        fwrite(Pixels, sizeof(PIXFILEPIXEL), NPixels, PixFile.FilePtr) !=
+        (size_t) NPixels)
+      ReportError(PixFile.FileName, 41);
+    HeaderDone = TRUE;
+  }
+
+  Date[0] = Current->Year;
+  Date[1] = Current->Month;
+  Date[2] = Current->Day;
+  Date[3] = Current->Hour;
+  Date[4] = Current->Min;
+  Date[5] = Current->Sec;
+  if (fwrite(Date, sizeof(int), 6, PixFile.FilePtr) != 6 ||
+      fwrite(Layouts, sizeof(PIXLAYOUT), NPixels, PixFile.FilePtr) !=
+      (size_t) NPixels ||
+      fwrite(Record, sizeof(float), (size_t) NPixels * Width, PixFile.FilePtr) !=
+      (size_t) NPixels * Width)
+    ReportError(PixFile.FileName, 41);
+}
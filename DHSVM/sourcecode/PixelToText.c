@@ -0,0 +1,132 @@
+/*
+ * SUMMARY:      PixelToText.c - Convert a binary pixel file to text
+ * USAGE:        make -f makefile_for_binary.txt pixel_to_text
+ *               ./DHSVM_PixelToText <Pixel.Values.bin> [directory]
+ *
+ * DESCRIPTION:  Writes the Pixel.<name> text file of every pixel in a
+ *               binary pixel file (written with [OUTPUT] PIXEL OUTPUT
+ *               FORMAT = BINARY, see PixelOutput.c) to the directory, by
+ *               default the directory of the binary file.  The text files
+ *               are the same as the model writes with PIXEL OUTPUT FORMAT =
+ *               TEXT.  At most MAXOPEN text files are open at a time, so
+ *               the binary file is read once for every MAXOPEN pixels.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "settings.h"
+#include "data.h"
+#include "DHSVMerror.h"
+#include "fileio.h"
+#include "pixeloutput.h"
+
+#define MAXOPEN 256       /* Text files written in one pass */
+
+int main(int argc, char **argv)
+{
+  const char *Routine = "PixelToText";
+  char Path[BUFSIZE + 1];
+  char FileName[2 * BUFSIZE + 2];
+  FILE *InFile;
+  FILE **OutFile;
+  PIXFILEHEADER Header;
+  PIXFILEPIXEL *Pixels;
+  PIXLAYOUT *Layouts;
+  float *Record;
+  int Date[6];
+  DATE Current;
+  size_t NValues;
+  long NSteps = 0;
+  long DataStart;
+  int First;
+  int Last;
+  int i;
+  char *Slash;
+
+  if (argc < 2 || argc > 3) {
+    fprintf(stderr, "usage: %s <Pixel.Values.bin> [directory]\n", argv[0]);
+    exit(EXIT_FAILURE);
+  }
+
+  if (argc == 3) {
+    strncpy(Path, argv[2], BUFSIZE - 1);
+    Path[BUFSIZE - 1] = '\0';
+    if (strlen(Path) > 0 && Path[strlen(Path) - 1] != '/')
+      strcat(Path, "/");
+  }
+  else {
+    strncpy(Path, argv[1], BUFSIZE);
+    Path[BUFSIZE] = '\0';
+    if ((Slash = strrchr(Path, '/')) != NULL)
+      Slash[1] = '\0';
+    else
+      Path[0] = '\0';
+  }
+
+  OpenFile(&InFile, argv[1], "rb", FALSE);
+  if (fread(&Header, sizeof(PIXFILEHEADER), 1, InFile) != 1)
+    ReportError(argv[1], 2);
+  if (memcmp(Header.Magic, PIXFILE_MAGIC, sizeof(Header.Magic)) != 0 ||
+      Header.Version != PIXFILE_VERSION || Header.NPix <= 0 || Header.Width <= 0)
+    ReportError(argv[1], 51);
+
+  NValues = (size_t) Header.NPix * Header.Width;
+  if (!(Pixels = (PIXFILEPIXEL *) calloc(Header.NPix, sizeof(PIXFILEPIXEL))) ||
+      !(Layouts = (PIXLAYOUT *) calloc(Header.NPix, sizeof(PIXLAYOUT))) ||
+      !(OutFile = (FILE **) calloc(MAXOPEN, sizeof(FILE *))) ||
+      !(Record = (float *) calloc(NValues, sizeof(float))))
+    ReportError((char *) Routine, 1);
+  if (fread(Pixels, sizeof(PIXFILEPIXEL), Header.NPix, InFile) !=
+      (size_t) Header.NPix)
+    ReportError(argv[1], 2);
+
+  for (i = 0; i < Header.NPix; i++) {
+    if (PixLayoutSize(&(Pixels[i].Layout)) > Header.Width)
+      ReportError(argv[1], 51);
+    Pixels[i].FileName[BUFSIZE] = '\0';
+  }
+  DataStart = ftell(InFile);
+
+  for (First = 0; First < Header.NPix; First = Last) {
+    Last = (First + MAXOPEN < Header.NPix) ? First + MAXOPEN : Header.NPix;
+    for (i = First; i < Last; i++) {
+      sprintf(FileName, "%s%s", Path, Pixels[i].FileName);
+      OpenFile(&(OutFile[i - First]), FileName, "w", TRUE);
+      PrintPixHeader(OutFile[i - First], &(Pixels[i].Layout));
+    }
+
+    if (fseek(InFile, DataStart, SEEK_SET))
+      ReportError(argv[1], 39);
+    NSteps = 0;
+    while (fread(Date, sizeof(int), 6, InFile) == 6) {
+      if (fread(Layouts, sizeof(PIXLAYOUT), Header.NPix, InFile) !=
+          (size_t) Header.NPix ||
+          fread(Record, sizeof(float), NValues, InFile) != NValues)
+        ReportError(argv[1], 2);
+      memset(&Current, 0, sizeof(DATE));
+      Current.Year = Date[0];
+      Current.Month = Date[1];
+      Current.Day = Date[2];
+      Current.Hour = Date[3];
+      Current.Min = Date[4];
+      Current.Sec = Date[5];
+      for (i = First; i < Last; i++) {
+        if (PixLayoutSize(&(Layouts[i])) > Header.Width)
+          ReportError(argv[1], 51);
+        PrintPixValues(OutFile[i - First], &Current, &(Layouts[i]),
+                       Record + (size_t) i * Header.Width);
+        fprintf(OutFile[i - First], "\n");
+      }
+      NSteps++;
+    }
+
+    for (i = First; i < Last; i++)
+      fclose(OutFile[i - First]);
+  }
+
+  fclose(InFile);
+  printf("%d pixels, %ld time steps\n", Header.NPix, NSteps);
+
+  return EXIT_SUCCESS;
+}
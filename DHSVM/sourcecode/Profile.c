@@ -0,0 +1,219 @@
+/*
+ * SUMMARY:      Profile.c - Wall-clock timing of the model stages
+ * USAGE:        Part of DHSVM
+ *
+ * DESCRIPTION:  Accumulates the wall-clock time spent in each stage of the
+ *               time loop (see enum PROFILESTAGE in profile.h).  Stages may
+ *               be nested; the time of an enclosing stage is suspended while
+ *               a nested stage runs, so the stage times add up to the total.
+ *               With PROFILE = TIMESTEP the times of each step are also
+ *               written to Profile.csv in the output directory.
+ *
+ *               When profiling is off, ProfileStart() and ProfileStop()
+ *               return immediately without reading the clock.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "settings.h"
+#include "data.h"
+#include "DHSVMerror.h"
+#include "fileio.h"
+#include "functions.h"
+#include "profile.h"
+
+#define PROFILE_MAXDEPTH 8
+
+static const char *StageName[PROF_NSTAGES] = {
+  "Initialization", "NewPeriod", "NewStep/MetData",
+  "LocalMet/MassEnergy", "RouteSubSurface", "RouteChannel", "RouteSurface",
+  "Aggregate", "MassBalance", "Output", "StateDump", "Other"
+};
+
+static int ProfileMode = FALSE;
+static double TotalTime[PROF_NSTAGES];
+static double StepTime[PROF_NSTAGES];
+static double MaxStepTime[PROF_NSTAGES];
+static int Stack[PROFILE_MAXDEPTH];
+static int Depth = 0;
+static double Mark;                 /* Time at which the current stage was (re)started */
+static double RunStart;             /* Time at which the model was started */
+static long NSteps = 0;
+static FILE *ProfileFile = NULL;
+
+/*****************************************************************************
+  WallClock()
+
+  Returns a monotonic wall-clock time in seconds
+*****************************************************************************/
+double WallClock(void)
+{
+  struct timespec t;
+
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return (double) t.tv_sec + 1e-9 * (double) t.tv_nsec;
+}
+
+/*****************************************************************************
+  InitProfile()
+
+  Sets up profiling according to Options->Profile.  StartTime is the
+  WallClock() time at which the model was started; everything up to now is
+  counted as initialization, and the PROF_INIT stage is left running until
+  the time loop starts.  A forecast scenario calls it again to start its
+  own profile.
+*****************************************************************************/
+void InitProfile(OPTIONSTRUCT *Options, char *Path, double StartTime)
+{
+  char FileName[BUFSIZE + 1];
+  int i;
+
+  if (ProfileFile != NULL) {
+    fclose(ProfileFile);
+    ProfileFile = NULL;
+  }
+  NSteps = 0;
+
+  ProfileMode = Options->Profile;
+  RunStart = StartTime;
+  if (ProfileMode == FALSE)
+    return;
+
+  for (i = 0; i < PROF_NSTAGES; i++) {
+    TotalTime[i] = 0.0;
+    StepTime[i] = 0.0;
+    MaxStepTime[i] = 0.0;
+  }
+
+  if (ProfileMode == PROFILE_TIMESTEP) {
+    sprintf(FileName, "%sProfile.csv", Path);
+    OpenFile(&ProfileFile, FileName, "w", TRUE);
+    fprintf(ProfileFile, "Date");
+    for (i = PROF_NEWPERIOD; i < PROF_NSTAGES; i++)
+      fprintf(ProfileFile, ",%s", StageName[i]);
+    fprintf(ProfileFile, ",Total\n");
+  }
+
+  Depth = 0;
+  Stack[Depth++] = PROF_INIT;
+  Mark = StartTime;
+}
+
+/*****************************************************************************
+  ProfileStart()
+*****************************************************************************/
+void ProfileStart(int Stage)
+{
+  double Now;
+
+  if (ProfileMode == FALSE)
+    return;
+
+  Now = WallClock();
+  if (Depth > 0)
+    StepTime[Stack[Depth - 1]] += Now - Mark;
+  if (Depth >= PROFILE_MAXDEPTH)
+    ReportError("ProfileStart", 14);
+  Stack[Depth++] = Stage;
+  Mark = Now;
+}
+
+/*****************************************************************************
+  ProfileStop()
+*****************************************************************************/
+void ProfileStop(int Stage)
+{
+  double Now;
+
+  if (ProfileMode == FALSE)
+    return;
+
+  Now = WallClock();
+  if (Depth < 1 || Stack[Depth - 1] != Stage)
+    ReportError("ProfileStop", 14);
+  StepTime[Stage] += Now - Mark;
+  Depth--;
+  Mark = Now;
+}
+
+/*****************************************************************************
+  ProfileEndStep()
+
+  Adds the times of the step that just finished to the run totals and
+  writes them to Profile.csv if requested.  Initialization is counted
+  towards the totals at the end of the first step.
+*****************************************************************************/
+void ProfileEndStep(DATE *Current)
+{
+  char buffer[32];
+  double Total = 0.0;
+  int i;
+
+  if (ProfileMode == FALSE)
+    return;
+
+  if (ProfileFile != NULL) {
+    SPrintDate(Current, buffer);
+    fprintf(ProfileFile, "%s", buffer);
+    for (i = PROF_NEWPERIOD; i < PROF_NSTAGES; i++) {
+      fprintf(ProfileFile, ",%.6f", StepTime[i]);
+      Total += StepTime[i];
+    }
+    fprintf(ProfileFile, ",%.6f\n", Total);
+  }
+
+  for (i = 0; i < PROF_NSTAGES; i++) {
+    TotalTime[i] += StepTime[i];
+    if (i != PROF_INIT && StepTime[i] > MaxStepTime[i])
+      MaxStepTime[i] = StepTime[i];
+    StepTime[i] = 0.0;
+  }
+  NSteps++;
+}
+
+/*****************************************************************************
+  ProfileReport()
+
+  Prints the time spent in each stage over the whole run
+*****************************************************************************/
+void ProfileReport(FILE *OutFile)
+{
+  double Total = 0.0;
+  double Elapsed;
+  int i;
+
+  if (ProfileMode == FALSE)
+    return;
+
+  /* Anything after the last step (final dumps) */
+  for (i = 0; i < PROF_NSTAGES; i++) {
+    TotalTime[i] += StepTime[i];
+    StepTime[i] = 0.0;
+  }
+
+  for (i = 0; i < PROF_NSTAGES; i++)
+    Total += TotalTime[i];
+  Elapsed = WallClock() - RunStart;
+
+  fprintf(OutFile, "\nProfile of %ld time steps (wall-clock time):\n", NSteps);
+  fprintf(OutFile, "%-20s %12s %7s %12s %12s\n", "Stage", "Total (s)", "%",
+          "Mean (ms)", "Max (ms)");
+  for (i = 0; i < PROF_NSTAGES; i++) {
+    if (i == PROF_INIT)
+      fprintf(OutFile, "%-20s %12.3f %7.2f %12s %12s\n", StageName[i], TotalTime[i],
+              (Total > 0.0) ? 100.0 * TotalTime[i] / Total : 0.0, "", "");
+    else
+      fprintf(OutFile, "%-20s %12.3f %7.2f %12.3f %12.3f\n", StageName[i], TotalTime[i],
+              (Total > 0.0) ? 100.0 * TotalTime[i] / Total : 0.0,
+              (NSteps > 0) ? 1000.0 * TotalTime[i] / NSteps : 0.0,
+              1000.0 * MaxStepTime[i]);
+  }
+  fprintf(OutFile, "%-20s %12.3f\n", "Total", Total);
+  fprintf(OutFile, "%-20s %12.3f\n", "Elapsed", Elapsed);
+
+  if (ProfileFile != NULL) {
+    fclose(ProfileFile);
+    ProfileFile = NULL;
+  }
+}
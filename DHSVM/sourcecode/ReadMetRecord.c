@@ -17,9 +17,21 @@
 void ReadMetRecord(OPTIONSTRUCT *Options, DATE *Current, int NSoilLayers,
 		   FILES *InFile, MET *MetRecord)
 {
-  DATE MetDate;			/* Date of meteorological record */
   float Array[MAXMETVARS];	/* Temporary storage of met variables */
-  int i;
+  int ErrorCode;
+
+  if ((ErrorCode = ScanMetRecord(Options, Current, NSoilLayers, InFile, Array)))
+    ReportError(InFile->FileName, ErrorCode);
+  SetMetRecord(Options, NSoilLayers, InFile->FileName, Array, MetRecord);
+}
+
+/*****************************************************************************
+  MetRecordSize()
+
+  Number of variables in a record of a station file
+*****************************************************************************/
+int MetRecordSize(OPTIONSTRUCT *Options, int NSoilLayers)
+{
   int NMetVars;			/* Number of meteorological variables to read */
   NMetVars = 6;
   /* these are - in order: 
@@ -39,14 +51,33 @@ void ReadMetRecord(OPTIONSTRUCT *Options, DATE *Current, int NSoilLayers,
   if (Options->TempLapse == VARIABLE)
     NMetVars++;
 
+  return NMetVars;
+}
+
+/*****************************************************************************
+  ScanMetRecord()
+
+  Reads the variables of the record of Current from a station file into
+  Array, skipping earlier records.  Does not report errors, so that it can
+  be called from the met prefetch thread (MetPrefetch.c), but returns the
+  ReportError() code of the failure or 0.
+*****************************************************************************/
+int ScanMetRecord(OPTIONSTRUCT *Options, DATE *Current, int NSoilLayers,
+		  FILES *InFile, float *Array)
+{
+  DATE MetDate;			/* Date of meteorological record */
+  int NMetVars;			/* Number of meteorological variables to read */
+
+  NMetVars = MetRecordSize(Options, NSoilLayers);
+
   if (!ScanDate(InFile->FilePtr, &MetDate))
-    ReportError(InFile->FileName, 23);
+    return 23;
 
   while (!IsEqualTime(&MetDate, Current) && !feof(InFile->FilePtr)) {
     if (ScanFloats(InFile->FilePtr, Array, NMetVars) != NMetVars)
-      ReportError(InFile->FileName, 5);
+      return 5;
     if (!ScanDate(InFile->FilePtr, &MetDate))
-      ReportError(InFile->FileName, 23);
+      return 23;
   }
 
   if (!IsEqualTime(&MetDate, Current)) {
@@ -56,17 +87,31 @@ void ReadMetRecord(OPTIONSTRUCT *Options, DATE *Current, int NSoilLayers,
       printf("Current: ");
       PrintDate(Current, stdout);
     }
-    ReportError(InFile->FileName, 28);
+    return 28;
   }
 
   if (ScanFloats(InFile->FilePtr, Array, NMetVars) != NMetVars)
-    ReportError(InFile->FileName, 5);
+    return 5;
+
+  return 0;
+}
+
+/*****************************************************************************
+  SetMetRecord()
+
+  Sets MetRecord from the variables read by ScanMetRecord(), with the checks
+  of the values
+*****************************************************************************/
+void SetMetRecord(OPTIONSTRUCT *Options, int NSoilLayers, char *FileName,
+		  float *Array, MET *MetRecord)
+{
+  int i;
 
   MetRecord->Tair = Array[0];
   MetRecord->Wind = Array[1];
   MetRecord->Rh = Array[2];
   if (MetRecord->Rh < 0.0 || MetRecord->Rh > 100.0) {
-    printf("warning: RH out of bounds: %s\n", InFile->FileName);
+    printf("warning: RH out of bounds: %s\n", FileName);
     if (MetRecord->Rh < 0.0)
       MetRecord->Rh = 0.0;
     if (MetRecord->Rh > 100.0)
@@ -74,17 +119,17 @@ void ReadMetRecord(OPTIONSTRUCT *Options, DATE *Current, int NSoilLayers,
   }
   MetRecord->Sin = Array[3];
   if (MetRecord->Sin > 1380.0) {
-    printf("warning: Shortwave out of bounds: %s\n", InFile->FileName);
+    printf("warning: Shortwave out of bounds: %s\n", FileName);
     MetRecord->Sin = 1380.0;
   }
   if (MetRecord->Sin < 0.0) {
     printf("Warning: Negative Shortwave, setting to zero: %s\n",
-	   InFile->FileName);
+	   FileName);
     MetRecord->Sin = 0.0;
   }
   MetRecord->Lin = Array[4];
   if (MetRecord->Lin < 0.0 || MetRecord->Lin > 1800.0) {
-    printf("warning: Longwave out of bounds: %s\n", InFile->FileName);
+    printf("warning: Longwave out of bounds: %s\n", FileName);
   }
 
   i = 0;
@@ -94,7 +139,7 @@ void ReadMetRecord(OPTIONSTRUCT *Options, DATE *Current, int NSoilLayers,
 
   MetRecord->Precip = Array[5 + i];
   if (MetRecord->Precip < 0) {
-    printf("Warning: negative precip %s \n", InFile->FileName);
+    printf("Warning: negative precip %s \n", FileName);
     MetRecord->Precip = 0.0;
   }
   i++;
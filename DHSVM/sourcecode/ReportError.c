@@ -73,9 +73,15 @@ static char *ErrorMessage[] = {
   "Current version does not support this setup:", /* 65 */
   "Invalid Map->Resolution value for dumping map or image of variable ID:", /* 66 */
   "The options set in the input file do not support plotting variable ID:", /* 67 */
-  "", /* 68 */
+  "Forecast memory use exceeds MEMORY LIMIT:", /* 68 */
   "No gridded met file is found within the basin boundary", /* 69 */
   "Unknown keyword: ",                                      /* 70 */
+  "Canopy gapping requires IMPROVED RADIATION = TRUE:", /* 71 */
+  "Canopy gap diameter larger than the grid cell in:", /* 72 */
+  "Invalid forecast file entry (keys must be STATION FILE n in [METEOROLOGY]):", /* 73 */
+  "Canopy gap wind adjustment factor must be in (0, 1]:", /* 74 */
+  "Invalid ensemble file entry (keys must be in [CONSTANTS]):", /* 75 */
+  "Model state snapshot does not match the model setup:", /* 76 */
   NULL
 };
 
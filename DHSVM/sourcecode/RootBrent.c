@@ -9,6 +9,7 @@
 #include "massenergy.h"
 #include "functions.h"
 #include "DHSVMerror.h"
+#include "counters.h"
 
 /*****************************************************************************
   GENERAL DOCUMENTATION FOR THIS MODULE
@@ -112,7 +113,9 @@ float RootBrent(int y, int x, float LowerBound, float UpperBound,
     eval++;
     j++;
   }
+  CountEvent(CNT_BRENTBRACKET, y, x, j);
   if ((fa * fb) >= 0) {
+    CountEvent(CNT_BRENTEVAL, y, x, eval);
     ReportWarning(ErrorString, 34);
     return current;
   }
@@ -140,6 +143,7 @@ float RootBrent(int y, int x, float LowerBound, float UpperBound,
     m = 0.5 * (c - b);
 
     if (fabs(m) <= tol || fequal(fb, 0.0)) {
+      CountEvent(CNT_BRENTEVAL, y, x, eval);
       va_end(ap);
       return b;
     }
@@ -191,6 +195,7 @@ float RootBrent(int y, int x, float LowerBound, float UpperBound,
       eval++;
     }
   }
+  CountEvent(CNT_BRENTEVAL, y, x, eval);
   ReportWarning(ErrorString, 33);
   return current;
 }
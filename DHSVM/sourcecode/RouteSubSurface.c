@@ -2,6 +2,7 @@
 #include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include "settings.h"
 #include "data.h"
 #include "DHSVMerror.h"
@@ -10,6 +11,9 @@
 #include "soilmoisture.h"
 #include "slopeaspect.h"
 #include "DHSVMChannel.h"
+#include "counters.h"
+#include "memtrack.h"
+#include "diaglog.h"
 
 /*****************************************************************************
   RouteSubSurface()
@@ -74,18 +78,32 @@
   and FlowGrad (SubDir, SubTotalDir, SubFlowGrad) for Gradient = WATERTABLE 
   are now determined locally here (in RouteSubsurface.c.)
  
+  The subsurface flow directions and gradients are kept from one time step
+  to the next.  With Gradient = WATERTABLE they are only recalculated for
+  cells whose own water level, or that of one of their neighbors, changed
+  by more than WATER TABLE GRADIENT TOLERANCE since it was last used.  The
+  default tolerance of zero recalculates every cell whose inputs changed
+  at all, which gives the same result as recalculating all cells.  The
+  order in which the outflow of a cell is passed to its neighbors (by
+  decreasing flow fraction) is stored alongside and only redetermined
+  when the flow directions of the cell are recalculated.
+
   Update 2023-2024 Eli Boardman
   Initially the code had an if statement that prevented all
   lateral subsurface flow beneath stream channels. This version is considerably
   updated to enable hyporheic exchange and subsurface flow below channels.
  
+  When SATURATED FLOW SOLVER = IMPLICIT, the channel exchange and deep flux
+  are still computed here, but the lateral exchange between grid cells is
+  left to RouteSubSurfaceImplicit(), which is passed the transmissivity,
+  specific yield and available water of each cell.
+ 
 *****************************************************************************/
 void RouteSubSurface(int Dt, MAPSIZE *Map, TOPOPIX **TopoMap,
 		     VEGTABLE *VType, VEGPIX **VegMap,
 		     NETSTRUCT **Network, SOILTABLE *SType,
 		     SOILPIX **SoilMap, CHANNEL *ChannelData,
-		     TIMESTRUCT *Time, OPTIONSTRUCT *Options, 
-		     char *DumpPath)
+		     TIMESTRUCT *Time, OPTIONSTRUCT *Options)
 {
   const char *Routine = "RouteSubSurface";
   int x, nx;			/* counters */
@@ -111,43 +129,101 @@ void RouteSubSurface(int Dt, MAPSIZE *Map, TOPOPIX **TopoMap,
   float PotentialSatFlow, ActualSatFlow, LayerContribWater, LayerStorageCap, DeltaTableDepth;
   float LayerContribWaterK, LayerStorageK, LayerStorageCapK, DeltaTableDepthK, LayerUseFrac;
   int k, q;
-  float **SubFlowGrad;	        /* Magnitude of subsurface flow gradient slope * width */
-  unsigned char ***SubDir;      /* Fraction of flux moving in each direction*/ 
-  unsigned int **SubTotalDir;	/* Sum of Dir array */
-  ITEM kOrdered[NDIRS];
+  int n;
+  static float **SubFlowGrad = NULL;	      /* Magnitude of subsurface flow gradient slope * width */
+  static unsigned char ***SubDir = NULL;    /* Fraction of flux moving in each direction*/ 
+  static unsigned int **SubTotalDir = NULL; /* Sum of Dir array */
+  static float **RefWaterLevel = NULL;      /* Water level when the change was last passed on to the neighbors */
+  static unsigned char **Recompute = NULL;  /* TRUE if the flow directions of a cell need to be recalculated */
+  static unsigned char ***SubOrder = NULL;  /* Flow directions by increasing fraction, see OrderFlowDirections() */
+  static unsigned char **SubNFlow = NULL;   /* Number of directions receiving flow */
+  static unsigned char **OrderValid = NULL; /* FALSE if SubOrder needs to be redetermined */
+  static char FirstStep = TRUE;
+  int d;
+  int Implicit;
+  unsigned int LayerIter;       /* Layer-matching iterations of the current cell */
+  static float *CellTransmissivity = NULL;   /* Per-cell inputs to the implicit solver, */
+  static float *CellSpecificYield = NULL;    /* in Map->OrderedCells order */
+  static float *CellAvailableWater = NULL;
 
-  int count, totalcount;
+  int count = 0;                /* Cells counted in the saturation extent */
   float mgrid, sat;
-  char buffer[32];
-  char satoutfile[100];         /* Character arrays to hold file name. */ 
-  FILE *fs;                     /* File pointer. */
   /*****************************************************************************
-   Allocate memory 
+   Allocate memory (first call only, the flow directions persist between steps)
   ****************************************************************************/
   
-  if (!(SubFlowGrad = (float **)calloc(Map->NY, sizeof(float *))))
-    ReportError((char *) Routine, 1);
-  for(i=0; i<Map->NY; i++) {
-    if (!(SubFlowGrad[i] = (float *)calloc(Map->NX, sizeof(float))))
+  if (FirstStep) {
+    if (!(SubFlowGrad = (float **)TrackCalloc(Map->NY, sizeof(float *), MEM_ROUTING)))
       ReportError((char *) Routine, 1);
-  }
-  
-  if (!((SubDir) = (unsigned char ***) calloc(Map->NY, sizeof(unsigned char **))))
-    ReportError((char *) Routine, 1);
-  for (i=0; i<Map->NY; i++) {
-    if (!((SubDir)[i] = (unsigned char **) calloc(Map->NX, sizeof(unsigned char*))))
-	  ReportError((char *) Routine, 1);
-	for (j=0; j<Map->NX; j++) {
-      if (!(SubDir[i][j] = (unsigned char *)calloc(NDIRS, sizeof(unsigned char ))))
-		ReportError((char *) Routine, 1);
+    for(i=0; i<Map->NY; i++) {
+      if (!(SubFlowGrad[i] = (float *)TrackCalloc(Map->NX, sizeof(float), MEM_ROUTING)))
+        ReportError((char *) Routine, 1);
     }
-  }
-
-  if (!(SubTotalDir = (unsigned int **)calloc(Map->NY, sizeof(unsigned int *))))
-    ReportError((char *) Routine, 1);
-  for (i=0; i<Map->NY; i++) {
-    if (!(SubTotalDir[i] = (unsigned int *)calloc(Map->NX, sizeof(unsigned int))))
+    
+    if (!((SubDir) = (unsigned char ***) TrackCalloc(Map->NY, sizeof(unsigned char **), MEM_ROUTING)))
+      ReportError((char *) Routine, 1);
+    for (i=0; i<Map->NY; i++) {
+      if (!((SubDir)[i] = (unsigned char **) TrackCalloc(Map->NX, sizeof(unsigned char*), MEM_ROUTING)))
+        ReportError((char *) Routine, 1);
+      for (j=0; j<Map->NX; j++) {
+        if (!(SubDir[i][j] = (unsigned char *)TrackCalloc(NDIRS, sizeof(unsigned char ), MEM_ROUTING)))
+          ReportError((char *) Routine, 1);
+      }
+    }
+    
+    if (!(SubTotalDir = (unsigned int **)TrackCalloc(Map->NY, sizeof(unsigned int *), MEM_ROUTING)))
+      ReportError((char *) Routine, 1);
+    for (i=0; i<Map->NY; i++) {
+      if (!(SubTotalDir[i] = (unsigned int *)TrackCalloc(Map->NX, sizeof(unsigned int), MEM_ROUTING)))
+        ReportError((char *) Routine, 1);
+    }
+    
+    if (!(RefWaterLevel = (float **)TrackCalloc(Map->NY, sizeof(float *), MEM_ROUTING)))
+      ReportError((char *) Routine, 1);
+    if (!(Recompute = (unsigned char **)TrackCalloc(Map->NY, sizeof(unsigned char *), MEM_ROUTING)))
+      ReportError((char *) Routine, 1);
+    for (i=0; i<Map->NY; i++) {
+      if (!(RefWaterLevel[i] = (float *)TrackCalloc(Map->NX, sizeof(float), MEM_ROUTING)))
+        ReportError((char *) Routine, 1);
+      if (!(Recompute[i] = (unsigned char *)TrackCalloc(Map->NX, sizeof(unsigned char), MEM_ROUTING)))
+        ReportError((char *) Routine, 1);
+    }
+    
+    if (!(SubOrder = (unsigned char ***)TrackCalloc(Map->NY, sizeof(unsigned char **), MEM_ROUTING)))
       ReportError((char *) Routine, 1);
+    if (!(SubNFlow = (unsigned char **)TrackCalloc(Map->NY, sizeof(unsigned char *), MEM_ROUTING)))
+      ReportError((char *) Routine, 1);
+    if (!(OrderValid = (unsigned char **)TrackCalloc(Map->NY, sizeof(unsigned char *), MEM_ROUTING)))
+      ReportError((char *) Routine, 1);
+    for (i=0; i<Map->NY; i++) {
+      if (!(SubOrder[i] = (unsigned char **)TrackCalloc(Map->NX, sizeof(unsigned char *), MEM_ROUTING)))
+        ReportError((char *) Routine, 1);
+      for (j=0; j<Map->NX; j++) {
+        if (!(SubOrder[i][j] = (unsigned char *)TrackCalloc(NDIRS, sizeof(unsigned char), MEM_ROUTING)))
+          ReportError((char *) Routine, 1);
+      }
+      if (!(SubNFlow[i] = (unsigned char *)TrackCalloc(Map->NX, sizeof(unsigned char), MEM_ROUTING)))
+        ReportError((char *) Routine, 1);
+      if (!(OrderValid[i] = (unsigned char *)TrackCalloc(Map->NX, sizeof(unsigned char), MEM_ROUTING)))
+        ReportError((char *) Routine, 1);
+    }
+    
+    if (Options->SatFlowSolver == IMPLICIT) {
+      if (!(CellTransmissivity = (float *)TrackCalloc(Map->NumCells, sizeof(float), MEM_ROUTING)))
+        ReportError((char *) Routine, 1);
+      if (!(CellSpecificYield = (float *)TrackCalloc(Map->NumCells, sizeof(float), MEM_ROUTING)))
+        ReportError((char *) Routine, 1);
+      if (!(CellAvailableWater = (float *)TrackCalloc(Map->NumCells, sizeof(float), MEM_ROUTING)))
+        ReportError((char *) Routine, 1);
+    }
+  }
+  
+  Implicit = (Options->SatFlowSolver == IMPLICIT);
+  if (Implicit) {
+    /* Cells without lateral outflow keep zero inputs, as on the first step */
+    memset(CellTransmissivity, 0, Map->NumCells * sizeof(float));
+    memset(CellSpecificYield, 0, Map->NumCells * sizeof(float));
+    memset(CellAvailableWater, 0, Map->NumCells * sizeof(float));
   }
   
   /* Reset the saturated subsurface flow to zero,
@@ -163,9 +239,15 @@ void RouteSubSurface(int Dt, MAPSIZE *Map, TOPOPIX **TopoMap,
     
     SoilMap[y][x].SatFlow = 0.0;
     
+    /* The water table does not change in this routine, so the cells of the
+       saturation extent are counted here */
+    mgrid = (SoilMap[y][x].Depth - SoilMap[y][x].TableDepth)/SoilMap[y][x].Depth;
+    if (mgrid > MTHRESH)
+      count += 1;
+    
     SoilMap[y][x].WaterLevel = TopoMap[y][x].Dem - SoilMap[y][x].TableDepth;
     
-    if (Options->FlowGradient == WATERTABLE) {
+    if (Options->FlowGradient == WATERTABLE && !Implicit) {
       flag = 0;
       for (k = 0; k < NDIRS; k++) {
         nx = xdirection[k] + x;
@@ -189,14 +271,40 @@ void RouteSubSurface(int Dt, MAPSIZE *Map, TOPOPIX **TopoMap,
       
       SoilMap[y][x].WaterLevelLast = SoilMap[y][x].WaterLevel;
     } /* End of water table adjustments */
+    else if (Implicit)
+      SoilMap[y][x].WaterLevelLast = SoilMap[y][x].WaterLevel;
   }
   
   /* Calculate flow directions and gradient */
-  if (Options->FlowGradient == WATERTABLE) {
-    for (q = (Map->NumCells - 1); q > -1;  q--)
-      HeadSlopeAspect(Map, TopoMap, SoilMap, SubFlowGrad, SubDir, SubTotalDir, Options->MultiFlowDir,
-                      Map->OrderedCells[q].x, Map->OrderedCells[q].y);
+  if (Options->FlowGradient == WATERTABLE && !Implicit) {
+    /* Flag cells whose water level moved beyond the tolerance, and their neighbors */
+    for (q = (Map->NumCells - 1); q > -1;  q--) {
+      y = Map->OrderedCells[q].y;
+      x = Map->OrderedCells[q].x;
+      if (FirstStep ||
+          ABSVAL(SoilMap[y][x].WaterLevel - RefWaterLevel[y][x]) > Options->HeadSlopeTol) {
+        RefWaterLevel[y][x] = SoilMap[y][x].WaterLevel;
+        Recompute[y][x] = TRUE;
+        for (n = 0; n < NNEIGHBORS; n++) {
+          nx = xneighbor[n] + x;
+          ny = yneighbor[n] + y;
+          if (valid_cell(Map, nx, ny))
+            Recompute[ny][nx] = TRUE;
+        }
+      }
+    }
+    for (q = (Map->NumCells - 1); q > -1;  q--) {
+      y = Map->OrderedCells[q].y;
+      x = Map->OrderedCells[q].x;
+      if (Recompute[y][x]) {
+        HeadSlopeAspect(Map, TopoMap, SoilMap, SubFlowGrad, SubDir, SubTotalDir, Options->MultiFlowDir,
+                        x, y);
+        Recompute[y][x] = FALSE;
+        OrderValid[y][x] = FALSE;
+      }
+    }
   }
+  FirstStep = FALSE;
   
   /* Next sweep through all the grid cells (by descending elevation),
      calculate the amount of flow in each direction,
@@ -247,6 +355,26 @@ void RouteSubSurface(int Dt, MAPSIZE *Map, TOPOPIX **TopoMap,
                          SoilMap[y][x].Depth, VType[VegMap[y][x].Veg - 1].RootDepth,
                          SoilMap[y][x].Porosity, SoilMap[y][x].FCap, SoilMap[y][x].Moist,
                          AdjTableDepth, Adjust);
+      
+      if (Implicit) {
+        CellTransmissivity[q] = Transmissivity;
+        
+        /* Drainable porosity of the layer containing the water table */
+        i = 0;
+        Depth = 0.0;
+        while (i < SType[SoilMap[y][x].Soil - 1].NLayers && Depth < AdjTableDepth) {
+          if (VType[VegMap[y][x].Veg - 1].RootDepth[i] < (SoilMap[y][x].Depth - Depth))
+            Depth += VType[VegMap[y][x].Veg - 1].RootDepth[i];
+          else
+            Depth = SoilMap[y][x].Depth;
+          i++;
+        }
+        if (Depth > AdjTableDepth)
+          i--;
+        if (i < 0)
+          i = 0;
+        CellSpecificYield[q] = (SoilMap[y][x].Porosity[i] - SoilMap[y][x].FCap[i]) * Adjust[i];
+      }
     }
     else
       OutFlow = 0.0f;
@@ -346,6 +474,12 @@ void RouteSubSurface(int Dt, MAPSIZE *Map, TOPOPIX **TopoMap,
     SoilMap[y][x].DeepFlux = DeepFlux;
     AvailableWater += DeepFlux;
     
+    /* Lateral flow between cells is solved for all cells at once below */
+    if (Implicit) {
+      CellAvailableWater[q] = (AdjTableDepth < SoilMap[y][x].Depth) ? AvailableWater : 0.0;
+      continue;
+    }
+    
     /* Subsurface lateral outflow */
     OutFlow = (OutFlow > AvailableWater) ? AvailableWater : OutFlow;
     if (OutFlow < 0.0)
@@ -357,27 +491,21 @@ void RouteSubSurface(int Dt, MAPSIZE *Map, TOPOPIX **TopoMap,
     else
       OutFlow = 0.;
     
-    /* Sort flow directions in order of gradient */
-    for (k = 0; k < NDIRS; k++) {
-      nx = xdirection[k] + x;
-      ny = ydirection[k] + y;
-      kOrdered[k].x = nx;
-      kOrdered[k].y = ny;
-      if (valid_cell(Map, nx, ny))
-        kOrdered[k].Rank = (float) SubDir[y][x][k];
-      else
-        kOrdered[k].Rank = 0.0;
+    /* Flow directions in order of gradient; directions without flow are skipped */
+    if (!OrderValid[y][x]) {
+      OrderFlowDirections(Map, SubDir[y][x], x, y, SubOrder[y][x], &(SubNFlow[y][x]));
+      OrderValid[y][x] = TRUE;
     }
     
-    quick(kOrdered, NDIRS);
-    
-    for (k = (NDIRS - 1); k > -1; k--) {
-      nx = kOrdered[k].x;
-      ny = kOrdered[k].y;
+    LayerIter = 0;
+    for (k = (NDIRS - 1); k >= (NDIRS - SubNFlow[y][x]); k--) {
+      d = SubOrder[y][x][k];
+      nx = xdirection[d] + x;
+      ny = ydirection[d] + y;
       
       if (valid_cell(Map, nx, ny) && INBASIN(TopoMap[ny][nx].Mask)) {
         
-        PotentialSatFlow = OutFlow * kOrdered[k].Rank;
+        PotentialSatFlow = OutFlow * (float) SubDir[y][x][d];
         
         if (Options->FlowGradient != WATERTABLE ||
            (TopoMap[y][x].Dem - SoilMap[y][x].Depth) > TopoMap[ny][nx].Dem) {
@@ -407,6 +535,7 @@ void RouteSubSurface(int Dt, MAPSIZE *Map, TOPOPIX **TopoMap,
           while (AdjWaterLevelK < AdjWaterLevel && PotentialSatFlow > 0.0
                 && i <= SType[SoilMap[y][x].Soil - 1].NLayers) {
             
+            LayerIter++;
             if (i < SType[SoilMap[y][x].Soil - 1].NLayers) {
               LayerContribWater = (SoilMap[y][x].Moist[i] - SoilMap[y][x].FCap[i]) *
                                   Adjust[i] * VType[VegMap[y][x].Veg - 1].RootDepth[i];
@@ -446,6 +575,7 @@ void RouteSubSurface(int Dt, MAPSIZE *Map, TOPOPIX **TopoMap,
             while (AdjWaterLevelK < AdjWaterLevel && LayerContribWater > 0.0 &&
                   j >= 0) {
               
+              LayerIter++;
               LayerContribWaterK = LayerContribWater;
               
               if (j < SType[SoilMap[ny][nx].Soil - 1].NLayers) {
@@ -522,61 +652,41 @@ void RouteSubSurface(int Dt, MAPSIZE *Map, TOPOPIX **TopoMap,
         SoilMap[y][x].SatFlow -= ActualSatFlow;
       }
     }
+    if (LayerIter > 0)
+      CountEvent(CNT_LAYERMATCH, y, x, LayerIter);
   }
   
- for(i=0; i<Map->NY; i++) { 
-    free(SubTotalDir[i]);
-    free(SubFlowGrad[i]);
-    for(j=0; j<Map->NX; j++){
-      free(SubDir[i][j]);
-    }
-    free(SubDir[i]);
+  if (Implicit) {
+    RouteSubSurfaceImplicit(Dt, Map, TopoMap, SoilMap, CellTransmissivity,
+                            CellSpecificYield, CellAvailableWater);
   }
-  free(SubDir);
-  free(SubTotalDir);
-  free(SubFlowGrad);
-
+  
   /**********************************************************************/
-  /* Dump saturation extent file to screen.
+  /* Write the saturation extent.
      Saturation extent is based on the number of pixels with a water table 
      that is at least MTHRESH of soil depth. */ 
   
-  count =0;
-  totalcount = 0;
-  for (y = 0; y < Map->NY; y++) {
-    for (x = 0; x < Map->NX; x++) {
-      if (INBASIN(TopoMap[y][x].Mask)) {
-	     mgrid = (SoilMap[y][x].Depth - SoilMap[y][x].TableDepth)/SoilMap[y][x].Depth;
-	     if (mgrid > MTHRESH) 
-		   count += 1;
-		 totalcount += 1;
-      }
-    }
-  }
- 
-  sat = 100.*((float)count/(float)totalcount);
-  
-  sprintf(satoutfile, "%ssaturation_extent.txt", DumpPath);
-  
-  if((fs = fopen(satoutfile,"a")) == NULL){
-    printf("Cannot open saturation extent output file.\n");
-    exit(0);
-  }
-  
-  SPrintDate(&(Time->Current), buffer);
-  fprintf(fs, "%-20s %.4f \n", buffer, sat); 
-  fclose(fs);    
+  sat = 100.*((float)count/(float)Map->NumCells);
+  DiagLog(DIAG_SATEXTENT, &(Time->Current), sat);
 }
 
 /*******************************************************************************
   Simplified/condensed subsurface routing scheme used during spinup
+ 
+  Relax scales the net daily flux (lateral exchange plus recharge) before it
+  is applied to the soil column, i.e. an over-relaxed fixed-point iteration
+  toward the steady-state water table. Relax = 1 reproduces the plain scheme.
+ 
+  Returns the largest absolute change in water table depth (m) over all
+  cells, which the caller uses to detect convergence.
 *******************************************************************************/
 
-void RouteSubSurfaceSpinup(int Dt, MAPSIZE *Map, TOPOPIX **TopoMap,
+float RouteSubSurfaceSpinup(int Dt, MAPSIZE *Map, TOPOPIX **TopoMap,
 		     VEGTABLE *VType, VEGPIX **VegMap,
 		     NETSTRUCT **Network, SOILTABLE *SType,
 		     SOILPIX **SoilMap, OPTIONSTRUCT *Options,
-		     float **SubFlowGrad, unsigned char ***SubDir, unsigned int **SubTotalDir)
+		     float **SubFlowGrad, unsigned char ***SubDir, unsigned int **SubTotalDir,
+		     float Relax)
 {
   int x, nx;			/* counters */
   int y, ny;			/* counters */
@@ -585,6 +695,9 @@ void RouteSubSurfaceSpinup(int Dt, MAPSIZE *Map, TOPOPIX **TopoMap,
   float Transmissivity;
   float TotalAvailableWater = 0.0;
   float ActualSatFlow;
+  float OldTableDepth;
+  float DeltaTableDepth;
+  float MaxDeltaTableDepth = 0.0;
   int k, q;
   
   /* Reset the saturated subsurface flow to zero 
@@ -676,6 +789,9 @@ void RouteSubSurfaceSpinup(int Dt, MAPSIZE *Map, TOPOPIX **TopoMap,
     
     /* Add constant recharge */
     SoilMap[y][x].SatFlow += Options->GW_SPINUP_RECHARGE;
+    SoilMap[y][x].SatFlow *= Relax;
+    
+    OldTableDepth = SoilMap[y][x].TableDepth;
     
     DistributeSatflow(Dt, Map->DX, Map->DX, SoilMap[y][x].SatFlow,
                       SType[SoilMap[y][x].Soil - 1].NLayers, SoilMap[y][x].Depth, VType[VegMap[y][x].Veg - 1].RootDepth,
@@ -686,6 +802,11 @@ void RouteSubSurfaceSpinup(int Dt, MAPSIZE *Map, TOPOPIX **TopoMap,
     SoilMap[y][x].TableDepth = WaterTableDepth(SType[SoilMap[y][x].Soil - 1].NLayers, SoilMap[y][x].Depth,
                                                VType[VegMap[y][x].Veg - 1].RootDepth, SoilMap[y][x].Porosity, SoilMap[y][x].FCap,
                                                Network[y][x].Adjust, SoilMap[y][x].Moist);
-      
+    
+    DeltaTableDepth = ABSVAL(SoilMap[y][x].TableDepth - OldTableDepth);
+    if (DeltaTableDepth > MaxDeltaTableDepth)
+      MaxDeltaTableDepth = DeltaTableDepth;
   }
+  
+  return MaxDeltaTableDepth;
 }
@@ -0,0 +1,418 @@
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "settings.h"
+#include "data.h"
+#include "DHSVMerror.h"
+#include "functions.h"
+#include "constants.h"
+#include "slopeaspect.h"
+
+#define SATSOLVER_TOL      1e-8   /* Relative residual at which the PCG iteration stops */
+#define SATSOLVER_MAXITER  1000   /* Maximum number of PCG iterations per time step */
+#define MIN_SPECIFIC_YIELD 1e-3   /* Lower bound on drainable porosity to keep the system well conditioned */
+
+/* Sparse (CSR) system for the saturated zone.  The structure (which active
+   cells are connected) only depends on the basin mask, so it is built on
+   the first call and reused for all later time steps; only the values and
+   the incomplete Cholesky factor are recomputed each step. Rows follow the
+   order of Map->OrderedCells. */
+typedef struct {
+  int N;              /* Number of active cells (rows) */
+  int NNZ;            /* Number of stored entries */
+  int *RowPtr;        /* Start of each row in ColIdx/Val, N + 1 in size */
+  int *ColIdx;        /* Column of each entry, sorted within each row */
+  int *DiagIdx;       /* Position of the diagonal entry of each row */
+  float *Geometry;    /* Flow width / flow distance for each off-diagonal entry */
+  double *Val;        /* Matrix values */
+  double *LVal;       /* Lower triangle of the IC(0) factor, same layout as Val */
+  double *Head;       /* Water level at the start of the step (m) */
+  double *dHead;      /* Solution: change in water level over the step (m) */
+  double *r, *z, *p, *Ap;  /* PCG work vectors */
+} SATSYSTEM;
+
+static SATSYSTEM Sat;
+static char SatInitialized = FALSE;
+
+static void BuildSatSystem(MAPSIZE *Map, TOPOPIX **TopoMap);
+static int FactorSatSystem(void);
+static void ApplyPreconditioner(double *r, double *z);
+static int SolveSatSystem(double *b, double *x);
+
+/*****************************************************************************
+  Function name: RouteSubSurfaceImplicit()
+
+  Purpose      : Compute the lateral saturated flow between grid cells with
+                 a semi-implicit (backward Euler) finite-volume scheme
+                 instead of the explicit downslope sweep in RouteSubSurface()
+
+  Required     :
+    int Dt                 - Model time step (s)
+    MAPSIZE *Map           - Size and cell ordering of the model area
+    TOPOPIX **TopoMap      - Terrain information
+    SOILPIX **SoilMap      - Soil information; WaterLevel must be current
+    float *Transmissivity  - Transmissivity of each cell (m2/s), OrderedCells order
+    float *SpecificYield   - Drainable porosity at the water table, OrderedCells order
+    float *AvailableWater  - Water available for lateral outflow (m), OrderedCells order
+
+  Modifies     :
+    SoilMap[y][x].SatFlow  - Net lateral exchange is added (m)
+
+  Comments     :
+    For each pair of active neighbors i, j the flux is
+      Q_ij = C_ij * (h_i - h_j),  C_ij = 0.5 * (T_i + T_j) * w_ij / d_ij
+    with flow width w_ij = DX * PI/8 and distance d_ij = DX or DXY for the
+    8-neighbor case (consistent with flow_fractions()), and w = d = DX for
+    the 4-neighbor case.  Transmissivity is lagged (taken at the start of
+    the step), which gives the symmetric positive definite system
+      (S_i A / Dt + sum_j C_ij) dh_i - sum_j C_ij dh_j = -sum_j C_ij (h_i - h_j)
+    that is solved with conjugate gradients preconditioned by an
+    incomplete Cholesky factorization, IC(0).  Solving for the change in
+    head rather than the head itself avoids losing millimetre changes
+    against water levels of thousands of metres.
+
+    Being unconditionally stable, this needs neither the WaterLevelLast
+    averaging nor the layer-by-layer water level matching used by the
+    explicit WATERTABLE scheme.  After the solve, outgoing fluxes from
+    a cell are scaled back if they would exceed the water available in
+    its saturated zone.  Each flux is added to one cell and removed from
+    its neighbor, so the exchange conserves mass exactly.
+*****************************************************************************/
+void RouteSubSurfaceImplicit(int Dt, MAPSIZE *Map, TOPOPIX **TopoMap,
+                             SOILPIX **SoilMap, float *Transmissivity,
+                             float *SpecificYield, float *AvailableWater)
+{
+  const char *Routine = "RouteSubSurfaceImplicit";
+  int i, j, k;
+  int x, y, nx, ny;
+  int NIter;
+  double Area;
+  double Conductance;
+  double Diag;
+  double Flux;
+  double *OutFlux;     /* Total potential outflow of each cell (m) */
+  double *Limiter;     /* Fraction of potential outflow each cell can supply */
+
+  if (!SatInitialized) {
+    BuildSatSystem(Map, TopoMap);
+    SatInitialized = TRUE;
+  }
+
+  Area = Map->DX * Map->DY;
+
+  /* Assemble the matrix and right-hand side */
+  for (i = 0; i < Sat.N; i++) {
+    y = Map->OrderedCells[i].y;
+    x = Map->OrderedCells[i].x;
+    Sat.Head[i] = SoilMap[y][x].WaterLevel;
+  }
+  for (i = 0; i < Sat.N; i++) {
+    Diag = MAX(SpecificYield[i], MIN_SPECIFIC_YIELD) * Area / Dt;
+    Sat.r[i] = 0.0;
+    for (k = Sat.RowPtr[i]; k < Sat.RowPtr[i + 1]; k++) {
+      j = Sat.ColIdx[k];
+      if (j == i)
+        continue;
+      Conductance = 0.5 * (Transmissivity[i] + Transmissivity[j]) * Sat.Geometry[k];
+      Sat.Val[k] = -Conductance;
+      Diag += Conductance;
+      Sat.r[i] -= Conductance * (Sat.Head[i] - Sat.Head[j]);
+    }
+    Sat.Val[Sat.DiagIdx[i]] = Diag;
+  }
+
+  if (!FactorSatSystem())
+    ReportError((char *) Routine, 14);
+
+  NIter = SolveSatSystem(Sat.r, Sat.dHead);
+  if (NIter < 0)
+    printf("WARNING: saturated flow solver did not converge in %d iterations\n",
+           SATSOLVER_MAXITER);
+
+  /* Pairwise fluxes at the end of the step, limited by available water */
+  if (!(OutFlux = (double *)calloc(Sat.N, sizeof(double))))
+    ReportError((char *) Routine, 1);
+  if (!(Limiter = (double *)calloc(Sat.N, sizeof(double))))
+    ReportError((char *) Routine, 1);
+
+  for (i = 0; i < Sat.N; i++) {
+    for (k = Sat.RowPtr[i]; k < Sat.RowPtr[i + 1]; k++) {
+      j = Sat.ColIdx[k];
+      if (j == i)
+        continue;
+      Flux = -Sat.Val[k] * ((Sat.Head[i] + Sat.dHead[i]) - (Sat.Head[j] + Sat.dHead[j])) * Dt / Area;
+      if (Flux > 0.0)
+        OutFlux[i] += Flux;
+    }
+    if (OutFlux[i] > AvailableWater[i])
+      Limiter[i] = (AvailableWater[i] > 0.0) ? AvailableWater[i] / OutFlux[i] : 0.0;
+    else
+      Limiter[i] = 1.0;
+  }
+
+  for (i = 0; i < Sat.N; i++) {
+    y = Map->OrderedCells[i].y;
+    x = Map->OrderedCells[i].x;
+    for (k = Sat.RowPtr[i]; k < Sat.RowPtr[i + 1]; k++) {
+      j = Sat.ColIdx[k];
+      if (j == i)
+        continue;
+      Flux = -Sat.Val[k] * ((Sat.Head[i] + Sat.dHead[i]) - (Sat.Head[j] + Sat.dHead[j])) * Dt / Area;
+      if (Flux > 0.0) {
+        Flux *= Limiter[i];
+        ny = Map->OrderedCells[j].y;
+        nx = Map->OrderedCells[j].x;
+        SoilMap[y][x].SatFlow -= (float) Flux;
+        SoilMap[ny][nx].SatFlow += (float) Flux;
+      }
+    }
+  }
+
+  free(OutFlux);
+  free(Limiter);
+}
+
+/*****************************************************************************
+  BuildSatSystem()
+
+  Number the active cells, find the active neighbors of each cell and
+  allocate the CSR arrays and work vectors.
+*****************************************************************************/
+static void BuildSatSystem(MAPSIZE *Map, TOPOPIX **TopoMap)
+{
+  const char *Routine = "BuildSatSystem";
+  int **CellIndex;
+  int i, k, m, n, x, y, nx, ny;
+  int Cols[MAXDIRS + 1];
+  float Geom[MAXDIRS + 1];
+  float Width;
+  float Distance;
+  int TmpCol;
+  float TmpGeom;
+
+  if (!(CellIndex = (int **)calloc(Map->NY, sizeof(int *))))
+    ReportError((char *) Routine, 1);
+  for (y = 0; y < Map->NY; y++) {
+    if (!(CellIndex[y] = (int *)calloc(Map->NX, sizeof(int))))
+      ReportError((char *) Routine, 1);
+    for (x = 0; x < Map->NX; x++)
+      CellIndex[y][x] = -1;
+  }
+  for (i = 0; i < Map->NumCells; i++)
+    CellIndex[Map->OrderedCells[i].y][Map->OrderedCells[i].x] = i;
+
+  Sat.N = Map->NumCells;
+  if (!(Sat.RowPtr = (int *)calloc(Sat.N + 1, sizeof(int))))
+    ReportError((char *) Routine, 1);
+  if (!(Sat.DiagIdx = (int *)calloc(Sat.N, sizeof(int))))
+    ReportError((char *) Routine, 1);
+  if (!(Sat.ColIdx = (int *)calloc(Sat.N * (NDIRS + 1), sizeof(int))))
+    ReportError((char *) Routine, 1);
+  if (!(Sat.Geometry = (float *)calloc(Sat.N * (NDIRS + 1), sizeof(float))))
+    ReportError((char *) Routine, 1);
+
+  Sat.NNZ = 0;
+  for (i = 0; i < Sat.N; i++) {
+    y = Map->OrderedCells[i].y;
+    x = Map->OrderedCells[i].x;
+
+    n = 0;
+    Cols[n] = i;
+    Geom[n] = 0.0;
+    n++;
+    for (k = 0; k < NDIRS; k++) {
+      nx = xdirection[k] + x;
+      ny = ydirection[k] + y;
+      if (valid_cell(Map, nx, ny) && INBASIN(TopoMap[ny][nx].Mask)) {
+        if (NDIRS == 8) {
+          Width = Map->DX * PI / 8;
+          Distance = (xdirection[k] != 0 && ydirection[k] != 0) ? Map->DXY : Map->DX;
+        }
+        else {
+          Width = Map->DX;
+          Distance = Map->DX;
+        }
+        Cols[n] = CellIndex[ny][nx];
+        Geom[n] = Width / Distance;
+        n++;
+      }
+    }
+
+    /* Sort the (at most nine) entries of the row by column */
+    for (k = 1; k < n; k++) {
+      TmpCol = Cols[k];
+      TmpGeom = Geom[k];
+      for (m = k - 1; m >= 0 && Cols[m] > TmpCol; m--) {
+        Cols[m + 1] = Cols[m];
+        Geom[m + 1] = Geom[m];
+      }
+      Cols[m + 1] = TmpCol;
+      Geom[m + 1] = TmpGeom;
+    }
+
+    Sat.RowPtr[i] = Sat.NNZ;
+    for (k = 0; k < n; k++) {
+      if (Cols[k] == i)
+        Sat.DiagIdx[i] = Sat.NNZ;
+      Sat.ColIdx[Sat.NNZ] = Cols[k];
+      Sat.Geometry[Sat.NNZ] = Geom[k];
+      Sat.NNZ++;
+    }
+  }
+  Sat.RowPtr[Sat.N] = Sat.NNZ;
+
+  if (!(Sat.Val = (double *)calloc(Sat.NNZ, sizeof(double))))
+    ReportError((char *) Routine, 1);
+  if (!(Sat.LVal = (double *)calloc(Sat.NNZ, sizeof(double))))
+    ReportError((char *) Routine, 1);
+  if (!(Sat.Head = (double *)calloc(Sat.N, sizeof(double))))
+    ReportError((char *) Routine, 1);
+  if (!(Sat.dHead = (double *)calloc(Sat.N, sizeof(double))))
+    ReportError((char *) Routine, 1);
+  if (!(Sat.r = (double *)calloc(Sat.N, sizeof(double))))
+    ReportError((char *) Routine, 1);
+  if (!(Sat.z = (double *)calloc(Sat.N, sizeof(double))))
+    ReportError((char *) Routine, 1);
+  if (!(Sat.p = (double *)calloc(Sat.N, sizeof(double))))
+    ReportError((char *) Routine, 1);
+  if (!(Sat.Ap = (double *)calloc(Sat.N, sizeof(double))))
+    ReportError((char *) Routine, 1);
+
+  for (y = 0; y < Map->NY; y++)
+    free(CellIndex[y]);
+  free(CellIndex);
+}
+
+/*****************************************************************************
+  FactorSatSystem()
+
+  Incomplete Cholesky factorization with zero fill-in, A ~ L L^T, where L
+  has the sparsity pattern of the lower triangle of A.  The matrix is a
+  diagonally dominant M-matrix, for which IC(0) does not break down; a
+  non-positive pivot is nevertheless caught and reported.  Returns FALSE
+  on breakdown.
+*****************************************************************************/
+static int FactorSatSystem(void)
+{
+  int i, k, kk, a, b;
+  double Sum;
+
+  for (i = 0; i < Sat.N; i++) {
+    for (k = Sat.RowPtr[i]; k < Sat.DiagIdx[i]; k++) {
+      kk = Sat.ColIdx[k];
+      /* Sum over columns common to rows i and kk that are left of kk */
+      Sum = Sat.Val[k];
+      a = Sat.RowPtr[i];
+      b = Sat.RowPtr[kk];
+      while (a < k && b < Sat.DiagIdx[kk]) {
+        if (Sat.ColIdx[a] == Sat.ColIdx[b]) {
+          Sum -= Sat.LVal[a] * Sat.LVal[b];
+          a++;
+          b++;
+        }
+        else if (Sat.ColIdx[a] < Sat.ColIdx[b])
+          a++;
+        else
+          b++;
+      }
+      Sat.LVal[k] = Sum / Sat.LVal[Sat.DiagIdx[kk]];
+    }
+    Sum = Sat.Val[Sat.DiagIdx[i]];
+    for (k = Sat.RowPtr[i]; k < Sat.DiagIdx[i]; k++)
+      Sum -= Sat.LVal[k] * Sat.LVal[k];
+    if (Sum <= 0.0)
+      return FALSE;
+    Sat.LVal[Sat.DiagIdx[i]] = sqrt(Sum);
+  }
+  return TRUE;
+}
+
+/*****************************************************************************
+  ApplyPreconditioner()
+
+  z = (L L^T)^-1 r by a forward and a backward triangular solve
+*****************************************************************************/
+static void ApplyPreconditioner(double *r, double *z)
+{
+  int i, k;
+  double Sum;
+
+  for (i = 0; i < Sat.N; i++) {
+    Sum = r[i];
+    for (k = Sat.RowPtr[i]; k < Sat.DiagIdx[i]; k++)
+      Sum -= Sat.LVal[k] * z[Sat.ColIdx[k]];
+    z[i] = Sum / Sat.LVal[Sat.DiagIdx[i]];
+  }
+
+  /* L^T is traversed by columns of the stored rows of L */
+  for (i = Sat.N - 1; i >= 0; i--) {
+    z[i] /= Sat.LVal[Sat.DiagIdx[i]];
+    for (k = Sat.RowPtr[i]; k < Sat.DiagIdx[i]; k++)
+      z[Sat.ColIdx[k]] -= Sat.LVal[k] * z[i];
+  }
+}
+
+/*****************************************************************************
+  SolveSatSystem()
+
+  Preconditioned conjugate gradients for A x = b, starting from x = 0.
+  b is overwritten with the residual.  Returns the number of iterations,
+  or -1 if the tolerance was not reached.
+*****************************************************************************/
+static int SolveSatSystem(double *b, double *x)
+{
+  int i, k, Iter;
+  double Alpha, Beta;
+  double rz, rzOld;
+  double pAp;
+  double Norm0, Norm;
+  double *r = b;
+
+  Norm0 = 0.0;
+  for (i = 0; i < Sat.N; i++) {
+    x[i] = 0.0;
+    Norm0 += r[i] * r[i];
+  }
+  Norm0 = sqrt(Norm0);
+  if (Norm0 == 0.0)
+    return 0;
+
+  ApplyPreconditioner(r, Sat.z);
+  rz = 0.0;
+  for (i = 0; i < Sat.N; i++) {
+    Sat.p[i] = Sat.z[i];
+    rz += r[i] * Sat.z[i];
+  }
+
+  for (Iter = 1; Iter <= SATSOLVER_MAXITER; Iter++) {
+    pAp = 0.0;
+    for (i = 0; i < Sat.N; i++) {
+      Sat.Ap[i] = 0.0;
+      for (k = Sat.RowPtr[i]; k < Sat.RowPtr[i + 1]; k++)
+        Sat.Ap[i] += Sat.Val[k] * Sat.p[Sat.ColIdx[k]];
+      pAp += Sat.p[i] * Sat.Ap[i];
+    }
+    Alpha = rz / pAp;
+
+    Norm = 0.0;
+    for (i = 0; i < Sat.N; i++) {
+      x[i] += Alpha * Sat.p[i];
+      r[i] -= Alpha * Sat.Ap[i];
+      Norm += r[i] * r[i];
+    }
+    if (sqrt(Norm) <= SATSOLVER_TOL * Norm0)
+      return Iter;
+
+    ApplyPreconditioner(r, Sat.z);
+    rzOld = rz;
+    rz = 0.0;
+    for (i = 0; i < Sat.N; i++)
+      rz += r[i] * Sat.z[i];
+    Beta = rz / rzOld;
+    for (i = 0; i < Sat.N; i++)
+      Sat.p[i] = Sat.z[i] + Beta * Sat.p[i];
+  }
+
+  return -1;
+}
@@ -8,6 +8,7 @@
 #include "DHSVMerror.h"
 #include "functions.h"
 #include "constants.h"
+#include "counters.h"
 /*****************************************************************************
 RouteSurface()
 If the watertable calculated in WaterTableDepth() was negative, then water is
@@ -183,6 +184,7 @@ void RouteSurface(MAPSIZE * Map, TIMESTRUCT * Time, TOPOPIX ** TopoMap,
           /* Only compute kinematic routing parameters for cells with non-zero runoff */
           if (SoilMap[y][x].IExcess > 0.0 || Runon[y][x] > 0.0){
             
+            CountEvent(CNT_SURFACESTEP, y, x, 1);
             outflow = SoilMap[y][x].startRunoff;
             
             slope = TopoMap[y][x].Slope;
@@ -297,6 +299,7 @@ float FindDT(SOILPIX **SoilMap, MAPSIZE *Map, TIMESTRUCT *Time,
   double Ck;
   float DT, minDT;
   float numinc;
+  int ymin = -1, xmin = -1;     /* Pixel that sets the time step */
   minDT = 36000.;
   
   for (y = 0; y < Map->NY; y++) {
@@ -313,8 +316,11 @@ float FindDT(SOILPIX **SoilMap, MAPSIZE *Map, TIMESTRUCT *Time,
           /* Calculate flow velocity from discharge  using Manning's equation */
           Ck = 1. / (alpha * beta * pow((double) SoilMap[y][x].Runoff, beta - 1.));
           
-          if((Map->DX / Ck) < minDT)
+          if((Map->DX / Ck) < minDT) {
             minDT = Map->DX / Ck;
+            ymin = y;
+            xmin = x;
+          }
         }
       }
     }
@@ -326,5 +332,11 @@ float FindDT(SOILPIX **SoilMap, MAPSIZE *Map, TIMESTRUCT *Time,
   if(DT > Time->Dt)
     DT = (float) Time->Dt;
   
+  /* The pixel only limits the time step if more than one sub-step is needed */
+  if (numinc > 1.0)
+    CountSubSteps((int) numinc, ymin, xmin);
+  else
+    CountSubSteps(1, -1, -1);
+  
   return DT;
 }
@@ -0,0 +1,215 @@
+/*
+ * SUMMARY:      ShadeStream.c - Streamed terrain shading maps
+ * USAGE:        Part of DHSVM
+ *
+ * DESCRIPTION:  Without streaming, InitNewMonth() reads the shade factors of
+ *               every time step of the day (<SHADING DATA PATH>.<MM>.<ext>)
+ *               into memory at the start of each month, i.e. NDaySteps maps
+ *               of NY x NX bytes.  With [OPTIONS] STREAM SHADING = TRUE only
+ *               two maps are held: the one of the current time step and the
+ *               one of the next time step, which a background thread reads
+ *               while the model computes the current step.
+ *
+ *               The monthly file stays open between time steps and is read
+ *               with pread(), so that the processes forked in a forecast
+ *               run can share the descriptor.  ShadowMap keeps its layout:
+ *               the rows of ShadowMap[DayStep] point into the map of the
+ *               current time step, the rows of the other steps are NULL.
+ *
+ *               The shade files must be in the plain binary format.  A
+ *               compressed file (see FileIOZip.c) is rejected, because the
+ *               decoder is not safe to run in the background thread; such a
+ *               file can be read without streaming or converted with
+ *               DHSVM_MapToBin.
+ */
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "settings.h"
+#include "data.h"
+#include "DHSVMerror.h"
+#include "memtrack.h"
+#include "shadestream.h"
+#include "fifozip.h"
+
+/* A shade map in memory, tagged with the month and the time step of the day
+   it holds (Month 0 if it holds none) */
+typedef struct {
+  int Month;
+  int DayStep;
+  unsigned char *Grid;
+} SHADEBUFFER;
+
+static SHADEBUFFER Buffer[2];
+static int Current = 0;           /* Buffer of the current time step */
+static int File = -1;             /* Descriptor of the open monthly file */
+static int FileMonth = 0;         /* Month of the open monthly file */
+static char FileName[BUFSIZE * 2 + 5];
+static size_t GridSize = 0;       /* Bytes per map (NY * NX) */
+static int NSteps = 0;            /* NDaySteps */
+static OPTIONSTRUCT *StreamOptions = NULL;
+
+/* Prefetch of the next map by the background thread */
+static pthread_t Prefetch;
+static int Pending = FALSE;       /* TRUE while the thread has not been joined */
+static int PrefetchStatus = 0;    /* ReportError() code of a failed prefetch */
+
+static void WaitPrefetch(void);
+static void *PrefetchMap(void *Arg);
+static int ReadMap(SHADEBUFFER *Map);
+
+/*****************************************************************************
+  InitShadeStream()
+
+  Allocates the row pointers of ShadowMap and the two maps of the stream
+*****************************************************************************/
+void InitShadeStream(int NDaySteps, MAPSIZE *Map, unsigned char ****ShadowMap)
+{
+  const char *Routine = "InitShadeStream";
+  int i, n;
+
+  if (!((*ShadowMap) =
+    (unsigned char ***)TrackCalloc(NDaySteps, sizeof(unsigned char **), MEM_SHADING)))
+    ReportError((char *)Routine, 1);
+  for (n = 0; n < NDaySteps; n++) {
+    if (!((*ShadowMap)[n] =
+      (unsigned char **)TrackCalloc(Map->NY, sizeof(unsigned char *), MEM_SHADING)))
+      ReportError((char *)Routine, 1);
+  }
+
+  GridSize = (size_t) Map->NY * Map->NX;
+  NSteps = NDaySteps;
+  for (i = 0; i < 2; i++) {
+    Buffer[i].Month = 0;
+    Buffer[i].DayStep = -1;
+    if (!(Buffer[i].Grid =
+      (unsigned char *)TrackCalloc(GridSize, sizeof(unsigned char), MEM_SHADING)))
+      ReportError((char *)Routine, 1);
+  }
+
+  /* A forked process must not inherit a read in progress */
+  pthread_atfork(WaitPrefetch, NULL, NULL);
+}
+
+/*****************************************************************************
+  ShadeStreamStep()
+
+  Makes ShadowMap[Time->DayStep] point to the shade map of the current time
+  step and starts reading the map of the next time step
+*****************************************************************************/
+void ShadeStreamStep(OPTIONSTRUCT *Options, MAPSIZE *Map, TIMESTRUCT *Time,
+                     unsigned char ***ShadowMap)
+{
+  TIMESTRUCT Next;
+  SHADEBUFFER *Map0;
+  int ErrorCode;
+  int y;
+
+  StreamOptions = Options;
+  WaitPrefetch();
+  if (PrefetchStatus != 0) {
+    ErrorCode = PrefetchStatus;
+    PrefetchStatus = 0;
+    ReportError(FileName, ErrorCode);
+  }
+
+  if (Buffer[1 - Current].Month == Time->Current.Month &&
+      Buffer[1 - Current].DayStep == Time->DayStep)
+    Current = 1 - Current;
+  Map0 = &Buffer[Current];
+  if (Map0->Month != Time->Current.Month || Map0->DayStep != Time->DayStep) {
+    Map0->Month = Time->Current.Month;
+    Map0->DayStep = Time->DayStep;
+    if ((ErrorCode = ReadMap(Map0)) != 0) {
+      Map0->Month = 0;
+      ReportError(FileName, ErrorCode);
+    }
+  }
+
+  for (y = 0; y < Map->NY; y++)
+    ShadowMap[Time->DayStep][y] = Map0->Grid + (size_t) y * Map->NX;
+
+  /* Read ahead unless this is the last time step of the run */
+  Next = *Time;
+  IncreaseTime(&Next);
+  if (After(&(Next.Current), &(Next.End)))
+    return;
+  Buffer[1 - Current].Month = Next.Current.Month;
+  Buffer[1 - Current].DayStep = Next.DayStep;
+  if (pthread_create(&Prefetch, NULL, PrefetchMap, &Buffer[1 - Current]) == 0)
+    Pending = TRUE;
+  else
+    Buffer[1 - Current].Month = 0;
+}
+
+/*****************************************************************************
+  WaitPrefetch()
+
+  Waits until the background read, if any, has finished
+*****************************************************************************/
+static void WaitPrefetch(void)
+{
+  if (Pending) {
+    pthread_join(Prefetch, NULL);
+    Pending = FALSE;
+  }
+}
+
+/*****************************************************************************
+  PrefetchMap()
+
+  Body of the background thread.  Errors are reported by ShadeStreamStep()
+  in the main thread.
+*****************************************************************************/
+static void *PrefetchMap(void *Arg)
+{
+  SHADEBUFFER *Map = (SHADEBUFFER *) Arg;
+
+  if ((PrefetchStatus = ReadMap(Map)) != 0)
+    Map->Month = 0;
+  return NULL;
+}
+
+/*****************************************************************************
+  ReadMap()
+
+  Reads the shade map of Map->Month and Map->DayStep, opening the file of
+  that month if needed.  If the time step is shorter than an hour, the maps
+  in the file are hourly and a map is used for each time step in the hour,
+  as in ReadShadeMap().  Returns 0 or the ReportError() code of the failure.
+*****************************************************************************/
+static int ReadMap(SHADEBUFFER *Map)
+{
+  char Magic[sizeof(((MAPZHEADER *) 0)->Magic)];
+  off_t Offset;
+  ssize_t NRead;
+  size_t Total;
+  int DataSet;
+
+  if (File < 0 || FileMonth != Map->Month) {
+    if (File >= 0)
+      close(File);
+    FileMonth = 0;
+    sprintf(FileName, "%s.%02d.%s", StreamOptions->ShadingDataPath,
+      Map->Month, StreamOptions->ShadingDataExt);
+    if ((File = open(FileName, O_RDONLY)) < 0)
+      return 3;
+    if (pread(File, Magic, sizeof(Magic), 0) == (ssize_t) sizeof(Magic) &&
+        memcmp(Magic, MAPZ_MAGIC, sizeof(Magic)) == 0)
+      return 65;
+    FileMonth = Map->Month;
+  }
+
+  DataSet = (NSteps > 24) ? Map->DayStep / (NSteps / 24) : Map->DayStep;
+  Offset = (off_t) GridSize * DataSet;
+  for (Total = 0; Total < GridSize; Total += NRead) {
+    NRead = pread(File, Map->Grid + Total, GridSize - Total, Offset + Total);
+    if (NRead <= 0)
+      return 2;
+  }
+  return 0;
+}
@@ -8,6 +8,7 @@
 #include "functions.h"
 #include "slopeaspect.h"
 #include "DHSVMerror.h"
+#include "memtrack.h"
 
 float temp_aspect[NNEIGHBORS] = {
   225., 180., 135., 90., 45., 0., 315., 270.
@@ -340,7 +341,7 @@ void ElevationSlopeAspect(MAPSIZE * Map, TOPOPIX ** TopoMap, int MultiFlowDir)
   } /* End of loop over y,x */
   /* Create a structure to hold elevations of only those cells
      within the basin and the y,x of those cells */
-  if (!(Map->OrderedCells = (ITEM *) calloc(Map->NumCells, sizeof(ITEM))))
+  if (!(Map->OrderedCells = (ITEM *) TrackCalloc(Map->NumCells, sizeof(ITEM), MEM_TERRAIN)))
     ReportError((char *) Routine, 1);
   k = 0;
   for (y = 0; y < Map->NY; y++) {
@@ -440,6 +441,40 @@ void qs(ITEM *item, int left, int right)
   if(left<j) qs(item,left,j);
   if(i<right) qs(item,i,right);
 }
+/* -------------------------------------------------------------
+   OrderFlowDirections
+   Ranks the NDIRS flow directions of cell x, y by their weight in
+   Dir, with directions that leave the grid ranked zero.  On return
+   Order[] holds the direction indices in the order produced by
+   quick() (ascending weight), and NFlow the number of directions
+   with a non-zero weight, which are the last NFlow entries of Order.
+   The ordering only changes when Dir does, so callers can store it
+   with the flow directions instead of sorting every time step.
+   ------------------------------------------------------------- */
+void OrderFlowDirections(MAPSIZE * Map, unsigned char *Dir, int x, int y,
+                         unsigned char *Order, unsigned char *NFlow)
+{
+  int k;
+  ITEM kOrdered[MAXDIRS];
+
+  *NFlow = 0;
+  for (k = 0; k < NDIRS; k++) {
+    kOrdered[k].x = k;
+    kOrdered[k].y = 0;
+    if (valid_cell(Map, x + xdirection[k], y + ydirection[k]))
+      kOrdered[k].Rank = (float) Dir[k];
+    else
+      kOrdered[k].Rank = 0.0;
+    if (kOrdered[k].Rank > 0.0)
+      (*NFlow)++;
+  }
+
+  quick(kOrdered, NDIRS);
+
+  for (k = 0; k < NDIRS; k++)
+    Order[k] = (unsigned char) kOrdered[k].x;
+}
+
 /* -------------------------------------------------------------
    HeadSlopeAspect
    This computes slope and aspect using the water table elevation. 
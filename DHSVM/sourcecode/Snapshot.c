@@ -0,0 +1,353 @@
+/*
+ * SUMMARY:      Snapshot.c - Single-file binary model state
+ * USAGE:        Part of DHSVM
+ *
+ * DESCRIPTION:  With [OPTIONS] STATE SNAPSHOT = TRUE the model state is
+ *               stored at the state dump times in one binary file,
+ *               <OUTPUT DIRECTORY>Model.State.<date>.bin, instead of the
+ *               Interception, Snow, Soil and Channel state files.  At
+ *               start-up the snapshot for the start date in the INITIAL
+ *               STATE DIRECTORY is memory-mapped and restored in one pass.
+ *               If there is no snapshot for the start date, the state files
+ *               are read as before, so that a run can start from the state
+ *               files of an earlier run.
+ *
+ *               The file holds a SNAPSHOTHEADER followed by
+ *                 - the state maps in the order in which StoreModelState()
+ *                   writes them, each a SNAPSHOTMAP followed by one float
+ *                   per basin pixel (row by row)
+ *                 - one SNAPSHOTSEGMENT per channel segment
+ *                 - the storage of each lake (m)
+ *               The header also holds the time and the mass balance
+ *               accumulators at the time the state was stored, so that a run
+ *               restored from a snapshot continues the mass balance of the
+ *               run that stored it (a run restored from the state files
+ *               starts a new one).  Numbers are stored in the byte order of
+ *               the machine.
+ *
+ *               StoreModelState() and InitModelState() write and read their
+ *               maps through WriteStateMap() and ReadStateMap(), which go to
+ *               the snapshot while one is being written or is open, so that
+ *               both formats restore exactly the same variables.
+ */
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "settings.h"
+#include "data.h"
+#include "constants.h"
+#include "DHSVMerror.h"
+#include "fileio.h"
+#include "functions.h"
+#include "snapshot.h"
+
+static FILE *OutFile = NULL;        /* Snapshot that is being written */
+static char *Mapped = NULL;         /* Snapshot that is being read */
+static size_t MappedSize = 0;
+static size_t NextMap = 0;          /* Position of the next map in Mapped */
+static SNAPSHOTHEADER Header;
+static char SnapshotName[BUFSIZE + 1];
+static int NCells = 0;
+static int *Cells = NULL;           /* Offsets y * NX + x of the basin pixels */
+static float *Column = NULL;        /* One map, basin pixels only */
+
+static void MakeSnapshotName(char *Path, DATE *Now);
+static void FindBasinCells(MAPSIZE *Map, TOPOPIX **TopoMap);
+static void *SnapshotSection(size_t *Position, size_t Size);
+
+/*****************************************************************************
+  StoreModelSnapshot()
+
+  Store the model state in a single file.  Called instead of
+  StoreModelState() and StoreChannelState() at the state dump times.
+*****************************************************************************/
+void StoreModelSnapshot(char *Path, DATE *Current, MAPSIZE *Map,
+                        OPTIONSTRUCT *Options, TOPOPIX **TopoMap,
+                        PRECIPPIX **PrecipMap, SNOWPIX **SnowMap,
+                        VEGPIX **VegMap, LAYER *Veg, SOILPIX **SoilMap,
+                        LAYER *Soil, NETSTRUCT **Network,
+                        CHANNEL *ChannelData, LAKETABLE *LType,
+                        WATERBALANCE *Mass)
+{
+  Channel *Stream;
+  SNAPSHOTSEGMENT Segment;
+  int i;
+
+  FindBasinCells(Map, TopoMap);
+  MakeSnapshotName(Path, Current);
+  OpenFile(&OutFile, SnapshotName, "wb", TRUE);
+
+  memset(&Header, 0, sizeof(SNAPSHOTHEADER));
+  memcpy(Header.Magic, SNAPSHOT_MAGIC, sizeof(Header.Magic));
+  Header.Version = SNAPSHOT_VERSION;
+  Header.NX = Map->NX;
+  Header.NY = Map->NY;
+  Header.NCells = NCells;
+  Header.NLakes = Map->NumLakes;
+  Header.Now = *Current;
+  Header.Mass = *Mass;
+  if (fwrite(&Header, sizeof(SNAPSHOTHEADER), 1, OutFile) != 1)
+    ReportError(SnapshotName, 2);
+
+  /* The maps are added by WriteStateMap() */
+  Header.MapOffset = ftell(OutFile);
+  StoreModelState(Path, Current, Map, Options, TopoMap, PrecipMap, SnowMap,
+                  VegMap, Veg, SoilMap, Soil, Network, ChannelData);
+
+  Header.SegmentOffset = ftell(OutFile);
+  for (Stream = ChannelData->streams; Stream; Stream = Stream->next) {
+    Segment.id = Stream->id;
+    Segment.storage = Stream->storage;
+    if (fwrite(&Segment, sizeof(SNAPSHOTSEGMENT), 1, OutFile) != 1)
+      ReportError(SnapshotName, 2);
+    Header.NSegments++;
+  }
+
+  Header.LakeOffset = ftell(OutFile);
+  for (i = 0; i < Map->NumLakes; i++) {
+    if (fwrite(&(LType[i].Storage), sizeof(float), 1, OutFile) != 1)
+      ReportError(SnapshotName, 2);
+  }
+
+  /* Complete the header */
+  rewind(OutFile);
+  if (fwrite(&Header, sizeof(SNAPSHOTHEADER), 1, OutFile) != 1)
+    ReportError(SnapshotName, 2);
+  fclose(OutFile);
+  OutFile = NULL;
+}
+
+/*****************************************************************************
+  OpenModelSnapshot()
+
+  Map the snapshot for Now in Path into memory.  Returns FALSE if there is no
+  such snapshot, in which case the state is read from the state files.
+  Between OpenModelSnapshot() and CloseModelSnapshot(), ReadStateMap() takes
+  the maps from the snapshot.
+*****************************************************************************/
+int OpenModelSnapshot(char *Path, DATE *Now, MAPSIZE *Map, TOPOPIX **TopoMap)
+{
+  struct stat Stat;
+  int fd;
+
+  MakeSnapshotName(Path, Now);
+  if ((fd = open(SnapshotName, O_RDONLY)) < 0)
+    return FALSE;
+  if (fstat(fd, &Stat) < 0)
+    ReportError(SnapshotName, 2);
+  MappedSize = Stat.st_size;
+  if (MappedSize < sizeof(SNAPSHOTHEADER))
+    ReportError(SnapshotName, 76);
+  Mapped = mmap(NULL, MappedSize, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (Mapped == MAP_FAILED) {
+    Mapped = NULL;
+    ReportError(SnapshotName, 2);
+  }
+  memcpy(&Header, Mapped, sizeof(SNAPSHOTHEADER));
+
+  FindBasinCells(Map, TopoMap);
+  if (memcmp(Header.Magic, SNAPSHOT_MAGIC, sizeof(Header.Magic)) ||
+      Header.Version != SNAPSHOT_VERSION || Header.NX != Map->NX ||
+      Header.NY != Map->NY || Header.NCells != NCells ||
+      !IsEqualTime(&(Header.Now), Now) ||
+      Header.LakeOffset + Header.NLakes * sizeof(float) > MappedSize)
+    ReportError(SnapshotName, 76);
+
+  printf("Restoring model state from %s\n", SnapshotName);
+  NextMap = Header.MapOffset;
+  return TRUE;
+}
+
+/*****************************************************************************
+  ReadSnapshotChannel()
+
+  Restore the storage in each channel segment, as ReadChannelState() does.
+  The segments are stored in the order of the channel network, so they are
+  matched in one pass.
+*****************************************************************************/
+void ReadSnapshotChannel(Channel *Head)
+{
+  Channel *Current;
+  SNAPSHOTSEGMENT Segment;
+  size_t Position;
+  int i;
+
+  Position = Header.SegmentOffset;
+  for (Current = Head, i = 0; Current; Current = Current->next, i++) {
+    if (i >= Header.NSegments)
+      ReportError(SnapshotName, 76);
+    memcpy(&Segment, SnapshotSection(&Position, sizeof(SNAPSHOTSEGMENT)),
+           sizeof(SNAPSHOTSEGMENT));
+    if (Segment.id != Current->id)
+      ReportError(SnapshotName, 76);
+    Current->storage = Segment.storage;
+
+    /* Initialize depth uniformly in each segment */
+    Current->top_water_depth =
+      Current->storage / (Current->class2->width * Current->length);
+    Current->bottom_water_depth = Current->top_water_depth;
+  }
+  if (i != Header.NSegments)
+    ReportError(SnapshotName, 76);
+}
+
+/*****************************************************************************
+  ReadSnapshotLakes()
+
+  Restore the lake storages, which the state files do not hold.
+*****************************************************************************/
+void ReadSnapshotLakes(LAKETABLE *LType, int NumLakes)
+{
+  size_t Position;
+  int i;
+
+  if (Header.NLakes != NumLakes)
+    ReportError(SnapshotName, 76);
+  Position = Header.LakeOffset;
+  for (i = 0; i < NumLakes; i++)
+    memcpy(&(LType[i].Storage), SnapshotSection(&Position, sizeof(float)), sizeof(float));
+}
+
+/*****************************************************************************
+  ReadSnapshotMass()
+
+  Restore the mass balance accumulators.
+*****************************************************************************/
+void ReadSnapshotMass(WATERBALANCE *Mass)
+{
+  *Mass = Header.Mass;
+}
+
+/*****************************************************************************
+  CloseModelSnapshot()
+*****************************************************************************/
+void CloseModelSnapshot(void)
+{
+  if (Mapped) {
+    munmap(Mapped, MappedSize);
+    Mapped = NULL;
+  }
+  free(Column);
+  free(Cells);
+  Column = NULL;
+  Cells = NULL;
+}
+
+/*****************************************************************************
+  CreateStateFile()
+
+  Create a state file, unless the state goes to a snapshot.
+*****************************************************************************/
+void CreateStateFile(char *FileName, char *FileLabel, MAPSIZE *Map)
+{
+  if (!OutFile)
+    CreateMapFile(FileName, FileLabel, Map);
+}
+
+/*****************************************************************************
+  WriteStateMap()
+
+  Write a state map (floats) to its state file or to the snapshot.
+*****************************************************************************/
+void WriteStateMap(char *FileName, void *Array, MAPDUMP *DMap, MAPSIZE *Map)
+{
+  SNAPSHOTMAP Record;
+  int i;
+
+  if (!OutFile) {
+    Write2DMatrix(FileName, Array, DMap->NumberType, Map, DMap, 0);
+    return;
+  }
+
+  Record.ID = DMap->ID;
+  Record.Layer = DMap->Layer;
+  for (i = 0; i < NCells; i++)
+    Column[i] = ((float *) Array)[Cells[i]];
+  if (fwrite(&Record, sizeof(SNAPSHOTMAP), 1, OutFile) != 1 ||
+      fwrite(Column, sizeof(float), NCells, OutFile) != (size_t) NCells)
+    ReportError(SnapshotName, 2);
+  Header.NMaps++;
+}
+
+/*****************************************************************************
+  ReadStateMap()
+
+  Read a state map (floats) from its state file or from the snapshot.  Only
+  the basin pixels of Array are set when reading from the snapshot.
+*****************************************************************************/
+void ReadStateMap(char *FileName, void *Array, MAPDUMP *DMap, MAPSIZE *Map,
+                  int NSet)
+{
+  SNAPSHOTMAP Record;
+  int i;
+
+  if (!Mapped) {
+    Read2DMatrix(FileName, Array, DMap->NumberType, Map, NSet, DMap->Name, 0);
+    return;
+  }
+
+  memcpy(&Record, SnapshotSection(&NextMap, sizeof(SNAPSHOTMAP)),
+         sizeof(SNAPSHOTMAP));
+  if (Record.ID != DMap->ID)
+    ReportError(SnapshotName, 76);
+  memcpy(Column, SnapshotSection(&NextMap, NCells * sizeof(float)),
+         NCells * sizeof(float));
+  for (i = 0; i < NCells; i++)
+    ((float *) Array)[Cells[i]] = Column[i];
+}
+
+/*****************************************************************************
+  MakeSnapshotName()
+*****************************************************************************/
+static void MakeSnapshotName(char *Path, DATE *Now)
+{
+  sprintf(SnapshotName, "%sModel.State.%02d.%02d.%04d.%02d.%02d.%02d.bin",
+          Path, Now->Month, Now->Day, Now->Year, Now->Hour, Now->Min,
+          Now->Sec);
+}
+
+/*****************************************************************************
+  FindBasinCells()
+
+  List the basin pixels in the order in which they are stored.
+*****************************************************************************/
+static void FindBasinCells(MAPSIZE *Map, TOPOPIX **TopoMap)
+{
+  const char *Routine = "FindBasinCells";
+  int x;
+  int y;
+
+  if (Cells)
+    return;
+  if (!(Cells = (int *) calloc(Map->NX * Map->NY, sizeof(int))) ||
+      !(Column = (float *) calloc(Map->NX * Map->NY, sizeof(float))))
+    ReportError((char *) Routine, 1);
+  NCells = 0;
+  for (y = 0; y < Map->NY; y++)
+    for (x = 0; x < Map->NX; x++)
+      if (INBASIN(TopoMap[y][x].Mask))
+        Cells[NCells++] = y * Map->NX + x;
+}
+
+/*****************************************************************************
+  SnapshotSection()
+
+  Return the Size bytes of the mapped snapshot at Position, and advance
+  Position past them.
+*****************************************************************************/
+static void *SnapshotSection(size_t *Position, size_t Size)
+{
+  void *Section;
+
+  if (*Position + Size > MappedSize)
+    ReportError(SnapshotName, 76);
+  Section = Mapped + *Position;
+  *Position += Size;
+  return Section;
+}
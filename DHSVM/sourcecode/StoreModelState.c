@@ -10,6 +10,7 @@
 #include "constants.h"
 #include "sizeofnt.h"
 #include "varid.h"
+#include "snapshot.h"
 
  /*****************************************************************************
    StoreModelState()
@@ -35,6 +36,9 @@
          - temperature
        - surface temperature
        - ground heat storage
+
+   When called from StoreModelSnapshot(), the maps go to the snapshot
+   instead of the state files.
  *****************************************************************************/
 void StoreModelState(char *Path, DATE * Current, MAPSIZE * Map,
   OPTIONSTRUCT * Options, TOPOPIX ** TopoMap,
@@ -66,7 +70,7 @@ void StoreModelState(char *Path, DATE * Current, MAPSIZE * Map,
   sprintf(FileName, "%sInterception.State.%s%s", Path, Str, fileext);
   strcpy(FileLabel, "Interception storage for each vegetation layer");
 
-  CreateMapFile(FileName, FileLabel, Map);
+  CreateStateFile(FileName, FileLabel, Map);
 
   if (!(Array = (float *)calloc(Map->NY * Map->NX, sizeof(float))))
     ReportError((char *)Routine, 1);
@@ -90,7 +94,7 @@ void StoreModelState(char *Path, DATE * Current, MAPSIZE * Map,
     DMap.Resolution = MAP_OUTPUT;
     strcpy(DMap.FileName, "");
     GetVarAttr(&DMap);
-    Write2DMatrix(FileName, Array, DMap.NumberType, Map, &DMap, 0);
+    WriteStateMap(FileName, Array, &DMap, Map);
   }
 
   for (i = 0; i < Veg->MaxLayers; i++) {
@@ -112,7 +116,7 @@ void StoreModelState(char *Path, DATE * Current, MAPSIZE * Map,
     DMap.Resolution = MAP_OUTPUT;
     strcpy(DMap.FileName, "");
     GetVarAttr(&DMap);
-    Write2DMatrix(FileName, Array, DMap.NumberType, Map, &DMap, 0);
+    WriteStateMap(FileName, Array, &DMap, Map);
   }
 
   for (y = 0; y < Map->NY; y++) {
@@ -129,7 +133,7 @@ void StoreModelState(char *Path, DATE * Current, MAPSIZE * Map,
   DMap.Resolution = MAP_OUTPUT;
   strcpy(DMap.FileName, "");
   GetVarAttr(&DMap);
-  Write2DMatrix(FileName, Array, DMap.NumberType, Map, &DMap, 0);
+  WriteStateMap(FileName, Array, &DMap, Map);
 
   free(Array);
 
@@ -137,7 +141,7 @@ void StoreModelState(char *Path, DATE * Current, MAPSIZE * Map,
 
   sprintf(FileName, "%sSnow.State.%s%s", Path, Str, fileext);
   strcpy(FileLabel, "Snow pack moisture and temperature state");
-  CreateMapFile(FileName, FileLabel, Map);
+  CreateStateFile(FileName, FileLabel, Map);
 
   if (!(Array = (float *)calloc(Map->NY * Map->NX, sizeof(float))))
     ReportError((char *)Routine, 1);
@@ -154,7 +158,7 @@ void StoreModelState(char *Path, DATE * Current, MAPSIZE * Map,
   DMap.Resolution = MAP_OUTPUT;
   strcpy(DMap.FileName, "");
   GetVarAttr(&DMap);
-  Write2DMatrix(FileName, Array, DMap.NumberType, Map, &DMap, 0);
+  WriteStateMap(FileName, Array, &DMap, Map);
 
   for (y = 0; y < Map->NY; y++) {
     for (x = 0; x < Map->NX; x++) {
@@ -168,7 +172,7 @@ void StoreModelState(char *Path, DATE * Current, MAPSIZE * Map,
   DMap.Resolution = MAP_OUTPUT;
   strcpy(DMap.FileName, "");
   GetVarAttr(&DMap);
-  Write2DMatrix(FileName, Array, DMap.NumberType, Map, &DMap, 0);
+  WriteStateMap(FileName, Array, &DMap, Map);
 
   for (y = 0; y < Map->NY; y++) {
     for (x = 0; x < Map->NX; x++) {
@@ -182,7 +186,7 @@ void StoreModelState(char *Path, DATE * Current, MAPSIZE * Map,
   DMap.Resolution = MAP_OUTPUT;
   strcpy(DMap.FileName, "");
   GetVarAttr(&DMap);
-  Write2DMatrix(FileName, Array, DMap.NumberType, Map, &DMap, 0);
+  WriteStateMap(FileName, Array, &DMap, Map);
 
   for (y = 0; y < Map->NY; y++) {
     for (x = 0; x < Map->NX; x++) {
@@ -196,7 +200,7 @@ void StoreModelState(char *Path, DATE * Current, MAPSIZE * Map,
   DMap.Resolution = MAP_OUTPUT;
   strcpy(DMap.FileName, "");
   GetVarAttr(&DMap);
-  Write2DMatrix(FileName, Array, DMap.NumberType, Map, &DMap, 0);
+  WriteStateMap(FileName, Array, &DMap, Map);
 
   for (y = 0; y < Map->NY; y++) {
     for (x = 0; x < Map->NX; x++) {
@@ -210,7 +214,7 @@ void StoreModelState(char *Path, DATE * Current, MAPSIZE * Map,
   DMap.Resolution = MAP_OUTPUT;
   strcpy(DMap.FileName, "");
   GetVarAttr(&DMap);
-  Write2DMatrix(FileName, Array, DMap.NumberType, Map, &DMap, 0);
+  WriteStateMap(FileName, Array, &DMap, Map);
 
   for (y = 0; y < Map->NY; y++) {
     for (x = 0; x < Map->NX; x++) {
@@ -224,7 +228,7 @@ void StoreModelState(char *Path, DATE * Current, MAPSIZE * Map,
   DMap.Resolution = MAP_OUTPUT;
   strcpy(DMap.FileName, "");
   GetVarAttr(&DMap);
-  Write2DMatrix(FileName, Array, DMap.NumberType, Map, &DMap, 0);
+  WriteStateMap(FileName, Array, &DMap, Map);
 
   for (y = 0; y < Map->NY; y++) {
     for (x = 0; x < Map->NX; x++) {
@@ -238,7 +242,7 @@ void StoreModelState(char *Path, DATE * Current, MAPSIZE * Map,
   DMap.Resolution = MAP_OUTPUT;
   strcpy(DMap.FileName, "");
   GetVarAttr(&DMap);
-  Write2DMatrix(FileName, Array, DMap.NumberType, Map, &DMap, 0);
+  WriteStateMap(FileName, Array, &DMap, Map);
 
   for (y = 0; y < Map->NY; y++) {
     for (x = 0; x < Map->NX; x++) {
@@ -252,7 +256,7 @@ void StoreModelState(char *Path, DATE * Current, MAPSIZE * Map,
   DMap.Resolution = MAP_OUTPUT;
   strcpy(DMap.FileName, "");
   GetVarAttr(&DMap);
-  Write2DMatrix(FileName, Array, DMap.NumberType, Map, &DMap, 0);
+  WriteStateMap(FileName, Array, &DMap, Map);
 
   free(Array);
 
@@ -260,7 +264,7 @@ void StoreModelState(char *Path, DATE * Current, MAPSIZE * Map,
 
   sprintf(FileName, "%sSoil.State.%s%s", Path, Str, fileext);
   strcpy(FileLabel, "Soil moisture and temperature state");
-  CreateMapFile(FileName, FileLabel, Map);
+  CreateStateFile(FileName, FileLabel, Map);
 
   if (!(Array = (float *)calloc(Map->NY * Map->NX, sizeof(float))))
     ReportError((char *)Routine, 1);
@@ -284,7 +288,7 @@ void StoreModelState(char *Path, DATE * Current, MAPSIZE * Map,
     DMap.Resolution = MAP_OUTPUT;
     strcpy(DMap.FileName, "");
     GetVarAttr(&DMap);
-    Write2DMatrix(FileName, Array, DMap.NumberType, Map, &DMap, 0);
+    WriteStateMap(FileName, Array, &DMap, Map);
   }
 
   for (y = 0; y < Map->NY; y++) {
@@ -299,7 +303,7 @@ void StoreModelState(char *Path, DATE * Current, MAPSIZE * Map,
   DMap.Resolution = MAP_OUTPUT;
   strcpy(DMap.FileName, "");
   GetVarAttr(&DMap);
-  Write2DMatrix(FileName, Array, DMap.NumberType, Map, &DMap, 0);
+  WriteStateMap(FileName, Array, &DMap, Map);
 
   for (i = 0; i < Soil->MaxLayers; i++) {
     for (y = 0; y < Map->NY; y++) {
@@ -320,7 +324,7 @@ void StoreModelState(char *Path, DATE * Current, MAPSIZE * Map,
     DMap.Resolution = MAP_OUTPUT;
     strcpy(DMap.FileName, "");
     GetVarAttr(&DMap);
-    Write2DMatrix(FileName, Array, DMap.NumberType, Map, &DMap, 0);
+    WriteStateMap(FileName, Array, &DMap, Map);
   }
 
   for (y = 0; y < Map->NY; y++) {
@@ -335,7 +339,7 @@ void StoreModelState(char *Path, DATE * Current, MAPSIZE * Map,
   DMap.Resolution = MAP_OUTPUT;
   strcpy(DMap.FileName, "");
   GetVarAttr(&DMap);
-  Write2DMatrix(FileName, Array, DMap.NumberType, Map, &DMap, 0);
+  WriteStateMap(FileName, Array, &DMap, Map);
 
   for (y = 0; y < Map->NY; y++) {
     for (x = 0; x < Map->NX; x++) {
@@ -350,7 +354,7 @@ void StoreModelState(char *Path, DATE * Current, MAPSIZE * Map,
   DMap.Resolution = MAP_OUTPUT;
   strcpy(DMap.FileName, "");
   GetVarAttr(&DMap);
-  Write2DMatrix(FileName, Array, DMap.NumberType, Map, &DMap, 0);
+  WriteStateMap(FileName, Array, &DMap, Map);
 
   free(Array);
 }
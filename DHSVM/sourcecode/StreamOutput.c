@@ -0,0 +1,168 @@
+/*
+ * SUMMARY:      StreamOutput.c - Binary streamflow output
+ * USAGE:        Part of DHSVM
+ *
+ * DESCRIPTION:  With [OPTIONS] STREAMFLOW OUTPUT FORMAT = BINARY the
+ *               streamflow of the recorded segments is written to
+ *               <OUTPUT DIRECTORY>/Stream.Values.bin instead of Stream.Flow
+ *               and Streamflow.Only.  Every record holds one vector of all
+ *               recorded segments per variable, written in one block through
+ *               a large stdio buffer (see streamoutput.h for the layout).
+ *
+ *               With STREAMFLOW AGGREGATION = DAILY the values are
+ *               aggregated in the model and a record holds the daily mean
+ *               and maximum instead of a single time step.  The record of
+ *               the first and last day of the run may cover part of the day.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "settings.h"
+#include "data.h"
+#include "DHSVMerror.h"
+#include "fileio.h"
+#include "streamoutput.h"
+
+#define STREAMFILE_BUFFER (4 << 20)  /* Bytes of the stdio buffer of the file */
+
+static FILES StreamFile;
+static char *StreamBuffer = NULL;
+static int NSegments = 0;
+static Channel **Segments = NULL;    /* Recorded segments */
+static STREAMFILESEGMENT *SegmentInfo = NULL;
+static float *Values = NULL;         /* NStats x STREAMFILE_NVARS vectors */
+static int NStats = 1;
+static int NSteps = 0;               /* Time steps in the current record */
+static DATE RecordDate;              /* Date of the current record */
+static int HeaderDone = FALSE;       /* TRUE once the header is written */
+
+/*****************************************************************************
+  InitStreamBinary()
+
+  Collects the recorded segments of the network and opens the binary
+  streamflow file.  Daily is TRUE for daily aggregation.
+*****************************************************************************/
+void InitStreamBinary(char *Path, Channel *Net, int Daily)
+{
+  const char *Routine = "InitStreamBinary";
+  Channel *Seg;
+  int i;
+
+  NSegments = 0;
+  for (Seg = Net; Seg != NULL; Seg = Seg->next)
+    if (Seg->record)
+      NSegments++;
+  NStats = Daily ? 2 : 1;
+  NSteps = 0;
+  HeaderDone = FALSE;
+
+  /* A forecast scenario starts its own file */
+  free(Segments);
+  free(SegmentInfo);
+  free(Values);
+  if (!(Segments = (Channel **) calloc(NSegments + 1, sizeof(Channel *))) ||
+      !(SegmentInfo = (STREAMFILESEGMENT *) calloc(NSegments + 1,
+                                                   sizeof(STREAMFILESEGMENT))) ||
+      !(Values = (float *) calloc((size_t) NStats * STREAMFILE_NVARS *
+                                  NSegments + 1, sizeof(float))))
+    ReportError((char *) Routine, 1);
+  for (Seg = Net, i = 0; Seg != NULL; Seg = Seg->next) {
+    if (!Seg->record)
+      continue;
+    Segments[i] = Seg;
+    SegmentInfo[i].ID = Seg->id;
+    if (Seg->record_name != NULL)
+      strncpy(SegmentInfo[i].Name, Seg->record_name, NAMESIZE);
+    i++;
+  }
+
+  sprintf(StreamFile.FileName, "%s%s", Path, STREAMFILE_NAME);
+  if (StreamFile.FilePtr != NULL)
+    fclose(StreamFile.FilePtr);
+  OpenFile(&(StreamFile.FilePtr), StreamFile.FileName, "wb", TRUE);
+  if (StreamBuffer == NULL && !(StreamBuffer = malloc(STREAMFILE_BUFFER)))
+    ReportError((char *) Routine, 1);
+  setvbuf(StreamFile.FilePtr, StreamBuffer, _IOFBF, STREAMFILE_BUFFER);
+}
+
+/*****************************************************************************
+  WriteStreamBinary()
+
+  Adds the streamflow of the current time step to the current record, and
+  writes the record if it is complete: every time step, or with daily
+  aggregation at the last time step of the day and of the run.  The header
+  of the file is written at the first time step.
+*****************************************************************************/
+void WriteStreamBinary(TIMESTRUCT *Time)
+{
+  STREAMFILEHEADER Header;
+  Channel *Seg;
+  float Value[STREAMFILE_NVARS];
+  float *Mean = Values;
+  float *Max = Values + (size_t) STREAMFILE_NVARS * NSegments;
+  size_t NValues = (size_t) NStats * STREAMFILE_NVARS * NSegments;
+  int Date[7];
+  int i;
+  int j;
+
+  if (!HeaderDone) {
+    memset(&Header, 0, sizeof(STREAMFILEHEADER));
+    memcpy(Header.Magic, STREAMFILE_MAGIC, sizeof(Header.Magic));
+    Header.Version = STREAMFILE_VERSION;
+    Header.NSegments = NSegments;
+    Header.NVars = STREAMFILE_NVARS;
+    Header.NStats = NStats;
+    Header.Interval = (NStats == 2) ? SECPDAY : Time->Dt;
+    if (fwrite(&Header, sizeof(STREAMFILEHEADER), 1, StreamFile.FilePtr) != 1 ||
+        fwrite(SegmentInfo, sizeof(STREAMFILESEGMENT), NSegments,
+               StreamFile.FilePtr) != (size_t) NSegments)
+      ReportError(StreamFile.FileName, 41);
+    HeaderDone = TRUE;
+  }
+
+  if (NSteps == 0)
+    RecordDate = Time->Current;
+
+  for (i = 0; i < NSegments; i++) {
+    Seg = Segments[i];
+    Value[0] = Seg->inflow;
+    Value[1] = Seg->outflow;
+    Value[2] = Seg->storage;
+    Value[3] = Seg->lateral_inflow;
+    for (j = 0; j < STREAMFILE_NVARS; j++) {
+      if (NSteps == 0) {
+        Mean[j * NSegments + i] = Value[j];
+        if (NStats == 2)
+          Max[j * NSegments + i] = Value[j];
+      }
+      else {
+        Mean[j * NSegments + i] += Value[j];
+        if (Value[j] > Max[j * NSegments + i])
+          Max[j * NSegments + i] = Value[j];
+      }
+    }
+  }
+  NSteps++;
+
+  if (NStats == 2 && Time->DayStep != Time->NDaySteps - 1 &&
+      !IsEqualTime(&(Time->Current), &(Time->End)))
+    return;
+
+  if (NSteps > 1)
+    for (i = 0; i < STREAMFILE_NVARS * NSegments; i++)
+      Mean[i] /= NSteps;
+
+  /* A daily record is dated at the start of the day */
+  Date[0] = RecordDate.Year;
+  Date[1] = RecordDate.Month;
+  Date[2] = RecordDate.Day;
+  Date[3] = (NStats == 2) ? 0 : RecordDate.Hour;
+  Date[4] = (NStats == 2) ? 0 : RecordDate.Min;
+  Date[5] = (NStats == 2) ? 0 : RecordDate.Sec;
+  Date[6] = NSteps;
+  if (fwrite(Date, sizeof(int), 7, StreamFile.FilePtr) != 7 ||
+      fwrite(Values, sizeof(float), NValues, StreamFile.FilePtr) != NValues)
+    ReportError(StreamFile.FileName, 41);
+  NSteps = 0;
+}
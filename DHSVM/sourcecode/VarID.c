@@ -260,6 +260,30 @@ struct {
   806, "Snow.MinAlbedoMelt",
       "Min Albedo during melt", "%.4f", "", 
       "Min Albedo during melt", NC_FLOAT, FALSE, FALSE, FALSE, 0}, {   
+  901, "Count.BrentEval",
+      "RootBrent Evaluations", "%d",
+      "count", "RootBrent function evaluations since the start of the run",
+      NC_INT, FALSE, FALSE, FALSE, 0}, {
+  902, "Count.BrentBracket",
+      "RootBrent Bracket Expansions", "%d",
+      "count", "RootBrent bracket expansions since the start of the run",
+      NC_INT, FALSE, FALSE, FALSE, 0}, {
+  903, "Count.SurfaceStep",
+      "Surface Routing Sub-steps", "%d",
+      "count", "Kinematic surface routing sub-steps with water in the pixel",
+      NC_INT, FALSE, FALSE, FALSE, 0}, {
+  904, "Count.DTLimit",
+      "Surface Sub-step Limits", "%d",
+      "count", "Time steps in which the pixel set the surface routing sub-step",
+      NC_INT, FALSE, FALSE, FALSE, 0}, {
+  905, "Count.LayerMatch",
+      "Layer-matching Iterations", "%d",
+      "count", "Water table layer-matching iterations in subsurface routing",
+      NC_INT, FALSE, FALSE, FALSE, 0}, {
+  906, "Count.KClamp",
+      "Channel K Clamps", "%d",
+      "count", "Channel storage constants raised to the minimum",
+      NC_INT, FALSE, FALSE, FALSE, 0}, {
   ENDOFLIST, "", "", "", "", "",
       ENDOFLIST, ENDOFLIST, ENDOFLIST, ENDOFLIST, ENDOFLIST}
 };
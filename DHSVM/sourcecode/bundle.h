@@ -0,0 +1,33 @@
+#ifndef BUNDLE_H
+#define BUNDLE_H
+
+#include "settings.h"
+#include "data.h"
+
+#define BUNDLE_MAGIC "DHSVMBDL"
+#define BUNDLE_VERSION 1
+
+/* The basin bundle starts with this header (see Bundle.c) */
+typedef struct {
+  char Magic[8];                /* BUNDLE_MAGIC, without the terminating 0 */
+  int Version;                  /* BUNDLE_VERSION */
+  int NX;                       /* Number of columns of the model grid */
+  int NY;                       /* Number of rows of the model grid */
+  int NumCells;                 /* Number of pixels in the basin */
+  int NStats;                   /* Number of met stations of the weights */
+  unsigned long long TerrainKey;/* Hash of the inputs of each section, */
+  unsigned long long WeightsKey;/* 0 if the section is not stored */
+  long TerrainOffset;           /* Offsets (bytes) of the sections from */
+  long WeightsOffset;           /* the start of the file */
+} BUNDLEHEADER;
+
+int LoadBundleTerrain(OPTIONSTRUCT *Options, MAPSIZE *Map, TOPOPIX **TopoMap,
+                      char *DemFile, char *MaskFile, char *LakeFile);
+void StoreBundleTerrain(OPTIONSTRUCT *Options, MAPSIZE *Map,
+                        TOPOPIX **TopoMap);
+int LoadBundleWeights(OPTIONSTRUCT *Options, MAPSIZE *Map, METLOCATION *Stat,
+                      int NStats, uchar ****WeightArray);
+void StoreBundleWeights(OPTIONSTRUCT *Options, MAPSIZE *Map, int NStats,
+                        uchar ***WeightArray);
+
+#endif
@@ -11,6 +11,8 @@
 #include "constants.h"
 #include "tableio.h"
 #include "settings.h"
+#include "counters.h"
+#include "memtrack.h"
 
 /* -------------------------------------------------------------
 -------------- ChannelClass Functions -----------------------
@@ -23,7 +25,7 @@ static ChannelClass *alloc_channel_class(void)
 {
   ChannelClass *p;
 
-  if ((p = (ChannelClass *) malloc(sizeof(ChannelClass))) == NULL) {
+  if ((p = (ChannelClass *) TrackMalloc(sizeof(ChannelClass), MEM_CHANNEL)) == NULL) {
     error_handler(ERRHDL_ERROR, "alloc_channel_class: malloc failed: %s",
       strerror(errno));
     return NULL;
@@ -183,7 +185,7 @@ alloc_channel_segment
 static Channel *alloc_channel_segment(void)
 {
   Channel *seg;
-  if ((seg = (Channel *) malloc(sizeof(Channel))) == NULL) {
+  if ((seg = (Channel *) TrackMalloc(sizeof(Channel), MEM_CHANNEL)) == NULL) {
     error_handler(ERRHDL_ERROR, "alloc_channel_segment: malloc failed: %s",
       strerror(errno));
     return NULL;
@@ -203,6 +205,7 @@ static Channel *alloc_channel_segment(void)
   seg->lake_inflow = 0.0;
   seg->outflow = 0.0;
   seg->storage = 0.0;
+  seg->last_storage = 0.0;
   seg->infiltration = 0.0;
   seg->remaining_infil = 0.0;
   seg->evaporation = 0.0;
@@ -226,15 +229,98 @@ Channel *channel_find_segment(Channel * head, SegmentID id)
   }
   if (head == NULL) {
     error_handler(ERRHDL_WARNING,
-      "channel_find_segment: unable to find segment %d", id);
+      "channel_find_segment: unable to find segment %u", id);
   }
   else {
-    error_handler(ERRHDL_DEBUG, "channel_find_segment: found segment %d", id);
+    error_handler(ERRHDL_DEBUG, "channel_find_segment: found segment %u", id);
   }
 
   return head;
 }
 
+/* -------------------------------------------------------------
+channel_index_create
+Builds a hash table of the segments in the network with open
+addressing.  The table is kept at most half full, so that a lookup
+takes a few probes whatever the size of the network.  Returns NULL
+if two segments share an id.
+------------------------------------------------------------- */
+ChannelIndex *channel_index_create(Channel *net)
+{
+  ChannelIndex *index;
+  Channel *segment;
+  unsigned int n, nsegments = 0;
+
+  for (segment = net; segment != NULL; segment = segment->next)
+    nsegments++;
+
+  if ((index = (ChannelIndex *) malloc(sizeof(ChannelIndex))) == NULL) {
+    error_handler(ERRHDL_FATAL, "channel_index_create: malloc failed: %s",
+      strerror(errno));
+  }
+  for (index->size = 16; index->size < 2 * nsegments; index->size *= 2)
+    ;
+  if ((index->slot = (Channel **) calloc(index->size, sizeof(Channel *))) == NULL) {
+    error_handler(ERRHDL_FATAL, "channel_index_create: malloc failed: %s",
+      strerror(errno));
+  }
+
+  for (segment = net; segment != NULL; segment = segment->next) {
+    n = channel_index_slot(index, segment->id);
+    if (index->slot[n] != NULL) {
+      error_handler(ERRHDL_ERROR,
+        "channel_index_create: segment id %u is not unique", segment->id);
+      channel_index_free(index);
+      return NULL;
+    }
+    index->slot[n] = segment;
+  }
+
+  return index;
+}
+
+/* -------------------------------------------------------------
+channel_index_slot
+Returns the slot that holds the segment with the given id, or the
+empty slot where it would go
+------------------------------------------------------------- */
+int channel_index_slot(ChannelIndex *index, SegmentID id)
+{
+  unsigned int n;
+
+  /* Fibonacci hashing spreads consecutive ids over the table */
+  n = (id * 2654435769u) & (index->size - 1);
+  while (index->slot[n] != NULL && index->slot[n]->id != id)
+    n = (n + 1) & (index->size - 1);
+
+  return n;
+}
+
+/* -------------------------------------------------------------
+channel_index_find
+Same as channel_find_segment, using the index
+------------------------------------------------------------- */
+Channel *channel_index_find(ChannelIndex *index, SegmentID id)
+{
+  Channel *segment = index->slot[channel_index_slot(index, id)];
+
+  if (segment == NULL) {
+    error_handler(ERRHDL_WARNING,
+      "channel_index_find: unable to find segment %u", id);
+  }
+
+  return segment;
+}
+
+/* -------------------------------------------------------------
+channel_index_free
+------------------------------------------------------------- */
+void channel_index_free(ChannelIndex *index)
+{
+  free(index->slot);
+  free(index);
+}
+
 /* -------------------------------------------------------------
 channel_routing_parameters
 ------------------------------------------------------------- */
@@ -313,8 +399,10 @@ void channel_update_routing_parameters(Channel *network, int deltat, int max_ord
         /* Use moving average to prevent numeric oscillation across timesteps */
         segment->K = (segment->K + Kold) / 2.0;
         
-        if (segment->K < MINSTORAGEK)
+        if (segment->K < MINSTORAGEK) {
           segment->K = MINSTORAGEK;
+          CountSegmentEvent(CNT_KCLAMP, segment->id);
+        }
         
         segment->X = exp(-segment->K * deltat);
       }
@@ -329,6 +417,7 @@ channel_read_network
 Channel *channel_read_network(const char *file, ChannelClass *class_list, int *MaxID)
 {
   Channel *head = NULL, *current = NULL;
+  ChannelIndex *index;
   int err = 0;
   int done;
   static const int fields = 8;
@@ -388,11 +477,11 @@ Channel *channel_read_network(const char *file, ChannelClass *class_list, int *M
         switch (i) {
         case 0:
           current->id = chan_fields[i].value.integer;
-          if(current->id > *MaxID) *MaxID = current->id;
-          if (current->id <= 0) {
+          if(chan_fields[i].value.integer > *MaxID) *MaxID = chan_fields[i].value.integer;
+          if (chan_fields[i].value.integer <= 0) {
             error_handler(ERRHDL_ERROR,
               "%s: segment %d: channel id invalid",
-              file, current->id);
+              file, chan_fields[i].value.integer);
             err++;
           }
           break;
@@ -402,7 +491,7 @@ Channel *channel_read_network(const char *file, ChannelClass *class_list, int *M
           }
           else {
             error_handler(ERRHDL_ERROR,
-              "%s: segment %d: channel order (%d) invalid",
+              "%s: segment %u: channel order (%d) invalid",
               file, current->id, chan_fields[i].value.integer);
             err++;
           }
@@ -413,7 +502,7 @@ Channel *channel_read_network(const char *file, ChannelClass *class_list, int *M
           }
           else {
             error_handler(ERRHDL_ERROR,
-              "%s: segment %d: channel slope (%f) invalid",
+              "%s: segment %u: channel slope (%f) invalid",
               file, current->id, chan_fields[i].value.real);
             err++;
           }
@@ -424,7 +513,7 @@ Channel *channel_read_network(const char *file, ChannelClass *class_list, int *M
           }
           else {
             error_handler(ERRHDL_ERROR,
-              "%s: segment %d: channel length (%f) invalid",
+              "%s: segment %u: channel length (%f) invalid",
               file, current->id, chan_fields[i].value.real);
             err++;
           }
@@ -434,7 +523,7 @@ Channel *channel_read_network(const char *file, ChannelClass *class_list, int *M
             find_channel_class(class_list, chan_fields[i].value.integer)
             ) == NULL) {
               error_handler(ERRHDL_ERROR,
-                "%s: segment %d: channel class %d not found",
+                "%s: segment %u: channel class %d not found",
                 file, current->id, chan_fields[i].value.integer);
               err++;
           }
@@ -462,16 +551,22 @@ Channel *channel_read_network(const char *file, ChannelClass *class_list, int *M
   /* find segment outlet segments, if
   specified */
 
-  for (current = head; current != NULL; current = current->next) {
-    if (current->outid != 0) {
-      current->outlet = channel_find_segment(head, current->outid);
-      if (current->outlet == NULL) {
-        error_handler(ERRHDL_ERROR,
-          "%s: cannot find outlet (%d) for segment %d",
-          file, current->outid, current->id);
-        err++;
+  if ((index = channel_index_create(head)) == NULL) {
+    err++;
+  }
+  else {
+    for (current = head; current != NULL; current = current->next) {
+      if (current->outid != 0) {
+        current->outlet = channel_index_find(index, current->outid);
+        if (current->outlet == NULL) {
+          error_handler(ERRHDL_ERROR,
+            "%s: cannot find outlet (%u) for segment %u",
+            file, current->outid, current->id);
+          err++;
+        }
       }
     }
+    channel_index_free(index);
   }
 
   table_errors += err;
@@ -744,7 +839,7 @@ int
       
       /* Stream.Flow file */
       if (SaveExtraStreamData) {
-        if (fprintf(out, "%15s %10d %12.5g %12.5g %12.5g %12.5g %12.5g %12.5g",
+        if (fprintf(out, "%15s %10u %12.5g %12.5g %12.5g %12.5g %12.5g %12.5g",
                     tstring, net->id, net->inflow, net->lateral_inflow,
                     net->outflow, net->storage - net->last_storage, net->infiltration, net->evaporation) == EOF) {
           error_handler(ERRHDL_ERROR,
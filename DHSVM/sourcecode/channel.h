@@ -6,7 +6,8 @@
 
 typedef struct LAKETABLE LAKETABLE;
 
-typedef unsigned short int SegmentID, ClassID;
+typedef unsigned int SegmentID;
+typedef unsigned short int ClassID;
 
 /* -------------------------------------------------------------
    struct ChannelClass
@@ -63,6 +64,16 @@ struct _channel_rec_ {
 };
 typedef struct _channel_rec_ Channel, *ChannelPtr;
 
+/* -------------------------------------------------------------
+   struct ChannelIndex
+   Hash table of the segments of a network keyed on segment id, so
+   that a segment can be found without walking the network list.
+   ------------------------------------------------------------- */
+typedef struct _channel_index_ {
+  unsigned int size;		/* number of slots, a power of 2 */
+  Channel **slot;		/* NULL for empty slots */
+} ChannelIndex;
+
 /* -------------------------------------------------------------
    externally available routines
    ------------------------------------------------------------- */
@@ -76,6 +87,10 @@ Channel *channel_read_network(const char *file, ChannelClass * class_list, int *
 void channel_routing_parameters(Channel *net, int deltat);
 void channel_update_routing_parameters(Channel *network, int deltat, int max_order);
 Channel *channel_find_segment(Channel *net, SegmentID id);
+ChannelIndex *channel_index_create(Channel *net);
+int channel_index_slot(ChannelIndex *index, SegmentID id);
+Channel *channel_index_find(ChannelIndex *index, SegmentID id);
+void channel_index_free(ChannelIndex *index);
 int channel_step_initialize_network(Channel *net);
 int channel_incr_lat_inflow(Channel *segment, float linflow);
 void channel_segment_infil_evap(Channel * segment);
@@ -17,6 +17,7 @@
 #include "constants.h"
 #include "functions.h"
 #include "massenergy.h"
+#include "memtrack.h"
 
 /* -------------------------------------------------------------
    local function prototype
@@ -49,12 +50,19 @@ void channel_grid_init(int cols, int rows)
 static ChannelMapRec *alloc_channel_map_record(void)
 {
   ChannelMapRec *p;
-  if ((p = (ChannelMapRec *) malloc(sizeof(ChannelMapRec))) == NULL) {
+  if ((p = (ChannelMapRec *) TrackMalloc(sizeof(ChannelMapRec), MEM_CHANNEL)) == NULL) {
     error_handler(ERRHDL_FATAL,
 		  "alloc_channel_map_record: %s", strerror(errno));
   }
   p->length = 0.0;
+  p->cut_height = 0.0;
+  p->cut_width = 0.0;
+  p->table_depth = 0.0;
   p->infiltration_rate = 0.0;
+  p->infiltration = 0.0;
+  p->evaporation = 0.0;
+  p->avail_water = 0.0;
+  p->satflow = 0.0;
   p->channel = NULL;
   p->next = NULL;
   p->next_seg = NULL;
@@ -70,12 +78,12 @@ static ChannelMapPtr **channel_grid_create_map(int cols, int rows)
   int row, col;
   ChannelMapPtr *junk;
 
-  if ((map = (ChannelMapPtr **) malloc(cols * sizeof(ChannelMapPtr *))) == NULL) {
+  if ((map = (ChannelMapPtr **) TrackMalloc(cols * sizeof(ChannelMapPtr *), MEM_CHANNEL)) == NULL) {
     error_handler(ERRHDL_FATAL, "channel_grid_create_map: malloc failed: %s",
 		  strerror(errno));
   }
   if ((junk =
-       (ChannelMapPtr *) malloc(rows * cols * sizeof(ChannelMapPtr))) == NULL) {
+       (ChannelMapPtr *) TrackMalloc(rows * cols * sizeof(ChannelMapPtr), MEM_CHANNEL)) == NULL) {
     free(map);
     error_handler(ERRHDL_FATAL,
 		  "channel_grid_create_map: malloc failed: %s",
@@ -135,6 +143,7 @@ ChannelMapPtr **channel_grid_read_map(Channel *net, const char *file,
 				      SOILTABLE *SType, SOILPIX ** SoilMap, VEGTABLE *VType, VEGPIX **VegMap)
 {
   ChannelMapPtr **map;
+  ChannelIndex *index;
   static const int fields = 6;
   static TableField map_fields[6] = {
     {"Column", TABLE_INTEGER, TRUE, FALSE, {0.0}, "", NULL},
@@ -163,6 +172,11 @@ ChannelMapPtr **channel_grid_read_map(Channel *net, const char *file,
     return NULL;
   }
 
+  if ((index = channel_index_create(net)) == NULL) {
+    table_close();
+    return NULL;
+  }
+
   map = channel_grid_create_map(channel_grid_cols, channel_grid_rows);
 
   done = FALSE;
@@ -231,8 +245,8 @@ ChannelMapPtr **channel_grid_read_map(Channel *net, const char *file,
 	switch (i) {
 	case 2:
 	  if ((cell->channel =
-	       channel_find_segment(net,
-				    map_fields[i].value.integer)) == NULL) {
+	       channel_index_find(index,
+				  map_fields[i].value.integer)) == NULL) {
 	    error_handler(ERRHDL_ERROR,
 			  "%s, line %d: unable to locate segment %d", file,
 			  table_lineno(), map_fields[i].value.integer);
@@ -300,6 +314,7 @@ ChannelMapPtr **channel_grid_read_map(Channel *net, const char *file,
 		file, table_errors, table_warnings);
 
   table_close();
+  channel_index_free(index);
 
   error_handler(ERRHDL_STATUS,
 		"channel_grid_read_map: done reading file \"%s\"", file);
@@ -316,42 +331,54 @@ ChannelMapPtr **channel_grid_read_map(Channel *net, const char *file,
 
 /* -------------------------------------------------------------
  channel_combine_map_network
+ Chains the map records of each segment in the order of the
+ ordered cells, from the top of the segment down, in a single pass
+ over the ordered cells.  last holds the position in the ordered
+ cells where each segment was last seen, indexed on the slot of the
+ segment in the network index.
  ------------------------------------------------------------- */
 void channel_combine_map_network(Channel * net, ChannelMapPtr ** map, MAPSIZE * Map)
 {
-  Channel *segment;
+  ChannelIndex *index;
   ChannelMapPtr cell, cell2;
-  int j, k, col, row;
+  int *last;
+  int j, k, n;
   
-  for (segment = net; segment != NULL; segment = segment->next) {
-    /* Check all grid cells to see if they contain the current segment */
-    for (k = (Map->NumCells - 1); k > -1;  k--) {
-      row = Map->OrderedCells[k].y;
-      col = Map->OrderedCells[k].x;
-      cell = map[col][row];
-      while (cell != NULL) {
-        if (cell->channel->id == segment->id){
-          
-          /* Entry point from network to map */
-          if (segment->grid == NULL)
-            segment->grid = cell;
-          
-          /* Find next downstream cell which also matches channel id */
-          for (j = (k - 1); (cell->next_seg == NULL && j > -1);  j--) {
-            row = Map->OrderedCells[j].y;
-            col = Map->OrderedCells[j].x;
-            cell2 = map[col][row];
-            while (cell2 != NULL && cell->next_seg == NULL) {
-              if (cell2->channel->id == segment->id)
-                cell->next_seg = cell2;
-              cell2 = cell2->next;
-            }
-          } /* End of finding downstream cell */
+  if ((index = channel_index_create(net)) == NULL)
+    error_handler(ERRHDL_FATAL, "channel_combine_map_network: invalid network");
+  if ((last = (int *) malloc(index->size * sizeof(int))) == NULL)
+    error_handler(ERRHDL_FATAL, "channel_combine_map_network: malloc failed: %s",
+                  strerror(errno));
+  for (n = 0; n < (int) index->size; n++)
+    last[n] = -1;
+
+  for (k = (Map->NumCells - 1); k > -1;  k--) {
+    cell = map[Map->OrderedCells[k].x][Map->OrderedCells[k].y];
+    for (; cell != NULL; cell = cell->next) {
+      n = channel_index_slot(index, cell->channel->id);
+      if (last[n] == k)
+        continue;
+      
+      if (last[n] < 0) {
+        /* Entry point from network to map */
+        cell->channel->grid = cell;
+      }
+      else {
+        /* This is the next downstream cell of the records of the
+           segment in the cell where it was last seen */
+        j = last[n];
+        cell2 = map[Map->OrderedCells[j].x][Map->OrderedCells[j].y];
+        for (; cell2 != NULL; cell2 = cell2->next) {
+          if (cell2->channel == cell->channel && cell2->next_seg == NULL)
+            cell2->next_seg = cell;
         }
-        cell = cell->next;
       }
+      last[n] = k;
     }
   }
+
+  free(last);
+  channel_index_free(index);
 }
 
 /* -------------------------------------------------------------
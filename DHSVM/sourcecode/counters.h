@@ -0,0 +1,36 @@
+#ifndef COUNTERS_H
+#define COUNTERS_H
+
+#include <stdio.h>
+#include "settings.h"
+#include "data.h"
+#include "DHSVMChannel.h"
+
+/* Events that are counted per pixel and per time step.  The order must
+   match the map variable IDs 901 - 906 in VarID.c */
+enum COUNTER {
+  CNT_BRENTEVAL = 0, /* RootBrent() function evaluations */
+  CNT_BRENTBRACKET,  /* RootBrent() bracket expansions */
+  CNT_SURFACESTEP,   /* Kinematic surface routing sub-steps in which the pixel
+                        carried water */
+  CNT_DTLIMIT,       /* Time steps in which the pixel set the surface routing
+                        sub-step (FindDT()) */
+  CNT_LAYERMATCH,    /* Water table layer-matching iterations in
+                        RouteSubSurface() (GRADIENT = WATERTABLE) */
+  CNT_KCLAMP,        /* Channel storage constants K raised to MINSTORAGEK,
+                        counted at the lowest pixel of the segment */
+  CNT_NCOUNTERS
+};
+
+#define COUNTER_FIRSTID 901
+
+void InitCounters(OPTIONSTRUCT *Options, MAPSIZE *Map, TOPOPIX **TopoMap,
+                  CHANNEL *ChannelData, char *Path);
+void CountEvent(int Counter, int y, int x, unsigned int n);
+void CountSegmentEvent(int Counter, SegmentID id);
+void CountSubSteps(int NSubSteps, int y, int x);
+unsigned int CounterValue(int Counter, int y, int x);
+void CountersEndStep(DATE *Current);
+void CountersReport(FILE *OutFile);
+
+#endif
@@ -30,6 +30,11 @@ typedef struct {
   char FileLabel[BUFSIZE + 1];	/* File label */
   int NumberType;		/* Number type of variable */
   DATE *DumpDate;		/* Date(s) at which to dump */
+  int Aggregation;		/* MAP_SNAPSHOT, or statistic over the window */
+  int Window;			/* Aggregation window */
+  int NSteps;			/* Time steps in the current window */
+  int NWindows;		/* Number of windows written */
+  double *Accum;		/* Statistic over the current window */
 } MAPDUMP;
 
 typedef struct {
@@ -49,6 +54,8 @@ typedef struct {
   DATE *DState;						/* Array with dates on which to dump state */
   int NPix;							/* Number of pixels for which to output timeseries */
   PIXDUMP *Pix;						/* Array with info on pixels for which to output timeseries */
+  int PixBinary;					/* If TRUE, the pixel timeseries are written to one
+                           binary file (see PixelOutput.c) */
   int NMaps;						/* Number of variables for which to output maps */
   MAPDUMP *DMap;					/* Array with info on each map to output */
 } DUMPSTRUCT;
@@ -180,9 +187,36 @@ typedef struct {
                            be recalculated every timestep */
   int MultiFlowDir;     /* TRUE to use multiple flow directions or FALSE for steepest descent;
                            only applicable if ROUTING NEIGHBORS = 8*/
+  int SatFlowSolver;    /* EXPLICIT (downslope sweep) or IMPLICIT (sparse linear
+                           solve) for lateral saturated flow; IMPLICIT requires
+                           GRADIENT = WATERTABLE */
+  float HeadSlopeTol;   /* Change in water level (m) beyond which the subsurface flow
+                           directions of a cell and its neighbors are recalculated
+                           (GRADIENT = WATERTABLE only) */
   int HeatFlux;					/* Specifies whether a sensible heat flux 
                            should be calculated, TRUE or FALSE */
   int Routing;          /* Overland flow routing indicator, either CONVENTIONAL (FALSE) or KINEMATIC (TRUE) */
+  int Profile;          /* FALSE, PROFILE_SUMMARY (time spent per model stage) or
+                           PROFILE_TIMESTEP (summary plus Profile.csv per time step) */
+  int Counters;         /* If TRUE, solver iterations and sub-steps are counted per
+                           pixel and per time step (see Counters.c) */
+  int MemoryReport;     /* If TRUE, the memory forecast and the memory use per
+                           subsystem are printed (see MemTrack.c) */
+  float MemoryLimit;    /* Run is stopped if the forecast memory use exceeds this
+                           many GB, 0.0 for no limit */
+  int Ensemble;         /* If TRUE, the members listed in EnsembleFile are run
+                           in lockstep (see Ensemble.c) */
+  int Forecast;         /* If TRUE, the scenarios listed in ForecastFile are
+                           forked at ForecastStart (see Ensemble.c) */
+  DATE ForecastStart;
+  int Snapshot;         /* If TRUE, the model state is stored in and restored
+                           from a single binary file (see Snapshot.c) */
+  int Bundle;           /* If TRUE, the terrain and the interpolation weights
+                           are kept in BundleFile (see Bundle.c) */
+  int MetPrefetch;      /* Number of time steps of met records read ahead by a
+                           background thread, 0 for none (see MetPrefetch.c) */
+  int ContiguousSoil;   /* If TRUE, the per-layer soil arrays of all pixels are
+                           stored in contiguous blocks (see InitSoilLayers()) */
   int LakeDynamics;		  /* If TRUE, lake dynamics will be simulated using power law storage relationships */
   int UseInterflow;		  /* If TRUE, unsaturated lateral flow is simulated */
   int UseKsatAnisotropy;/* Vertical Ksat from lateral Ksat and anisotropy (TRUE) or default table (FALSE) */
@@ -192,6 +226,8 @@ typedef struct {
   int SnowPattern;		  /* If TRUE, user supplied snow map will be used to redistribute precipitation */
   int CanopyRadAtt;			/* Radiation attenuation through the canopy, either FIXED (old method) or VARIABLE */
   int Shading;					/* if TRUE then terrain shading for solar is on */
+  int StreamShading;		/* if TRUE then only the shade maps of the current
+                           and the next time step are held (ShadeStream.c) */
   int Outside;					/* if TRUE then all listed met stats are used */
   int Rhoverride;				/* if TRUE then RH=100% if Precip>0 */
   int TempLapse;				/* Whether the temperature lapse rate is CONSTANT or VARIABLE */
@@ -206,17 +242,28 @@ typedef struct {
   int DynamicVeg;       /* if TRUE update vegetation maps at user defined dates*/
   int DumpExtraStream;  /* Whether to save extra stream data when dumping model state */
   int SaveExtraStreamData;  /* Whether to save extra file with detailed stream timeseries */
+  int StreamBinary;     /* If TRUE, the streamflow is written to one binary file
+                           instead of Stream.Flow and Streamflow.Only */
+  int StreamDaily;      /* If TRUE, the binary streamflow holds the daily mean
+                           and maximum instead of every time step */
+  int MapCompressed;    /* If TRUE, the maps and state files are written in the
+                           compressed format (see FileIOZip.c) */
   int PointX;					  /* X-index of point to model in POINT mode */
   int PointY;					  /* Y-index of point to model in POINT mode */
   int GW_SPINUP;        /* Whether to spinup groundwater state prior to launching run */
   int GW_SPINUP_YRS;    /* Number of years in groundwater spinup */
   float GW_SPINUP_RECHARGE; /* Yearly groundwater recharge rate during spinup (m/yr) */
+  float GW_SPINUP_TOL;  /* Spinup stops once the max daily water table change is below this (m); 0 = run all years */
+  float GW_SPINUP_RELAX;/* Over-relaxation factor applied to the daily spinup flux (1 = plain iteration) */
   char PrismDataPath[BUFSIZE + 1];
   char PrismDataExt[BUFSIZE + 1];
   char SnowPatternDataPath[BUFSIZE + 1];
   char ShadingDataPath[BUFSIZE + 1];
   char ShadingDataExt[BUFSIZE + 1];
   char SkyViewDataPath[BUFSIZE + 1];
+  char EnsembleFile[BUFSIZE + 1];
+  char ForecastFile[BUFSIZE + 1];
+  char BundleFile[BUFSIZE + 1];
   char ImperviousFilePath[BUFSIZ + 1];
   char PrecipMultiplierMapPath[BUFSIZ + 1];
   char SnowMeltMultiplierMapPath[BUFSIZ + 1];
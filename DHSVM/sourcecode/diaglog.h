@@ -0,0 +1,20 @@
+#ifndef DIAGLOG_H
+#define DIAGLOG_H
+
+#include "settings.h"
+#include "data.h"
+
+/* Scalar diagnostics that are written every time step, each to its own
+   file in the output directory.  The order must match the table in
+   DiagLog.c */
+enum DIAGLOG {
+  DIAG_SATEXTENT = 0,  /* Percentage of the basin with a water table within
+                          (1 - MTHRESH) of the soil depth of the surface
+                          (saturation_extent.txt) */
+  DIAG_NLOGS
+};
+
+void InitDiagLogs(char *Path);
+void DiagLog(int Log, DATE *Current, float Value);
+
+#endif
@@ -0,0 +1,22 @@
+#ifndef ENSEMBLE_H
+#define ENSEMBLE_H
+
+#include "settings.h"
+#include "data.h"
+#include "getinit.h"
+
+/* Number of time steps of met records the reading process may be ahead of
+   the slowest ensemble member */
+#define ENSEMBLE_RING 64
+
+void RunEnsemble(LISTPTR Input, OPTIONSTRUCT *Options, MAPSIZE *Map,
+                 TIMESTRUCT *Time, LAYER *Veg, VEGTABLE *VType,
+                 int NSoilLayers, int NStats, METLOCATION *Stat);
+void RunForecast(LISTPTR Input, OPTIONSTRUCT *Options, int NStats,
+                 METLOCATION *Stat);
+int EnsembleMetRecords(OPTIONSTRUCT *Options, int NSoilLayers, int NStats,
+                       METLOCATION *Stat);
+int EnsembleShadeMap(int Month, int NDaySteps, MAPSIZE *Map,
+                     unsigned char ***ShadowMap);
+
+#endif
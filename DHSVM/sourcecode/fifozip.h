@@ -0,0 +1,60 @@
+#ifndef FIFOZIP_H
+#define FIFOZIP_H
+
+#include <stdio.h>
+
+#define MAPZ_MAGIC   "DHSVMMPZ"
+#define MAPZ_VERSION 1
+#define MAPZ_TILE    64        /* Tiles are MAPZ_TILE x MAPZ_TILE cells */
+#define MAPZ_BLOCK   511       /* Entries per index block */
+
+/* A compressed map file (see FileIOZip.c) starts with this header.  The
+   matrices (slices) follow in the order in which they were written, with
+   the index blocks between them.  Index block i holds the offsets of
+   slices i * MAPZ_BLOCK to (i + 1) * MAPZ_BLOCK - 1 and the offset of
+   index block i + 1.  Numbers are stored in the byte order of the
+   machine. */
+typedef struct {
+  char Magic[8];        /* MAPZ_MAGIC, without the terminating 0 */
+  int Version;          /* MAPZ_VERSION */
+  int NY;               /* Number of rows */
+  int NX;               /* Number of columns */
+  int Tile;             /* MAPZ_TILE */
+  int NSlices;          /* Number of matrices in the file */
+  int Reserved;
+  long long FirstBlock; /* Offset of the first index block, 0 if none */
+  long long LastBlock;  /* Offset of the last index block, 0 if none */
+} MAPZHEADER;
+
+typedef struct {
+  long long Next;               /* Offset of the next block, 0 if none */
+  long long Slice[MAPZ_BLOCK];  /* Offsets of the slices */
+} MAPZBLOCK;
+
+/* A slice is this header followed by Size bytes with the tiles, row by row
+   of tiles.  Each tile is a mode byte: MAPZ_CONSTANT followed by one
+   element, MAPZ_PACKED followed by the packed length (int) and the
+   packed bytes, or MAPZ_RAW followed by the elements.  A packed tile holds
+   the elements xor-ed with the element before them in the tile, split in
+   planes of the first, second, ... byte of every element, and run-length
+   coded as in PackBits. */
+typedef struct {
+  int NumberType;       /* Number type of the matrix */
+  int Size;             /* Bytes of tile data */
+} MAPZSLICE;
+
+enum MAPZMODE {
+  MAPZ_CONSTANT = 0, MAPZ_PACKED, MAPZ_RAW
+};
+
+void CreateMapFileZip(char *FileName, ...);
+int Read2DMatrixZip(char *FileName, void *Matrix, int NumberType, int NY,
+		    int NX, int NDataSet, ...);
+int Write2DMatrixZip(char *FileName, void *Matrix, int NumberType, int NY,
+		     int NX, ...);
+int IsMapFileZip(FILE *InFile);
+void ReadMapHeaderZip(FILE *InFile, char *FileName, MAPZHEADER *Header);
+int ReadMapSliceZip(FILE *InFile, char *FileName, MAPZHEADER *Header,
+		    int NDataSet, int NumberType, void *Matrix);
+
+#endif
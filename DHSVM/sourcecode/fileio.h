@@ -4,7 +4,7 @@
 
 #include "data.h"
 
-void InitFileIO(void);
+void InitFileIO(OPTIONSTRUCT *Options);
 
 /* global file extension string */
 extern char fileext[];
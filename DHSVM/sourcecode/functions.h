@@ -59,11 +59,12 @@ void DumpPix(DATE *Current, int first, FILES *OutFile, EVAPPIX *Evap,
 void DumpTopo(MAPSIZE *Map, TOPOPIX **TopoMap);
 #endif
 
-void ExecDump(MAPSIZE *Map, DATE *Current, DATE *Start, OPTIONSTRUCT *Options,
+void ExecDump(MAPSIZE *Map, TIMESTRUCT *Time, OPTIONSTRUCT *Options,
 	      DUMPSTRUCT *Dump, TOPOPIX **TopoMap, EVAPPIX **EvapMap, PIXRAD **RadiMap,
 	      PRECIPPIX ** PrecipMap, SNOWPIX **SnowMap, 
           VEGPIX **VegMap, LAYER *Veg, SOILPIX **SoilMap, NETSTRUCT **Network, 
-          CHANNEL *ChannelData, LAYER *Soil, AGGREGATED *Total);
+          CHANNEL *ChannelData, LAYER *Soil, AGGREGATED *Total,
+          LAKETABLE *LType, WATERBALANCE *Mass);
 
 unsigned char fequal(float a, float b);
 
@@ -172,6 +173,9 @@ void InitPrismMap(int NY, int NX, float ***PrismMap);
 void InitSnowPatternMap(float ***SnowPatternMap, float ***SnowPatternMapBase,
                         MAPSIZE *Map, OPTIONSTRUCT *Options);
 
+void ReadShadeMap(OPTIONSTRUCT *Options, MAPSIZE *Map, int Month, int NDaySteps,
+  unsigned char ***ShadowMap);
+
 void InitShadeMap(OPTIONSTRUCT *Options, int NDaySteps, MAPSIZE *Map,
 		  unsigned char ****ShadowMap, float ***SkyViewMap);
 
@@ -188,6 +192,9 @@ void InitSoilMap(LISTPTR Input, OPTIONSTRUCT *Options, MAPSIZE *Map,
 		 LAYER *Soil, TOPOPIX **TopoMap, SOILPIX ***SoilMap, SOILTABLE * SType,
 		 VEGPIX *** VegMap, VEGTABLE * VType);
 
+void InitSoilLayers(OPTIONSTRUCT *Options, MAPSIZE *Map, LAYER *Soil,
+                    TOPOPIX **TopoMap, SOILPIX **SoilMap);
+
 int InitSoilTable(OPTIONSTRUCT *Options, SOILTABLE **SType, 
 			LISTPTR Input, LAYER *Soil, int InfiltOption, TIMESTRUCT *Time);
 
@@ -244,6 +251,8 @@ void MassEnergyBalance(OPTIONSTRUCT *Options, int y, int x, float SineSolarAltit
             CHANNEL *ChannelData, float **skyview,
             SOILPIX *LocalSoilDownhill, VEGTABLE *VTypeDownhill, NETSTRUCT *LocalNetworkDownhill, TOPOPIX *LocalTopo);
 
+int MetRecordSize(OPTIONSTRUCT *Options, int NSoilLayers);
+
 double pow (double a, double b);
 
 void quick(ITEM *OrderedCells, int count);
@@ -268,14 +277,18 @@ void RouteSubSurface(int Dt, MAPSIZE *Map, TOPOPIX **TopoMap,
 		     VEGTABLE *VType, VEGPIX **VegMap,
 		     NETSTRUCT **Network, SOILTABLE *SType,
 		     SOILPIX **SoilMap, CHANNEL *ChannelData, 
-		     TIMESTRUCT *Time, OPTIONSTRUCT *Options, 
-		     char *DumpPath);
+		     TIMESTRUCT *Time, OPTIONSTRUCT *Options);
 
-void RouteSubSurfaceSpinup(int Dt, MAPSIZE *Map, TOPOPIX **TopoMap,
-                           VEGTABLE *VType, VEGPIX **VegMap,
-                           NETSTRUCT **Network, SOILTABLE *SType,
-                           SOILPIX **SoilMap, OPTIONSTRUCT *Options,
-                           float **SubFlowGrad, unsigned char ***SubDir, unsigned int **SubTotalDir);
+float RouteSubSurfaceSpinup(int Dt, MAPSIZE *Map, TOPOPIX **TopoMap,
+                            VEGTABLE *VType, VEGPIX **VegMap,
+                            NETSTRUCT **Network, SOILTABLE *SType,
+                            SOILPIX **SoilMap, OPTIONSTRUCT *Options,
+                            float **SubFlowGrad, unsigned char ***SubDir, unsigned int **SubTotalDir,
+                            float Relax);
+
+void RouteSubSurfaceImplicit(int Dt, MAPSIZE *Map, TOPOPIX **TopoMap,
+                             SOILPIX **SoilMap, float *Transmissivity,
+                             float *SpecificYield, float *AvailableWater);
 
 void RouteSurface(MAPSIZE * Map, TIMESTRUCT * Time, TOPOPIX ** TopoMap,
   SOILPIX ** SoilMap, OPTIONSTRUCT *Options,
@@ -290,8 +303,14 @@ int ScanDoubles(FILE *FilePtr, double *X, int N);
 
 int ScanFloats(FILE *FilePtr, float *X, int N);
 
+int ScanMetRecord(OPTIONSTRUCT *Options, DATE *Current, int NSoilLayers,
+		  FILES *InFile, float *Array);
+
 uchar ScanUChars(FILE *FilePtr, uchar *X, int N);
 
+void SetMetRecord(OPTIONSTRUCT *Options, int NSoilLayers, char *FileName,
+		  float *Array, MET *MetRecord);
+
 void SkipHeader(FILES *InFile, int NLines);
 
 void SkipLines(FILES *InFile, int NLines);
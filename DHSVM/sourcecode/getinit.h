@@ -27,10 +27,13 @@ typedef struct _INTINIENTRY {
 } INTINIENTRY;
 
 typedef struct _INPUTSTRUCT *LISTPTR;
+typedef struct _INITINDEX INITINDEX;
 
 typedef struct _INPUTSTRUCT {
   char Str[BUFSIZE + 1];
   LISTPTR Next;
+  INITINDEX *Index;             /* Section/key index of the list, only set
+                                   in the first node (see ReadInitFile) */
 } INPUTSTRUCT;
 
 typedef struct _DBLINIENTRY {
@@ -73,6 +76,9 @@ unsigned long GetInitString(const char *Section, const char *Key,
 
 int IsEmptyStr(char *Str);
 
+unsigned char ReplaceInitString(const char *Section, const char *Key,
+				const char *Entry, LISTPTR Input);
+
 unsigned char IsKeyEntryPair(char *Buffer);
 
 unsigned char IsSection(char *Buffer);
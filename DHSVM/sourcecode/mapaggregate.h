@@ -0,0 +1,19 @@
+#ifndef MAPAGGREGATE_H
+#define MAPAGGREGATE_H
+
+#include "settings.h"
+#include "data.h"
+
+/* A map variable with [OUTPUT] MAP AGGREGATION i other than NONE is
+   collected every time step and written once per window (see MAP WINDOW i)
+   to Map.<Name>.<Statistic>.<Window>.bin as NC_FLOAT, instead of at the
+   dates given by MAP DATE j i */
+
+void InitMapAggregate(MAPSIZE *Map, MAPDUMP *DMap);
+void FreeMapAggregate(MAPDUMP *DMap);
+int StoreMap(char *FileName, void *Matrix, int NumberType, MAPSIZE *Map,
+	     MAPDUMP *DMap, int Index);
+uchar IsMapWindowEnd(TIMESTRUCT *Time, int Window);
+void WriteMapAggregate(MAPSIZE *Map, MAPDUMP *DMap);
+
+#endif
@@ -0,0 +1,36 @@
+#ifndef MEMTRACK_H
+#define MEMTRACK_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include "settings.h"
+#include "data.h"
+#include "getinit.h"
+
+/* Subsystems to which allocated memory is attributed */
+enum MEMSUBSYSTEM {
+  MEM_TERRAIN = 0,   /* TopoMap and the routing order of the cells */
+  MEM_SOIL,          /* SoilMap and its per-layer arrays */
+  MEM_VEG,           /* VegMap and its per-layer arrays */
+  MEM_CANOPYGAP,     /* Canopy gap structures of VegMap */
+  MEM_SNOW,          /* SnowMap */
+  MEM_EVAP,          /* EvapMap and its per-layer arrays */
+  MEM_PRECIP,        /* PrecipMap and its per-layer arrays */
+  MEM_RADIATION,     /* RadiationMap */
+  MEM_SHADING,       /* ShadowMap and SkyViewMap */
+  MEM_METMAPS,       /* PRISM, snow pattern and multiplier maps */
+  MEM_METWEIGHTS,    /* Met station interpolation weights */
+  MEM_NETWORK,       /* Network (storage adjustment) */
+  MEM_ROUTING,       /* Subsurface flow directions kept between time steps */
+  MEM_CHANNEL,       /* Channel classes, segments and map records */
+  MEM_DIAGNOSTICS,   /* Counters */
+  MEM_NSUBSYSTEMS
+};
+
+void *TrackCalloc(size_t NElements, size_t Size, int Subsystem);
+void *TrackMalloc(size_t Size, int Subsystem);
+void MemoryForecast(LISTPTR Input, OPTIONSTRUCT *Options, MAPSIZE *Map,
+                    LAYER *Soil, LAYER *Veg, int NDaySteps);
+void MemoryReport(FILE *OutFile, const char *When);
+
+#endif
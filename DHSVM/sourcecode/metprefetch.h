@@ -0,0 +1,10 @@
+#ifndef METPREFETCH_H
+#define METPREFETCH_H
+
+#include "settings.h"
+#include "data.h"
+
+int PrefetchMetRecords(OPTIONSTRUCT *Options, TIMESTRUCT *Time,
+                       int NSoilLayers, int NStats, METLOCATION *Stat);
+
+#endif
@@ -0,0 +1,53 @@
+#ifndef PIXELOUTPUT_H
+#define PIXELOUTPUT_H
+
+#include <stdio.h>
+#include "settings.h"
+#include "data.h"
+
+#define PIXFILE_NAME    "Pixel.Values.bin"
+#define PIXFILE_MAGIC   "DHSVMPIX"
+#define PIXFILE_VERSION 2
+
+/* Columns of a pixel time series (see GetPixValues()) */
+typedef struct {
+  int NSoil;            /* Number of soil layers */
+  int NCanopyStory;     /* Number of vegetation layers */
+  int HeatFlux;         /* If TRUE, the surface temperature is included */
+  int Gap;              /* If TRUE, the canopy gap energy balance is included */
+  int DynamicInfilt;    /* If TRUE, the accumulated infiltration is included */
+  int GapRad;           /* If TRUE, the gap radiation is included */
+} PIXLAYOUT;
+
+/* The binary pixel file starts with this header, followed by a PIXFILEPIXEL
+   for every pixel and a record for every time step: the date (6 ints: year,
+   month, day, hour, minute, second), the PIXLAYOUT of every pixel at that
+   time step and Width floats for every pixel.  The layout of a pixel can
+   change during the run (DYNAMIC VEGETATION); the PIXFILEPIXEL holds the
+   layout of the first time step, which gives the columns of the header */
+typedef struct {
+  char Magic[8];        /* PIXFILE_MAGIC, without the terminating 0 */
+  int Version;          /* PIXFILE_VERSION */
+  int NPix;             /* Number of pixels */
+  int Width;            /* Floats per pixel per time step */
+} PIXFILEHEADER;
+
+typedef struct {
+  char FileName[BUFSIZE + 1];   /* Name of the text file of the pixel */
+  PIXLAYOUT Layout;
+} PIXFILEPIXEL;
+
+void GetPixLayout(PIXLAYOUT *Layout, int NSoil, int NCanopyStory, VEGPIX *Veg,
+                  OPTIONSTRUCT *Options, int flag);
+void GetPixValues(int first, EVAPPIX *Evap, PRECIPPIX *Precip, PIXRAD *Rad,
+                  SNOWPIX *Snow, SOILPIX *Soil, VEGPIX *Veg, PIXLAYOUT *Layout,
+                  float *Values);
+int PixLayoutSize(PIXLAYOUT *Layout);
+void PrintPixHeader(FILE *OutFile, PIXLAYOUT *Layout);
+void PrintPixValues(FILE *OutFile, DATE *Current, PIXLAYOUT *Layout,
+                    float *Values);
+void InitPixBinary(char *Path, int NPix, PIXDUMP *Pix, PIXLAYOUT *MaxLayout);
+float *PixBinarySlot(int Pixel, PIXLAYOUT *Layout);
+void WritePixBinary(DATE *Current);
+
+#endif
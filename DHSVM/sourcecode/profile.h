@@ -0,0 +1,33 @@
+
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <stdio.h>
+#include "settings.h"
+#include "data.h"
+
+/* Stages of the model run that are timed separately */
+enum PROFILESTAGE {
+  PROF_INIT = 0,     /* Initialization, before the first time step */
+  PROF_NEWPERIOD,    /* InitNewWaterYear, InitNewMonth, InitNewDay */
+  PROF_NEWSTEP,      /* InitNewStep, including reading met data */
+  PROF_PIXELS,       /* MakeLocalMetData and MassEnergyBalance of all cells */
+  PROF_SUBSURFACE,   /* RouteSubSurface */
+  PROF_CHANNEL,      /* RouteChannel */
+  PROF_SURFACE,      /* RouteSurface */
+  PROF_AGGREGATE,    /* Aggregate */
+  PROF_MASSBALANCE,  /* MassBalance */
+  PROF_OUTPUT,       /* ExecDump, excluding model state */
+  PROF_STATE,        /* Model and channel state dumps */
+  PROF_OTHER,        /* Everything else in the time loop */
+  PROF_NSTAGES
+};
+
+double WallClock(void);
+void InitProfile(OPTIONSTRUCT *Options, char *Path, double StartTime);
+void ProfileStart(int Stage);
+void ProfileStop(int Stage);
+void ProfileEndStep(DATE *Current);
+void ProfileReport(FILE *OutFile);
+
+#endif
@@ -40,6 +40,14 @@ typedef unsigned int unint;
 #define TOPOGRAPHY     1
 #define WATERTABLE     2
 
+/* Options for run-time profiling */
+#define PROFILE_SUMMARY  1
+#define PROFILE_TIMESTEP 2
+
+/* Options for saturated subsurface flow solver */
+#define EXPLICIT       1
+#define IMPLICIT       2
+
 /* Options for meterological interpolation */
 #define INVDIST        1
 #define NEAREST        2
@@ -80,6 +88,16 @@ typedef unsigned int unint;
 
 #define MAP_OUTPUT 1
 
+/* Statistic written for a map variable ([OUTPUT] MAP AGGREGATION) */
+enum MAPAGGREGATION {
+  MAP_SNAPSHOT = 0, MAP_MEAN, MAP_MIN, MAP_MAX, MAP_SUM
+};
+
+/* Window over which a map variable is aggregated ([OUTPUT] MAP WINDOW) */
+enum MAPWINDOW {
+  MAP_DAILY = 0, MAP_MONTHLY, MAP_WATERYEAR
+};
+
 #define MIN_SWE 0.005
 #define MELTOUT_SWE 0.05
 
@@ -91,15 +109,20 @@ enum CanopyType {
 
 enum KEYS {
 /* Options *//* list order must match order in InitConstants.c */
-  extent = 0, gradient, routing_neighbors, routing_mfd,
+  extent = 0, gradient, routing_neighbors, routing_mfd, sat_solver,
+  head_slope_tol, contiguous_soil, profile, counters,
+  memory_report, memory_limit, ensemble_file, forecast_file, forecast_start,
+  state_snapshot, basin_bundle, met_prefetch,
   sensible_heat_flux, routing, lakedyna, interflow, vertksatsource, infiltration,
   interpolation, max_interp_dist, prism, snowpattern,
   canopy_radatt, shading, outside, rhoverride, 
   temp_lapse, cressman_radius, cressman_stations,
   prism_data_path, prism_data_ext, snowpattern_data_path,
-  shading_data_path, shading_data_ext, skyview_data_path, 
+  shading_data_path, shading_data_ext, skyview_data_path, stream_shading,
   improv_radiation, gapping, snowslide, sepr, 
-  snowstats, dynaveg, streamdata, streamtime, gw_spinup, gw_spinup_yrs, gw_spinup_recharge,
+  snowstats, dynaveg, streamdata, streamtime, streamflow_format,
+  streamflow_aggregation, map_format, gw_spinup, gw_spinup_yrs, gw_spinup_recharge,
+  gw_spinup_tol, gw_spinup_relax,
   /* Area */
   coordinate_system, extreme_north, extreme_west, center_latitude,
   center_longitude, time_zone_meridian, number_of_rows,
@@ -147,13 +170,13 @@ enum KEYS {
   stream_network = 0, stream_map, stream_class,
   /* number of each type of output */
   output_path =
-    0, initial_state_path, npixels, nstates, nmapvars,
+    0, initial_state_path, npixels, nstates, nmapvars, pixel_format,
   /* pixel information */
   north = 0, east, name,
   /* state information */
   state_date = 0,
   /* map information */
-  map_variable = 0, map_layer, nmaps, map_date
+  map_variable = 0, map_layer, map_aggregation, map_window, nmaps, map_date
 };
 
 #endif
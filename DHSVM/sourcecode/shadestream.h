@@ -0,0 +1,11 @@
+#ifndef SHADESTREAM_H
+#define SHADESTREAM_H
+
+#include "settings.h"
+#include "data.h"
+
+void InitShadeStream(int NDaySteps, MAPSIZE *Map, unsigned char ****ShadowMap);
+void ShadeStreamStep(OPTIONSTRUCT *Options, MAPSIZE *Map, TIMESTRUCT *Time,
+                     unsigned char ***ShadowMap);
+
+#endif
@@ -20,6 +20,8 @@ void HeadSlopeAspect(MAPSIZE * Map, TOPOPIX ** TopoMap, SOILPIX ** SoilMap,
 void SnowSlopeAspect(MAPSIZE * Map, TOPOPIX ** TopoMap, SNOWPIX ** Snow,
   float **FlowGrad, unsigned char ***Dir, unsigned int **TotalDir, int MultiFlowDir);
 int valid_cell(MAPSIZE * Map, int x, int y);
+void OrderFlowDirections(MAPSIZE * Map, unsigned char *Dir, int x, int y,
+  unsigned char *Order, unsigned char *NFlow);
 void quick(ITEM *OrderedCells, int count);
 #endif
 
@@ -0,0 +1,57 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include "settings.h"
+#include "data.h"
+#include "DHSVMChannel.h"
+
+#define SNAPSHOT_MAGIC "DHSVMSNP"
+#define SNAPSHOT_VERSION 1
+
+/* The snapshot file starts with this header (see Snapshot.c) */
+typedef struct {
+  char Magic[8];          /* SNAPSHOT_MAGIC, without the terminating 0 */
+  int Version;            /* SNAPSHOT_VERSION */
+  int NX;                 /* Number of columns of the model grid */
+  int NY;                 /* Number of rows of the model grid */
+  int NCells;             /* Number of pixels in the basin */
+  int NMaps;              /* Number of state maps */
+  int NSegments;          /* Number of channel segments */
+  int NLakes;             /* Number of lakes */
+  DATE Now;               /* Time at which the state was stored */
+  WATERBALANCE Mass;      /* Mass balance accumulators at that time */
+  long MapOffset;         /* Offsets (bytes) of the map, channel and lake */
+  long SegmentOffset;     /* sections from the start of the file */
+  long LakeOffset;
+} SNAPSHOTHEADER;
+
+/* Each state map is a SNAPSHOTMAP followed by NCells floats */
+typedef struct {
+  int ID;                 /* Variable ID (see VarID.c) */
+  int Layer;              /* Layer of the variable */
+} SNAPSHOTMAP;
+
+typedef struct {
+  unsigned int id;        /* Channel segment ID */
+  float storage;          /* Segment storage (m3) */
+} SNAPSHOTSEGMENT;
+
+void StoreModelSnapshot(char *Path, DATE *Current, MAPSIZE *Map,
+                        OPTIONSTRUCT *Options, TOPOPIX **TopoMap,
+                        PRECIPPIX **PrecipMap, SNOWPIX **SnowMap,
+                        VEGPIX **VegMap, LAYER *Veg, SOILPIX **SoilMap,
+                        LAYER *Soil, NETSTRUCT **Network,
+                        CHANNEL *ChannelData, LAKETABLE *LType,
+                        WATERBALANCE *Mass);
+int OpenModelSnapshot(char *Path, DATE *Now, MAPSIZE *Map, TOPOPIX **TopoMap);
+void ReadSnapshotChannel(Channel *Head);
+void ReadSnapshotLakes(LAKETABLE *LType, int NumLakes);
+void ReadSnapshotMass(WATERBALANCE *Mass);
+void CloseModelSnapshot(void);
+
+void CreateStateFile(char *FileName, char *FileLabel, MAPSIZE *Map);
+void WriteStateMap(char *FileName, void *Array, MAPDUMP *DMap, MAPSIZE *Map);
+void ReadStateMap(char *FileName, void *Array, MAPDUMP *DMap, MAPSIZE *Map,
+                  int NSet);
+
+#endif
@@ -0,0 +1,39 @@
+#ifndef STREAMOUTPUT_H
+#define STREAMOUTPUT_H
+
+#include <stdio.h>
+#include "settings.h"
+#include "data.h"
+#include "channel.h"
+
+#define STREAMFILE_NAME    "Stream.Values.bin"
+#define STREAMFILE_MAGIC   "DHSVMSTR"
+#define STREAMFILE_VERSION 1
+#define STREAMFILE_NVARS   4  /* Inflow, outflow, storage, lateral inflow */
+
+/* The binary streamflow file starts with this header, followed by a
+   STREAMFILESEGMENT for every recorded segment and a record for every time
+   step (or day with STREAMFLOW AGGREGATION = DAILY): the date (6 ints:
+   year, month, day, hour, minute, second), the number of model time steps
+   in the record (int) and NStats x NVars vectors of NSegments floats.  The
+   vectors are the inflow, outflow, storage and lateral inflow (m3 per time
+   step, storage in m3), first the mean and then, if NStats is 2, the
+   maximum over the record */
+typedef struct {
+  char Magic[8];        /* STREAMFILE_MAGIC, without the terminating 0 */
+  int Version;          /* STREAMFILE_VERSION */
+  int NSegments;        /* Number of recorded segments */
+  int NVars;            /* STREAMFILE_NVARS */
+  int NStats;           /* 1 (every time step) or 2 (daily mean and maximum) */
+  int Interval;         /* Seconds per record */
+} STREAMFILEHEADER;
+
+typedef struct {
+  SegmentID ID;                 /* Segment id */
+  char Name[NAMESIZE + 1];      /* Record name, empty if the segment has none */
+} STREAMFILESEGMENT;
+
+void InitStreamBinary(char *Path, Channel *Net, int Daily);
+void WriteStreamBinary(TIMESTRUCT *Time);
+
+#endif